@@ -0,0 +1,300 @@
+/*
+ * LifeBand Alert Channel
+ * Immediate, acknowledged delivery of critical events on their own characteristic
+ *
+ * Arrhythmia, anemia, preeclampsia and severe-BP alerts only reached the
+ * phone as flags in the next vitals frame: up to SEND_INTERVAL_MS after
+ * detection, and not at all while streaming was off or the link was down.
+ * Alerts now go out on the ALERT characteristic as soon as the transport
+ * stage sees them, and each one is repeated until the phone acknowledges
+ * its sequence number:
+ *
+ *   inference  AlertEvent -> alert queue -> transport accept(), poll()
+ *   BLE task   ack write  -> acknowledge() (SPSC ring) -> poll()
+ *
+ * An unacknowledged alert is resent after ALERT_RETRY_MS, doubling up to
+ * ALERT_RETRY_MAX_MS, and immediately after a reconnect (resendAll()).
+ * Alerts are only dropped when more than ALERT_PENDING are outstanding;
+ * the oldest goes first and is counted.
+ *
+ * Alert frame, little-endian:
+ *   header  [0] magic 'A' (0x41)  [1] version
+ *           [2] payload length    [3] flags: bit0 retransmission
+ *   payload  0 u16 sequence         8 u8  bp_sys
+ *            2 u8  AlertType        9 u8  bp_dia
+ *            3 u8  AlertSeverity   10 u32 timestamp_ms (millis() at detection)
+ *            4 u8  value (RhythmType / RiskLevel)
+ *            5 u8  confidence      14 u32 age_ms (detection -> this send)
+ *            6 u8  hr
+ *            7 u8  spo2
+ * Acknowledgement (phone -> ALERT write): u16 sequence.
+ *
+ * Detection-to-notify latency is measured from the event's micros() stamp,
+ * taken by the detector. Single owner (transport stage) apart from acknowledge(); no
+ * Arduino dependency.
+ */
+
+#ifndef ALERT_CHANNEL_H
+#define ALERT_CHANNEL_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+#include "spsc_ring.h"
+#include "vitals_frame.h"
+
+#define ALERT_MAGIC 0x41
+#define ALERT_VERSION 1
+#define ALERT_HEADER 4
+#define ALERT_PAYLOAD 18
+#define ALERT_FRAME_SIZE (ALERT_HEADER + ALERT_PAYLOAD)
+#define ALERT_FLAG_RETRANSMIT 0x01
+
+#define ALERT_PENDING 8                 // unacknowledged alerts kept
+#define ALERT_ACK_QUEUE 8               // power of two
+#define ALERT_RETRY_MS 1000             // first retransmission
+#define ALERT_RETRY_MAX_MS 8000         // backoff ceiling
+
+enum AlertType : uint8_t {
+  ALERT_ARRHYTHMIA = 1,
+  ALERT_ANEMIA = 2,
+  ALERT_PREECLAMPSIA = 3,
+  ALERT_SEVERE_BP = 4
+};
+
+enum AlertSeverity : uint8_t {
+  ALERT_WARNING = 1,
+  ALERT_CRITICAL = 2
+};
+
+struct AlertEvent {
+  uint8_t type;             // AlertType
+  uint8_t severity;         // AlertSeverity
+  uint8_t value;            // RhythmType or RiskLevel
+  uint8_t confidence;       // 0-100
+  uint8_t hr;
+  uint8_t spo2;
+  uint8_t bp_sys;
+  uint8_t bp_dia;
+  uint32_t time_ms;         // millis() at detection
+  uint32_t detect_us;       // micros() at detection
+};
+
+struct AlertLatency {
+  uint32_t last_us;
+  uint32_t max_us;
+  uint32_t mean_us;
+};
+
+struct AlertStats {
+  uint32_t raised;          // alerts accepted
+  uint32_t sent;            // notifications, first sends and retransmissions
+  uint32_t retransmits;
+  uint32_t acked;
+  uint32_t stray_acks;      // unknown or repeated sequence numbers
+  uint32_t evicted;         // dropped unacknowledged (too many pending)
+  AlertLatency notify;      // detection -> first notify
+  AlertLatency ack;         // first notify -> acknowledgement
+};
+
+class AlertChannel {
+private:
+  struct Pending {
+    AlertEvent event;
+    uint16_t seq;
+    bool used;
+    bool sent;
+    uint32_t first_sent_us;
+    uint32_t next_ms;       // due time of the next (re)send
+    uint32_t backoff_ms;
+  };
+
+  Pending pending[ALERT_PENDING];
+  SpscRing<uint16_t, ALERT_ACK_QUEUE> acks;
+  uint16_t next_seq;
+
+  AlertStats stats;
+  uint64_t notify_sum;
+  uint64_t ack_sum;
+
+  static void record(AlertLatency& lat, uint64_t& sum, uint32_t count, uint32_t us) {
+    lat.last_us = us;
+    if (us > lat.max_us) {
+      lat.max_us = us;
+    }
+    sum += us;
+    lat.mean_us = (uint32_t)(sum / count);
+  }
+
+  void drainAcks(uint32_t now_us) {
+    uint16_t seq;
+    while (acks.pop(seq)) {
+      bool found = false;
+      for (uint8_t i = 0; i < ALERT_PENDING; i++) {
+        Pending& p = pending[i];
+        if (p.used && p.seq == seq) {
+          if (p.sent) {
+            stats.acked++;
+            record(stats.ack, ack_sum, stats.acked, now_us - p.first_sent_us);
+          }
+          p.used = false;
+          found = true;
+          break;
+        }
+      }
+      if (!found) {
+        stats.stray_acks++;
+      }
+    }
+  }
+
+public:
+  AlertChannel() :
+    next_seq(1),
+    notify_sum(0),
+    ack_sum(0) {
+    memset(pending, 0, sizeof(pending));
+    memset(&stats, 0, sizeof(stats));
+  }
+
+  /**
+   * Queue an alert for sending (transport stage)
+   * @return sequence number assigned
+   */
+  uint16_t accept(const AlertEvent& event, uint32_t now_ms) {
+    Pending* slot = nullptr;
+    for (uint8_t i = 0; i < ALERT_PENDING && !slot; i++) {
+      if (!pending[i].used) slot = &pending[i];
+    }
+    if (!slot) {
+      slot = &pending[0];                       // evict the oldest
+      for (uint8_t i = 1; i < ALERT_PENDING; i++) {
+        if ((int16_t)(pending[i].seq - slot->seq) < 0) slot = &pending[i];
+      }
+      stats.evicted++;
+    }
+    slot->event = event;
+    slot->seq = next_seq++;
+    if (next_seq == 0) next_seq = 1;            // 0 is never used
+    slot->used = true;
+    slot->sent = false;
+    slot->next_ms = now_ms;
+    slot->backoff_ms = ALERT_RETRY_MS;
+    stats.raised++;
+    return slot->seq;
+  }
+
+  /**
+   * Phone acknowledged an alert (BLE task)
+   * @return false if the ack queue is full (the alert is resent and acked again)
+   */
+  bool acknowledge(uint16_t seq) {
+    return acks.push(seq);
+  }
+
+  /**
+   * Encode the oldest alert that is due, and schedule its retransmission
+   * (transport stage; call until it returns 0)
+   * @param buf: at least ALERT_FRAME_SIZE bytes
+   * @return bytes to notify, 0 if nothing is due
+   */
+  size_t poll(uint32_t now_ms, uint32_t now_us, uint8_t* buf, size_t capacity) {
+    drainAcks(now_us);
+    if (capacity < ALERT_FRAME_SIZE) {
+      return 0;
+    }
+    Pending* due = nullptr;
+    for (uint8_t i = 0; i < ALERT_PENDING; i++) {
+      Pending& p = pending[i];
+      if (!p.used || (int32_t)(now_ms - p.next_ms) < 0) continue;
+      if (!due || (int16_t)(p.seq - due->seq) < 0) due = &p;
+    }
+    if (!due) {
+      return 0;
+    }
+
+    const AlertEvent& e = due->event;
+    buf[0] = ALERT_MAGIC;
+    buf[1] = ALERT_VERSION;
+    buf[2] = ALERT_PAYLOAD;
+    buf[3] = due->sent ? ALERT_FLAG_RETRANSMIT : 0;
+    uint8_t* p = buf + ALERT_HEADER;
+    vitalsPut16(p + 0, due->seq);
+    p[2] = e.type;
+    p[3] = e.severity;
+    p[4] = e.value;
+    p[5] = e.confidence;
+    p[6] = e.hr;
+    p[7] = e.spo2;
+    p[8] = e.bp_sys;
+    p[9] = e.bp_dia;
+    vitalsPut32(p + 10, e.time_ms);
+    vitalsPut32(p + 14, now_ms - e.time_ms);
+
+    stats.sent++;
+    if (due->sent) {
+      stats.retransmits++;
+    } else {
+      due->sent = true;
+      due->first_sent_us = now_us;
+      uint32_t sent_count = stats.sent - stats.retransmits;
+      record(stats.notify, notify_sum, sent_count, now_us - e.detect_us);
+    }
+    due->next_ms = now_ms + due->backoff_ms;
+    due->backoff_ms = due->backoff_ms * 2 > ALERT_RETRY_MAX_MS ? ALERT_RETRY_MAX_MS : due->backoff_ms * 2;
+    return ALERT_FRAME_SIZE;
+  }
+
+  /**
+   * Make every unacknowledged alert due now (phone resubscribed)
+   */
+  void resendAll(uint32_t now_ms) {
+    for (uint8_t i = 0; i < ALERT_PENDING; i++) {
+      if (pending[i].used) {
+        pending[i].next_ms = now_ms;
+        pending[i].backoff_ms = ALERT_RETRY_MS;
+      }
+    }
+  }
+
+  uint8_t pendingCount() const {
+    uint8_t n = 0;
+    for (uint8_t i = 0; i < ALERT_PENDING; i++) {
+      if (pending[i].used) n++;
+    }
+    return n;
+  }
+
+  AlertStats getStats() const {
+    return stats;
+  }
+};
+
+/**
+ * Parse an alert frame (phone side, host tests)
+ * @param seq: receives the sequence number to acknowledge
+ */
+static inline bool decodeAlert(const uint8_t* buf, size_t len, AlertEvent& e, uint16_t& seq, uint32_t* age_ms = nullptr) {
+  if (len < ALERT_HEADER || buf[0] != ALERT_MAGIC || buf[1] < 1 ||
+      buf[2] < ALERT_PAYLOAD || len < (size_t)ALERT_HEADER + buf[2]) {
+    return false;
+  }
+  const uint8_t* p = buf + ALERT_HEADER;
+  seq = vitalsGet16(p);
+  e.type = p[2];
+  e.severity = p[3];
+  e.value = p[4];
+  e.confidence = p[5];
+  e.hr = p[6];
+  e.spo2 = p[7];
+  e.bp_sys = p[8];
+  e.bp_dia = p[9];
+  e.time_ms = vitalsGet32(p + 10);
+  e.detect_us = 0;
+  if (age_ms) {
+    *age_ms = vitalsGet32(p + 14);
+  }
+  return true;
+}
+
+#endif // ALERT_CHANNEL_H
@@ -0,0 +1,229 @@
+/*
+ * LifeBand Beat History
+ * Minutes of RR intervals with running time-domain HRV
+ *
+ * calculateHRV() rescanned a 5-entry array on every call and was called up
+ * to six times per beat. BeatHistory keeps every accepted beat of the last
+ * window (default 5 minutes, BEAT_HISTORY_CAPACITY beats at most) in a ring
+ * stored as separate arrays (RR, time, flags) and updates its statistics in
+ * O(1) when a beat enters or is evicted:
+ *
+ *   SDNN     standard deviation of RR
+ *   RMSSD    root mean square of successive RR differences
+ *   pNN50    % of successive differences above 50 ms
+ *   variance RR variance (ms^2), an Edge AI input
+ *
+ * RR intervals are whole milliseconds, so the running sums (RR, RR^2,
+ * diff^2, NN50 count) are kept as exact integers: adding and evicting never
+ * accumulates rounding error, which is what a floating-point Welford update
+ * with removal has to guard against. A successive difference only counts if
+ * both beats are adjacent; markGap() (first beat after re-learning,
+ * rejected beat) breaks the chain without dropping history.
+ *
+ * The snapshot is recomputed once per add() and read by reference, so any
+ * number of readers per beat cost nothing. Single owner (inference stage);
+ * no Arduino dependency.
+ */
+
+#ifndef BEAT_HISTORY_H
+#define BEAT_HISTORY_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+#include <math.h>
+
+#define BEAT_HISTORY_CAPACITY 1024          // 5 min at 200 BPM, power of two
+#define BEAT_HISTORY_WINDOW_MS 300000UL     // 5 minutes
+#define BEAT_NN50_MS 50
+
+#define BEAT_FLAG_ADJACENT 0x01             // previous beat in the ring is the preceding one
+
+struct HrvSnapshot {
+  uint16_t beats;           // RR intervals in the window
+  uint16_t diffs;           // successive differences in the window
+  uint16_t last_rr_ms;
+  float mean_rr_ms;
+  float sdnn_ms;
+  float rmssd_ms;
+  float pnn50;              // %
+  float rr_variance;        // ms^2
+  uint32_t span_ms;         // time covered by the window
+};
+
+class BeatHistory {
+  static_assert((BEAT_HISTORY_CAPACITY & (BEAT_HISTORY_CAPACITY - 1)) == 0,
+                "BEAT_HISTORY_CAPACITY must be a power of two");
+
+private:
+  static const uint32_t MASK = BEAT_HISTORY_CAPACITY - 1;
+
+  // Structure of arrays: each pass touches only the field it needs
+  uint16_t rr_ms[BEAT_HISTORY_CAPACITY];
+  uint32_t time_ms[BEAT_HISTORY_CAPACITY];
+  uint8_t flags[BEAT_HISTORY_CAPACITY];
+
+  uint32_t head;            // next slot to write
+  uint32_t count;
+  uint32_t window_ms;
+  bool gap;                 // next beat does not follow the newest one
+
+  // Running sums over the window
+  uint64_t sum_rr;
+  uint64_t sum_rr2;
+  uint32_t diff_count;
+  uint64_t sum_diff2;
+  uint32_t nn50_count;
+
+  HrvSnapshot snap;
+
+  uint32_t slot(uint32_t age) const {
+    return (head - 1 - age) & MASK;   // age 0 = newest
+  }
+
+  void addDiff(int32_t diff, int sign) {
+    uint32_t d2 = (uint32_t)(diff * diff);
+    bool nn50 = diff > BEAT_NN50_MS || diff < -BEAT_NN50_MS;
+    if (sign > 0) {
+      diff_count++;
+      sum_diff2 += d2;
+      nn50_count += nn50 ? 1 : 0;
+    } else {
+      diff_count--;
+      sum_diff2 -= d2;
+      nn50_count -= nn50 ? 1 : 0;
+    }
+  }
+
+  void evictOldest() {
+    uint32_t oldest = slot(count - 1);
+    uint16_t rr = rr_ms[oldest];
+    sum_rr -= rr;
+    sum_rr2 -= (uint64_t)rr * rr;
+    count--;
+    // The difference to the beat after it leaves the window too
+    if (count > 0) {
+      uint32_t next = slot(count - 1);
+      if (flags[next] & BEAT_FLAG_ADJACENT) {
+        addDiff((int32_t)rr_ms[next] - rr, -1);
+        flags[next] &= ~BEAT_FLAG_ADJACENT;
+      }
+    }
+  }
+
+  void updateSnapshot() {
+    memset(&snap, 0, sizeof(snap));
+    snap.beats = (uint16_t)count;
+    snap.diffs = (uint16_t)diff_count;
+    if (count == 0) {
+      return;
+    }
+    snap.last_rr_ms = rr_ms[slot(0)];
+    snap.span_ms = time_ms[slot(0)] - time_ms[slot(count - 1)] + rr_ms[slot(count - 1)];
+    snap.mean_rr_ms = (float)sum_rr / count;
+    if (count >= 2) {
+      // n * sum(x^2) - sum(x)^2 is exact in 64 bits for this capacity
+      uint64_t num = (uint64_t)count * sum_rr2 - sum_rr * sum_rr;
+      snap.rr_variance = (float)num / ((float)count * (float)count);
+      snap.sdnn_ms = sqrtf(snap.rr_variance);
+    }
+    if (diff_count > 0) {
+      snap.rmssd_ms = sqrtf((float)sum_diff2 / diff_count);
+      snap.pnn50 = 100.0f * nn50_count / diff_count;
+    }
+  }
+
+public:
+  BeatHistory() : window_ms(BEAT_HISTORY_WINDOW_MS) {
+    clear();
+  }
+
+  void clear() {
+    head = 0;
+    count = 0;
+    gap = true;
+    sum_rr = 0;
+    sum_rr2 = 0;
+    diff_count = 0;
+    sum_diff2 = 0;
+    nn50_count = 0;
+    memset(&snap, 0, sizeof(snap));
+  }
+
+  /**
+   * @param ms: beats older than this (relative to the newest) are evicted
+   */
+  void setWindow(uint32_t ms) {
+    window_ms = ms;
+  }
+
+  /**
+   * The next beat is not adjacent to the newest one (missed or rejected beat)
+   */
+  void markGap() {
+    gap = true;
+  }
+
+  /**
+   * Add one accepted RR interval and refresh the snapshot
+   * @param beat_ms: time of the beat that ends the interval
+   */
+  void add(uint16_t rr, uint32_t beat_ms) {
+    if (rr == 0) {
+      markGap();
+      return;
+    }
+    if (count == BEAT_HISTORY_CAPACITY) {
+      evictOldest();
+    }
+
+    uint32_t s = head & MASK;
+    rr_ms[s] = rr;
+    time_ms[s] = beat_ms;
+    flags[s] = 0;
+    if (!gap && count > 0) {
+      flags[s] |= BEAT_FLAG_ADJACENT;
+      addDiff((int32_t)rr - rr_ms[slot(0)], 1);
+    }
+    head++;
+    count++;
+    gap = false;
+    sum_rr += rr;
+    sum_rr2 += (uint64_t)rr * rr;
+
+    while (count > 1 && beat_ms - time_ms[slot(count - 1)] > window_ms) {
+      evictOldest();
+    }
+    updateSnapshot();
+  }
+
+  /**
+   * Statistics as of the last add()
+   */
+  const HrvSnapshot& snapshot() const {
+    return snap;
+  }
+
+  uint32_t size() const { return count; }
+
+  /**
+   * RR of a beat in the window
+   * @param age: 0 = newest
+   */
+  uint16_t rr(uint32_t age) const {
+    return age < count ? rr_ms[slot(age)] : 0;
+  }
+
+  uint32_t beatTime(uint32_t age) const {
+    return age < count ? time_ms[slot(age)] : 0;
+  }
+
+  /**
+   * @return true if the beat at age follows the one at age + 1 directly
+   */
+  bool adjacent(uint32_t age) const {
+    return age < count && (flags[slot(age)] & BEAT_FLAG_ADJACENT) != 0;
+  }
+};
+
+#endif // BEAT_HISTORY_H
@@ -0,0 +1,356 @@
+/*
+ * LifeBand Beat Quality
+ * Per-beat signal quality index from template correlation
+ *
+ * calculateECGReliability() and calculatePPGReliability() scored quality
+ * from range checks on single values (peak amplitude, QRS width, raw IR),
+ * which a saturated, clipped or motion-corrupted signal passes as easily as
+ * a clean one. What distinguishes a real beat is its shape: consecutive
+ * beats of one subject through one lead look alike, noise does not.
+ *
+ * BeatQuality<N> keeps a short history of the stream and, for every beat
+ * its detector reports, takes N samples around the fiducial point (R-peak,
+ * systolic peak), removes their mean and scales them to a fixed peak, then
+ * scores them against a running average template by normalised cross-
+ * correlation:
+ *
+ *   NCC = (N Sxt - Sx St) / sqrt((N Sxx - Sx^2)(N Stt - St^2))
+ *
+ * SQI = 100 x max(NCC, 0). The first BEAT_QUALITY_LEARN_BEATS beats build
+ * the template; afterwards only beats at least BEAT_QUALITY_UPDATE_SQI alike
+ * refine it, and BEAT_QUALITY_RELEARN_RUN poor beats in a row (electrode or
+ * sensor moved, new morphology) start it over. A beat is scored once the
+ * stream has passed its window, so the fiducial may arrive late.
+ *
+ * Per beat the cost is fixed: one gather and normalise pass and two N-point
+ * int16 dot products (Sxt, Sxx). The dot kernel has a compile-time length
+ * and independent accumulators so compilers vectorise it; SSE2 builds (host
+ * benchmark) use it explicitly, everything else - including the ESP32 - the
+ * scalar loop. Define BEAT_QUALITY_SCALAR to force the scalar kernel.
+ *
+ * Single owner (DSP stage); no heap; no Arduino dependency.
+ */
+
+#ifndef BEAT_QUALITY_H
+#define BEAT_QUALITY_H
+
+#include <stdint.h>
+#include <string.h>
+#include <math.h>
+
+#if defined(__SSE2__) && !defined(BEAT_QUALITY_SCALAR)
+#include <emmintrin.h>
+#define BEAT_QUALITY_SSE2 1
+#endif
+
+#define BEAT_QUALITY_HISTORY 512        // samples kept, power of two (1 s at 500 Hz)
+#define BEAT_QUALITY_MAX_PENDING 4      // beats waiting for the end of their window
+#define BEAT_QUALITY_PEAK 2047          // segments are scaled to this peak
+#define BEAT_QUALITY_LEARN_BEATS 4      // beats averaged into a new template
+#define BEAT_QUALITY_UPDATE_SQI 80      // beats at least this alike refine the template
+#define BEAT_QUALITY_POOR_SQI 50
+#define BEAT_QUALITY_RELEARN_RUN 8      // poor beats in a row that restart the template
+#define BEAT_QUALITY_AMPLITUDE_SPAN 1.5f  // amplitude ratio to the template accepted without penalty
+
+struct BeatScore {
+  uint32_t index;           // fiducial sample index
+  float ncc;                // -1..1
+  uint8_t sqi;              // this beat, 0-100
+  uint8_t quality;          // running SQI, 0-100
+  bool learning;            // template still being built
+};
+
+struct BeatQualityStats {
+  uint32_t beats;           // fiducials received
+  uint32_t scored;
+  uint32_t poor;            // scored below BEAT_QUALITY_POOR_SQI
+  uint32_t updates;         // beats folded into the template
+  uint32_t relearns;
+  uint32_t missed;          // window no longer in the history, or queue full
+};
+
+template <uint8_t N>
+class BeatQuality {
+  static_assert(N >= 8 && N <= 64 && (N % 8) == 0,
+                "BeatQuality length must be a multiple of 8, at most 64");
+  static_assert((BEAT_QUALITY_HISTORY & (BEAT_QUALITY_HISTORY - 1)) == 0,
+                "BEAT_QUALITY_HISTORY must be a power of two");
+
+private:
+  static const uint32_t MASK = BEAT_QUALITY_HISTORY - 1;
+
+  int16_t history[BEAT_QUALITY_HISTORY];
+  uint32_t newest;          // index of the newest sample
+
+  uint8_t stride;           // stream samples per template sample
+  uint8_t pre;              // template samples before the fiducial
+
+  uint32_t pending[BEAT_QUALITY_MAX_PENDING];
+  uint8_t pending_head;
+  uint8_t pending_count;
+
+  int16_t segment[N];
+  int16_t templ[N];
+  int32_t accum[N];         // template x 16
+  int32_t segment_peak;     // raw peak of the current segment around its mean
+  int32_t templ_peak;       // raw peak of the template beats, x 16
+  int32_t templ_sum;
+  int64_t templ_energy;     // N Stt - St^2
+  uint8_t learned;          // beats in the template, up to BEAT_QUALITY_LEARN_BEATS
+  uint8_t poor_run;
+  uint16_t quality_q8;      // running SQI x 256
+
+  BeatQualityStats stats;
+
+  /**
+   * Fixed-length int16 dot product, exact in int32 for |values| <= 2047
+   */
+  static int32_t dot(const int16_t* a, const int16_t* b) {
+#ifdef BEAT_QUALITY_SSE2
+    __m128i acc = _mm_setzero_si128();
+    for (uint8_t i = 0; i < N; i += 8) {
+      __m128i va = _mm_loadu_si128((const __m128i*)(a + i));
+      __m128i vb = _mm_loadu_si128((const __m128i*)(b + i));
+      acc = _mm_add_epi32(acc, _mm_madd_epi16(va, vb));
+    }
+    acc = _mm_add_epi32(acc, _mm_shuffle_epi32(acc, 0x4E));
+    acc = _mm_add_epi32(acc, _mm_shuffle_epi32(acc, 0xB1));
+    return _mm_cvtsi128_si32(acc);
+#else
+    int32_t s0 = 0, s1 = 0, s2 = 0, s3 = 0;
+    for (uint8_t i = 0; i < N; i += 4) {
+      s0 += (int32_t)a[i] * b[i];
+      s1 += (int32_t)a[i + 1] * b[i + 1];
+      s2 += (int32_t)a[i + 2] * b[i + 2];
+      s3 += (int32_t)a[i + 3] * b[i + 3];
+    }
+    return s0 + s1 + s2 + s3;
+#endif
+  }
+
+  /**
+   * Gather the window around a fiducial, mean-removed and scaled to
+   * BEAT_QUALITY_PEAK
+   * @return sum of the scaled samples, or false for a flat window
+   */
+  bool gather(uint32_t fiducial, int32_t& sum) {
+    uint32_t first = fiducial - (uint32_t)pre * stride;
+    int32_t raw_sum = 0;
+    for (uint8_t i = 0; i < N; i++) {
+      segment[i] = history[(first + (uint32_t)i * stride) & MASK];
+      raw_sum += segment[i];
+    }
+    int32_t mean = raw_sum / N;
+    int32_t peak = 0;
+    for (uint8_t i = 0; i < N; i++) {
+      int32_t v = segment[i] - mean;
+      if (v < 0) v = -v;
+      if (v > peak) peak = v;
+    }
+    segment_peak = peak;
+    if (peak == 0) {
+      return false;
+    }
+    // |v - mean| <= peak, so v * scale stays below 2^27
+    int32_t scale = ((int32_t)BEAT_QUALITY_PEAK << 16) / peak;
+    sum = 0;
+    for (uint8_t i = 0; i < N; i++) {
+      segment[i] = (int16_t)(((segment[i] - mean) * scale) >> 16);
+      sum += segment[i];
+    }
+    return true;
+  }
+
+  void rebuildTemplate() {
+    templ_sum = 0;
+    for (uint8_t i = 0; i < N; i++) {
+      templ[i] = (int16_t)((accum[i] + 8) >> 4);
+      templ_sum += templ[i];
+    }
+    templ_energy = (int64_t)N * dot(templ, templ) - (int64_t)templ_sum * templ_sum;
+  }
+
+  /**
+   * Fold the current segment into the template: plain mean while learning,
+   * then an exponential average with weight 1/8
+   */
+  void updateTemplate() {
+    if (learned < BEAT_QUALITY_LEARN_BEATS) {
+      learned++;
+      for (uint8_t i = 0; i < N; i++) {
+        accum[i] += ((int32_t)segment[i] * 16 - accum[i]) / learned;
+      }
+      templ_peak += (segment_peak * 16 - templ_peak) / learned;
+    } else {
+      for (uint8_t i = 0; i < N; i++) {
+        accum[i] += ((int32_t)segment[i] * 16 - accum[i]) >> 3;
+      }
+      templ_peak += (segment_peak * 16 - templ_peak) >> 3;
+    }
+    rebuildTemplate();
+    stats.updates++;
+  }
+
+  void restartTemplate() {
+    memset(accum, 0, sizeof(accum));
+    memset(templ, 0, sizeof(templ));
+    templ_sum = 0;
+    templ_energy = 0;
+    templ_peak = 0;
+    learned = 0;
+    poor_run = 0;
+  }
+
+  void score(uint32_t fiducial, BeatScore& out) {
+    out.index = fiducial;
+    out.ncc = 0.0f;
+    out.sqi = 0;
+
+    int32_t sum = 0;
+    bool shaped = gather(fiducial, sum);
+    if (shaped && learned > 0 && templ_energy > 0 && templ_peak > 0) {
+      // N Sxx - Sx^2 and N Sxt - Sx St reach 2^34: int64
+      int64_t energy = (int64_t)N * dot(segment, segment) - (int64_t)sum * sum;
+      int64_t cross = (int64_t)N * dot(segment, templ) - (int64_t)sum * templ_sum;
+      if (energy > 0) {
+        out.ncc = (float)cross / sqrtf((float)energy * (float)templ_energy);
+      }
+      // The shape is compared at a fixed scale, so clipping, a lost
+      // contact or a motion step can still correlate: a beat far from
+      // the template's amplitude loses in proportion
+      float ratio = (float)segment_peak * 16.0f / (float)templ_peak;
+      if (ratio < 1.0f) ratio = 1.0f / ratio;
+      float sqi = out.ncc * 100.0f;
+      if (ratio > BEAT_QUALITY_AMPLITUDE_SPAN) sqi *= BEAT_QUALITY_AMPLITUDE_SPAN / ratio;
+      if (sqi > 0.0f) {
+        out.sqi = (uint8_t)(sqi + 0.5f);
+      }
+    }
+
+    bool learning = learned < BEAT_QUALITY_LEARN_BEATS;
+    if (shaped && (learning || out.sqi >= BEAT_QUALITY_UPDATE_SQI)) {
+      updateTemplate();
+    }
+    if (!learning && out.sqi < BEAT_QUALITY_POOR_SQI) {
+      stats.poor++;
+      if (++poor_run >= BEAT_QUALITY_RELEARN_RUN) {
+        restartTemplate();
+        stats.relearns++;
+      }
+    } else {
+      poor_run = 0;
+    }
+
+    // Template beats count as unscored rather than as poor
+    if (!learning) {
+      quality_q8 += ((int32_t)out.sqi * 256 - quality_q8) / 4;
+    }
+    out.quality = (uint8_t)((quality_q8 + 128) >> 8);
+    out.learning = learning;
+    stats.scored++;
+  }
+
+public:
+  BeatQuality() {
+    configure(1, 0);
+  }
+
+  /**
+   * @param sample_stride: stream samples between template samples
+   * @param pre_samples: template samples before the fiducial (< N)
+   */
+  void configure(uint8_t sample_stride, uint8_t pre_samples) {
+    stride = sample_stride > 0 ? sample_stride : 1;
+    pre = pre_samples < N ? pre_samples : N - 1;
+    if ((uint32_t)N * stride > BEAT_QUALITY_HISTORY / 2) {
+      stride = BEAT_QUALITY_HISTORY / 2 / N;      // leave room for detector delay
+    }
+    reset();
+  }
+
+  /**
+   * Set the window from a sample rate and its extent around the fiducial
+   * @param rate: stream sample rate in Hz
+   * @param window_ms: total window length
+   * @param pre_ms: part of the window before the fiducial
+   */
+  void configureWindow(uint16_t rate, uint16_t window_ms, uint16_t pre_ms) {
+    uint32_t span = (uint32_t)rate * window_ms / 1000;          // stream samples
+    uint32_t step = (span + N / 2) / N;
+    if (step < 1) step = 1;
+    if (step > 255) step = 255;
+    uint32_t before = ((uint32_t)rate * pre_ms / 1000 + step / 2) / step;
+    configure((uint8_t)step, (uint8_t)(before < N ? before : N - 1));
+  }
+
+  /**
+   * Forget the history, the queue and the template
+   */
+  void reset() {
+    newest = 0;
+    pending_head = 0;
+    pending_count = 0;
+    quality_q8 = 0;
+    restartTemplate();
+    memset(&stats, 0, sizeof(stats));
+  }
+
+  /**
+   * Queue a fiducial point reported by the beat detector
+   * @param index: stream sample index of the R-peak / systolic peak
+   */
+  void addBeat(uint32_t index) {
+    stats.beats++;
+    if (pending_count == BEAT_QUALITY_MAX_PENDING) {
+      pending_head = (pending_head + 1) % BEAT_QUALITY_MAX_PENDING;
+      pending_count--;
+      stats.missed++;
+    }
+    pending[(pending_head + pending_count) % BEAT_QUALITY_MAX_PENDING] = index;
+    pending_count++;
+  }
+
+  /**
+   * Add one stream sample (consecutive indices)
+   * @return true when a queued beat was scored into out
+   */
+  bool addSample(uint32_t index, int16_t value, BeatScore& out) {
+    history[index & MASK] = value;
+    newest = index;
+
+    while (pending_count > 0) {
+      uint32_t fiducial = pending[pending_head];
+      uint32_t first = fiducial - (uint32_t)pre * stride;
+      uint32_t last = first + (uint32_t)(N - 1) * stride;
+      if ((int32_t)(newest - last) < 0) {
+        return false;                       // window not complete yet
+      }
+      pending_head = (pending_head + 1) % BEAT_QUALITY_MAX_PENDING;
+      pending_count--;
+      if (newest - first >= BEAT_QUALITY_HISTORY) {
+        stats.missed++;                     // already overwritten
+        continue;
+      }
+      score(fiducial, out);
+      return true;
+    }
+    return false;
+  }
+
+  /**
+   * Running SQI (0-100), 0 until the template is learned
+   */
+  uint8_t quality() const {
+    return (uint8_t)((quality_q8 + 128) >> 8);
+  }
+
+  bool isLearning() const {
+    return learned < BEAT_QUALITY_LEARN_BEATS;
+  }
+
+  BeatQualityStats getStats() const {
+    return stats;
+  }
+};
+
+#endif // BEAT_QUALITY_H
@@ -0,0 +1,134 @@
+/*
+ * LifeBand BLE Link Monitor
+ * Connection bookkeeping and reconnect latency, no Arduino dependency
+ *
+ * A dropped link used to reboot the ESP32, so every reconnect paid for the
+ * boot banner, TFLite setup and ECG threshold learning, and lost all HR,
+ * SpO2 and HRV history. The link is now recovered in place while the
+ * pipeline keeps running: the disconnect callback only raises a flag, and
+ * loop() clears the link state and restarts advertising. This monitor
+ * records what that costs:
+ *
+ *   disconnect  -> advertising restarted   (readvertise_ms)
+ *   connect     -> first notification sent (first_notify_ms)
+ *
+ * The connect-to-first-notify time covers service discovery, the CCCD
+ * write and the first vitals frame, i.e. what the app waits before it sees
+ * data again. Both are kept as last / max / mean.
+ *
+ * onConnect() runs on the BLE host task, onDisconnect()/onAdvertising() in
+ * loop() and onNotify() on the transport stage. The connect timestamp is
+ * published with a release store, and the pending-advertising flag is an
+ * atomic that onConnect() may clear under loop(); statistics are plain
+ * fields, each written by one task and read for diagnostics only.
+ */
+
+#ifndef BLE_LINK_H
+#define BLE_LINK_H
+
+#include <stdint.h>
+#include <string.h>
+#include <atomic>
+
+struct LinkLatency {
+  uint32_t last_ms;
+  uint32_t max_ms;
+  uint32_t mean_ms;
+  uint32_t count;
+};
+
+struct LinkStats {
+  uint32_t connects;
+  uint32_t disconnects;
+  LinkLatency readvertise;      // disconnect -> advertising restarted
+  LinkLatency first_notify;     // connect -> first notification
+};
+
+class BleLinkMonitor {
+private:
+  std::atomic<uint32_t> connect_ms;
+  std::atomic<bool> awaiting_notify;
+  std::atomic<bool> awaiting_advertising;
+  uint32_t disconnect_ms;
+
+  LinkStats stats;
+  uint64_t readvertise_sum;
+  uint64_t first_notify_sum;
+
+  static void record(LinkLatency& lat, uint64_t& sum, uint32_t ms) {
+    lat.last_ms = ms;
+    if (ms > lat.max_ms) {
+      lat.max_ms = ms;
+    }
+    lat.count++;
+    sum += ms;
+    lat.mean_ms = (uint32_t)(sum / lat.count);
+  }
+
+public:
+  BleLinkMonitor() :
+    connect_ms(0),
+    awaiting_notify(false),
+    awaiting_advertising(false),
+    disconnect_ms(0),
+    readvertise_sum(0),
+    first_notify_sum(0) {
+    memset(&stats, 0, sizeof(stats));
+  }
+
+  /**
+   * Link up (BLE host task)
+   */
+  void onConnect(uint32_t now) {
+    stats.connects++;
+    awaiting_advertising.store(false, std::memory_order_relaxed);
+    connect_ms.store(now, std::memory_order_relaxed);
+    awaiting_notify.store(true, std::memory_order_release);
+  }
+
+  /**
+   * Link down (loop(), with the time the callback saw it)
+   */
+  void onDisconnect(uint32_t now) {
+    stats.disconnects++;
+    awaiting_notify.store(false, std::memory_order_relaxed);
+    disconnect_ms = now;
+    awaiting_advertising.store(true, std::memory_order_relaxed);
+  }
+
+  /**
+   * Advertising restarted after a disconnect (loop())
+   * @return time since the disconnect, 0 if none was pending
+   */
+  uint32_t onAdvertising(uint32_t now) {
+    if (!awaiting_advertising.exchange(false, std::memory_order_relaxed)) {
+      return 0;
+    }
+    uint32_t elapsed = now - disconnect_ms;
+    record(stats.readvertise, readvertise_sum, elapsed);
+    return elapsed;
+  }
+
+  /**
+   * A notification was sent (transport stage)
+   * @return connect-to-first-notify time for the first one on this link, else 0
+   */
+  uint32_t onNotify(uint32_t now) {
+    if (!awaiting_notify.load(std::memory_order_relaxed) ||
+        !awaiting_notify.exchange(false, std::memory_order_acquire)) {
+      return 0;
+    }
+    uint32_t elapsed = now - connect_ms.load(std::memory_order_relaxed);
+    record(stats.first_notify, first_notify_sum, elapsed);
+    return elapsed > 0 ? elapsed : 1;
+  }
+
+  /**
+   * @return true once the link has gone down at least once since boot
+   */
+  bool isReconnect() const { return stats.disconnects > 0; }
+
+  LinkStats getStats() const { return stats; }
+};
+
+#endif // BLE_LINK_H
@@ -0,0 +1,135 @@
+/*
+ * LifeBand Block Device
+ * Minimal NOR-flash interface for on-device storage engines
+ *
+ * Storage code (vitals_store.h) is written against this interface instead
+ * of the ESP-IDF partition API, so the same engine runs on a file-backed
+ * stand-in on a Linux host (host/file_block_device.h). The contract is the
+ * one raw SPI NOR flash gives:
+ *
+ *   - erase() sets a whole sector to 0xFF
+ *   - program() can only clear bits (1 -> 0); programming over data that
+ *     was not erased ANDs the bytes, it never sets them back
+ *   - an operation interrupted by power loss leaves its range in an
+ *     unknown mix of old and new contents
+ *
+ * On the ESP32 PartitionBlockDevice maps the interface onto a data
+ * partition. Flash erase and program stall both cores' cache, so callers
+ * should keep writes small and erases rare.
+ *
+ * mapReadOnly() optionally exposes the whole device as read-only memory
+ * (esp_partition_mmap through the flash cache), for data that is used in
+ * place rather than copied out (model_slots.h). Programs and erases show
+ * up in the mapping once they return.
+ */
+
+#ifndef BLOCK_DEVICE_H
+#define BLOCK_DEVICE_H
+
+#ifdef ARDUINO
+#include <Arduino.h>
+#include <esp_partition.h>
+#endif
+
+#include <stdint.h>
+#include <stddef.h>
+
+class BlockDevice {
+public:
+  virtual ~BlockDevice() {}
+
+  /**
+   * Erase unit in bytes (4096 on the ESP32 SPI flash)
+   */
+  virtual uint32_t sectorSize() const = 0;
+  virtual uint32_t sectorCount() const = 0;
+
+  /**
+   * @param offset: byte offset from the start of the device
+   * @return false on a device error or an out-of-range request
+   */
+  virtual bool read(uint32_t offset, void* dst, size_t len) = 0;
+  virtual bool program(uint32_t offset, const void* src, size_t len) = 0;
+  virtual bool erase(uint32_t sector) = 0;
+
+  /**
+   * @return the device contents, or nullptr if it cannot be mapped
+   */
+  virtual const uint8_t* mapReadOnly() { return nullptr; }
+};
+
+#ifdef ARDUINO
+#if ESP_ARDUINO_VERSION_MAJOR >= 3
+typedef esp_partition_mmap_handle_t PartitionMapHandle;
+#define PARTITION_MMAP_DATA ESP_PARTITION_MMAP_DATA
+#define partitionMunmap esp_partition_munmap
+#else
+typedef spi_flash_mmap_handle_t PartitionMapHandle;    // IDF 4.x names
+#define PARTITION_MMAP_DATA SPI_FLASH_MMAP_DATA
+#define partitionMunmap spi_flash_munmap
+#endif
+
+class PartitionBlockDevice : public BlockDevice {
+private:
+  const esp_partition_t* partition;
+  const void* mapped;
+  PartitionMapHandle map_handle;
+
+public:
+  PartitionBlockDevice() : partition(nullptr), mapped(nullptr), map_handle(0) {}
+
+  ~PartitionBlockDevice() {
+    if (mapped) {
+      partitionMunmap(map_handle);
+    }
+  }
+
+  /**
+   * Attach to a data partition
+   * @param label: partition label, or nullptr for the first SPIFFS-type
+   *               data partition (the Arduino "spiffs" partition)
+   * @return false if no such partition exists
+   */
+  bool begin(const char* label = nullptr) {
+    partition = esp_partition_find_first(ESP_PARTITION_TYPE_DATA,
+                                         label ? ESP_PARTITION_SUBTYPE_ANY : ESP_PARTITION_SUBTYPE_DATA_SPIFFS,
+                                         label);
+    return partition != nullptr;
+  }
+
+  uint32_t sectorSize() const override {
+    return SPI_FLASH_SEC_SIZE;
+  }
+
+  uint32_t sectorCount() const override {
+    return partition ? partition->size / SPI_FLASH_SEC_SIZE : 0;
+  }
+
+  bool read(uint32_t offset, void* dst, size_t len) override {
+    return partition && esp_partition_read(partition, offset, dst, len) == ESP_OK;
+  }
+
+  bool program(uint32_t offset, const void* src, size_t len) override {
+    return partition && esp_partition_write(partition, offset, src, len) == ESP_OK;
+  }
+
+  bool erase(uint32_t sector) override {
+    return partition &&
+           esp_partition_erase_range(partition, sector * SPI_FLASH_SEC_SIZE, SPI_FLASH_SEC_SIZE) == ESP_OK;
+  }
+
+  const uint8_t* mapReadOnly() override {
+    if (!mapped && partition &&
+        esp_partition_mmap(partition, 0, partition->size, PARTITION_MMAP_DATA, &mapped, &map_handle) != ESP_OK) {
+      mapped = nullptr;
+    }
+    return (const uint8_t*)mapped;
+  }
+
+  uint32_t size() const {
+    return partition ? partition->size : 0;
+  }
+};
+#endif
+
+#endif // BLOCK_DEVICE_H
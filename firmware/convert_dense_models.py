@@ -0,0 +1,279 @@
+"""
+LIFEBAND ESP32-S3 - Dense Model Converter
+==========================================
+Turns the model byte arrays in models_h/*.h into constexpr weight headers
+for the dependency-free dense engine (dense_engine.h):
+
+    models_h/arrhythmia_risk_model.h  ->  models_h/arrhythmia_risk_model_dense.h
+
+Two inputs are understood:
+1. The bundled dense layout ("TFL3" at offset 0): u32 inputs/hidden/outputs
+   at 16/20/24, float32 weights from offset 52 (W1[in][hid], b1, W2[hid][out],
+   b2), ReLU hidden layer, softmax output.
+2. A real TFLite flatbuffer ("TFL3" at offset 4): FULLY_CONNECTED weights and
+   biases are read with tf.lite.Interpreter (tensorflow is only imported in
+   this case); hidden layers are taken as ReLU, the last as softmax.
+
+For each layer the header holds float weights transposed to [out][in] with
+rows padded to 4 floats, and int8 weights padded to 16 bytes with one
+symmetric scale per output row. The number of rows is padded to 4 with
+zero rows (zero bias), so the engine always computes four outputs at once.
+
+Models trained on standardized inputs carry their constants in
+models_h/<name>_norm.json, {"mean": [...], "std": [...]} with one value per
+input; the header (and image) then holds input_mean and input_scale = 1/std
+and the firmware standardizes the feature vector before invoking. Without
+the file the model takes raw features, as the bundled models do.
+
+With --image VERSION the same layers are also written as a flash model
+image (models_h/<name>.v<VERSION>.lbm, "LBMD" layout in model_slots.h) for
+upload over BLE into a model slot; the arrays are byte-for-byte those of
+the header, so the device maps them in place.
+Usage:
+
+    python convert_dense_models.py [--image VERSION] [models_h/name.h ...]
+"""
+
+import json
+import os
+import re
+import struct
+import sys
+import zlib
+
+MODELS = ["arrhythmia_risk_model", "anemia_risk_model", "preeclampsia_risk_model"]  # ModelType order
+LANES_F32 = 4
+LANES_I8 = 16
+BUNDLED_HEADER = 52
+ACTIVATIONS = {"DENSE_LINEAR": 0, "DENSE_RELU": 1, "DENSE_SOFTMAX": 2}
+IMAGE_MAGIC = b"LBMD"
+IMAGE_FORMAT = 2
+IMAGE_HEADER = 32
+IMAGE_LAYER = 16
+IMAGE_ALIGN = 16
+
+
+def read_c_array(path):
+    """Bytes of the first unsigned char array in a C header, and its name"""
+    text = open(path).read()
+    match = re.search(r"unsigned\s+char\s+(\w+)\s*\[\s*\][^=]*=\s*\{(.*?)\}", text, re.S)
+    if not match:
+        raise ValueError(f"{path}: no unsigned char array found")
+    values = re.findall(r"0x([0-9a-fA-F]{1,2})", match.group(2))
+    return match.group(1), bytes(int(v, 16) for v in values)
+
+
+def parse_bundled(data):
+    """Layers as (inputs, outputs, weights[out][in], bias[out], activation)"""
+    n_in, n_hid, n_out = struct.unpack_from("<III", data, 16)
+    count = n_in * n_hid + n_hid + n_hid * n_out + n_out
+    if BUNDLED_HEADER + 4 * count > len(data):
+        raise ValueError("bundled model is truncated")
+    f = struct.unpack_from(f"<{count}f", data, BUNDLED_HEADER)
+    w1 = f[:n_in * n_hid]
+    b1 = f[n_in * n_hid:n_in * n_hid + n_hid]
+    w2 = f[n_in * n_hid + n_hid:n_in * n_hid + n_hid + n_hid * n_out]
+    b2 = f[count - n_out:]
+    # Stored input-major ([in][out]); the engine wants one row per output
+    l1 = [[w1[i * n_hid + o] for i in range(n_in)] for o in range(n_hid)]
+    l2 = [[w2[j * n_out + o] for j in range(n_hid)] for o in range(n_out)]
+    return [(n_in, n_hid, l1, list(b1), "DENSE_RELU"),
+            (n_hid, n_out, l2, list(b2), "DENSE_SOFTMAX")]
+
+
+def parse_flatbuffer(data):
+    import tensorflow as tf  # only needed for real TFLite models
+
+    interpreter = tf.lite.Interpreter(model_content=bytes(data))
+    interpreter.allocate_tensors()
+    details = {t["index"]: t for t in interpreter.get_tensor_details()}
+
+    def tensor(index):
+        t = details[index]
+        value = interpreter.get_tensor(index).astype("float64")
+        scale, zero = t["quantization"]
+        if scale:
+            value = (value - zero) * scale
+        return value
+
+    layers = []
+    for op in interpreter._get_ops_details():
+        if op["op_name"] != "FULLY_CONNECTED":
+            continue
+        weights = tensor(op["inputs"][1])          # TFLite FC weights are [out][in]
+        bias = tensor(op["inputs"][2]) if len(op["inputs"]) > 2 and op["inputs"][2] >= 0 else None
+        n_out, n_in = weights.shape
+        layers.append([n_in, n_out, weights.tolist(),
+                       bias.tolist() if bias is not None else [0.0] * n_out, "DENSE_RELU"])
+    if not layers:
+        raise ValueError("no FULLY_CONNECTED ops in model")
+    layers[-1][4] = "DENSE_SOFTMAX"
+    return [tuple(l) for l in layers]
+
+
+def pad(n, lanes):
+    return (n + lanes - 1) // lanes * lanes
+
+
+def c_float(x):
+    text = f"{x:.9g}"
+    return (text if any(c in text for c in ".en") else text + ".0") + "f"
+
+
+def emit_rows(rows, width, fmt, per_line, count=None):
+    values = []
+    for row in rows + [[]] * ((count or len(rows)) - len(rows)):
+        values.extend(row + [0] * (width - len(row)))
+    lines = []
+    for i in range(0, len(values), per_line):
+        lines.append("  " + ", ".join(fmt(v) for v in values[i:i + per_line]))
+    return ",\n".join(lines)
+
+
+def quantize(rows):
+    scales, q = [], []
+    for row in rows:
+        peak = max(abs(v) for v in row)
+        scale = peak / 127.0 if peak > 0 else 1.0
+        scales.append(scale)
+        q.append([max(-127, min(127, int(round(v / scale)))) for v in row])
+    return scales, q
+
+
+def read_norm(path, name, inputs):
+    """(mean, scale) from models_h/<name>_norm.json, or None for raw inputs"""
+    norm_path = os.path.join(os.path.dirname(path), f"{name}_norm.json")
+    if not os.path.exists(norm_path):
+        return None
+    norm = json.load(open(norm_path))
+    mean, std = [float(v) for v in norm["mean"]], [float(v) for v in norm["std"]]
+    if len(mean) != inputs or len(std) != inputs or min(std) <= 0:
+        raise ValueError(f"{norm_path}: needs {inputs} means and {inputs} positive stds")
+    return mean, [1.0 / v for v in std]
+
+
+def write_header(name, source, layers, norm, path):
+    guard = f"{name.upper()}_DENSE_H"
+    out = []
+    out.append("/*")
+    out.append(f" * LifeBand dense weights: {name}")
+    out.append(f" * Generated by convert_dense_models.py from {source} - do not edit")
+    out.append(" *")
+    shape = " -> ".join([str(layers[0][0])] + [str(l[1]) for l in layers])
+    out.append(f" * {shape}, rows padded to {LANES_F32} floats / {LANES_I8} int8, row count to {LANES_F32}")
+    out.append(" */")
+    out.append("")
+    out.append(f"#ifndef {guard}")
+    out.append(f"#define {guard}")
+    out.append("")
+    out.append('#include "../dense_engine.h"')
+    out.append("")
+
+    descriptors = []
+    for k, (n_in, n_out, rows, bias, activation) in enumerate(layers):
+        p = f"{name}_l{k}"
+        sf, si, rows_p = pad(n_in, LANES_F32), pad(n_in, LANES_I8), pad(n_out, LANES_F32)
+        scales, q = quantize(rows)
+        out.append(f"alignas(DENSE_ALIGN) static constexpr float {p}_w_f32[{rows_p} * {sf}] = {{")
+        out.append(emit_rows(rows, sf, c_float, sf, rows_p) + "\n};")
+        out.append(f"alignas(DENSE_ALIGN) static constexpr int8_t {p}_w_i8[{rows_p} * {si}] = {{")
+        out.append(emit_rows(q, si, str, si, rows_p) + "\n};")
+        out.append(f"alignas(DENSE_ALIGN) static constexpr float {p}_scale_i8[{rows_p}] = {{")
+        out.append(emit_rows([scales], rows_p, c_float, 4) + "\n};")
+        out.append(f"alignas(DENSE_ALIGN) static constexpr float {p}_bias[{rows_p}] = {{")
+        out.append(emit_rows([bias], rows_p, c_float, 4) + "\n};")
+        out.append("")
+        descriptors.append(f"  {{ {n_in}, {n_out}, {rows_p}, {sf}, {si}, {activation}, "
+                           f"{p}_w_f32, {p}_w_i8, {p}_scale_i8, {p}_bias }}")
+
+    out.append(f"static constexpr DenseLayer {name}_layers[{len(layers)}] = {{")
+    out.append(",\n".join(descriptors))
+    out.append("};")
+    out.append("")
+    if norm:
+        out.append(f"static constexpr float {name}_input_mean[{len(norm[0])}] = {{")
+        out.append(emit_rows([norm[0]], len(norm[0]), c_float, 4) + "\n};")
+        out.append(f"static constexpr float {name}_input_scale[{len(norm[1])}] = {{")
+        out.append(emit_rows([norm[1]], len(norm[1]), c_float, 4) + "\n};")
+        out.append("")
+        standardization = f"{name}_input_mean, {name}_input_scale"
+    else:
+        standardization = "nullptr, nullptr"   # raw features
+    out.append(f"static constexpr DenseNetwork {name}_dense = {{ {len(layers)}, {layers[0][0]}, "
+               f"{layers[-1][1]}, {name}_layers, {standardization} }};")
+    out.append("")
+    out.append(f"#endif // {guard}")
+    with open(path, "w") as f:
+        f.write("\n".join(out) + "\n")
+
+
+def write_image(name, layers, norm, version, path):
+    """Flash model image: header, layer table, per layer w_f32, w_i8, scale_i8, bias, then the standardization"""
+    if name not in MODELS:
+        raise ValueError(f"{name}: not a registry model, cannot build an image")
+    table = b""
+    arrays = b""
+    base = IMAGE_HEADER + IMAGE_LAYER * len(layers)
+    base = pad(base, IMAGE_ALIGN)
+    for n_in, n_out, rows, bias, activation in layers:
+        sf, si, rows_p = pad(n_in, LANES_F32), pad(n_in, LANES_I8), pad(n_out, LANES_F32)
+        scales, q = quantize(rows)
+        offset = base + len(arrays)
+        w_f32 = [v for r in rows + [[]] * (rows_p - len(rows)) for v in r + [0.0] * (sf - len(r))]
+        w_i8 = [v for r in q + [[]] * (rows_p - len(q)) for v in r + [0] * (si - len(r))]
+        block = struct.pack(f"<{len(w_f32)}f", *w_f32) + struct.pack(f"<{len(w_i8)}b", *w_i8)
+        block += struct.pack(f"<{rows_p}f", *(scales + [0.0] * (rows_p - len(scales))))
+        block += struct.pack(f"<{rows_p}f", *(bias + [0.0] * (rows_p - len(bias))))
+        arrays += block + b"\0" * (pad(len(block), IMAGE_ALIGN) - len(block))
+        table += struct.pack("<HHB3xI4x", n_in, n_out, ACTIVATIONS[activation], offset)
+    norm_offset = 0
+    if norm:
+        norm_offset = base + len(arrays)
+        arrays += struct.pack(f"<{2 * len(norm[0])}f", *(norm[0] + norm[1]))
+    body = table + b"\0" * (base - IMAGE_HEADER - len(table)) + arrays
+    size = IMAGE_HEADER + len(body)
+    header = IMAGE_MAGIC + struct.pack("<BBBBHHIIII", IMAGE_FORMAT, MODELS.index(name), len(layers), 0,
+                                       layers[0][0], layers[-1][1], version, size,
+                                       zlib.crc32(body) & 0xFFFFFFFF, norm_offset)
+    header += struct.pack("<I", zlib.crc32(header) & 0xFFFFFFFF)
+    with open(path, "wb") as f:
+        f.write(header + body)
+    return size
+
+
+def convert(path, version=None):
+    array, data = read_c_array(path)
+    if data[4:8] == b"TFL3":
+        layers = parse_flatbuffer(data)
+    elif data[0:4] == b"TFL3":
+        layers = parse_bundled(data)
+    else:
+        raise ValueError(f"{path}: unknown model format")
+    name = array[:-len("_tflite")] if array.endswith("_tflite") else array
+    target = os.path.join(os.path.dirname(path), f"{name}_dense.h")
+    norm = read_norm(path, name, layers[0][0])
+    write_header(name, os.path.basename(path), layers, norm, target)
+    params = sum(l[0] * l[1] + l[1] for l in layers)
+    print(f"✓ {target}: {' -> '.join([str(layers[0][0])] + [str(l[1]) for l in layers])}, {params} parameters"
+          f"{', standardized inputs' if norm else ''}")
+    if version is not None:
+        image = os.path.join(os.path.dirname(path), f"{name}.v{version}.lbm")
+        size = write_image(name, layers, norm, version, image)
+        print(f"✓ {image}: version {version}, {size} bytes")
+
+
+if __name__ == "__main__":
+    print("=" * 60)
+    print("LIFEBAND Dense Model Converter")
+    print("=" * 60)
+    here = os.path.dirname(os.path.abspath(__file__))
+    args = sys.argv[1:]
+    version = None
+    if args[:1] == ["--image"]:
+        if len(args) < 2 or not args[1].isdigit():
+            sys.exit("usage: convert_dense_models.py [--image VERSION] [models_h/name.h ...]")
+        version = int(args[1])
+        args = args[2:]
+    sources = args or [os.path.join(here, "models_h", f"{m}.h") for m in MODELS]
+    for source in sources:
+        convert(source, version)
@@ -0,0 +1,358 @@
+/*
+ * LifeBand Dense Engine
+ * Dependency-free int8/float fully connected networks with constexpr weights
+ *
+ * The bundled models are two small fully connected layers and a softmax
+ * (5 -> 8 -> 4/5). TFLite Micro needs a flatbuffer parser, an op resolver,
+ * an interpreter and an arena for that. This engine runs the same networks
+ * straight from constexpr arrays that convert_dense_models.py generates
+ * from the model headers (models_h/<name>_dense.h), so there is nothing to
+ * parse or allocate at boot.
+ *
+ * Weights are stored transposed, one row per output. Rows are padded with
+ * zeros to the vector width and the row count to a multiple of four, so
+ * every kernel walks whole 16-byte vectors and produces four outputs at a
+ * time, with no tail handling:
+ *
+ *   float  w_f32[rows][stride_f32]     stride_f32 = inputs rounded up to 4
+ *   int8   w_i8 [rows][stride_i8]      stride_i8  = inputs rounded up to 16
+ *   float  scale_i8[rows], bias[rows]  rows       = outputs rounded up to 4
+ *
+ * Padding rows have zero weights and bias, so their outputs are exactly 0
+ * and the next layer reads whole padded vectors. Outputs are stored four
+ * at a time: single-float stores read back by a 16-byte load stall on
+ * store forwarding, which at these sizes costs more than the arithmetic.
+ *
+ * int8 layers are dynamic-range quantized, as in TFLite's hybrid kernels.
+ * Weights are symmetric per output row (scale_i8[o]). The layer input is
+ * quantized symmetrically per call from its largest magnitude. The int32 dot
+ * product is then rescaled by both scales and the float bias is added.
+ *
+ * input_mean / input_scale are the standardization the network was trained
+ * with, stored alongside its weights. run() takes inputs as given: the
+ * registry standardizes the feature vector before invoking (model_registry.h).
+ *
+ * Kernels, chosen at compile time:
+ *   ESP32-S3  int8: PIE EE.VMULAS.S8.ACCX, 16 MACs per instruction
+ *             (define DENSE_NO_PIE to use the scalar loop)
+ *   x86 SSE2  float: 4-wide mul/add; int8: sign-extend + PMADDWD
+ *   other     scalar loops over the same padded layout
+ *
+ * Single owner (inference stage); no Arduino dependency.
+ */
+
+#ifndef DENSE_ENGINE_H
+#define DENSE_ENGINE_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+#include <math.h>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#define DENSE_SSE2 1
+#endif
+
+#if defined(CONFIG_IDF_TARGET_ESP32S3) && !defined(DENSE_NO_PIE)
+#define DENSE_PIE 1
+#endif
+
+#define DENSE_LANES_F32 4
+#define DENSE_LANES_I8 16
+#define DENSE_ALIGN 16
+#define DENSE_MAX_WIDTH 64                // widest layer (padded inputs or rows)
+
+constexpr uint16_t denseStride(uint16_t n, uint16_t lanes) {
+  return (uint16_t)((n + lanes - 1) / lanes * lanes);
+}
+
+enum DenseActivation : uint8_t {
+  DENSE_LINEAR = 0,
+  DENSE_RELU = 1,
+  DENSE_SOFTMAX = 2
+};
+
+enum DenseMode : uint8_t {
+  DENSE_FLOAT = 0,
+  DENSE_INT8 = 1
+};
+
+struct DenseLayer {
+  uint16_t inputs;
+  uint16_t outputs;
+  uint16_t rows;                          // denseStride(outputs, DENSE_LANES_F32)
+  uint16_t stride_f32;                    // denseStride(inputs, DENSE_LANES_F32)
+  uint16_t stride_i8;                     // denseStride(inputs, DENSE_LANES_I8)
+  DenseActivation activation;
+  const float* w_f32;                     // [rows][stride_f32], 16-byte aligned
+  const int8_t* w_i8;                     // [rows][stride_i8], 16-byte aligned
+  const float* scale_i8;                  // [rows] per-row weight scale, 16-byte aligned
+  const float* bias;                      // [rows], 16-byte aligned
+};
+
+struct DenseNetwork {
+  uint8_t layers;
+  uint16_t inputs;
+  uint16_t outputs;
+  const DenseLayer* layer;
+  const float* input_mean;                // [inputs] standardization, nullptr = raw features
+  const float* input_scale;               // [inputs] 1 / std
+};
+
+// ==================== KERNELS ====================
+
+/**
+ * Four float outputs: y[r] = w[r] . x + bias[r] for rows r = 0..3
+ * @param stride: row length (multiple of DENSE_LANES_F32); rows are stride floats apart
+ * @param relu: clamp negative outputs to 0
+ */
+static inline void denseRows4F32(const float* w, uint16_t stride, const float* x, const float* bias,
+                                 bool relu, float* y) {
+#if DENSE_SSE2
+  __m128 a0 = _mm_setzero_ps(), a1 = _mm_setzero_ps(), a2 = _mm_setzero_ps(), a3 = _mm_setzero_ps();
+  for (uint16_t i = 0; i < stride; i += DENSE_LANES_F32) {
+    __m128 v = _mm_load_ps(x + i);
+    a0 = _mm_add_ps(a0, _mm_mul_ps(_mm_load_ps(w + i), v));
+    a1 = _mm_add_ps(a1, _mm_mul_ps(_mm_load_ps(w + stride + i), v));
+    a2 = _mm_add_ps(a2, _mm_mul_ps(_mm_load_ps(w + 2 * stride + i), v));
+    a3 = _mm_add_ps(a3, _mm_mul_ps(_mm_load_ps(w + 3 * stride + i), v));
+  }
+  _MM_TRANSPOSE4_PS(a0, a1, a2, a3);
+  __m128 sum = _mm_add_ps(_mm_add_ps(_mm_add_ps(a0, a1), _mm_add_ps(a2, a3)), _mm_load_ps(bias));
+  if (relu) {
+    sum = _mm_max_ps(sum, _mm_setzero_ps());
+  }
+  _mm_store_ps(y, sum);
+#else
+  for (uint8_t r = 0; r < 4; r++) {
+    const float* row = w + (size_t)r * stride;
+    float a0 = 0.0f, a1 = 0.0f, a2 = 0.0f, a3 = 0.0f;
+    for (uint16_t i = 0; i < stride; i += DENSE_LANES_F32) {
+      a0 += row[i] * x[i];
+      a1 += row[i + 1] * x[i + 1];
+      a2 += row[i + 2] * x[i + 2];
+      a3 += row[i + 3] * x[i + 3];
+    }
+    float s = (a0 + a1) + (a2 + a3) + bias[r];
+    y[r] = (relu && s < 0.0f) ? 0.0f : s;
+  }
+#endif
+}
+
+/**
+ * Quantize a float vector to int8, symmetric around 0
+ * @param n_f32: lanes of x to read (padded width; padding lanes are 0)
+ * @param n_i8: lanes of q to write; lanes from n_f32 on are zeroed
+ * @return scale (x ~= q * scale)
+ */
+static inline float denseQuantize(const float* x, uint16_t n_f32, int8_t* q, uint16_t n_i8) {
+#if DENSE_SSE2
+  const __m128 abs_mask = _mm_castsi128_ps(_mm_set1_epi32(0x7fffffff));
+  __m128 peak4 = _mm_setzero_ps();
+  for (uint16_t i = 0; i < n_f32; i += DENSE_LANES_F32) {
+    peak4 = _mm_max_ps(peak4, _mm_and_ps(_mm_load_ps(x + i), abs_mask));
+  }
+  peak4 = _mm_max_ps(peak4, _mm_movehl_ps(peak4, peak4));
+  peak4 = _mm_max_ss(peak4, _mm_shuffle_ps(peak4, peak4, 1));
+  float peak = _mm_cvtss_f32(peak4);
+  float scale = peak > 0.0f ? peak / 127.0f : 1.0f;
+  __m128 inv = _mm_set1_ps(1.0f / scale);
+  for (uint16_t b = 0; b < n_i8; b += DENSE_LANES_I8) {
+    __m128i v[4];
+    for (uint8_t k = 0; k < 4; k++) {
+      uint16_t i = b + k * DENSE_LANES_F32;
+      v[k] = i < n_f32 ? _mm_cvtps_epi32(_mm_mul_ps(_mm_load_ps(x + i), inv)) : _mm_setzero_si128();
+    }
+    __m128i packed = _mm_packs_epi16(_mm_packs_epi32(v[0], v[1]), _mm_packs_epi32(v[2], v[3]));
+    _mm_store_si128((__m128i*)(q + b), packed);
+  }
+  return scale;
+#else
+  float peak = 0.0f;
+  for (uint16_t i = 0; i < n_f32; i++) {
+    float a = fabsf(x[i]);
+    if (a > peak) peak = a;
+  }
+  float scale = peak > 0.0f ? peak / 127.0f : 1.0f;
+  float inv = 1.0f / scale;
+  for (uint16_t i = 0; i < n_i8; i++) {
+    q[i] = i < n_f32 ? (int8_t)lrintf(x[i] * inv) : 0;
+  }
+  return scale;
+#endif
+}
+
+#if !DENSE_SSE2
+/**
+ * Dot product over n int8 values (n a multiple of DENSE_LANES_I8, both 16-byte aligned)
+ */
+static inline int32_t denseDotI8(const int8_t* w, const int8_t* x, uint16_t n) {
+#if DENSE_PIE
+  int32_t result;
+  const int8_t* pw = w;
+  const int8_t* px = x;
+  __asm__ volatile (
+    "ee.zero.accx\n"
+    : : : "memory");
+  for (uint16_t i = 0; i < n; i += DENSE_LANES_I8) {
+    __asm__ volatile (
+      "ee.vld.128.ip q0, %0, 16\n"
+      "ee.vld.128.ip q1, %1, 16\n"
+      "ee.vmulas.s8.accx q0, q1\n"
+      : "+r"(pw), "+r"(px) : : "memory");
+  }
+  __asm__ volatile (
+    "ee.srs.accx %0, %1, 0\n"
+    : "=r"(result) : "r"(0) : "memory");
+  return result;
+#else
+  int32_t acc = 0;
+  for (uint16_t i = 0; i < n; i++) {
+    acc += (int32_t)w[i] * x[i];
+  }
+  return acc;
+#endif
+}
+#endif
+
+/**
+ * Four int8 outputs: y[r] = (w[r] . q) * q_scale * scale[r] + bias[r] for rows r = 0..3
+ * @param stride: row length (multiple of DENSE_LANES_I8); rows are stride bytes apart
+ * @param relu: clamp negative outputs to 0
+ */
+static inline void denseRows4I8(const int8_t* w, uint16_t stride, const int8_t* q, float q_scale,
+                                const float* scale, const float* bias, bool relu, float* y) {
+#if DENSE_SSE2
+  __m128i acc[4] = { _mm_setzero_si128(), _mm_setzero_si128(), _mm_setzero_si128(), _mm_setzero_si128() };
+  for (uint16_t i = 0; i < stride; i += DENSE_LANES_I8) {
+    // Sign-extend bytes to 16 bits (high byte of each pair, then arithmetic shift)
+    __m128i vx = _mm_load_si128((const __m128i*)(q + i));
+    __m128i xl = _mm_srai_epi16(_mm_unpacklo_epi8(vx, vx), 8);
+    __m128i xh = _mm_srai_epi16(_mm_unpackhi_epi8(vx, vx), 8);
+    for (uint8_t r = 0; r < 4; r++) {
+      __m128i vw = _mm_load_si128((const __m128i*)(w + (size_t)r * stride + i));
+      __m128i wl = _mm_srai_epi16(_mm_unpacklo_epi8(vw, vw), 8);
+      __m128i wh = _mm_srai_epi16(_mm_unpackhi_epi8(vw, vw), 8);
+      acc[r] = _mm_add_epi32(acc[r], _mm_add_epi32(_mm_madd_epi16(wl, xl), _mm_madd_epi16(wh, xh)));
+    }
+  }
+  // Transpose-add the four accumulators into one vector of row totals
+  __m128i s01 = _mm_add_epi32(_mm_unpacklo_epi32(acc[0], acc[1]), _mm_unpackhi_epi32(acc[0], acc[1]));
+  __m128i s23 = _mm_add_epi32(_mm_unpacklo_epi32(acc[2], acc[3]), _mm_unpackhi_epi32(acc[2], acc[3]));
+  __m128i total = _mm_add_epi32(_mm_unpacklo_epi64(s01, s23), _mm_unpackhi_epi64(s01, s23));
+  __m128 sum = _mm_add_ps(_mm_mul_ps(_mm_mul_ps(_mm_cvtepi32_ps(total), _mm_set1_ps(q_scale)), _mm_load_ps(scale)),
+                          _mm_load_ps(bias));
+  if (relu) {
+    sum = _mm_max_ps(sum, _mm_setzero_ps());
+  }
+  _mm_store_ps(y, sum);
+#else
+  for (uint8_t r = 0; r < 4; r++) {
+    float s = (float)denseDotI8(w + (size_t)r * stride, q, stride) * q_scale * scale[r] + bias[r];
+    y[r] = (relu && s < 0.0f) ? 0.0f : s;
+  }
+#endif
+}
+
+// ==================== ENGINE ====================
+
+class DenseEngine {
+private:
+  alignas(DENSE_ALIGN) float act_a[DENSE_MAX_WIDTH];
+  alignas(DENSE_ALIGN) float act_b[DENSE_MAX_WIDTH];
+  alignas(DENSE_ALIGN) int8_t act_q[DENSE_MAX_WIDTH];
+
+  static void softmax(float* y, uint16_t n) {
+    float top = y[0];
+    for (uint16_t i = 1; i < n; i++) {
+      if (y[i] > top) top = y[i];
+    }
+    float sum = 0.0f;
+    for (uint16_t i = 0; i < n; i++) {
+      y[i] = expf(y[i] - top);
+      sum += y[i];
+    }
+    float inv = 1.0f / sum;
+    for (uint16_t i = 0; i < n; i++) {
+      y[i] *= inv;
+    }
+  }
+
+  static bool aligned(const void* p) {
+    return ((uintptr_t)p % DENSE_ALIGN) == 0;
+  }
+
+public:
+  DenseEngine() {
+    memset(act_a, 0, sizeof(act_a));
+    memset(act_b, 0, sizeof(act_b));
+    memset(act_q, 0, sizeof(act_q));
+  }
+
+  /**
+   * Check shapes and layout once (at boot)
+   */
+  static bool validate(const DenseNetwork& net) {
+    if (net.layers == 0 || !net.layer || net.inputs != net.layer[0].inputs ||
+        net.outputs != net.layer[net.layers - 1].outputs || !net.input_mean != !net.input_scale) {
+      return false;
+    }
+    for (uint8_t k = 0; k < net.layers; k++) {
+      const DenseLayer& l = net.layer[k];
+      if (l.inputs == 0 || l.outputs == 0 || l.rows > DENSE_MAX_WIDTH || l.stride_i8 > DENSE_MAX_WIDTH ||
+          l.rows != denseStride(l.outputs, DENSE_LANES_F32) ||
+          l.stride_f32 != denseStride(l.inputs, DENSE_LANES_F32) ||
+          l.stride_i8 != denseStride(l.inputs, DENSE_LANES_I8) ||
+          (k > 0 && l.inputs != net.layer[k - 1].outputs) ||
+          (l.activation == DENSE_SOFTMAX && k != net.layers - 1)) {
+        return false;
+      }
+      if (!l.w_f32 || !l.bias || !aligned(l.w_f32) || !aligned(l.bias) ||
+          (l.w_i8 && !aligned(l.w_i8)) || (l.scale_i8 && !aligned(l.scale_i8))) {
+        return false;
+      }
+    }
+    return true;
+  }
+
+  /**
+   * Run the network
+   * @param input: net.inputs values
+   * @param output: receives net.outputs values
+   * @return false if int8 was asked for and the network has no int8 weights
+   */
+  bool run(const DenseNetwork& net, DenseMode mode, const float* input, float* output) {
+    float* x = act_a;
+    float* y = act_b;
+    memset(x, 0, net.layer[0].stride_f32 * sizeof(float));   // padding lanes must be zero
+    memcpy(x, input, net.inputs * sizeof(float));
+
+    for (uint8_t k = 0; k < net.layers; k++) {
+      const DenseLayer& l = net.layer[k];
+      bool relu = l.activation == DENSE_RELU;
+      if (mode == DENSE_INT8) {
+        if (!l.w_i8 || !l.scale_i8) {
+          return false;
+        }
+        float q_scale = denseQuantize(x, l.stride_f32, act_q, l.stride_i8);
+        for (uint16_t o = 0; o < l.rows; o += 4) {
+          denseRows4I8(l.w_i8 + (size_t)o * l.stride_i8, l.stride_i8, act_q, q_scale,
+                       l.scale_i8 + o, l.bias + o, relu, y + o);
+        }
+      } else {
+        for (uint16_t o = 0; o < l.rows; o += 4) {
+          denseRows4F32(l.w_f32 + (size_t)o * l.stride_f32, l.stride_f32, x, l.bias + o, relu, y + o);
+        }
+      }
+      if (l.activation == DENSE_SOFTMAX) {
+        softmax(y, l.outputs);               // last layer only (validate)
+      }
+      float* t = x; x = y; y = t;
+    }
+    memcpy(output, x, net.outputs * sizeof(float));
+    return true;
+  }
+};
+
+#endif // DENSE_ENGINE_H
@@ -0,0 +1,117 @@
+/*
+ * LifeBand Dense Inference
+ * InferenceBackend that runs a registry model on the dense engine
+ *
+ * The default backend: each model's weights come from its generated
+ * models_h/<name>_dense.h header (convert_dense_models.py) and all three
+ * engines share one DenseEngine, whose scratch is the only working
+ * memory (a few hundred bytes; the models never run at the same time).
+ * begin() checks the network against the registry's shapes, so a header
+ * that was not regenerated after a model change falls back to rules
+ * instead of reading past its weights.
+ *
+ * LIFEBAND_DENSE_MODE picks the kernels. Float is the default: it matches
+ * the model to float rounding, and at 93 weights per model the S3's
+ * single-precision FPU is not the bottleneck. DENSE_INT8 uses the PIE
+ * path and stays within about 0.02 of the float probabilities.
+ *
+ * The network's input standardization, if it has one, is handed to the
+ * registry through standardization(), so the inputs arrive standardized.
+ *
+ * useNetwork() swaps in another network with the same shapes, e.g. one
+ * mapped from a flash model slot (model_slots.h); begin() must then be
+ * run again. Outputs that are not finite fail the invocation, so a bad
+ * image falls back to rules and fails its trial.
+ *
+ * Build with LIFEBAND_USE_TFLM to run the flatbuffers on TensorFlow Lite
+ * Micro instead (tflite_inference_eloquent.h).
+ *
+ * Single owner (inference stage); no Arduino dependency.
+ */
+
+#ifndef DENSE_INFERENCE_H
+#define DENSE_INFERENCE_H
+
+#include "model_registry.h"
+#include "dense_engine.h"
+#include "models_h/arrhythmia_risk_model_dense.h"
+#include "models_h/anemia_risk_model_dense.h"
+#include "models_h/preeclampsia_risk_model_dense.h"
+
+#ifndef LIFEBAND_DENSE_MODE
+#define LIFEBAND_DENSE_MODE DENSE_FLOAT   // or DENSE_INT8
+#endif
+
+class DenseInferenceEngine : public InferenceBackend {
+private:
+  const ModelSpec& model_spec;
+  const DenseNetwork& builtin;
+  const DenseNetwork* network;
+  DenseEngine& engine;
+  DenseMode mode;
+  bool loaded;
+
+public:
+  /**
+   * @param spec: registry entry the network was converted from
+   * @param net: generated network (e.g. arrhythmia_risk_model_dense)
+   * @param shared: scratch shared by all dense backends
+   * @param dense_mode: DENSE_INT8 (PIE on the S3) or DENSE_FLOAT
+   */
+  DenseInferenceEngine(const ModelSpec& spec, const DenseNetwork& net, DenseEngine& shared, DenseMode dense_mode) :
+    model_spec(spec),
+    builtin(net),
+    network(&net),
+    engine(shared),
+    mode(dense_mode),
+    loaded(false) {
+  }
+
+  const ModelSpec& spec() const override {
+    return model_spec;
+  }
+
+  const char* name() const override {
+    return mode == DENSE_INT8 ? "dense int8" : "dense float";
+  }
+
+  bool begin() override {
+    loaded = DenseEngine::validate(*network) &&
+             network->inputs == model_spec.inputs &&
+             network->outputs == model_spec.outputs;
+    return loaded;
+  }
+
+  bool invoke(const float* in, float* out) override {
+    if (!loaded || !engine.run(*network, mode, in, out)) {
+      return false;
+    }
+    for (uint16_t i = 0; i < network->outputs; i++) {
+      if (!isfinite(out[i])) {
+        return false;
+      }
+    }
+    return true;
+  }
+
+  bool standardization(const float*& mean, const float*& scale) const override {
+    mean = network->input_mean;
+    scale = network->input_scale;
+    return mean != nullptr;
+  }
+
+  /**
+   * Run another network from the next begin() on
+   * @param net: nullptr for the built-in weights
+   */
+  void useNetwork(const DenseNetwork* net) {
+    network = net ? net : &builtin;
+    loaded = false;
+  }
+
+  bool usesBuiltin() const { return network == &builtin; }
+
+  DenseMode getMode() const { return mode; }
+};
+
+#endif // DENSE_INFERENCE_H
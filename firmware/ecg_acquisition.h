@@ -0,0 +1,328 @@
+/*
+ * LifeBand ECG Acquisition
+ * Fixed-rate AD8232 sampling decoupled from loop()
+ *
+ * A hardware timer fires at the configured rate (250/500 Hz) and wakes a
+ * pinned high-priority sampler task, which reads the ADC and pushes the
+ * sample into a lock-free ring together with its sample index. The index
+ * IS the timestamp: sample n was taken at tick n, so consumers get an exact
+ * timebase no matter how late they drain the ring.
+ *
+ * Timing faults are counted instead of hidden:
+ * - missed ticks: the sampler woke up after more than one tick had elapsed
+ *   (the index skips, so gaps are visible downstream)
+ * - overruns: the consumer fell behind and the ring was full
+ * - latency: how long after its tick each sample was actually read
+ *
+ * Without ARDUINO the timer/task backend is compiled out and samples are fed
+ * through onTicks() by host/simulated_adc_source.h.
+ */
+
+#ifndef ECG_ACQUISITION_H
+#define ECG_ACQUISITION_H
+
+#ifdef ARDUINO
+#include <Arduino.h>
+#endif
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+#include "spsc_ring.h"
+
+#define ECG_RING_CAPACITY 1024   // 4 s at 250 Hz, 2 s at 500 Hz
+#define ECG_SAMPLER_CORE 1
+#define ECG_SAMPLER_PRIORITY 20
+#define ECG_SAMPLER_STACK 3072
+
+struct EcgSample {
+  uint32_t index;   // sample number since begin(), one per timer tick
+  int16_t value;    // raw ADC reading (0-4095)
+};
+
+struct AcquisitionStats {
+  uint32_t samples;          // samples pushed into the ring
+  uint32_t missed_ticks;     // ticks skipped because the sampler ran late
+  uint32_t overruns;         // samples lost because the ring was full
+  uint32_t late_samples;     // samples read more than 1/4 period after their tick
+  uint32_t max_latency_us;   // worst tick-to-read latency
+  uint32_t mean_latency_us;  // average tick-to-read latency
+};
+
+class EcgAcquisition {
+private:
+  SpscRing<EcgSample, ECG_RING_CAPACITY> ring;
+
+  uint16_t rate_hz;
+  uint32_t period_us;
+  uint32_t late_threshold_us;
+  uint32_t start_us;         // scheduled time of sample 0
+  uint32_t start_ms;         // millis() equivalent of sample 0
+  uint32_t next_index;       // ticks serviced so far
+  volatile int16_t latest_value;
+
+  AcquisitionStats stats;
+  uint64_t latency_sum;
+
+#ifdef ARDUINO
+  uint8_t pin;
+  hw_timer_t* timer;
+  TaskHandle_t sampler_task;
+  static EcgAcquisition* active;
+
+  static void IRAM_ATTR onTimerISR() {
+    BaseType_t woken = pdFALSE;
+    if (active && active->sampler_task) {
+      vTaskNotifyGiveFromISR(active->sampler_task, &woken);
+    }
+    if (woken == pdTRUE) {
+      portYIELD_FROM_ISR();
+    }
+  }
+
+  static void samplerTask(void* arg) {
+    EcgAcquisition* self = (EcgAcquisition*)arg;
+    for (;;) {
+      // Returns the number of ticks that fired since the last wake-up
+      uint32_t ticks = ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+      if (ticks == 0) {
+        continue;
+      }
+      int16_t value = (int16_t)analogRead(self->pin);
+      self->onTicks(ticks, (uint32_t)micros(), value);
+    }
+  }
+#endif
+
+public:
+  EcgAcquisition() :
+    rate_hz(0),
+    period_us(0),
+    late_threshold_us(0),
+    start_us(0),
+    start_ms(0),
+    next_index(0),
+    latest_value(0),
+    latency_sum(0)
+#ifdef ARDUINO
+    , pin(0),
+    timer(nullptr),
+    sampler_task(nullptr)
+#endif
+  {
+    memset(&stats, 0, sizeof(stats));
+  }
+
+  /**
+   * Set the sample rate and timebase without starting any hardware
+   * @param first_sample_us: scheduled micros() of sample 0
+   * @param first_sample_ms: millis() of sample 0 (for sampleTimeMs)
+   * @return false if the rate does not divide 1 MHz evenly
+   */
+  bool configure(uint16_t rate, uint32_t first_sample_us, uint32_t first_sample_ms) {
+    if (rate == 0 || (1000000UL % rate) != 0) {
+      return false;
+    }
+    rate_hz = rate;
+    period_us = 1000000UL / rate;
+    late_threshold_us = period_us / 4;
+    start_us = first_sample_us;
+    start_ms = first_sample_ms;
+    next_index = 0;
+    latency_sum = 0;
+    memset(&stats, 0, sizeof(stats));
+    ring.clear();
+    return true;
+  }
+
+  /**
+   * Producer side: service one sampler wake-up
+   * @param ticks: timer ticks elapsed since the previous wake-up (>= 1)
+   * @param now_us: time the ADC was actually read
+   * @param value: ADC reading, attributed to the most recent tick
+   */
+  void onTicks(uint32_t ticks, uint32_t now_us, int16_t value) {
+    if (ticks == 0 || period_us == 0) {
+      return;
+    }
+
+    uint32_t index = next_index + ticks - 1;
+    next_index += ticks;
+    stats.missed_ticks += ticks - 1;
+
+    uint32_t scheduled_us = start_us + (uint32_t)((uint64_t)index * period_us);
+    uint32_t latency = now_us - scheduled_us;
+    if ((int32_t)latency < 0) {
+      latency = 0;
+    }
+    if (latency > stats.max_latency_us) {
+      stats.max_latency_us = latency;
+    }
+    if (latency > late_threshold_us) {
+      stats.late_samples++;
+    }
+    latency_sum += latency;
+
+    latest_value = value;
+
+    EcgSample sample;
+    sample.index = index;
+    sample.value = value;
+    if (ring.push(sample)) {
+      stats.samples++;
+      stats.mean_latency_us = (uint32_t)(latency_sum / stats.samples);
+    } else {
+      stats.overruns++;
+    }
+  }
+
+  /**
+   * Ticks elapsed by now_us that have not been serviced yet
+   * (lets loop() drive the same path when no timer is available)
+   */
+  uint32_t ticksDue(uint32_t now_us) const {
+    if (period_us == 0 || (int32_t)(now_us - start_us) < 0) {
+      return 0;
+    }
+    uint32_t elapsed = (now_us - start_us) / period_us + 1;
+    return elapsed > next_index ? elapsed - next_index : 0;
+  }
+
+  /**
+   * Consumer side: drain up to max_samples in sample-index order
+   */
+  size_t readBlock(EcgSample* out, size_t max_samples) {
+    return ring.popBlock(out, max_samples);
+  }
+
+  size_t available() const {
+    return ring.size();
+  }
+
+  /**
+   * millis() timestamp of a sample, derived from its index (no jitter)
+   */
+  uint32_t sampleTimeMs(uint32_t index) const {
+    if (rate_hz == 0) {
+      return start_ms;
+    }
+    return start_ms + (uint32_t)((uint64_t)index * 1000UL / rate_hz);
+  }
+
+  /**
+   * micros() timestamp of a sample (its timer tick), the timebase shared
+   * with the PPG stream
+   */
+  uint32_t sampleTimeUs(uint32_t index) const {
+    return start_us + (uint32_t)((uint64_t)index * period_us);
+  }
+
+  /**
+   * Convert a duration in samples to milliseconds
+   */
+  uint32_t samplesToMs(uint32_t samples) const {
+    return rate_hz ? (uint32_t)((uint64_t)samples * 1000UL / rate_hz) : 0;
+  }
+
+  uint16_t sampleRate() const {
+    return rate_hz;
+  }
+
+  uint32_t periodUs() const {
+    return period_us;
+  }
+
+  int16_t latestValue() const {
+    return latest_value;
+  }
+
+  AcquisitionStats getStats() const {
+    return stats;
+  }
+
+#ifdef ARDUINO
+  /**
+   * Start timer-driven sampling on the given ADC pin
+   * @param rate: sample rate in Hz (250 or 500 recommended)
+   * @return true if the timer and sampler task are running
+   */
+  bool begin(uint8_t adc_pin, uint16_t rate) {
+    if (timer || sampler_task) {
+      end();
+    }
+    pin = adc_pin;
+    active = this;
+
+    if (!configure(rate, 0, 0)) {
+      Serial.print("[ECG-ACQ] ✗ Unsupported sample rate: ");
+      Serial.println(rate);
+      return false;
+    }
+
+    BaseType_t ok = xTaskCreatePinnedToCore(
+      samplerTask, "ecg_sampler", ECG_SAMPLER_STACK, this,
+      ECG_SAMPLER_PRIORITY, &sampler_task, ECG_SAMPLER_CORE);
+    if (ok != pdPASS) {
+      Serial.println("[ECG-ACQ] ✗ Failed to create sampler task");
+      sampler_task = nullptr;
+      return false;
+    }
+
+#if ESP_ARDUINO_VERSION_MAJOR >= 3
+    timer = timerBegin(1000000);                 // 1 MHz timer clock
+    if (!timer) {
+      Serial.println("[ECG-ACQ] ✗ No hardware timer available");
+      end();
+      return false;
+    }
+    timerAttachInterrupt(timer, &onTimerISR);
+    start_us = (uint32_t)micros() + period_us;   // first tick one period from now
+    start_ms = (uint32_t)millis() + period_us / 1000;
+    timerAlarm(timer, period_us, true, 0);
+#else
+    timer = timerBegin(0, 80, true);             // 80 MHz APB / 80 = 1 MHz
+    if (!timer) {
+      Serial.println("[ECG-ACQ] ✗ No hardware timer available");
+      end();
+      return false;
+    }
+    timerAttachInterrupt(timer, &onTimerISR, true);
+    timerAlarmWrite(timer, period_us, true);
+    start_us = (uint32_t)micros() + period_us;
+    start_ms = (uint32_t)millis() + period_us / 1000;
+    timerAlarmEnable(timer);
+#endif
+
+    Serial.print("[ECG-ACQ] ✓ Sampling GPIO");
+    Serial.print(pin);
+    Serial.print(" at ");
+    Serial.print(rate_hz);
+    Serial.println(" Hz (timer-driven)");
+    return true;
+  }
+
+  /**
+   * Stop the timer and sampler task
+   */
+  void end() {
+    if (timer) {
+      timerDetachInterrupt(timer);
+      timerEnd(timer);
+      timer = nullptr;
+    }
+    if (sampler_task) {
+      vTaskDelete(sampler_task);
+      sampler_task = nullptr;
+    }
+    if (active == this) {
+      active = nullptr;
+    }
+  }
+#endif
+};
+
+#ifdef ARDUINO
+EcgAcquisition* EcgAcquisition::active = nullptr;
+#endif
+
+#endif // ECG_ACQUISITION_H
@@ -0,0 +1,294 @@
+/*
+ * LifeBand ECG Pre-Filter
+ * Streaming mains notch + baseline-wander removal + optional decimation
+ *
+ * Sits between EcgAcquisition and QrsDetector:
+ *   notch     - 2nd-order IIR notch at 50 or 60 Hz, ~4 Hz wide at any rate,
+ *               Q14 coefficients, int64 accumulation, unity DC gain
+ *   baseline  - two cascaded running means (200 ms then 600 ms) estimate
+ *               respiration drift; output = delayed input - baseline.
+ *               Corner is ~1 Hz (0.3 Hz wander down 24 dB), tuned for beat
+ *               detection rather than ST-segment fidelity; delay is 400 ms
+ *   decimate  - optional factor 2/4 by block averaging
+ *
+ * Samples are processed in blocks, every buffer is sized for 500 Hz at
+ * compile time and nothing is allocated at runtime. Output indices are
+ * consecutive in the decimated index space; toInputIndex() maps them back
+ * to acquisition sample indices (group delay already compensated).
+ */
+
+#ifndef ECG_FILTER_H
+#define ECG_FILTER_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <math.h>
+#include "ecg_acquisition.h"
+
+#define ECG_FILTER_MAX_RATE_HZ 500
+#define ECG_FILTER_MAX_SHORT 104    // 200 ms at 500 Hz = 101
+#define ECG_FILTER_MAX_LONG 304     // 600 ms at 500 Hz = 301
+#define ECG_FILTER_DELAY_LINE 256   // power of two >= max baseline delay (200)
+#define ECG_FILTER_MAX_GAP_FILL 16  // missing samples bridged by repetition
+#define ECG_NOTCH_BANDWIDTH_HZ 4.0f  // -3 dB width of the mains notch
+
+enum MainsNotch {
+  NOTCH_OFF = 0,
+  NOTCH_50HZ = 50,
+  NOTCH_60HZ = 60
+};
+
+class EcgPreFilter {
+private:
+  template <size_t N>
+  struct RunningMean {
+    int32_t buf[N];
+    uint16_t len;
+    uint16_t pos;
+    int32_t sum;
+
+    RunningMean() : buf(), len(1), pos(0), sum(0) {
+    }
+
+    void init(uint16_t length, int32_t fill) {
+      len = length;
+      pos = 0;
+      sum = fill * (int32_t)length;
+      for (uint16_t i = 0; i < length; i++) buf[i] = fill;
+    }
+
+    int32_t push(int32_t x) {
+      sum += x - buf[pos];
+      buf[pos] = x;
+      if (++pos == len) pos = 0;
+      return sum / (int32_t)len;
+    }
+  };
+
+  // --- Configuration ---
+  uint16_t fs;
+  MainsNotch notch_hz;
+  uint8_t decimation;
+  uint16_t short_len;
+  uint16_t long_len;
+  uint16_t delay;           // baseline group delay in input samples
+
+  // --- Notch (Q14 coefficients, Q4 state) ---
+  int32_t b0, b1, b2, a1, a2;
+  int32_t nx1, nx2, ny1, ny2;
+
+  // --- Baseline ---
+  RunningMean<ECG_FILTER_MAX_SHORT> mean_short;
+  RunningMean<ECG_FILTER_MAX_LONG> mean_long;
+  int16_t delay_line[ECG_FILTER_DELAY_LINE];
+
+  // --- Decimation / indexing ---
+  int32_t dec_sum;
+  uint8_t dec_count;
+  bool primed;
+  uint32_t next_in;         // next expected input index
+  uint32_t first_in;        // input index of the first sample after (re)start
+  uint32_t out_base;        // output index of first_in
+  int16_t last_in;
+
+  uint32_t gap_fills;
+  uint32_t restarts;
+
+  void designNotch() {
+    if (notch_hz == NOTCH_OFF || notch_hz * 2 >= fs) {
+      b0 = 1 << 14; b1 = 0; b2 = 0; a1 = 0; a2 = 0;
+      return;
+    }
+    // Pole radius sets the -3 dB width: r = 1 - pi * BW / fs
+    const float r = 1.0f - 3.14159265f * ECG_NOTCH_BANDWIDTH_HZ / (float)fs;
+    float c = cosf(2.0f * 3.14159265f * (float)notch_hz / (float)fs);
+    float fb1 = -2.0f * c;
+    float fa1 = -2.0f * r * c;
+    float fa2 = r * r;
+    // Scale the numerator so DC passes with unity gain
+    float g = (1.0f + fa1 + fa2) / (2.0f + fb1);
+    b0 = (int32_t)lroundf(g * 16384.0f);
+    b1 = (int32_t)lroundf(g * fb1 * 16384.0f);
+    b2 = b0;
+    a1 = (int32_t)lroundf(fa1 * 16384.0f);
+    a2 = (int32_t)lroundf(fa2 * 16384.0f);
+  }
+
+  int32_t notchStep(int32_t x) {
+    int32_t xs = x << 4;
+    int64_t acc = (int64_t)b0 * xs + (int64_t)b1 * nx1 + (int64_t)b2 * nx2
+                - (int64_t)a1 * ny1 - (int64_t)a2 * ny2;
+    int32_t y = (int32_t)(acc >> 14);
+    nx2 = nx1; nx1 = xs;
+    ny2 = ny1; ny1 = y;
+    return (y + 8) >> 4;
+  }
+
+  void prime(int16_t x) {
+    int32_t xs = (int32_t)x << 4;
+    nx1 = nx2 = ny1 = ny2 = xs;
+    mean_short.init(short_len, x);
+    mean_long.init(long_len, x);
+    for (uint16_t i = 0; i < ECG_FILTER_DELAY_LINE; i++) delay_line[i] = x;
+    dec_sum = 0;
+    dec_count = 0;
+    primed = true;
+  }
+
+  /**
+   * Run one input sample through the chain
+   * @return true if an output sample was produced
+   */
+  bool step(int16_t x, uint32_t in_index, EcgSample& out) {
+    int32_t v = notchStep(x);
+    delay_line[in_index & (ECG_FILTER_DELAY_LINE - 1)] = (int16_t)v;
+
+    int32_t base = mean_long.push(mean_short.push(v));
+    int32_t centred = (int32_t)delay_line[(in_index - delay) & (ECG_FILTER_DELAY_LINE - 1)] - base;
+
+    // Nothing valid until the delay line has filled once
+    if (in_index - first_in < delay) {
+      return false;
+    }
+
+    dec_sum += centred;
+    if (++dec_count < decimation) {
+      return false;
+    }
+    int32_t y = dec_sum / decimation;
+    dec_sum = 0;
+    dec_count = 0;
+
+    if (y > 32767) y = 32767;
+    if (y < -32768) y = -32768;
+    out.index = out_base + (in_index - delay - first_in) / decimation;
+    out.value = (int16_t)y;
+    return true;
+  }
+
+public:
+  EcgPreFilter() : fs(0) {
+    configure(250, NOTCH_50HZ, 1);
+  }
+
+  /**
+   * @param rate_hz: input sample rate (<= ECG_FILTER_MAX_RATE_HZ)
+   * @param notch: mains frequency to reject, or NOTCH_OFF
+   * @param decimate: 1, 2 or 4
+   * @return false for an unsupported combination (previous setup kept)
+   */
+  bool configure(uint16_t rate_hz, MainsNotch notch, uint8_t decimate) {
+    if (rate_hz < 100 || rate_hz > ECG_FILTER_MAX_RATE_HZ) {
+      return false;
+    }
+    if (decimate != 1 && decimate != 2 && decimate != 4) {
+      return false;
+    }
+    fs = rate_hz;
+    notch_hz = notch;
+    decimation = decimate;
+    short_len = (uint16_t)(fs / 5) | 1;              // 200 ms, odd
+    long_len = (uint16_t)(fs * 3 / 5) | 1;           // 600 ms, odd
+    delay = (short_len - 1) / 2 + (long_len - 1) / 2;
+    designNotch();
+    reset();
+    return true;
+  }
+
+  /**
+   * Change only the notch frequency, keeping rate and decimation
+   *
+   * The chain re-primes on the next sample. Output indices carry on from
+   * the current input position, as after a gap restart, so they never run
+   * backwards and toInputIndex() stays valid across the change.
+   */
+  bool setNotch(MainsNotch notch) {
+    if (primed) {
+      out_base += (next_in - first_in) / decimation + 1;
+      primed = false;
+    }
+    notch_hz = notch;
+    designNotch();
+    return true;
+  }
+
+  /**
+   * Forget all history; the next sample re-primes the filters
+   */
+  void reset() {
+    primed = false;
+    next_in = 0;
+    first_in = 0;
+    out_base = 0;
+    last_in = 0;
+    gap_fills = 0;
+    restarts = 0;
+    dec_sum = 0;
+    dec_count = 0;
+  }
+
+  /**
+   * Filter a block of acquisition samples
+   * @param out: room for at least count samples
+   * @return number of output samples written
+   */
+  size_t process(const EcgSample* in, size_t count, EcgSample* out) {
+    size_t produced = 0;
+    for (size_t i = 0; i < count; i++) {
+      uint32_t idx = in[i].index;
+      int16_t x = in[i].value;
+
+      if (!primed) {
+        prime(x);
+        next_in = first_in = idx;
+      } else if (idx != next_in) {
+        uint32_t gap = idx - next_in;
+        if ((int32_t)gap < 0) {
+          continue;   // duplicate or out-of-order
+        }
+        if (gap > ECG_FILTER_MAX_GAP_FILL) {
+          // Too long to bridge: restart, keeping output indices monotonic
+          uint32_t resume = out_base + (next_in - first_in) / decimation + 1;
+          prime(x);
+          next_in = first_in = idx;
+          out_base = resume;
+          restarts++;
+        } else {
+          // Keep the filter state continuous; the bridged outputs are
+          // dropped so out never needs more room than count (QrsDetector
+          // bridges the resulting short index gap itself)
+          EcgSample dummy;
+          while (next_in != idx) {
+            step(last_in, next_in, dummy);
+            next_in++;
+            gap_fills++;
+          }
+        }
+      }
+
+      if (step(x, idx, out[produced])) {
+        produced++;
+      }
+      last_in = x;
+      next_in = idx + 1;
+    }
+    return produced;
+  }
+
+  /**
+   * Acquisition sample index that an output index corresponds to
+   */
+  uint32_t toInputIndex(uint32_t out_index) const {
+    return first_in + (out_index - out_base) * decimation;
+  }
+
+  uint16_t inputRate() const { return fs; }
+  uint16_t outputRate() const { return fs / decimation; }
+  uint16_t delaySamples() const { return delay; }
+  uint8_t decimationFactor() const { return decimation; }
+  MainsNotch notchFrequency() const { return notch_hz; }
+  uint32_t gapFillCount() const { return gap_fills; }
+  uint32_t restartCount() const { return restarts; }
+};
+
+#endif // ECG_FILTER_H
@@ -0,0 +1,318 @@
+/*
+ * LifeBand Feature Windows
+ * Windowed, incrementally updated model inputs on a fixed cadence
+ *
+ * The models used to get one instantaneous snapshot per beat: the last
+ * beat's QRS width and amplitude, whatever HR and SpO2 happened to be
+ * current. FeatureExtractor aggregates beats (RR, ECG HR, QRS width, R
+ * amplitude) and once-per-tick vitals samples (fused HR, SpO2, BP) over two
+ * windows, 30 s for rhythm and 5 minutes for the pregnancy risks, and emits
+ * one AiFeatures vector per window every FEATURE_HOP_MS:
+ *
+ *   ECG HR, HR, QRS width, R amplitude, SpO2, BP   window mean
+ *   SDNN, RR variance                              std / variance of RR
+ *
+ * Each window is FEATURE_WINDOW_BUCKETS time-aligned buckets (1 s and 10 s
+ * by default) holding count, sum and sum of squares per channel. Closing a
+ * bucket adds it to the window totals and evicts the bucket that left, so
+ * an emission costs the same whatever the window length. Values are summed
+ * as integers in 1/FEATURE_QUANT units, as BeatHistory does with RR: adding
+ * and evicting is exact, and a window never drifts however long it runs.
+ * An emission covers the closed buckets only, so the same inputs give the
+ * same features whenever they are replayed.
+ *
+ * A feature without samples in its window is 0 ("not measured", which the
+ * models' callers already skip on), SDNN needs two RR intervals. Inputs
+ * older than the open bucket (a beat timestamped just before a tick) are
+ * counted in the open bucket; a gap longer than a window restarts it.
+ *
+ * Single owner (inference stage); no Arduino dependency.
+ */
+
+#ifndef FEATURE_WINDOW_H
+#define FEATURE_WINDOW_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+#include <math.h>
+#include "model_registry.h"
+
+#define FEATURE_WINDOW_BUCKETS 30           // buckets per window
+#define FEATURE_SHORT_WINDOW_MS 30000UL     // rhythm (1 s buckets)
+#define FEATURE_LONG_WINDOW_MS 300000UL     // pregnancy risks (10 s buckets)
+#define FEATURE_HOP_MS 1000UL               // one emission per second
+#define FEATURE_QUANT 10                    // sums kept in 0.1 units
+
+// Aggregated input streams
+enum FeatureChannel : uint8_t {
+  FEAT_CH_RR = 0,           // ms, per beat
+  FEAT_CH_ECG_HR = 1,       // BPM, per beat (60000 / RR)
+  FEAT_CH_QRS = 2,          // ms, per beat
+  FEAT_CH_AMPLITUDE = 3,    // ADC counts, per beat
+  FEAT_CH_HR = 4,           // fused BPM, per tick
+  FEAT_CH_SPO2 = 5,         // %, per tick
+  FEAT_CH_BP_SYS = 6,       // mmHg, per tick
+  FEAT_CH_BP_DIA = 7,       // mmHg, per tick
+  FEAT_CH_COUNT = 8
+};
+
+struct FeatureStats {
+  uint32_t count;
+  float mean;
+  float variance;           // population variance
+};
+
+struct FeatureWindowStats {
+  uint32_t emitted;         // emit() calls
+  uint32_t beats;
+  uint32_t samples;         // addVitals() calls
+  uint32_t late;            // inputs older than the open bucket
+  uint32_t restarts;        // windows cleared by a gap
+};
+
+class FeatureExtractor {
+private:
+  static const uint32_t RING = FEATURE_WINDOW_BUCKETS + 1;   // closed buckets + the open one
+
+  struct Window {
+    uint32_t bucket_ms;
+    uint32_t open;                          // id (time / bucket_ms) of the open bucket
+    bool started;
+    // Structure of arrays, slot = bucket id % RING
+    uint16_t count[RING][FEAT_CH_COUNT];
+    int32_t sum[RING][FEAT_CH_COUNT];
+    int64_t sum2[RING][FEAT_CH_COUNT];
+    // Totals over the closed buckets [open - BUCKETS, open)
+    uint32_t total_count[FEAT_CH_COUNT];
+    int64_t total_sum[FEAT_CH_COUNT];
+    int64_t total_sum2[FEAT_CH_COUNT];
+  };
+
+  Window windows[FEATURE_WINDOW_COUNT];
+  AiFeatures features[FEATURE_WINDOW_COUNT];
+  uint32_t next_emit_ms;
+  bool emitting;
+
+  FeatureWindowStats stats;
+
+  static void clearWindow(Window& w) {
+    uint32_t bucket_ms = w.bucket_ms;
+    memset(&w, 0, sizeof(w));
+    w.bucket_ms = bucket_ms;
+  }
+
+  /**
+   * Close buckets until id is the open one
+   */
+  void advance(Window& w, uint32_t id) {
+    if (!w.started) {
+      w.started = true;
+      w.open = id;
+      return;
+    }
+    if (id - w.open > FEATURE_WINDOW_BUCKETS) {
+      clearWindow(w);                       // nothing in the window is recent
+      w.started = true;
+      w.open = id;
+      stats.restarts++;
+      return;
+    }
+    while (w.open != id) {
+      uint32_t closed = w.open % RING;
+      for (uint8_t c = 0; c < FEAT_CH_COUNT; c++) {
+        w.total_count[c] += w.count[closed][c];
+        w.total_sum[c] += w.sum[closed][c];
+        w.total_sum2[c] += w.sum2[closed][c];
+      }
+      w.open++;
+      // The new open bucket reuses the slot of the one leaving the window
+      uint32_t evicted = w.open % RING;
+      for (uint8_t c = 0; c < FEAT_CH_COUNT; c++) {
+        w.total_count[c] -= w.count[evicted][c];
+        w.total_sum[c] -= w.sum[evicted][c];
+        w.total_sum2[c] -= w.sum2[evicted][c];
+        w.count[evicted][c] = 0;
+        w.sum[evicted][c] = 0;
+        w.sum2[evicted][c] = 0;
+      }
+    }
+  }
+
+  /**
+   * Open the bucket of time_ms in every window
+   * @return false if time_ms lies before the open buckets (a late input)
+   */
+  bool seek(uint32_t time_ms) {
+    bool late = false;
+    for (uint8_t i = 0; i < FEATURE_WINDOW_COUNT; i++) {
+      Window& w = windows[i];
+      uint32_t id = time_ms / w.bucket_ms;
+      if (w.started && id != w.open && w.open - id <= FEATURE_WINDOW_BUCKETS) {
+        late = true;                        // slightly in the past: count it in the open bucket
+      } else {
+        advance(w, id);                     // forward, or far away (clock restart): restart
+      }
+    }
+    return !late;
+  }
+
+  void add(FeatureChannel channel, float value) {
+    int32_t q = (int32_t)lroundf(value * FEATURE_QUANT);
+    for (uint8_t i = 0; i < FEATURE_WINDOW_COUNT; i++) {
+      Window& w = windows[i];
+      uint32_t slot = w.open % RING;
+      w.count[slot][channel]++;
+      w.sum[slot][channel] += q;
+      w.sum2[slot][channel] += (int64_t)q * q;
+    }
+  }
+
+  FeatureStats windowStats(const Window& w, FeatureChannel channel) const {
+    FeatureStats s;
+    s.count = w.total_count[channel];
+    s.mean = 0;
+    s.variance = 0;
+    if (s.count == 0) {
+      return s;
+    }
+    int64_t n = s.count;
+    s.mean = (float)w.total_sum[channel] / (float)(n * FEATURE_QUANT);
+    if (n >= 2) {
+      // n * sum(x^2) - sum(x)^2 is exact in 64 bits for these windows
+      int64_t num = n * w.total_sum2[channel] - w.total_sum[channel] * w.total_sum[channel];
+      s.variance = (float)num / ((float)n * (float)n * FEATURE_QUANT * FEATURE_QUANT);
+    }
+    return s;
+  }
+
+  void computeFeatures(const Window& w, AiFeatures& f) const {
+    FeatureStats rr = windowStats(w, FEAT_CH_RR);
+    f.v[AI_FEAT_ECG_HR] = windowStats(w, FEAT_CH_ECG_HR).mean;
+    f.v[AI_FEAT_HR] = windowStats(w, FEAT_CH_HR).mean;
+    f.v[AI_FEAT_SDNN] = rr.count >= 2 ? sqrtf(rr.variance) : 0.0f;
+    f.v[AI_FEAT_RR_VARIANCE] = rr.variance;
+    f.v[AI_FEAT_QRS_WIDTH] = windowStats(w, FEAT_CH_QRS).mean;
+    f.v[AI_FEAT_R_AMPLITUDE] = windowStats(w, FEAT_CH_AMPLITUDE).mean;
+    f.v[AI_FEAT_SPO2] = windowStats(w, FEAT_CH_SPO2).mean;
+    f.v[AI_FEAT_BP_SYS] = windowStats(w, FEAT_CH_BP_SYS).mean;
+    f.v[AI_FEAT_BP_DIA] = windowStats(w, FEAT_CH_BP_DIA).mean;
+  }
+
+public:
+  /**
+   * @param short_ms: FEATURE_WINDOW_SHORT length
+   * @param long_ms: FEATURE_WINDOW_LONG length
+   */
+  explicit FeatureExtractor(uint32_t short_ms = FEATURE_SHORT_WINDOW_MS, uint32_t long_ms = FEATURE_LONG_WINDOW_MS) {
+    memset(&stats, 0, sizeof(stats));
+    configure(short_ms, long_ms);
+  }
+
+  /**
+   * Set the window lengths (rounded down to whole buckets) and start over
+   */
+  void configure(uint32_t short_ms, uint32_t long_ms) {
+    windows[FEATURE_WINDOW_SHORT].bucket_ms = short_ms >= FEATURE_WINDOW_BUCKETS ? short_ms / FEATURE_WINDOW_BUCKETS : 1;
+    windows[FEATURE_WINDOW_LONG].bucket_ms = long_ms >= FEATURE_WINDOW_BUCKETS ? long_ms / FEATURE_WINDOW_BUCKETS : 1;
+    clear();
+  }
+
+  void clear() {
+    for (uint8_t i = 0; i < FEATURE_WINDOW_COUNT; i++) {
+      clearWindow(windows[i]);
+    }
+    memset(features, 0, sizeof(features));
+    next_emit_ms = 0;
+    emitting = false;
+  }
+
+  /**
+   * One accepted ECG beat
+   */
+  void addBeat(uint32_t time_ms, uint16_t rr_ms, uint16_t qrs_ms, uint16_t amplitude) {
+    if (rr_ms == 0) {
+      return;
+    }
+    if (!seek(time_ms)) {
+      stats.late++;
+    }
+    add(FEAT_CH_RR, rr_ms);
+    add(FEAT_CH_ECG_HR, 60000.0f / rr_ms);
+    add(FEAT_CH_QRS, qrs_ms);
+    add(FEAT_CH_AMPLITUDE, amplitude);
+    stats.beats++;
+  }
+
+  /**
+   * Current vitals, once per tick; values <= 0 are not measured and skipped
+   */
+  void addVitals(uint32_t time_ms, float hr, float spo2, float bp_sys, float bp_dia) {
+    if (!seek(time_ms)) {
+      stats.late++;
+    }
+    if (hr > 0) {
+      add(FEAT_CH_HR, hr);
+    }
+    if (spo2 > 0) {
+      add(FEAT_CH_SPO2, spo2);
+    }
+    if (bp_sys > 0 && bp_dia > 0) {
+      add(FEAT_CH_BP_SYS, bp_sys);
+      add(FEAT_CH_BP_DIA, bp_dia);
+    }
+    stats.samples++;
+  }
+
+  /**
+   * @return true once every FEATURE_HOP_MS; ticks missed by more than a
+   *         hop are skipped, not caught up
+   */
+  bool due(uint32_t now_ms) {
+    if (!emitting) {
+      emitting = true;
+      next_emit_ms = now_ms;
+    }
+    if ((int32_t)(now_ms - next_emit_ms) < 0) {
+      return false;
+    }
+    next_emit_ms += FEATURE_HOP_MS;
+    if ((int32_t)(now_ms - next_emit_ms) >= 0) {
+      next_emit_ms = now_ms + FEATURE_HOP_MS;
+    }
+    return true;
+  }
+
+  /**
+   * Close the buckets before now_ms and compute every window's features
+   * @return FEATURE_WINDOW_COUNT vectors, indexed by FeatureWindow
+   */
+  const AiFeatures* emit(uint32_t now_ms) {
+    seek(now_ms);
+    for (uint8_t i = 0; i < FEATURE_WINDOW_COUNT; i++) {
+      computeFeatures(windows[i], features[i]);
+    }
+    stats.emitted++;
+    return features;
+  }
+
+  /**
+   * Statistics of one channel over a window as of the last emit()
+   */
+  FeatureStats channelStats(FeatureWindow window, FeatureChannel channel) const {
+    FeatureStats none = { 0, 0, 0 };
+    return window < FEATURE_WINDOW_COUNT && channel < FEAT_CH_COUNT ? windowStats(windows[window], channel) : none;
+  }
+
+  uint32_t windowMs(FeatureWindow window) const {
+    return window < FEATURE_WINDOW_COUNT ? windows[window].bucket_ms * FEATURE_WINDOW_BUCKETS : 0;
+  }
+
+  const AiFeatures& latest(FeatureWindow window) const {
+    return features[window < FEATURE_WINDOW_COUNT ? window : 0];
+  }
+
+  FeatureWindowStats getStats() const { return stats; }
+};
+
+#endif // FEATURE_WINDOW_H
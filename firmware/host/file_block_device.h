@@ -0,0 +1,203 @@
+/*
+ * LifeBand Host Build - File-backed Block Device
+ * NOR flash semantics on a regular file, with power-cut injection
+ *
+ * Stands in for PartitionBlockDevice so storage engines run unchanged on a
+ * Linux host. The file is the flash image: erase() fills a sector with
+ * 0xFF and program() ANDs the new bytes into the old ones, as NOR flash
+ * does, so code that programs over unerased data is caught the same way.
+ *
+ * mapReadOnly() mmap()s the file shared, so the mapping follows program()
+ * and erase() as the flash cache mapping does on the device.
+ *
+ * cutPowerAfter(n) lets n more erase/program operations complete; the next
+ * one is interrupted part-way (a random prefix of the program is written,
+ * or a random part of the sector is erased) and every later operation
+ * fails until powerOn(). Reopening the file then models a reboot.
+ */
+
+#ifndef FILE_BLOCK_DEVICE_H
+#define FILE_BLOCK_DEVICE_H
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+#include <sys/mman.h>
+#include "../block_device.h"
+
+class FileBlockDevice : public BlockDevice {
+private:
+  FILE* file;
+  void* mapped;
+  uint32_t sector_size;
+  uint32_t sector_count;
+
+  bool powered;
+  int32_t ops_left;         // operations until the cut, -1 = never
+  uint32_t seed;
+
+  uint32_t programs;
+  uint32_t erases;
+  uint64_t bytes_programmed;
+
+  uint32_t random() {
+    seed = seed * 1664525u + 1013904223u;
+    return seed >> 8;
+  }
+
+  /**
+   * Count one erase/program against the power-cut budget
+   * @param done: bytes of the operation to carry out (less than len if cut)
+   * @return false if the power is already off
+   */
+  bool beginOp(size_t len, size_t& done) {
+    done = len;
+    if (!powered) {
+      return false;
+    }
+    if (ops_left > 0) {
+      ops_left--;
+    } else if (ops_left == 0) {
+      done = len ? random() % len : 0;     // interrupted part-way
+      powered = false;
+    }
+    return true;
+  }
+
+public:
+  FileBlockDevice() :
+    file(nullptr),
+    mapped(nullptr),
+    sector_size(4096),
+    sector_count(0),
+    powered(true),
+    ops_left(-1),
+    seed(1),
+    programs(0),
+    erases(0),
+    bytes_programmed(0) {
+  }
+
+  ~FileBlockDevice() {
+    close();
+  }
+
+  /**
+   * Open (or create, erased) a flash image
+   */
+  bool open(const char* path, uint32_t sectors, uint32_t sector_bytes = 4096) {
+    close();
+    sector_size = sector_bytes;
+    sector_count = sectors;
+    file = fopen(path, "r+b");
+    if (!file) {
+      file = fopen(path, "w+b");
+      if (!file) {
+        return false;
+      }
+      uint8_t blank[256];
+      memset(blank, 0xFF, sizeof(blank));
+      for (uint64_t i = 0; i < (uint64_t)sectors * sector_bytes; i += sizeof(blank)) {
+        fwrite(blank, 1, sizeof(blank), file);
+      }
+      fflush(file);
+    }
+    return true;
+  }
+
+  void close() {
+    if (mapped) {
+      munmap(mapped, (size_t)sector_size * sector_count);
+      mapped = nullptr;
+    }
+    if (file) {
+      fclose(file);
+      file = nullptr;
+    }
+  }
+
+  void cutPowerAfter(int32_t operations, uint32_t random_seed) {
+    ops_left = operations;
+    seed = random_seed;
+  }
+
+  void powerOn() {
+    powered = true;
+    ops_left = -1;
+  }
+
+  bool isPowered() const { return powered; }
+  uint32_t programCount() const { return programs; }
+  uint32_t eraseCount() const { return erases; }
+  uint64_t bytesProgrammed() const { return bytes_programmed; }
+
+  uint32_t sectorSize() const override { return sector_size; }
+  uint32_t sectorCount() const override { return sector_count; }
+
+  const uint8_t* mapReadOnly() override {
+    if (!mapped && file) {
+      fflush(file);
+      void* p = mmap(nullptr, (size_t)sector_size * sector_count, PROT_READ, MAP_SHARED, fileno(file), 0);
+      mapped = p == MAP_FAILED ? nullptr : p;
+    }
+    return (const uint8_t*)mapped;
+  }
+
+  bool read(uint32_t offset, void* dst, size_t len) override {
+    if (!file || !powered || (uint64_t)offset + len > (uint64_t)sector_size * sector_count) {
+      return false;
+    }
+    fseek(file, offset, SEEK_SET);
+    return fread(dst, 1, len, file) == len;
+  }
+
+  bool program(uint32_t offset, const void* src, size_t len) override {
+    if (!file || (uint64_t)offset + len > (uint64_t)sector_size * sector_count) {
+      return false;
+    }
+    size_t done = 0;
+    if (!beginOp(len, done)) {
+      return false;
+    }
+    uint8_t old[256];
+    const uint8_t* in = (const uint8_t*)src;
+    for (size_t pos = 0; pos < done; pos += sizeof(old)) {
+      size_t n = done - pos < sizeof(old) ? done - pos : sizeof(old);
+      fseek(file, offset + pos, SEEK_SET);
+      if (fread(old, 1, n, file) != n) return false;
+      for (size_t i = 0; i < n; i++) old[i] &= in[pos + i];   // bits only clear
+      fseek(file, offset + pos, SEEK_SET);
+      fwrite(old, 1, n, file);
+    }
+    fflush(file);
+    programs++;
+    bytes_programmed += done;
+    return done == len && powered;
+  }
+
+  bool erase(uint32_t sector) override {
+    if (!file || sector >= sector_count) {
+      return false;
+    }
+    size_t done = 0;
+    if (!beginOp(sector_size, done)) {
+      return false;
+    }
+    // An interrupted erase leaves a random part of the sector erased
+    uint8_t blank[256];
+    memset(blank, 0xFF, sizeof(blank));
+    uint32_t start = done < sector_size ? random() % sector_size : 0;
+    if (start + done > sector_size) done = sector_size - start;
+    for (size_t pos = 0; pos < done; pos += sizeof(blank)) {
+      size_t n = done - pos < sizeof(blank) ? done - pos : sizeof(blank);
+      fseek(file, (uint64_t)sector * sector_size + start + pos, SEEK_SET);
+      fwrite(blank, 1, n, file);
+    }
+    fflush(file);
+    erases++;
+    return done == sector_size && powered;
+  }
+};
+
+#endif // FILE_BLOCK_DEVICE_H
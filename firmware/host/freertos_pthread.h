@@ -0,0 +1,166 @@
+/*
+ * LifeBand Host Build - FreeRTOS Task API on pthreads
+ * Just enough of FreeRTOS and the Arduino clock to run pipeline.h on Linux
+ *
+ * Tasks are detached pthreads; direct-to-task notifications are a counter
+ * guarded by a mutex/condition variable, which keeps the semantics the
+ * stages rely on (xTaskNotifyGive accumulates, ulTaskNotifyTake returns the
+ * count and blocks with a timeout). Core affinity and priorities are
+ * accepted and ignored: the host scheduler is not the ESP32 one, so host
+ * runs measure queue depth and hand-off latency under contention, not
+ * deadline behaviour.
+ *
+ * Task handles are never freed, so a late notify to a deleted task is
+ * harmless. Link with -pthread.
+ */
+
+#ifndef FREERTOS_PTHREAD_H
+#define FREERTOS_PTHREAD_H
+
+#ifdef ARDUINO
+#error "host/freertos_pthread.h is for host builds only"
+#endif
+
+#include <stdint.h>
+#include <stddef.h>
+#include <pthread.h>
+#include <time.h>
+#include <errno.h>
+
+typedef long BaseType_t;
+typedef unsigned long UBaseType_t;
+typedef uint32_t TickType_t;
+
+#define pdFALSE 0
+#define pdTRUE 1
+#define pdFAIL 0
+#define pdPASS 1
+#define portMAX_DELAY 0xFFFFFFFFUL
+#define portTICK_PERIOD_MS 1
+#define pdMS_TO_TICKS(ms) ((TickType_t)(ms))
+
+struct HostTask {
+  pthread_t thread;
+  pthread_mutex_t lock;
+  pthread_cond_t cond;
+  uint32_t notify_count;
+  void (*fn)(void*);
+  void* arg;
+};
+
+typedef HostTask* TaskHandle_t;
+
+static inline uint64_t hostMonotonicUs() {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec * 1000000ULL + (uint64_t)ts.tv_nsec / 1000ULL;
+}
+
+static inline uint32_t micros() {
+  return (uint32_t)hostMonotonicUs();
+}
+
+static inline uint32_t millis() {
+  return (uint32_t)(hostMonotonicUs() / 1000ULL);
+}
+
+static inline HostTask*& hostCurrentTask() {
+  static thread_local HostTask* current = nullptr;
+  return current;
+}
+
+static inline void* hostTaskEntry(void* p) {
+  HostTask* task = (HostTask*)p;
+  hostCurrentTask() = task;
+  task->fn(task->arg);
+  return nullptr;
+}
+
+static inline BaseType_t xTaskCreatePinnedToCore(void (*fn)(void*), const char* name,
+                                                 uint32_t stack_bytes, void* arg,
+                                                 UBaseType_t priority, TaskHandle_t* handle,
+                                                 BaseType_t core) {
+  (void)name; (void)stack_bytes; (void)priority; (void)core;
+  HostTask* task = new HostTask();
+  pthread_mutex_init(&task->lock, nullptr);
+  pthread_condattr_t attr;
+  pthread_condattr_init(&attr);
+  pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+  pthread_cond_init(&task->cond, &attr);
+  pthread_condattr_destroy(&attr);
+  task->notify_count = 0;
+  task->fn = fn;
+  task->arg = arg;
+  if (pthread_create(&task->thread, nullptr, hostTaskEntry, task) != 0) {
+    delete task;
+    return pdFAIL;
+  }
+  pthread_detach(task->thread);
+  if (handle) {
+    *handle = task;
+  }
+  return pdPASS;
+}
+
+static inline void xTaskNotifyGive(TaskHandle_t task) {
+  pthread_mutex_lock(&task->lock);
+  task->notify_count++;
+  pthread_cond_signal(&task->cond);
+  pthread_mutex_unlock(&task->lock);
+}
+
+static inline uint32_t ulTaskNotifyTake(BaseType_t clear_on_exit, TickType_t ticks) {
+  HostTask* self = hostCurrentTask();
+  if (!self) {
+    return 0;
+  }
+  struct timespec deadline;
+  clock_gettime(CLOCK_MONOTONIC, &deadline);
+  deadline.tv_sec += ticks / 1000;
+  deadline.tv_nsec += (long)(ticks % 1000) * 1000000L;
+  if (deadline.tv_nsec >= 1000000000L) {
+    deadline.tv_sec++;
+    deadline.tv_nsec -= 1000000000L;
+  }
+
+  pthread_mutex_lock(&self->lock);
+  while (self->notify_count == 0) {
+    if (ticks == portMAX_DELAY) {
+      pthread_cond_wait(&self->cond, &self->lock);
+    } else if (pthread_cond_timedwait(&self->cond, &self->lock, &deadline) == ETIMEDOUT) {
+      break;
+    }
+  }
+  uint32_t count = self->notify_count;
+  if (count > 0) {
+    self->notify_count = clear_on_exit ? 0 : count - 1;
+  }
+  pthread_mutex_unlock(&self->lock);
+  return count;
+}
+
+static inline void vTaskDelay(TickType_t ticks) {
+  struct timespec ts;
+  ts.tv_sec = ticks / 1000;
+  ts.tv_nsec = (long)(ticks % 1000) * 1000000L;
+  nanosleep(&ts, nullptr);
+}
+
+/**
+ * Only self-deletion (nullptr or own handle) is supported, as in pipeline.h
+ */
+static inline void vTaskDelete(TaskHandle_t task) {
+  if (task == nullptr || task == hostCurrentTask()) {
+    pthread_exit(nullptr);
+  }
+}
+
+/**
+ * Stack use is not tracked on the host
+ */
+static inline UBaseType_t uxTaskGetStackHighWaterMark(TaskHandle_t task) {
+  (void)task;
+  return 0;
+}
+
+#endif // FREERTOS_PTHREAD_H
@@ -0,0 +1,248 @@
+/*
+ * LifeBand Host Build - Maxim Batch SpO2 Reference
+ * Re-implementation of maxim_heart_rate_and_oxygen_saturation()
+ *
+ * The batch algorithm the firmware called before spo2_estimator.h, kept on
+ * the host so the two can be compared on the same simulated stream. Every
+ * call works on a 4 s buffer (100 samples at 25 Hz):
+ *
+ *   x    = -(IR - mean IR), 4-point moving average
+ *   th   = mean of x, clamped to 30..60
+ *   valleys of IR = peaks of x above th, at least 4 samples apart, at most
+ *        15, a lower peak within 4 samples of a higher one dropped
+ *   HR   = 60 * rate / mean valley-to-valley distance (needs 2 valleys)
+ *
+ * For each pair of neighbouring valleys more than 3 samples apart, the raw
+ * maximum between them is DC and its height above the line joining the two
+ * valleys is AC, for red and IR alike. Up to 5 ratios
+ *
+ *   R * 100 = (AC_red * DC_ir >> 7) * 100 / (AC_ir * DC_red >> 7)
+ *
+ * are sorted and the one at count / 2 (for 4 or 5 ratios the mean of that
+ * one and the one before, as in the original) indexes the Maxim table, i.e.
+ * -45.060 R^2 + 30.354 R + 94.845 rounded, valid for 2 < R * 100 < 184.
+ * Integer arithmetic as in the original.
+ *
+ * add() fills the buffer in time order and runs the batch every hop samples
+ * once it is full, which is the best case for the old call: the firmware
+ * filled it through sampleCount % 50 and ran it every 50 samples.
+ */
+
+#ifndef MAXIM_SPO2_REFERENCE_H
+#define MAXIM_SPO2_REFERENCE_H
+
+#include <stdint.h>
+#include <string.h>
+#include <math.h>
+
+#define MAXIM_SPO2_BUFFER 100
+#define MAXIM_SPO2_MA4 4
+#define MAXIM_SPO2_MAX_PEAKS 15
+#define MAXIM_SPO2_MIN_DISTANCE 4
+#define MAXIM_SPO2_MAX_RATIOS 5
+#define MAXIM_SPO2_TABLE 184
+
+struct MaximSpo2Result {
+  int32_t spo2;             // %, -999 if invalid
+  int32_t heart_rate;       // BPM, -999 if invalid
+  bool spo2_valid;
+  bool hr_valid;
+};
+
+class MaximSpo2Reference {
+private:
+  uint32_t red_buf[MAXIM_SPO2_BUFFER];
+  uint32_t ir_buf[MAXIM_SPO2_BUFFER];
+  int32_t an_x[MAXIM_SPO2_BUFFER];      // file-scope scratch in the original
+  int32_t an_y[MAXIM_SPO2_BUFFER];
+  uint8_t spo2_table[MAXIM_SPO2_TABLE];
+  uint16_t rate_hz;
+  uint16_t hop;
+  uint16_t filled;
+  uint16_t since_run;
+
+  void findPeaksAboveHeight(int32_t* locs, int32_t& count, const int32_t* x, int32_t size, int32_t min_height) {
+    int32_t i = 1;
+    count = 0;
+    while (i < size - 1) {
+      if (x[i] > min_height && x[i] > x[i - 1]) {
+        int32_t width = 1;
+        while (i + width < size && x[i] == x[i + width]) {
+          width++;                          // flat top: report its left edge
+        }
+        if (i + width < size && x[i] > x[i + width] && count < MAXIM_SPO2_MAX_PEAKS) {
+          locs[count++] = i;
+          i += width + 1;
+        } else {
+          i += width;
+        }
+      } else {
+        i++;
+      }
+    }
+  }
+
+  void removeClosePeaks(int32_t* locs, int32_t& count, const int32_t* x) {
+    // Highest first, then drop anything within the minimum distance of a kept peak
+    for (int32_t i = 1; i < count; i++) {
+      int32_t temp = locs[i];
+      int32_t j = i;
+      for (; j > 0 && x[temp] > x[locs[j - 1]]; j--) {
+        locs[j] = locs[j - 1];
+      }
+      locs[j] = temp;
+    }
+    for (int32_t i = -1; i < count; i++) {
+      int32_t old_count = count;
+      count = i + 1;
+      for (int32_t j = i + 1; j < old_count; j++) {
+        int32_t dist = locs[j] - (i == -1 ? -1 : locs[i]);
+        if (dist > MAXIM_SPO2_MIN_DISTANCE || dist < -MAXIM_SPO2_MIN_DISTANCE) {
+          locs[count++] = locs[j];
+        }
+      }
+    }
+    for (int32_t i = 1; i < count; i++) {
+      int32_t temp = locs[i];
+      int32_t j = i;
+      for (; j > 0 && temp < locs[j - 1]; j--) {
+        locs[j] = locs[j - 1];
+      }
+      locs[j] = temp;
+    }
+  }
+
+  void run(MaximSpo2Result& out) {
+    const int32_t n = MAXIM_SPO2_BUFFER;
+    out.spo2 = -999;
+    out.heart_rate = -999;
+    out.spo2_valid = false;
+    out.hr_valid = false;
+
+    uint32_t ir_mean = 0;
+    for (int32_t k = 0; k < n; k++) {
+      ir_mean += ir_buf[k];
+    }
+    ir_mean /= n;
+    for (int32_t k = 0; k < n; k++) {
+      an_x[k] = -((int32_t)ir_buf[k] - (int32_t)ir_mean);
+    }
+    for (int32_t k = 0; k < n - MAXIM_SPO2_MA4; k++) {
+      an_x[k] = (an_x[k] + an_x[k + 1] + an_x[k + 2] + an_x[k + 3]) / 4;
+    }
+
+    int32_t th = 0;
+    for (int32_t k = 0; k < n; k++) {
+      th += an_x[k];
+    }
+    th /= n;
+    if (th < 30) th = 30;
+    if (th > 60) th = 60;
+
+    int32_t valleys[MAXIM_SPO2_MAX_PEAKS];
+    int32_t count;
+    findPeaksAboveHeight(valleys, count, an_x, n - MAXIM_SPO2_MA4, th);
+    removeClosePeaks(valleys, count, an_x);
+
+    if (count >= 2) {
+      int32_t interval = (valleys[count - 1] - valleys[0]) / (count - 1);
+      if (interval > 0) {
+        out.heart_rate = (int32_t)(rate_hz * 60) / interval;
+        out.hr_valid = true;
+      }
+    }
+
+    for (int32_t k = 0; k < n; k++) {
+      an_x[k] = (int32_t)ir_buf[k];
+      an_y[k] = (int32_t)red_buf[k];
+    }
+
+    int32_t ratios[MAXIM_SPO2_MAX_RATIOS];
+    int32_t ratio_count = 0;
+    for (int32_t k = 0; k < count - 1; k++) {
+      int32_t v0 = valleys[k];
+      int32_t v1 = valleys[k + 1];
+      if (v1 - v0 <= 3) {
+        continue;
+      }
+      int32_t x_max = -16777216, y_max = -16777216;
+      int32_t x_loc = v0, y_loc = v0;
+      for (int32_t i = v0; i < v1; i++) {
+        if (an_x[i] > x_max) { x_max = an_x[i]; x_loc = i; }
+        if (an_y[i] > y_max) { y_max = an_y[i]; y_loc = i; }
+      }
+      int32_t y_ac = an_y[v0] + (an_y[v1] - an_y[v0]) * (y_loc - v0) / (v1 - v0);
+      y_ac = an_y[y_loc] - y_ac;
+      int32_t x_ac = an_x[v0] + (an_x[v1] - an_x[v0]) * (x_loc - v0) / (v1 - v0);
+      x_ac = an_x[x_loc] - x_ac;
+      int32_t nume = (int32_t)(((int64_t)y_ac * x_max) >> 7);
+      int32_t denom = (int32_t)(((int64_t)x_ac * y_max) >> 7);
+      if (denom > 0 && nume != 0 && ratio_count < MAXIM_SPO2_MAX_RATIOS) {
+        ratios[ratio_count++] = (int32_t)(((int64_t)nume * 100) / denom);
+      }
+    }
+    if (ratio_count == 0) {
+      return;
+    }
+
+    for (int32_t i = 1; i < ratio_count; i++) {
+      int32_t temp = ratios[i];
+      int32_t j = i;
+      for (; j > 0 && temp < ratios[j - 1]; j--) {
+        ratios[j] = ratios[j - 1];
+      }
+      ratios[j] = temp;
+    }
+    int32_t mid = ratio_count / 2;
+    int32_t ratio = mid > 1 ? (ratios[mid - 1] + ratios[mid]) / 2 : ratios[mid];
+    if (ratio > 2 && ratio < MAXIM_SPO2_TABLE) {
+      out.spo2 = spo2_table[ratio];
+      out.spo2_valid = true;
+    }
+  }
+
+public:
+  MaximSpo2Reference() : rate_hz(25), hop(50), filled(0), since_run(0) {
+    memset(red_buf, 0, sizeof(red_buf));
+    memset(ir_buf, 0, sizeof(ir_buf));
+    for (int i = 0; i < MAXIM_SPO2_TABLE; i++) {
+      float r = i / 100.0f;
+      long v = lroundf(-45.060f * r * r + 30.354f * r + 94.845f);
+      spo2_table[i] = (uint8_t)(v < 0 ? 0 : (v > 100 ? 100 : v));
+    }
+  }
+
+  /**
+   * @param rate sample rate in Hz (the buffer is MAXIM_SPO2_BUFFER samples)
+   * @param hop_samples samples between batch runs once the buffer is full
+   */
+  void configure(uint16_t rate, uint16_t hop_samples) {
+    rate_hz = rate;
+    hop = hop_samples;
+    filled = 0;
+    since_run = 0;
+  }
+
+  /**
+   * Add one red/IR sample
+   * @return true when a batch ran and out holds its result
+   */
+  bool add(uint32_t red, uint32_t ir, MaximSpo2Result& out) {
+    if (filled == MAXIM_SPO2_BUFFER) {
+      memmove(red_buf, red_buf + 1, (MAXIM_SPO2_BUFFER - 1) * sizeof(uint32_t));
+      memmove(ir_buf, ir_buf + 1, (MAXIM_SPO2_BUFFER - 1) * sizeof(uint32_t));
+      filled--;
+    }
+    red_buf[filled] = red;
+    ir_buf[filled] = ir;
+    filled++;
+    if (filled < MAXIM_SPO2_BUFFER || ++since_run < hop) {
+      return false;
+    }
+    since_run = 0;
+    run(out);
+    return true;
+  }
+};
+
+#endif // MAXIM_SPO2_REFERENCE_H
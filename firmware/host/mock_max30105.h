@@ -0,0 +1,232 @@
+/*
+ * LifeBand Host Build - MAX30105 Register Model
+ * Max30105Bus backed by a simulated sensor FIFO
+ *
+ * Models the parts of the MAX30105 the FIFO reader depends on:
+ * - 32-sample FIFO with 5-bit FIFO_WR_PTR / FIFO_RD_PTR that wrap, and
+ *   FIFO_DATA reads that pop one sample per 3 * channels bytes
+ * - OVF_COUNTER (saturates at 31) incremented for each sample that finds
+ *   the FIFO full; with FIFO_ROLLOVER_EN the oldest sample is overwritten,
+ *   without it the new one is lost; popping a complete sample clears it
+ * - A_FULL status set when the FIFO reaches 32 - FIFO_A_FULL samples,
+ *   cleared by reading INT_STATUS1 or FIFO_DATA; the INT line is reported
+ *   through a callback so a test can call Max30105Fifo::onInterrupt()
+ * - register auto-increment on multi-byte reads (except FIFO_DATA)
+ *
+ * Faults can be injected: the next n transfers fail with a given result,
+ * and the bus can be held "stuck" until recover() is called. Sample values
+ * are a counter per LED so order, gaps and wraparound can be checked.
+ */
+
+#ifndef MOCK_MAX30105_H
+#define MOCK_MAX30105_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+#include "../max30105_fifo.h"
+
+class MockMax30105 : public Max30105Bus {
+private:
+  uint8_t regs[256];
+  uint8_t fifo[MAX30105_FIFO_DEPTH][9];
+  uint8_t count;                // samples held in the FIFO
+  size_t read_limit;
+
+  uint32_t next_value;          // sample counter written as the LED values
+  uint8_t partial_bytes;        // FIFO_DATA bytes read of the current sample
+
+  I2cResult fault;
+  uint32_t fault_count;
+  bool stuck;
+
+  void (*int_callback)(void* ctx);
+  void* int_ctx;
+
+  uint8_t channels() const {
+    uint8_t mode = regs[MAX30105_REG_MODE_CONFIG] & 0x07;
+    return mode == 0x02 ? 1 : mode == 0x07 ? 3 : 2;
+  }
+
+  uint8_t almostFullLevel() const {
+    return MAX30105_FIFO_DEPTH - (regs[MAX30105_REG_FIFO_CONFIG] & 0x0F);
+  }
+
+  bool rollover() const {
+    return (regs[MAX30105_REG_FIFO_CONFIG] & 0x10) != 0;
+  }
+
+  uint8_t& wrPtr() { return regs[MAX30105_REG_FIFO_WR_PTR]; }
+  uint8_t& rdPtr() { return regs[MAX30105_REG_FIFO_RD_PTR]; }
+  uint8_t& ovf() { return regs[MAX30105_REG_FIFO_OVF]; }
+
+  void syncCount() {
+    // Pointers written by the host: FIFO content follows them
+    count = (uint8_t)((wrPtr() - rdPtr()) & 0x1F);
+  }
+
+  bool takeFault(I2cResult& result) {
+    if (stuck) {
+      result = I2C_TIMEOUT;
+      return true;
+    }
+    if (fault_count > 0) {
+      fault_count--;
+      result = fault;
+      return true;
+    }
+    return false;
+  }
+
+  uint8_t popFifoByte() {
+    if (count == 0) {
+      return 0;    // an empty FIFO returns the last sample again; zeros are enough here
+    }
+    uint8_t byte = fifo[rdPtr()][partial_bytes];
+    if (++partial_bytes == 3 * channels()) {
+      partial_bytes = 0;
+      rdPtr() = (rdPtr() + 1) & 0x1F;
+      count--;
+      ovf() = 0;
+    }
+    return byte;
+  }
+
+public:
+  MockMax30105() :
+    count(0),
+    read_limit(126),
+    next_value(1),
+    partial_bytes(0),
+    fault(I2C_OK),
+    fault_count(0),
+    stuck(false),
+    int_callback(nullptr),
+    int_ctx(nullptr) {
+    memset(regs, 0, sizeof(regs));
+    memset(fifo, 0, sizeof(fifo));
+    regs[MAX30105_REG_MODE_CONFIG] = 0x03;           // SpO2: red + IR
+    regs[MAX30105_REG_FIFO_CONFIG] = 0x50;           // 4-sample average, rollover
+  }
+
+  /**
+   * Called when A_FULL asserts INT (falling edge)
+   */
+  void setInterruptCallback(void (*fn)(void* ctx), void* ctx) {
+    int_callback = fn;
+    int_ctx = ctx;
+  }
+
+  void setReadLimit(size_t bytes) { read_limit = bytes; }
+  void setRollover(bool on) {
+    regs[MAX30105_REG_FIFO_CONFIG] = (regs[MAX30105_REG_FIFO_CONFIG] & ~0x10) | (on ? 0x10 : 0);
+  }
+
+  /**
+   * Fail the next n transfers with result
+   */
+  void injectFaults(I2cResult result, uint32_t n) {
+    fault = result;
+    fault_count = n;
+  }
+
+  /**
+   * Every transfer times out until recover() is called
+   */
+  void holdBus() { stuck = true; }
+
+  /**
+   * Sensor side: acquire n samples (red = k, IR = k + 0x10000 for sample k)
+   */
+  void produce(uint32_t n) {
+    for (uint32_t i = 0; i < n; i++) {
+      uint32_t values[3] = {
+        next_value & MAX30105_SAMPLE_MASK,
+        (next_value + 0x10000) & MAX30105_SAMPLE_MASK,
+        (next_value + 0x20000) & MAX30105_SAMPLE_MASK
+      };
+      next_value++;
+
+      if (count == MAX30105_FIFO_DEPTH) {
+        if (ovf() < 0x1F) {
+          ovf()++;
+        }
+        if (!rollover()) {
+          continue;
+        }
+        rdPtr() = (rdPtr() + 1) & 0x1F;   // oldest sample overwritten
+        count--;
+        partial_bytes = 0;
+      }
+      uint8_t* slot = fifo[wrPtr()];
+      for (uint8_t c = 0; c < channels(); c++) {
+        slot[3 * c] = (uint8_t)(values[c] >> 16);
+        slot[3 * c + 1] = (uint8_t)(values[c] >> 8);
+        slot[3 * c + 2] = (uint8_t)values[c];
+      }
+      wrPtr() = (wrPtr() + 1) & 0x1F;
+      count++;
+
+      bool was_set = (regs[MAX30105_REG_INT_STATUS1] & MAX30105_INT_A_FULL) != 0;
+      if (count == almostFullLevel() && !was_set) {
+        regs[MAX30105_REG_INT_STATUS1] |= MAX30105_INT_A_FULL;
+        if ((regs[MAX30105_REG_INT_ENABLE1] & MAX30105_INT_A_FULL) && int_callback) {
+          int_callback(int_ctx);
+        }
+      }
+    }
+  }
+
+  uint8_t fifoCount() const { return count; }
+  uint8_t reg(uint8_t addr) const { return regs[addr]; }
+
+  I2cResult read(uint8_t reg, uint8_t* buf, size_t len) override {
+    I2cResult result;
+    if (takeFault(result)) {
+      return result;
+    }
+    if (len > read_limit) {
+      return I2C_BUS_ERROR;
+    }
+    if (reg == MAX30105_REG_FIFO_DATA) {
+      regs[MAX30105_REG_INT_STATUS1] &= ~MAX30105_INT_A_FULL;
+      for (size_t i = 0; i < len; i++) {
+        buf[i] = popFifoByte();
+      }
+      return I2C_OK;
+    }
+    for (size_t i = 0; i < len; i++) {
+      uint8_t addr = (uint8_t)(reg + i);
+      buf[i] = addr == MAX30105_REG_FIFO_DATA ? 0 : regs[addr];
+      if (addr == MAX30105_REG_INT_STATUS1) {
+        regs[addr] = 0;       // status is cleared on read
+      }
+    }
+    return I2C_OK;
+  }
+
+  I2cResult write(uint8_t reg, uint8_t value) override {
+    I2cResult result;
+    if (takeFault(result)) {
+      return result;
+    }
+    regs[reg] = value;
+    if (reg == MAX30105_REG_FIFO_WR_PTR || reg == MAX30105_REG_FIFO_RD_PTR) {
+      regs[reg] &= 0x1F;
+      partial_bytes = 0;
+      syncCount();
+    }
+    return I2C_OK;
+  }
+
+  bool recover() override {
+    stuck = false;
+    return true;
+  }
+
+  size_t maxReadBytes() const override {
+    return read_limit;
+  }
+};
+
+#endif // MOCK_MAX30105_H
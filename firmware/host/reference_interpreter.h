@@ -0,0 +1,155 @@
+/*
+ * LifeBand Host Build - Reference Interpreter
+ * Straightforward double-precision evaluation of the bundled dense models
+ *
+ * Stands in for TFLiteInferenceEngine so ModelRegistry and LifeBandAI run
+ * unchanged on a Linux host, and gives optimized engines something to be
+ * compared against. It reads the model arrays in models_h/ directly (the
+ * registry only carries them in LIFEBAND_USE_TFLM builds):
+ *
+ *   [0]  "TFL3"
+ *   [16] u32 inputs   [20] u32 hidden units   [24] u32 outputs
+ *   [52] float32 W1[inputs][hidden], b1[hidden],
+ *                W2[hidden][outputs], b2[outputs]
+ *
+ * and computes softmax(W2' relu(W1' x + b1) + b2), the fully connected and
+ * softmax layers the TFLite resolver is set up for. Nothing is optimized:
+ * every multiply-add is done in double in the obvious order.
+ */
+
+#ifndef REFERENCE_INTERPRETER_H
+#define REFERENCE_INTERPRETER_H
+
+#include <stdint.h>
+#include <string.h>
+#include <math.h>
+#include "../model_registry.h"
+#include "../models_h/arrhythmia_risk_model.h"
+#include "../models_h/anemia_risk_model.h"
+#include "../models_h/preeclampsia_risk_model.h"
+
+#define REFERENCE_HEADER 52
+#define REFERENCE_MAX_HIDDEN 64
+
+class ReferenceInterpreter : public InferenceBackend {
+private:
+  const ModelSpec& model_spec;
+  uint32_t hidden;
+  const unsigned char* weights;   // REFERENCE_HEADER into the model
+  bool loaded;
+  uint32_t invocations;
+
+  static uint32_t get32(const unsigned char* p) {
+    return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+  }
+
+  static const unsigned char* flatbuffer(ModelType type, uint32_t& length) {
+    switch (type) {
+      case MODEL_ARRHYTHMIA:
+        length = arrhythmia_risk_model_tflite_len;
+        return arrhythmia_risk_model_tflite;
+      case MODEL_ANEMIA:
+        length = anemia_risk_model_tflite_len;
+        return anemia_risk_model_tflite;
+      case MODEL_PREECLAMPSIA:
+        length = preeclampsia_risk_model_tflite_len;
+        return preeclampsia_risk_model_tflite;
+      default:
+        length = 0;
+        return nullptr;
+    }
+  }
+
+  float weight(uint32_t index) const {
+    float w;
+    memcpy(&w, weights + 4 * index, sizeof(w));   // the array is not float-aligned
+    return w;
+  }
+
+public:
+  explicit ReferenceInterpreter(const ModelSpec& spec) :
+    model_spec(spec),
+    hidden(0),
+    weights(nullptr),
+    loaded(false),
+    invocations(0) {
+  }
+
+  const ModelSpec& spec() const override {
+    return model_spec;
+  }
+
+  const char* name() const override {
+    return "reference";
+  }
+
+  /**
+   * Check the header against the spec's shapes
+   */
+  bool begin() override {
+    uint32_t length;
+    const unsigned char* d = flatbuffer(model_spec.type, length);
+    loaded = false;
+    if (!d || length < REFERENCE_HEADER || memcmp(d, "TFL3", 4) != 0) {
+      return false;
+    }
+    hidden = get32(d + 20);
+    if (get32(d + 16) != model_spec.inputs || get32(d + 24) != model_spec.outputs ||
+        hidden == 0 || hidden > REFERENCE_MAX_HIDDEN) {
+      return false;
+    }
+    uint32_t count = model_spec.inputs * hidden + hidden + hidden * model_spec.outputs + model_spec.outputs;
+    if (REFERENCE_HEADER + 4 * count > length) {
+      return false;
+    }
+    weights = d + REFERENCE_HEADER;
+    loaded = true;
+    return true;
+  }
+
+  bool invoke(const float* input, float* output) override {
+    if (!loaded) {
+      return false;
+    }
+    const uint32_t in = model_spec.inputs;
+    const uint32_t out = model_spec.outputs;
+    const uint32_t b1 = in * hidden;
+    const uint32_t w2 = b1 + hidden;
+    const uint32_t b2 = w2 + hidden * out;
+
+    double h[REFERENCE_MAX_HIDDEN];
+    for (uint32_t j = 0; j < hidden; j++) {
+      double acc = weight(b1 + j);
+      for (uint32_t i = 0; i < in; i++) {
+        acc += (double)input[i] * weight(i * hidden + j);
+      }
+      h[j] = acc > 0.0 ? acc : 0.0;
+    }
+
+    double logits[MODEL_MAX_OUTPUTS];
+    double top = -INFINITY;
+    for (uint32_t k = 0; k < out; k++) {
+      double acc = weight(b2 + k);
+      for (uint32_t j = 0; j < hidden; j++) {
+        acc += h[j] * weight(w2 + j * out + k);
+      }
+      logits[k] = acc;
+      if (acc > top) top = acc;
+    }
+    double sum = 0.0;
+    for (uint32_t k = 0; k < out; k++) {
+      logits[k] = exp(logits[k] - top);
+      sum += logits[k];
+    }
+    for (uint32_t k = 0; k < out; k++) {
+      output[k] = (float)(logits[k] / sum);
+    }
+    invocations++;
+    return true;
+  }
+
+  uint32_t hiddenUnits() const { return hidden; }
+  uint32_t invocationCount() const { return invocations; }
+};
+
+#endif // REFERENCE_INTERPRETER_H
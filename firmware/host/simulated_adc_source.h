@@ -0,0 +1,130 @@
+/*
+ * LifeBand Host Build - Simulated AD8232 ADC Source
+ * Drives EcgAcquisition on Linux with a virtual clock
+ *
+ * Generates a synthetic ECG (P-QRS-T on a 2048 baseline) at the configured
+ * heart rate and replays the sampler timing of the ESP32 backend: each timer
+ * tick wakes the sampler, which reads the ADC after a configurable latency.
+ * Latency spikes longer than one period make ticks coalesce, exactly like
+ * ulTaskNotifyTake() returning a count > 1 on the device, so missed-tick,
+ * overrun and jitter counters can be checked without hardware.
+ */
+
+#ifndef SIMULATED_ADC_SOURCE_H
+#define SIMULATED_ADC_SOURCE_H
+
+#include <stdint.h>
+#include <math.h>
+#include "../ecg_acquisition.h"
+
+class SimulatedAdcSource {
+private:
+  uint16_t rate_hz;
+  float heart_rate_bpm;
+  float mains_amplitude;      // counts of 50 Hz pickup
+  float baseline_wander;      // counts of 0.3 Hz respiration drift
+
+  uint32_t base_latency_us;   // normal wake-up latency
+  uint32_t spike_every;       // inject a spike every N wake-ups (0 = never)
+  uint32_t spike_latency_us;  // latency of a spiked wake-up
+
+  uint32_t seed;
+
+  static float gaussian(float x, float mu, float sigma) {
+    float d = (x - mu) / sigma;
+    return expf(-0.5f * d * d);
+  }
+
+  float noise() {
+    seed = seed * 1664525UL + 1013904223UL;
+    return ((int32_t)(seed >> 16) & 0xFF) / 255.0f - 0.5f;
+  }
+
+public:
+  SimulatedAdcSource(uint16_t rate = 250, float bpm = 75.0f) :
+    rate_hz(rate),
+    heart_rate_bpm(bpm),
+    mains_amplitude(0.0f),
+    baseline_wander(0.0f),
+    base_latency_us(20),
+    spike_every(0),
+    spike_latency_us(0),
+    seed(12345) {
+  }
+
+  void setHeartRate(float bpm) { heart_rate_bpm = bpm; }
+  void setMainsNoise(float counts) { mains_amplitude = counts; }
+  void setBaselineWander(float counts) { baseline_wander = counts; }
+
+  /**
+   * Configure sampler wake-up latency
+   * @param base_us: latency of every ordinary wake-up
+   * @param every: every Nth wake-up is delayed by spike_us instead (0 = off)
+   */
+  void setLatencyProfile(uint32_t base_us, uint32_t every, uint32_t spike_us) {
+    base_latency_us = base_us;
+    spike_every = every;
+    spike_latency_us = spike_us;
+  }
+
+  /**
+   * Synthetic ECG value at a given sample index (12-bit ADC counts)
+   */
+  int16_t sampleAt(uint32_t index) {
+    float t = (float)index / rate_hz;
+    float beat = 60.0f / heart_rate_bpm;
+    float phase = fmodf(t, beat);
+
+    float v = 2048.0f;
+    v += 60.0f * gaussian(phase, 0.10f, 0.020f);     // P
+    v -= 80.0f * gaussian(phase, 0.185f, 0.008f);    // Q
+    v += 900.0f * gaussian(phase, 0.20f, 0.010f);    // R
+    v -= 150.0f * gaussian(phase, 0.215f, 0.008f);   // S
+    v += 150.0f * gaussian(phase, 0.42f, 0.040f);    // T
+    v += mains_amplitude * sinf(2.0f * 3.14159265f * 50.0f * t);
+    v += baseline_wander * sinf(2.0f * 3.14159265f * 0.3f * t);
+    v += 8.0f * noise();
+
+    if (v < 0) v = 0;
+    if (v > 4095) v = 4095;
+    return (int16_t)v;
+  }
+
+  /**
+   * Reconfigure acq at this source's rate and run n_ticks of virtual time
+   * @param start_us: virtual micros() of tick 0
+   * @return number of sampler wake-ups executed
+   */
+  uint32_t run(EcgAcquisition& acq, uint32_t n_ticks, uint32_t start_us = 0) {
+    acq.configure(rate_hz, start_us, start_us / 1000);
+    uint32_t period = acq.periodUs();
+    uint32_t serviced = 0;     // ticks handed to the acquisition so far
+    uint64_t busy_until = start_us;
+    uint32_t wakeups = 0;
+
+    while (serviced < n_ticks) {
+      uint64_t tick_time = start_us + (uint64_t)serviced * period;
+      uint64_t wake = tick_time > busy_until ? tick_time : busy_until;
+
+      uint32_t latency = base_latency_us;
+      if (spike_every && ((wakeups + 1) % spike_every) == 0) {
+        latency = spike_latency_us;
+      }
+      uint64_t read_time = wake + latency;
+
+      // Every tick that fired up to the moment of the read is folded in
+      uint32_t due = (uint32_t)((read_time - start_us) / period) + 1;
+      if (due > n_ticks) due = n_ticks;
+      uint32_t ticks = due - serviced;
+      if (ticks == 0) ticks = 1;
+
+      acq.onTicks(ticks, (uint32_t)read_time, sampleAt(serviced + ticks - 1));
+      serviced += ticks;
+      busy_until = read_time;
+      wakeups++;
+    }
+    return wakeups;
+  }
+};
+
+#endif // SIMULATED_ADC_SOURCE_H
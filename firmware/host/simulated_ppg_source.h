@@ -0,0 +1,130 @@
+/*
+ * LifeBand Host Build - Simulated MAX30105 PPG
+ * Red/IR samples with a known SpO2, pulse rate and perfusion index
+ *
+ * Each beat is a systolic upstroke plus a dicrotic wave; the sensor reading
+ * drops while blood volume rises (more absorption), as on the device. The
+ * red AC amplitude is set so that the ratio of ratios R gives the requested
+ * SpO2 through the Maxim calibration curve (upper branch, R >= 0.34), which
+ * both spo2_estimator.h and the Maxim batch algorithm assume. Beat-to-beat
+ * interval jitter, respiratory baseline wander and white noise can be added
+ * so estimators are compared on the same stream against ground truth;
+ * beatStart() / volumeAt() expose the pulse timing for PTT checks.
+ */
+
+#ifndef SIMULATED_PPG_SOURCE_H
+#define SIMULATED_PPG_SOURCE_H
+
+#include <stdint.h>
+#include <math.h>
+
+class SimulatedPpgSource {
+private:
+  uint16_t rate_hz;
+  float heart_rate_bpm;
+  float spo2_percent;
+  float perfusion_percent;    // IR AC peak-to-peak / DC
+  float ir_dc;
+  float red_dc;
+  float interval_jitter;      // fraction of the beat interval
+  float wander;               // fraction of DC, 0.25 Hz
+  float noise_counts;         // peak white noise
+
+  double t;                   // time of the next sample
+  double beat_start;
+  double beat_length;
+  uint32_t seed;
+
+  float uniform() {
+    seed = seed * 1664525UL + 1013904223UL;
+    return ((seed >> 8) & 0xFFFF) / 65535.0f - 0.5f;
+  }
+
+  /**
+   * Blood volume over one beat, 0..1 at phase 0..1
+   */
+  static float pulseShape(float phase) {
+    float sys = expf(-0.5f * powf((phase - 0.18f) / 0.07f, 2.0f));
+    float dic = 0.35f * expf(-0.5f * powf((phase - 0.45f) / 0.08f, 2.0f));
+    return (sys + dic) / 1.02f;
+  }
+
+  void nextBeat() {
+    beat_start += beat_length;
+    beat_length = 60.0 / heart_rate_bpm * (1.0 + interval_jitter * 2.0f * uniform());
+  }
+
+public:
+  SimulatedPpgSource(uint16_t rate = 25) :
+    rate_hz(rate),
+    heart_rate_bpm(72.0f),
+    spo2_percent(97.0f),
+    perfusion_percent(2.0f),
+    ir_dc(120000.0f),
+    red_dc(90000.0f),
+    interval_jitter(0.0f),
+    wander(0.0f),
+    noise_counts(0.0f),
+    t(0.0),
+    beat_start(0.0),
+    beat_length(60.0 / 72.0),
+    seed(4242) {
+  }
+
+  void setHeartRate(float bpm) { heart_rate_bpm = bpm; beat_length = 60.0 / bpm; }
+  void setSpo2(float percent) { spo2_percent = percent; }
+  void setPerfusion(float percent) { perfusion_percent = percent; }
+  void setDc(float ir, float red) { ir_dc = ir; red_dc = red; }
+  void setJitter(float fraction) { interval_jitter = fraction; }
+  void setWander(float fraction) { wander = fraction; }
+  void setNoise(float counts) { noise_counts = counts; }
+  void setSeed(uint32_t s) { seed = s; }
+
+  /**
+   * Ratio of ratios that maps to spo2 on the Maxim curve
+   */
+  static float ratioFor(float spo2) {
+    float disc = 30.354f * 30.354f - 4.0f * 45.060f * (spo2 - 94.845f);
+    if (disc < 0.0f) disc = 0.0f;
+    return (30.354f + sqrtf(disc)) / (2.0f * 45.060f);
+  }
+
+  /**
+   * Blood volume over one beat, 0..1 at phase 0..1 (ground truth for tests)
+   */
+  static float volumeAt(float phase) { return pulseShape(phase); }
+
+  /**
+   * Start and length (s) of the beat the last sample belongs to
+   */
+  double beatStart() const { return beat_start; }
+  double beatLength() const { return beat_length; }
+
+  float heartRate() const { return heart_rate_bpm; }
+  float spo2() const { return spo2_percent; }
+  float perfusion() const { return perfusion_percent; }
+
+  /**
+   * Next red/IR pair at rate_hz
+   */
+  void next(uint32_t& red, uint32_t& ir) {
+    while (t >= beat_start + beat_length) {
+      nextBeat();
+    }
+    float phase = (float)((t - beat_start) / beat_length);
+    float volume = pulseShape(phase);
+
+    float ir_ac = ir_dc * perfusion_percent / 100.0f;
+    float red_ac = red_dc * (perfusion_percent / 100.0f) * ratioFor(spo2_percent);
+    float drift = wander * sinf(2.0f * 3.14159265f * 0.25f * (float)t);
+
+    float ir_value = ir_dc * (1.0f + drift) - ir_ac * volume + noise_counts * 2.0f * uniform();
+    float red_value = red_dc * (1.0f + drift) - red_ac * volume + noise_counts * 2.0f * uniform();
+    ir = ir_value > 0.0f ? (uint32_t)ir_value : 0;
+    red = red_value > 0.0f ? (uint32_t)red_value : 0;
+
+    t += 1.0 / rate_hz;
+  }
+};
+
+#endif // SIMULATED_PPG_SOURCE_H
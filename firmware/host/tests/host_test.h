@@ -0,0 +1,68 @@
+/*
+ * LifeBand Host Tests - Minimal Check Harness
+ * Assertions and metric reporting for the firmware host tests
+ *
+ * Each test_*.cpp is one program. CHECK() records a failure with its
+ * location and keeps going, so one run reports every broken property;
+ * METRIC() prints a measured figure (detection rate, error, ns per call)
+ * next to the checks so a run can be compared with the numbers quoted in
+ * the change that introduced the module. Timings are informational and
+ * never fail a test. testResult() is main()'s return value.
+ */
+
+#ifndef HOST_TEST_H
+#define HOST_TEST_H
+
+#include <stdio.h>
+#include <stdint.h>
+#include <time.h>
+
+static int test_checks = 0;
+static int test_failures = 0;
+
+#define CHECK(cond) \
+  do { \
+    test_checks++; \
+    if (!(cond)) { \
+      test_failures++; \
+      printf("  FAIL %s:%d: %s\n", __FILE__, __LINE__, #cond); \
+    } \
+  } while (0)
+
+// Same as CHECK, with the offending values printed
+#define CHECK_MSG(cond, fmt, ...) \
+  do { \
+    test_checks++; \
+    if (!(cond)) { \
+      test_failures++; \
+      printf("  FAIL %s:%d: %s (" fmt ")\n", __FILE__, __LINE__, #cond, __VA_ARGS__); \
+    } \
+  } while (0)
+
+#define METRIC(fmt, ...) printf("  " fmt "\n", __VA_ARGS__)
+
+#define TEST_CASE(name) printf("%s\n", name)
+
+/**
+ * Monotonic time in nanoseconds, for the informational timings
+ */
+static inline uint64_t testNowNs() {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+/**
+ * Compiler barrier for timing loops: the bytes at p count as read, so the
+ * code that produced them cannot be dropped or hoisted out of the loop
+ */
+static inline void testKeep(const void* p) {
+  __asm__ __volatile__("" : : "r"(p) : "memory");
+}
+
+static inline int testResult(const char* name) {
+  printf("%s: %d checks, %d failed\n", name, test_checks, test_failures);
+  return test_failures ? 1 : 0;
+}
+
+#endif // HOST_TEST_H
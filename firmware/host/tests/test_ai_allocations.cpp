@@ -0,0 +1,106 @@
+/*
+ * The per-beat AI/vitals path must not touch the heap: 120 s of simulated
+ * ECG through filter, detector, feature windows, all three models and the
+ * vitals frame with global operator new counting
+ */
+
+#include <stdlib.h>
+#include <new>
+#include "host_test.h"
+
+static long heap_allocations = 0;
+static bool counting = false;
+
+void* operator new(size_t n) {
+  if (counting) heap_allocations++;
+  void* p = malloc(n ? n : 1);
+  if (!p) throw std::bad_alloc();
+  return p;
+}
+void* operator new[](size_t n) {
+  if (counting) heap_allocations++;
+  void* p = malloc(n ? n : 1);
+  if (!p) throw std::bad_alloc();
+  return p;
+}
+void operator delete(void* p) noexcept { free(p); }
+void operator delete[](void* p) noexcept { free(p); }
+void operator delete(void* p, size_t) noexcept { free(p); }
+void operator delete[](void* p, size_t) noexcept { free(p); }
+
+#include "lifeband_edge_ai.h"
+#include "feature_window.h"
+#include "ecg_filter.h"
+#include "qrs_detector.h"
+#include "vitals_frame.h"
+#include "simulated_adc_source.h"
+
+static unsigned long virtual_us = 0;
+static unsigned long virtualMicros() { return virtual_us; }
+
+int main() {
+  DenseEngine engine;
+  DenseInferenceEngine arrhythmia(MODEL_REGISTRY[MODEL_ARRHYTHMIA], arrhythmia_risk_model_dense, engine, DENSE_FLOAT);
+  DenseInferenceEngine anemia(MODEL_REGISTRY[MODEL_ANEMIA], anemia_risk_model_dense, engine, DENSE_FLOAT);
+  DenseInferenceEngine preeclampsia(MODEL_REGISTRY[MODEL_PREECLAMPSIA], preeclampsia_risk_model_dense, engine, DENSE_FLOAT);
+  LifeBandAI ai(virtualMicros);
+  ai.bind(&arrhythmia);
+  ai.bind(&anemia);
+  ai.bind(&preeclampsia);
+  ai.initialize();
+
+  SimulatedAdcSource src(250, 110);
+  src.setBaselineWander(200);
+  EcgPreFilter filter;
+  QrsDetector detector;
+  FeatureExtractor features;
+
+  TEST_CASE("120 s of beats, features, inference and frames");
+  EcgSample in[32], out[32];
+  uint32_t idx = 0, beats = 0, ran = 0, frames = 0;
+  uint32_t next_tick_ms = 0;
+  counting = true;
+  for (uint32_t block = 0; block < 250 * 120 / 32; block++) {
+    for (int i = 0; i < 32; i++, idx++) {
+      in[i].index = idx;
+      in[i].value = src.sampleAt(idx);
+    }
+    uint32_t now_ms = idx * 4;
+    virtual_us = now_ms * 1000UL;
+    size_t m = filter.process(in, 32, out);
+    for (size_t i = 0; i < m; i++) {
+      QrsEvent ev;
+      if (detector.process(out[i].value, out[i].index, ev)) {
+        beats++;
+        features.addBeat(filter.toInputIndex(ev.r_index) * 4, (uint16_t)detector.samplesToMs(ev.rr_samples),
+                         (uint16_t)detector.samplesToMs(ev.qrs_samples), (uint16_t)ev.amplitude);
+      }
+    }
+    if (now_ms >= next_tick_ms) {
+      next_tick_ms += 1000;
+      features.addVitals(now_ms, 110, 96, 150, 95);
+      if (features.due(now_ms)) {
+        AiEvaluation e = ai.evaluate(features.emit(now_ms), MODEL_BIT(MODEL_COUNT) - 1, now_ms);
+        for (uint8_t k = 0; k < MODEL_COUNT; k++) {
+          if (e.ran & MODEL_BIT(k)) ran++;
+        }
+        VitalsFrame f;
+        memset(&f, 0, sizeof(f));
+        f.rhythm = e.arrhythmia.rhythm_type;
+        uint8_t frame[VITALS_FRAME_SIZE];
+        frames += encodeVitalsFrame(f, (uint8_t)frames, frame, sizeof(frame)) > 0;
+        volatile const char* name = rhythmName(f.rhythm);
+        (void)name;
+      }
+    }
+  }
+  counting = false;
+
+  METRIC("%u beats, %u model runs, %u frames, %ld heap allocations", beats, ran, frames, heap_allocations);
+  CHECK(beats > 200);
+  CHECK(ran > 100);
+  CHECK(ai.getStats(MODEL_ARRHYTHMIA).runs > 0);
+  CHECK(heap_allocations == 0);
+
+  return testResult("test_ai_allocations");
+}
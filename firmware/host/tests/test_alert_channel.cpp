@@ -0,0 +1,173 @@
+/*
+ * AlertChannel: first send, retransmission backoff, acknowledgement,
+ * eviction when too many are pending, and delivery of every alert over a
+ * link that drops notifications and acknowledgements
+ */
+
+#include <vector>
+#include <string.h>
+#include "host_test.h"
+#include "alert_channel.h"
+
+static AlertEvent severeBp(uint32_t time_ms) {
+  AlertEvent e;
+  memset(&e, 0, sizeof(e));
+  e.type = ALERT_SEVERE_BP;
+  e.severity = ALERT_CRITICAL;
+  e.confidence = 100;
+  e.hr = 96;
+  e.spo2 = 97;
+  e.bp_sys = 170;
+  e.bp_dia = 112;
+  e.time_ms = time_ms;
+  e.detect_us = time_ms * 1000;
+  return e;
+}
+
+static uint32_t rng = 1;
+
+static uint32_t nextRandom() {
+  rng = rng * 1664525u + 1013904223u;
+  return rng >> 8;
+}
+
+int main() {
+  TEST_CASE("send, backoff, acknowledge");
+  {
+    AlertChannel ch;
+    uint8_t b[64];
+    AlertEvent e = severeBp(1000);
+    CHECK(ch.accept(e, 1000) == 1);
+    size_t n = ch.poll(1000, 1000250, b, sizeof(b));
+    CHECK(n == ALERT_FRAME_SIZE && b[3] == 0);
+    AlertEvent d;
+    uint16_t seq = 0;
+    uint32_t age = 1;
+    CHECK(decodeAlert(b, n, d, seq, &age));
+    CHECK(seq == 1 && d.type == ALERT_SEVERE_BP && d.severity == ALERT_CRITICAL);
+    CHECK(d.bp_sys == 170 && d.bp_dia == 112 && d.time_ms == 1000 && age == 0);
+    CHECK(ch.poll(1000, 1000250, b, sizeof(b)) == 0);              // one send per due time
+    CHECK(ch.poll(1000, 1000250, b, ALERT_FRAME_SIZE - 1) == 0);
+
+    CHECK(ch.poll(1500, 0, b, sizeof(b)) == 0);
+    n = ch.poll(2000, 0, b, sizeof(b));                            // first retry after 1 s
+    CHECK(n && b[3] == ALERT_FLAG_RETRANSMIT);
+    CHECK(decodeAlert(b, n, d, seq, &age) && age == 1000);
+    CHECK(ch.poll(3500, 0, b, sizeof(b)) == 0);                    // then 2 s
+    CHECK(ch.poll(4000, 0, b, sizeof(b)) != 0);
+    ch.resendAll(4100);                                            // resubscribed
+    CHECK(ch.poll(4100, 0, b, sizeof(b)) != 0);
+
+    CHECK(ch.acknowledge(1));
+    CHECK(ch.poll(9999, 1500000, b, sizeof(b)) == 0);
+    CHECK(ch.pendingCount() == 0);
+    ch.acknowledge(1);                                             // repeated ack
+    ch.poll(10000, 0, b, sizeof(b));
+
+    AlertStats st = ch.getStats();
+    METRIC("raised %u, sent %u, retransmits %u, acked %u, stray %u, notify %u us, ack %u us",
+           st.raised, st.sent, st.retransmits, st.acked, st.stray_acks, st.notify.last_us, st.ack.last_us);
+    CHECK(st.raised == 1 && st.sent == 4 && st.retransmits == 3);
+    CHECK(st.acked == 1 && st.stray_acks == 1);
+    CHECK(st.notify.last_us == 250);
+    CHECK(st.ack.last_us == 499750);
+  }
+
+  TEST_CASE("backoff ceiling");
+  {
+    AlertChannel ch;
+    uint8_t b[64];
+    ch.accept(severeBp(0), 0);
+    uint32_t last = 0, max_gap = 0;
+    for (uint32_t t = 0; t < 60000; t += 10) {
+      if (ch.poll(t, t * 1000, b, sizeof(b))) {
+        if (t - last > max_gap) max_gap = t - last;
+        last = t;
+      }
+    }
+    CHECK(max_gap == ALERT_RETRY_MAX_MS);
+  }
+
+  TEST_CASE("eviction keeps the newest ALERT_PENDING");
+  {
+    AlertChannel ch;
+    uint8_t b[64];
+    AlertEvent e = severeBp(20000);
+    for (int i = 0; i < ALERT_PENDING + 2; i++) {
+      ch.accept(e, 20000);
+    }
+    AlertStats st = ch.getStats();
+    CHECK(st.evicted == 2);
+    CHECK(ch.pendingCount() == ALERT_PENDING);
+    AlertEvent d;
+    uint16_t seq = 0;
+    size_t n = ch.poll(20000, 0, b, sizeof(b));
+    CHECK(decodeAlert(b, n, d, seq) && seq == 3);                 // oldest surviving first
+  }
+
+  TEST_CASE("lossy link: every alert delivered");
+  {
+    const uint32_t loss_percent[] = {0, 20, 50};
+    for (size_t k = 0; k < sizeof(loss_percent) / sizeof(loss_percent[0]); k++) {
+      AlertChannel ch;
+      rng = 7 + (uint32_t)k;
+      std::vector<uint32_t> delivered_ms(1, 0);    // by sequence, 0 = not yet
+      std::vector<uint32_t> raised_ms(1, 0);
+      uint32_t notifications = 0, worst = 0;
+      uint8_t b[64];
+      for (uint32_t t = 0; t < 660000; t += 20) {
+        if (t < 540000 && t % 15000 == 0) {       // one alert every 15 s
+          uint16_t seq = ch.accept(severeBp(t), t);
+          raised_ms.push_back(t);
+          delivered_ms.push_back(0);
+          CHECK(seq == raised_ms.size() - 1);
+        }
+        size_t n;
+        while ((n = ch.poll(t, t * 1000, b, sizeof(b))) > 0) {
+          notifications++;
+          if (nextRandom() % 100 < loss_percent[k]) continue;   // notification lost
+          AlertEvent d;
+          uint16_t seq = 0;
+          uint32_t age = 0;
+          CHECK(decodeAlert(b, n, d, seq, &age));
+          CHECK(seq < delivered_ms.size() && age == t - raised_ms[seq]);
+          if (seq < delivered_ms.size() && !delivered_ms[seq]) {
+            delivered_ms[seq] = t + 1;
+            if (t - raised_ms[seq] > worst) worst = t - raised_ms[seq];
+          }
+          if (nextRandom() % 100 >= loss_percent[k]) {
+            ch.acknowledge(seq);                                   // ack may be lost too
+          }
+        }
+      }
+      uint32_t missing = 0;
+      for (size_t s = 1; s < delivered_ms.size(); s++) {
+        if (!delivered_ms[s]) missing++;
+      }
+      AlertStats st = ch.getStats();
+      METRIC("%2u%% loss: %zu alerts, %u notifications, %u retransmits, worst delivery %u ms, %u pending at end",
+             loss_percent[k], delivered_ms.size() - 1, notifications, st.retransmits, worst, ch.pendingCount());
+      CHECK(missing == 0);
+      CHECK(st.evicted == 0);
+      CHECK(ch.pendingCount() == 0);
+      if (loss_percent[k] == 0) {
+        CHECK(st.retransmits == 0 && worst == 0);
+      }
+    }
+  }
+
+  TEST_CASE("malformed frames");
+  {
+    AlertChannel ch;
+    uint8_t b[64];
+    ch.accept(severeBp(0), 0);
+    size_t n = ch.poll(0, 0, b, sizeof(b));
+    AlertEvent d;
+    uint16_t seq;
+    CHECK(!decodeAlert(b, n - 1, d, seq));
+    b[0] = 'V';
+    CHECK(!decodeAlert(b, n, d, seq));
+  }
+
+  return testResult("test_alert_channel");
+}
@@ -0,0 +1,104 @@
+/*
+ * BeatHistory running HRV against a brute-force recomputation of every
+ * window: random RR with ectopic outliers, gaps, a window change, and a
+ * capacity-bound window
+ */
+
+#include "host_test.h"
+#include "beat_history.h"
+#include <math.h>
+#include <stdlib.h>
+#include <vector>
+
+struct Beat {
+  uint16_t rr;
+  uint32_t time_ms;
+  bool adjacent;
+};
+
+static double worst_error;
+
+// Statistics of the last beats within window_ms (at most the capacity)
+static bool matchesBruteForce(const BeatHistory& h, const std::vector<Beat>& all, uint32_t window_ms) {
+  uint32_t now = all.back().time_ms;
+  std::vector<Beat> w;
+  for (int i = (int)all.size() - 1; i >= 0 && (int)w.size() < BEAT_HISTORY_CAPACITY; i--) {
+    if (now - all[i].time_ms > window_ms && !w.empty()) break;
+    w.insert(w.begin(), all[i]);
+  }
+  double sum = 0;
+  for (const Beat& b : w) sum += b.rr;
+  double mean = sum / w.size();
+  double var = 0;
+  for (const Beat& b : w) var += (b.rr - mean) * (b.rr - mean);
+  var /= w.size();
+  double d2 = 0;
+  int diffs = 0, nn50 = 0;
+  for (size_t i = 1; i < w.size(); i++) {
+    if (!w[i].adjacent) continue;
+    double d = (double)w[i].rr - w[i - 1].rr;
+    d2 += d * d;
+    diffs++;
+    if (fabs(d) > BEAT_NN50_MS) nn50++;
+  }
+
+  const HrvSnapshot& s = h.snapshot();
+  if (s.beats != w.size() || s.diffs != diffs) return false;
+  double e = fabs(s.mean_rr_ms - mean);
+  e = fmax(e, fabs(s.sdnn_ms - (w.size() > 1 ? sqrt(var) : 0)));
+  e = fmax(e, fabs(s.rmssd_ms - (diffs ? sqrt(d2 / diffs) : 0)));
+  e = fmax(e, fabs(s.pnn50 - (diffs ? 100.0 * nn50 / diffs : 0)));
+  worst_error = fmax(worst_error, e);
+  return e < 0.01;
+}
+
+static void replay(uint32_t first_window, uint32_t second_window) {
+  BeatHistory h;
+  h.setWindow(first_window);
+  std::vector<Beat> all;
+  uint32_t t = 0;
+  bool gap = true;
+  int mismatches = 0, checks = 0;
+  srand(7);
+  for (int k = 0; k < 20000; k++) {
+    if (rand() % 97 == 0) {
+      h.markGap();
+      gap = true;
+      continue;
+    }
+    if (k == 12000) h.setWindow(second_window);
+    uint16_t rr = 300 + rand() % 900 + (rand() % 10 == 0 ? rand() % 400 : 0);
+    t += rr;
+    h.add(rr, t);
+    all.push_back({rr, t, !gap});
+    gap = false;
+    if (!matchesBruteForce(h, all, k >= 12000 ? second_window : first_window)) mismatches++;
+    checks++;
+  }
+  CHECK_MSG(mismatches == 0, "%d of %d windows differ", mismatches, checks);
+  METRIC("%d windows, final %u beats", checks, h.snapshot().beats);
+}
+
+int main() {
+  TEST_CASE("5 min window, then 1 min");
+  replay(BEAT_HISTORY_WINDOW_MS, 60000);
+
+  TEST_CASE("unbounded window: capacity evicts");
+  replay(0xFFFFFFFFu, 0xFFFFFFFFu);
+
+  TEST_CASE("a gap breaks the difference chain, keeps the beats");
+  {
+    BeatHistory h;
+    h.add(800, 800);
+    h.add(900, 1700);
+    h.markGap();
+    h.add(700, 3200);
+    const HrvSnapshot& s = h.snapshot();
+    CHECK(s.beats == 3 && s.diffs == 1);
+    CHECK(fabs(s.rmssd_ms - 100) < 1e-3 && s.pnn50 == 100);
+    CHECK(!h.adjacent(0) && h.adjacent(1));
+  }
+
+  METRIC("max abs error %.5f ms, history %u B", worst_error, (unsigned)sizeof(BeatHistory));
+  return testResult("test_beat_history");
+}
@@ -0,0 +1,179 @@
+/*
+ * BeatQuality on the ECG and PPG pipelines: the SQI stays high on clean
+ * beats and drops in the corrupted 10 s halves (noise, motion, clipping,
+ * EMG); template cost per beat and per sample
+ */
+
+#include "host_test.h"
+#include "ecg_filter.h"
+#include "qrs_detector.h"
+#include "beat_quality.h"
+#include "ppg_beat_detector.h"
+#include "host/simulated_adc_source.h"
+#include "host/simulated_ppg_source.h"
+#include <math.h>
+#include <vector>
+
+static uint32_t rng_state = 1;
+static float urand() {
+  rng_state = rng_state * 1664525u + 1013904223u;
+  return ((rng_state >> 8) & 0xFFFF) / 65535.0f;
+}
+
+enum Artefact { CLEAN, NOISE, MOTION, CLIPPED, EMG, LOW_PI };
+
+struct Halves {
+  double clean, bad;
+};
+
+static void report(const char* name, const Halves& h, Artefact a) {
+  METRIC("%-8s SQI clean half %5.1f, corrupted half %5.1f", name, h.clean, h.bad);
+  CHECK(h.clean >= 95);
+  if (a == CLEAN || a == LOW_PI) {
+    CHECK(h.bad >= 95);
+  } else {
+    CHECK(h.bad < h.clean - 2);
+  }
+}
+
+// Every odd 10 s of the 2 min record is corrupted
+static Halves ecg(Artefact a, int rate) {
+  SimulatedAdcSource src(rate, 72);
+  EcgPreFilter filter;
+  filter.configure(rate, NOTCH_50HZ, 1);
+  QrsDetector qrs;
+  qrs.configure(filter.outputRate());
+  BeatQuality<32> bq;
+  bq.configureWindow(filter.outputRate(), 256, 96);
+  int n = rate * 120;
+  std::vector<EcgSample> in(n), out(n);
+  float motion = 0;
+  for (int i = 0; i < n; i++) {
+    float v = src.sampleAt(i);
+    float t = (float)i / rate;
+    if ((int)(t / 10) % 2 == 1) {
+      if (a == NOISE) v += 300 * (urand() - 0.5f) * 2;
+      if (a == MOTION) {
+        if (urand() < 0.002f) motion += (urand() - 0.5f) * 1200;
+        motion *= 0.995f;
+        v += motion;
+      }
+      if (a == CLIPPED && v > 2500) v = 2500;
+      if (a == EMG && fmodf(t, 3.0f) < 1.5f) v += 250 * (urand() - 0.5f) * 2;
+    }
+    in[i].index = i;
+    in[i].value = (int16_t)fminf(fmaxf(v, 0), 4095);
+  }
+  size_t m = filter.process(in.data(), n, out.data());
+  double sum[2] = {0, 0};
+  int count[2] = {0, 0};
+  for (size_t i = 0; i < m; i++) {
+    QrsEvent e;
+    if (qrs.process(out[i].value, out[i].index, e)) bq.addBeat(e.r_index);
+    BeatScore sc;
+    if (bq.addSample(out[i].index, out[i].value, sc) && !sc.learning) {
+      int half = (int)((float)filter.toInputIndex(sc.index) / rate / 10) % 2;
+      sum[half] += sc.sqi;
+      count[half]++;
+    }
+  }
+  CHECK(bq.getStats().relearns == 0);
+  Halves h = {count[0] ? sum[0] / count[0] : 0, count[1] ? sum[1] / count[1] : 0};
+  return h;
+}
+
+static Halves ppg(Artefact a) {
+  SimulatedPpgSource src(25);
+  src.setSeed(7);
+  if (a == LOW_PI) src.setPerfusion(0.3f);
+  PpgBeatDetector det;
+  det.configure(25);
+  BeatQuality<16> bq;
+  bq.configureWindow(25, 640, 400);
+  double sum[2] = {0, 0};
+  int count[2] = {0, 0};
+  float motion = 0;
+  for (uint32_t i = 0; i < 25 * 120; i++) {
+    uint32_t red, ir;
+    src.next(red, ir);
+    float v = -(float)ir;
+    if ((i / 250) % 2 == 1) {
+      if (a == NOISE) v += 3000 * (urand() - 0.5f);
+      if (a == MOTION) {
+        if (urand() < 0.01f) motion += (urand() - 0.5f) * 20000;
+        motion *= 0.97f;
+        v += motion;
+      }
+      if (a == CLIPPED && v < -119000) v = -119000;
+    }
+    PpgBeat b;
+    if (det.process((int32_t)v, b)) bq.addBeat(i - (b.lag_ms * 25 + 500) / 1000);
+    float y = fminf(fmaxf(det.filtered(), -32768), 32767);
+    BeatScore sc;
+    if (bq.addSample(i, (int16_t)lroundf(y), sc) && !sc.learning) {
+      int half = (sc.index / 250) % 2;
+      sum[half] += sc.sqi;
+      count[half]++;
+    }
+  }
+  Halves h = {count[0] ? sum[0] / count[0] : 0, count[1] ? sum[1] / count[1] : 0};
+  return h;
+}
+
+template <uint8_t N>
+static void bench() {
+  std::vector<int16_t> v(1 << 20);
+  for (size_t i = 0; i < v.size(); i++) v[i] = (int16_t)(1000 * sinf(i * 0.05f) + 50 * (urand() - 0.5f));
+  BeatScore sc;
+
+  BeatQuality<N> samples_only;
+  samples_only.configure(1, N / 3);
+  double t0 = testNowNs();
+  for (uint32_t i = 0; i < v.size(); i++) samples_only.addSample(i, v[i], sc);
+  double per_sample = testNowNs() - t0;
+
+  BeatQuality<N> bq;
+  bq.configure(1, N / 3);
+  uint32_t beats = 0;
+  t0 = testNowNs();
+  for (uint32_t i = 0; i < v.size(); i++) {
+    if (i % 100 == 0 && i >= 2 * N) bq.addBeat(i - N);
+    beats += bq.addSample(i, v[i], sc);
+  }
+  double total = testNowNs() - t0;
+  METRIC("N=%2u: %.0f ns/beat, %.2f ns/sample (%s)", (unsigned)N, (total - per_sample) / beats,
+         per_sample / v.size(),
+#ifdef BEAT_QUALITY_SSE2
+         "SSE2"
+#else
+         "scalar"
+#endif
+  );
+  CHECK(beats > 0);
+}
+
+int main() {
+  TEST_CASE("ECG, 250 Hz");
+  report("clean", ecg(CLEAN, 250), CLEAN);
+  report("noise", ecg(NOISE, 250), NOISE);
+  report("motion", ecg(MOTION, 250), MOTION);
+  report("clipped", ecg(CLIPPED, 250), CLIPPED);
+  report("EMG", ecg(EMG, 250), EMG);
+
+  TEST_CASE("ECG, 500 Hz");
+  report("clean", ecg(CLEAN, 500), CLEAN);
+
+  TEST_CASE("PPG, 25 Hz");
+  report("clean", ppg(CLEAN), CLEAN);
+  report("noise", ppg(NOISE), NOISE);
+  report("motion", ppg(MOTION), MOTION);
+  report("clipped", ppg(CLIPPED), CLIPPED);
+  report("low PI", ppg(LOW_PI), LOW_PI);
+
+  TEST_CASE("template cost");
+  bench<16>();
+  bench<32>();
+  bench<64>();
+
+  return testResult("test_beat_quality");
+}
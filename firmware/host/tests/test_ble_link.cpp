@@ -0,0 +1,43 @@
+/*
+ * BleLinkMonitor: re-advertise and first-notify latency bookkeeping
+ */
+
+#include "host_test.h"
+#include "ble_link.h"
+
+int main() {
+  BleLinkMonitor m;
+
+  TEST_CASE("first notification after connect is timed once");
+  m.onConnect(1000);
+  CHECK(m.onNotify(1300) == 300);
+  CHECK(m.onNotify(1400) == 0);
+  CHECK(!m.isReconnect());
+
+  TEST_CASE("disconnect to advertising restart");
+  m.onDisconnect(5000);
+  CHECK(m.onNotify(5001) == 0);             // no link, nothing timed
+  CHECK(m.onAdvertising(5004) == 4);
+  CHECK(m.onAdvertising(5100) == 0);        // only the first restart counts
+
+  TEST_CASE("reconnect statistics");
+  m.onConnect(7000);
+  CHECK(m.onNotify(7900) == 900);
+  CHECK(m.isReconnect());
+  LinkStats s = m.getStats();
+  CHECK(s.connects == 2 && s.disconnects == 1);
+  CHECK(s.first_notify.max_ms == 900 && s.first_notify.mean_ms == 600);
+  CHECK(s.readvertise.last_ms == 4);
+
+  TEST_CASE("reconnect before loop() readvertises");
+  m.onDisconnect(8000);
+  m.onConnect(8010);                        // host task, ahead of loop()
+  CHECK(m.onAdvertising(8020) == 0);
+  CHECK(m.getStats().readvertise.count == 1);
+
+  TEST_CASE("millis() wrap");
+  m.onConnect(0xFFFFFF00u);
+  CHECK(m.onNotify(0x10) == 0x110);
+
+  return testResult("test_ble_link");
+}
@@ -0,0 +1,99 @@
+/*
+ * Dense engine against the double-precision reference interpreter: float
+ * kernels to float rounding, int8 kernels within the quantization budget,
+ * shape checks on begin(), and cost per inference
+ */
+
+#include <stdlib.h>
+#include <math.h>
+#include "host_test.h"
+#include "dense_inference.h"
+#include "reference_interpreter.h"
+
+static DenseEngine shared;
+static const DenseNetwork* const networks[MODEL_COUNT] = {
+  &arrhythmia_risk_model_dense, &anemia_risk_model_dense, &preeclampsia_risk_model_dense
+};
+
+static double nsPerInference(InferenceBackend& backend, int reps) {
+  float x[MODEL_MAX_INPUTS] = {0.3f, -1.2f, 0.8f, 1.5f, -0.4f};
+  float y[MODEL_MAX_OUTPUTS];
+  volatile float sink = 0;
+  uint64_t t0 = testNowNs();
+  for (int r = 0; r < reps; r++) {
+    x[0] += 1e-7f;
+    backend.invoke(x, y);
+    sink += y[0];
+  }
+  (void)sink;
+  return (double)(testNowNs() - t0) / reps;
+}
+
+int main() {
+  TEST_CASE("parity with the reference interpreter");
+  {
+    srand(7);
+    for (uint8_t m = 0; m < MODEL_COUNT; m++) {
+      const ModelSpec& s = MODEL_REGISTRY[m];
+      ReferenceInterpreter ref(s);
+      DenseInferenceEngine fp(s, *networks[m], shared, DENSE_FLOAT);
+      DenseInferenceEngine q8(s, *networks[m], shared, DENSE_INT8);
+      CHECK(ref.begin() && fp.begin() && q8.begin());
+      double max_float = 0, max_int8 = 0;
+      int agree = 0;
+      const int n = 20000;
+      for (int k = 0; k < n; k++) {
+        float x[MODEL_MAX_INPUTS], a[MODEL_MAX_OUTPUTS], b[MODEL_MAX_OUTPUTS], c[MODEL_MAX_OUTPUTS];
+        for (uint8_t i = 0; i < s.inputs; i++) {
+          x[i] = (rand() / (float)RAND_MAX) * 4 - 2;            // standardized range
+        }
+        ref.invoke(x, a);
+        fp.invoke(x, b);
+        q8.invoke(x, c);
+        int ia = 0, ic = 0;
+        for (uint8_t o = 0; o < s.outputs; o++) {
+          max_float = fmax(max_float, fabs(a[o] - b[o]));
+          max_int8 = fmax(max_int8, fabs(a[o] - c[o]));
+          if (a[o] > a[ia]) ia = o;
+          if (c[o] > c[ic]) ic = o;
+        }
+        agree += ia == ic;
+      }
+      METRIC("%-12s float max |d| %.2e, int8 max |d| %.2e, int8 argmax agrees %.2f%%",
+             s.name, max_float, max_int8, 100.0 * agree / n);
+      CHECK(max_float <= 1e-5);
+      CHECK(max_int8 <= 0.05);
+      CHECK(agree >= n * 97 / 100);
+    }
+  }
+
+  TEST_CASE("shapes are checked on begin()");
+  {
+    // Anemia weights (4 outputs) bound to the arrhythmia spec (5 outputs)
+    DenseInferenceEngine wrong(MODEL_REGISTRY[MODEL_ARRHYTHMIA], anemia_risk_model_dense, shared, DENSE_FLOAT);
+    float x[MODEL_MAX_INPUTS] = {0}, y[MODEL_MAX_OUTPUTS];
+    CHECK(!wrong.begin());
+    CHECK(!wrong.invoke(x, y));
+    DenseInferenceEngine right(MODEL_REGISTRY[MODEL_ARRHYTHMIA], arrhythmia_risk_model_dense, shared, DENSE_FLOAT);
+    CHECK(right.begin());
+    right.useNetwork(&anemia_risk_model_dense);                 // swapped in an image of another model
+    CHECK(!right.begin());
+    right.useNetwork(nullptr);                                  // back to the built-in weights
+    CHECK(right.begin() && right.invoke(x, y) && right.usesBuiltin());
+  }
+
+  TEST_CASE("cost per inference");
+  {
+    const int reps = 500000;
+    DenseInferenceEngine fp(MODEL_REGISTRY[MODEL_ARRHYTHMIA], arrhythmia_risk_model_dense, shared, DENSE_FLOAT);
+    DenseInferenceEngine q8(MODEL_REGISTRY[MODEL_ARRHYTHMIA], arrhythmia_risk_model_dense, shared, DENSE_INT8);
+    ReferenceInterpreter ref(MODEL_REGISTRY[MODEL_ARRHYTHMIA]);
+    fp.begin();
+    q8.begin();
+    ref.begin();
+    METRIC("float %.1f ns, int8 %.1f ns, reference %.1f ns per inference",
+           nsPerInference(fp, reps), nsPerInference(q8, reps), nsPerInference(ref, reps));
+  }
+
+  return testResult("test_dense_inference");
+}
@@ -0,0 +1,96 @@
+/*
+ * EcgAcquisition: sample indexing, missed-tick and latency accounting
+ * driven by the simulated ADC's virtual sampler clock
+ */
+
+#include "host_test.h"
+#include "simulated_adc_source.h"
+
+static uint32_t drainGaps(EcgAcquisition& acq, uint32_t& last_index, uint32_t& count) {
+  EcgSample block[64];
+  uint32_t skipped = 0;
+  bool first = true;
+  size_t n;
+  while ((n = acq.readBlock(block, 64)) > 0) {
+    for (size_t i = 0; i < n; i++) {
+      if (!first && block[i].index != last_index + 1) {
+        skipped += block[i].index - last_index - 1;
+      }
+      first = false;
+      last_index = block[i].index;
+      count++;
+    }
+  }
+  return skipped;
+}
+
+int main() {
+  TEST_CASE("clean timing at 250 Hz");
+  {
+    EcgAcquisition acq;
+    SimulatedAdcSource src(250, 75);
+    src.run(acq, 1000);
+    AcquisitionStats s = acq.getStats();
+    uint32_t last = 0, count = 0;
+    uint32_t skipped = drainGaps(acq, last, count);
+    METRIC("samples %u, missed %u, mean latency %u us", s.samples, s.missed_ticks, s.mean_latency_us);
+    CHECK(s.samples == 1000);
+    CHECK(s.missed_ticks == 0);
+    CHECK(s.overruns == 0);
+    CHECK(s.late_samples == 0);
+    CHECK(s.mean_latency_us == 20);
+    CHECK(skipped == 0);
+    CHECK(count == 1000 && last == 999);
+  }
+
+  TEST_CASE("latency spikes coalesce ticks and leave index gaps");
+  {
+    EcgAcquisition acq;
+    SimulatedAdcSource src(250, 75);
+    src.setLatencyProfile(20, 100, 9000);   // every 100th wake-up is 9 ms late
+    src.run(acq, 1000);
+    AcquisitionStats s = acq.getStats();
+    uint32_t last = 0, count = 0;
+    uint32_t skipped = drainGaps(acq, last, count);
+    METRIC("samples %u, missed %u, late %u, max latency %u us", s.samples, s.missed_ticks, s.late_samples, s.max_latency_us);
+    CHECK(s.missed_ticks > 0);
+    CHECK(s.overruns == 0);
+    CHECK(s.samples + s.missed_ticks == 1000);
+    CHECK(skipped == s.missed_ticks);        // every missed tick is visible downstream
+    CHECK(last == 999);
+    // The read is attributed to the newest elapsed tick
+    CHECK(s.max_latency_us < acq.periodUs());
+  }
+
+  TEST_CASE("ring overrun is counted, not hidden");
+  {
+    EcgAcquisition acq;
+    SimulatedAdcSource src(500, 75);
+    src.run(acq, ECG_RING_CAPACITY + 100);   // nobody drains
+    AcquisitionStats s = acq.getStats();
+    METRIC("samples %u, overruns %u", s.samples, s.overruns);
+    CHECK(s.overruns > 0);
+    CHECK(s.samples + s.overruns == ECG_RING_CAPACITY + 100);
+  }
+
+  TEST_CASE("index timebase");
+  {
+    EcgAcquisition acq;
+    CHECK(!acq.configure(300, 0, 0));        // does not divide 1 MHz
+    CHECK(acq.configure(500, 1000, 1));
+    CHECK(acq.sampleTimeUs(500) == 1000 + 1000000);
+    CHECK(acq.sampleTimeMs(250) == 1 + 500);
+    CHECK(acq.samplesToMs(125) == 250);
+    CHECK(acq.ticksDue(999) == 0);
+    CHECK(acq.ticksDue(1000) == 1);
+    CHECK(acq.ticksDue(1000 + 10 * 2000) == 11);
+    acq.onTicks(3, 1000 + 2 * 2000 + 50, 2048);
+    CHECK(acq.ticksDue(1000 + 10 * 2000) == 8);
+    CHECK(acq.getStats().missed_ticks == 2);
+    // micros() wrap: the index stays the timebase
+    CHECK(acq.configure(250, 0xFFFFF000UL, 0));
+    CHECK(acq.ticksDue(0x00001000UL) == 0x2000 / 4000 + 1);
+  }
+
+  return testResult("test_ecg_acquisition");
+}
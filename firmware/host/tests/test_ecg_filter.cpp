@@ -0,0 +1,166 @@
+/*
+ * EcgPreFilter: notch and baseline response, detection through the filter,
+ * gap handling and output index continuity across a notch change
+ */
+
+#include <math.h>
+#include "host_test.h"
+#include "ecg_filter.h"
+#include "qrs_detector.h"
+#include "simulated_adc_source.h"
+
+/**
+ * RMS gain for a 500-count sine, measured after the filter settles
+ */
+static double toneGain(uint16_t fs, MainsNotch notch, float hz) {
+  EcgPreFilter flt;
+  flt.configure(fs, notch, 1);
+  EcgSample in[32], out[32];
+  double energy = 0;
+  uint32_t count = 0, idx = 0;
+  for (uint32_t b = 0; b < fs * 12u / 32; b++) {
+    for (int i = 0; i < 32; i++, idx++) {
+      in[i].index = idx;
+      in[i].value = (int16_t)(2048 + 500 * sin(2 * M_PI * hz * idx / fs));
+    }
+    size_t m = flt.process(in, 32, out);
+    for (size_t i = 0; i < m; i++) {
+      if (out[i].index > fs * 6u) {
+        energy += (double)out[i].value * out[i].value;
+        count++;
+      }
+    }
+  }
+  return sqrt(energy / count) / (500 / sqrt(2.0));
+}
+
+static double dB(double gain) {
+  return 20 * log10(gain > 1e-9 ? gain : 1e-9);
+}
+
+int main() {
+  TEST_CASE("frequency response");
+  for (uint16_t fs = 250; fs <= 500; fs += 250) {
+    double n50 = dB(toneGain(fs, NOTCH_50HZ, 50));
+    double n60 = dB(toneGain(fs, NOTCH_60HZ, 60));
+    double wander = dB(toneGain(fs, NOTCH_50HZ, 0.3f));
+    double lo = 0, hi = -100;
+    const float pass[] = {5, 10, 15, 20, 30, 40};
+    for (size_t i = 0; i < sizeof(pass) / sizeof(pass[0]); i++) {
+      double g = dB(toneGain(fs, NOTCH_OFF, pass[i]));
+      if (g < lo) lo = g;
+      if (g > hi) hi = g;
+    }
+    METRIC("%u Hz: 50 Hz notch %.1f dB, 60 Hz notch %.1f dB, 0.3 Hz %.1f dB, 5-40 Hz %.2f..%.2f dB",
+           fs, n50, n60, wander, lo, hi);
+    CHECK(n50 < -40);
+    CHECK(n60 < -40);
+    CHECK(wander < -20);
+    CHECK(lo > -1.5 && hi < 1.0);
+  }
+
+  TEST_CASE("detection through the filter with mains and wander");
+  {
+    const uint16_t rates[] = {250, 500};
+    const float bpms[] = {50, 75, 140};
+    for (int r = 0; r < 2; r++) {
+      for (uint8_t dec = 1; dec <= 2; dec++) {
+        for (int b = 0; b < 3; b++) {
+          uint16_t fs = rates[r];
+          SimulatedAdcSource src(fs, bpms[b]);
+          src.setMainsNoise(150);
+          src.setBaselineWander(300);
+          EcgPreFilter flt;
+          flt.configure(fs, NOTCH_50HZ, dec);
+          QrsDetector det;
+          det.configure(flt.outputRate());
+          EcgSample in[32], out[32];
+          uint32_t idx = 0, beats = 0, matched = 0;
+          uint32_t n = fs * 60u;
+          float beat_s = 60.0f / bpms[b];
+          uint64_t t0 = testNowNs();
+          for (uint32_t k = 0; k < n / 32; k++) {
+            for (int i = 0; i < 32; i++, idx++) {
+              in[i].index = idx;
+              in[i].value = src.sampleAt(idx);
+            }
+            size_t m = flt.process(in, 32, out);
+            for (size_t i = 0; i < m; i++) {
+              QrsEvent ev;
+              if (det.process(out[i].value, out[i].index, ev)) {
+                beats++;
+                // R on the input timebase: 0.20 s into each beat
+                float t = (float)flt.toInputIndex(ev.r_index) / fs;
+                float phase = fmodf(t, beat_s);
+                if (fabsf(phase - 0.20f) < 0.05f) matched++;
+              }
+            }
+          }
+          double ns = (double)(testNowNs() - t0) / n;
+          uint32_t expected = (uint32_t)((60.0f - 3.0f) / beat_s);
+          METRIC("%u Hz /%u %3.0f BPM: %u beats (~%u expected), %u on R, %.0f ns/sample",
+                 fs, dec, bpms[b], beats, expected, matched, ns);
+          CHECK(beats + 2 >= expected && beats <= expected + 3);
+          CHECK(matched == beats);
+        }
+      }
+    }
+  }
+
+  TEST_CASE("gaps: short ones bridged, long ones restart with monotonic indices");
+  {
+    EcgPreFilter flt;
+    flt.configure(250, NOTCH_50HZ, 1);
+    EcgSample in[512], out[512];
+    for (uint32_t i = 0; i < 200; i++) in[i] = EcgSample{i, 2048};
+    for (uint32_t i = 200; i < 400; i++) in[i] = EcgSample{i + 5, 2048};     // 5 missing
+    for (uint32_t i = 400; i < 512; i++) in[i] = EcgSample{i + 500, 2048};   // 300 missing
+    size_t m = flt.process(in, 512, out);
+    bool monotonic = true;
+    for (size_t i = 1; i < m; i++) {
+      if (out[i].index <= out[i - 1].index) monotonic = false;
+    }
+    METRIC("%zu outputs, %u gap fills, %u restarts", m, flt.gapFillCount(), flt.restartCount());
+    CHECK(flt.gapFillCount() == 5);
+    CHECK(flt.restartCount() == 1);
+    CHECK(monotonic);
+    CHECK(flt.toInputIndex(out[m - 1].index) == 511u + 500u - flt.delaySamples());
+  }
+
+  TEST_CASE("notch change keeps output indices moving forward");
+  {
+    const uint8_t decs[] = {1, 4};
+    for (int d = 0; d < 2; d++) {
+      SimulatedAdcSource src(500, 75);
+      EcgPreFilter flt;
+      flt.configure(500, NOTCH_50HZ, decs[d]);
+      EcgSample in[50], out[50];
+      uint32_t idx = 0, last_out = 0, outputs = 0;
+      bool monotonic = true, mapped = true;
+      for (int block = 0; block < 100; block++) {
+        if (block == 40) flt.setNotch(NOTCH_60HZ);
+        if (block == 70) flt.setNotch(NOTCH_OFF);
+        for (int i = 0; i < 50; i++, idx++) {
+          in[i].index = idx;
+          in[i].value = src.sampleAt(idx);
+        }
+        size_t m = flt.process(in, 50, out);
+        for (size_t i = 0; i < m; i++) {
+          if (outputs && out[i].index <= last_out) monotonic = false;
+          // Each output maps back to the input sample it was delayed from
+          uint32_t at = flt.toInputIndex(out[i].index);
+          if (at > idx || idx - at > (uint32_t)flt.delaySamples() + 50 + decs[d]) mapped = false;
+          last_out = out[i].index;
+          outputs++;
+        }
+      }
+      METRIC("decimation %u: %u outputs, last index %u, notch %d", decs[d], outputs, last_out, (int)flt.notchFrequency());
+      CHECK(monotonic);
+      CHECK(mapped);
+      CHECK(flt.notchFrequency() == NOTCH_OFF);
+      CHECK(flt.decimationFactor() == decs[d]);
+    }
+  }
+
+  return testResult("test_ecg_filter");
+}
@@ -0,0 +1,254 @@
+/*
+ * FeatureExtractor: a 20-minute recording (irregular stretch, signal loss,
+ * beats delivered late) replayed as the inference stage feeds it, every
+ * emission compared to a brute-force float64 reference over the same
+ * buckets; then gap restarts, reconfiguration and cost per tick
+ */
+
+#include <vector>
+#include <math.h>
+#include "host_test.h"
+#include "feature_window.h"
+
+#define BEAT_LATENCY_MS 60          // R-peak to beat event, as the filter delay
+#define STEP_MS 20                  // inference stage period
+
+static uint32_t rng = 2024;
+
+static double urand() {
+  rng = rng * 1664525u + 1013904223u;
+  return (rng >> 8) / 16777216.0;
+}
+
+/**
+ * One input as the reference sees it: its channel, exact value and the
+ * bucket of each window it was counted in
+ */
+struct RefInput {
+  uint8_t channel;
+  double value;
+  uint32_t bucket[FEATURE_WINDOW_COUNT];
+};
+
+/**
+ * Keeps every input and recomputes each window from scratch. Inputs older
+ * than the open bucket count in the open bucket, as documented for
+ * FeatureExtractor
+ */
+class Reference {
+private:
+  std::vector<RefInput> inputs;
+  uint32_t bucket_ms[FEATURE_WINDOW_COUNT];
+  uint32_t open[FEATURE_WINDOW_COUNT];
+
+  void seek(uint32_t time_ms, uint32_t* bucket) {
+    for (uint8_t w = 0; w < FEATURE_WINDOW_COUNT; w++) {
+      uint32_t id = time_ms / bucket_ms[w];
+      if (id > open[w]) open[w] = id;
+      bucket[w] = open[w];
+    }
+  }
+
+public:
+  Reference(uint32_t short_ms, uint32_t long_ms) {
+    bucket_ms[FEATURE_WINDOW_SHORT] = short_ms / FEATURE_WINDOW_BUCKETS;
+    bucket_ms[FEATURE_WINDOW_LONG] = long_ms / FEATURE_WINDOW_BUCKETS;
+    open[0] = open[1] = 0;
+  }
+
+  void add(uint32_t time_ms, uint8_t channel, double value) {
+    RefInput in;
+    in.channel = channel;
+    in.value = value;
+    seek(time_ms, in.bucket);
+    inputs.push_back(in);
+  }
+
+  void features(uint32_t now_ms, double out[FEATURE_WINDOW_COUNT][AI_FEATURE_COUNT]) {
+    uint32_t bucket[FEATURE_WINDOW_COUNT];
+    seek(now_ms, bucket);
+    for (uint8_t w = 0; w < FEATURE_WINDOW_COUNT; w++) {
+      double n[FEAT_CH_COUNT] = {0}, sum[FEAT_CH_COUNT] = {0};
+      std::vector<double> rr;
+      for (size_t i = 0; i < inputs.size(); i++) {
+        const RefInput& in = inputs[i];
+        if (in.bucket[w] >= bucket[w] || in.bucket[w] + FEATURE_WINDOW_BUCKETS < bucket[w]) continue;
+        n[in.channel]++;
+        sum[in.channel] += in.value;
+        if (in.channel == FEAT_CH_RR) rr.push_back(in.value);
+      }
+      double mean[FEAT_CH_COUNT];
+      for (uint8_t c = 0; c < FEAT_CH_COUNT; c++) {
+        mean[c] = n[c] ? sum[c] / n[c] : 0;
+      }
+      double var = 0;
+      for (size_t i = 0; i < rr.size(); i++) {
+        var += (rr[i] - mean[FEAT_CH_RR]) * (rr[i] - mean[FEAT_CH_RR]);
+      }
+      var = rr.size() >= 2 ? var / rr.size() : 0;
+      double* f = out[w];
+      f[AI_FEAT_ECG_HR] = mean[FEAT_CH_ECG_HR];
+      f[AI_FEAT_HR] = mean[FEAT_CH_HR];
+      f[AI_FEAT_SDNN] = sqrt(var);
+      f[AI_FEAT_RR_VARIANCE] = var;
+      f[AI_FEAT_QRS_WIDTH] = mean[FEAT_CH_QRS];
+      f[AI_FEAT_R_AMPLITUDE] = mean[FEAT_CH_AMPLITUDE];
+      f[AI_FEAT_SPO2] = mean[FEAT_CH_SPO2];
+      f[AI_FEAT_BP_SYS] = mean[FEAT_CH_BP_SYS];
+      f[AI_FEAT_BP_DIA] = mean[FEAT_CH_BP_DIA];
+    }
+  }
+};
+
+struct Beat {
+  uint32_t r_ms;
+  uint16_t rr_ms;
+  uint16_t qrs_ms;
+  uint16_t amplitude;
+};
+
+/**
+ * 20 minutes of beats: slow HR drift with respiratory variation, an
+ * irregular stretch from 8 to 10 min, no signal from 12 to 17.5 min
+ */
+static std::vector<Beat> recording() {
+  std::vector<Beat> beats;
+  uint32_t t = 1500;
+  while (t < 1200000) {
+    double minute = t / 60000.0;
+    double hr = 72 + 10 * sin(minute / 3) + 3 * sin(t / 4000.0);
+    double rr = 60000 / hr;
+    if (minute >= 8 && minute < 10) rr *= 0.7 + 0.6 * urand();
+    Beat b;
+    b.rr_ms = (uint16_t)lround(rr);
+    t += b.rr_ms;
+    b.r_ms = t;
+    b.qrs_ms = (uint16_t)(86 + urand() * 12);
+    b.amplitude = (uint16_t)(900 + urand() * 300);
+    if (minute < 12 || minute >= 17.5) beats.push_back(b);
+  }
+  return beats;
+}
+
+/**
+ * Largest error a feature may have against the float64 reference: half a
+ * quantization step per summed value plus float rounding
+ */
+static double tolerance(uint8_t feature, double ref) {
+  double rel = 1e-5 * fabs(ref);
+  if (feature == AI_FEAT_SDNN || feature == AI_FEAT_RR_VARIANCE) return 1e-4 * fabs(ref) + 1e-3;
+  return 0.5 / FEATURE_QUANT + rel;
+}
+
+int main() {
+  TEST_CASE("replay against the float64 reference");
+  {
+    std::vector<Beat> beats = recording();
+    FeatureExtractor fx;
+    Reference ref(FEATURE_SHORT_WINDOW_MS, FEATURE_LONG_WINDOW_MS);
+    double max_error[AI_FEATURE_COUNT] = {0};
+    uint32_t emissions = 0, mismatches = 0, long_filled = 0;
+    size_t next_beat = 0;
+    for (uint32_t now = 0; now < 1200000; now += STEP_MS) {
+      while (next_beat < beats.size() && beats[next_beat].r_ms + BEAT_LATENCY_MS <= now) {
+        const Beat& b = beats[next_beat++];
+        fx.addBeat(b.r_ms, b.rr_ms, b.qrs_ms, b.amplitude);
+        ref.add(b.r_ms, FEAT_CH_RR, b.rr_ms);
+        ref.add(b.r_ms, FEAT_CH_ECG_HR, 60000.0 / b.rr_ms);
+        ref.add(b.r_ms, FEAT_CH_QRS, b.qrs_ms);
+        ref.add(b.r_ms, FEAT_CH_AMPLITUDE, b.amplitude);
+      }
+      if (!fx.due(now)) continue;
+      double minute = now / 60000.0;
+      bool signal = minute < 12 || minute >= 17.5;
+      float hr = signal ? (float)(74 + 8 * sin(minute / 3) + urand()) : 0;
+      float spo2 = signal ? (float)(96.5 + urand()) : 0;
+      float sys = now >= 90000 ? (float)(118 + minute / 4) : 0;
+      float dia = now >= 90000 ? 76.3f : 0;
+      fx.addVitals(now, hr, spo2, sys, dia);
+      if (hr > 0) ref.add(now, FEAT_CH_HR, hr);
+      if (spo2 > 0) ref.add(now, FEAT_CH_SPO2, spo2);
+      if (sys > 0 && dia > 0) {
+        ref.add(now, FEAT_CH_BP_SYS, sys);
+        ref.add(now, FEAT_CH_BP_DIA, dia);
+      }
+
+      const AiFeatures* got = fx.emit(now);
+      double want[FEATURE_WINDOW_COUNT][AI_FEATURE_COUNT];
+      ref.features(now, want);
+      emissions++;
+      for (uint8_t w = 0; w < FEATURE_WINDOW_COUNT; w++) {
+        for (uint8_t k = 0; k < AI_FEATURE_COUNT; k++) {
+          double err = fabs(got[w].v[k] - want[w][k]);
+          if (err > max_error[k]) max_error[k] = err;
+          if (err > tolerance(k, want[w][k])) {
+            if (mismatches++ < 5) {
+              CHECK_MSG(false, "t=%u window %u feature %u: %.4f, reference %.4f", now, w, k, got[w].v[k], want[w][k]);
+            }
+          }
+        }
+      }
+      if (got[FEATURE_WINDOW_LONG].v[AI_FEAT_SDNN] > 0) long_filled++;
+    }
+    FeatureWindowStats st = fx.getStats();
+    METRIC("%u emissions, %u beats (%u late), %u restarts", emissions, st.beats, st.late, st.restarts);
+    METRIC("max error: ECG HR %.4f, HR %.4f, SDNN %.5f, RR var %.4f, QRS %.4f, amplitude %.4f",
+           max_error[AI_FEAT_ECG_HR], max_error[AI_FEAT_HR], max_error[AI_FEAT_SDNN],
+           max_error[AI_FEAT_RR_VARIANCE], max_error[AI_FEAT_QRS_WIDTH], max_error[AI_FEAT_R_AMPLITUDE]);
+    METRIC("           SpO2 %.4f, BP %.4f/%.4f", max_error[AI_FEAT_SPO2], max_error[AI_FEAT_BP_SYS],
+           max_error[AI_FEAT_BP_DIA]);
+    CHECK(mismatches == 0);
+    CHECK(emissions == 1200000 / FEATURE_HOP_MS);
+    CHECK(st.late > 0 && st.restarts == 0);
+    CHECK(long_filled > 0);
+  }
+
+  TEST_CASE("window contents");
+  {
+    FeatureExtractor fx;
+    fx.addBeat(1000, 800, 90, 1000);
+    fx.addBeat(1800, 1000, 90, 1000);
+    fx.emit(1999);
+    CHECK(fx.latest(FEATURE_WINDOW_SHORT).v[AI_FEAT_SDNN] == 0);   // open bucket not counted yet
+    const AiFeatures* f = fx.emit(2000);
+    CHECK(f[FEATURE_WINDOW_SHORT].v[AI_FEAT_SDNN] == 100.0f);
+    CHECK(f[FEATURE_WINDOW_SHORT].v[AI_FEAT_ECG_HR] == 67.5f);
+    CHECK(f[FEATURE_WINDOW_LONG].v[AI_FEAT_SDNN] == 0);            // 10 s bucket still open
+    CHECK(fx.channelStats(FEATURE_WINDOW_SHORT, FEAT_CH_RR).count == 2);
+    f = fx.emit(32000);                                             // both beats have left the short window
+    CHECK(f[FEATURE_WINDOW_SHORT].v[AI_FEAT_ECG_HR] == 0);
+    CHECK(f[FEATURE_WINDOW_LONG].v[AI_FEAT_RR_VARIANCE] == 10000.0f);
+    f = fx.emit(32000 + FEATURE_LONG_WINDOW_MS + 10000);            // a gap longer than a window
+    CHECK(f[FEATURE_WINDOW_LONG].v[AI_FEAT_RR_VARIANCE] == 0);
+    CHECK(fx.getStats().restarts == FEATURE_WINDOW_COUNT);
+  }
+
+  TEST_CASE("reconfiguration and cadence");
+  {
+    FeatureExtractor fx(10000, 60000);
+    CHECK(fx.windowMs(FEATURE_WINDOW_SHORT) == 9990 && fx.windowMs(FEATURE_WINDOW_LONG) == 60000);   // whole buckets
+    fx.configure(45000, 600000);
+    CHECK(fx.windowMs(FEATURE_WINDOW_SHORT) == 45000 && fx.windowMs(FEATURE_WINDOW_LONG) == 600000);
+    CHECK(fx.due(5000) && !fx.due(5999) && fx.due(6000));
+    CHECK(fx.due(9500) && !fx.due(10000) && fx.due(10500));         // missed ticks skipped, not caught up
+  }
+
+  TEST_CASE("cost per tick");
+  {
+    FeatureExtractor fx;
+    const uint32_t ticks = 200000;
+    uint64_t t0 = testNowNs();
+    volatile float sink = 0;
+    for (uint32_t t = 0; t < ticks; t++) {
+      uint32_t now = t * FEATURE_HOP_MS;
+      fx.addBeat(now, (uint16_t)(800 + t % 40), 90, 1000);
+      fx.addVitals(now, 75, 97, 118, 76);
+      sink += fx.emit(now)[FEATURE_WINDOW_LONG].v[AI_FEAT_SDNN];
+    }
+    (void)sink;
+    METRIC("%.1f ns per tick (beat + vitals + emit), sizeof(FeatureExtractor) %zu",
+           (double)(testNowNs() - t0) / ticks, sizeof(FeatureExtractor));
+  }
+
+  return testResult("test_feature_window");
+}
@@ -0,0 +1,156 @@
+/*
+ * HrvSpectrum against a float64 DFT of the same resampled, windowed RR
+ * series: sinusoidal LF/HF modulation with noise and dropped beats, short
+ * histories and per-step cost
+ */
+
+#include "host_test.h"
+#include "hrv_spectrum.h"
+#include <math.h>
+#include <random>
+#include <vector>
+
+struct Bands {
+  double vlf, lf, hf;
+};
+
+static Bands reference(const BeatHistory& h) {
+  uint32_t end = h.beatTime(0);
+  uint32_t max_span = (HRV_FFT_SIZE - 1) * HRV_RESAMPLE_MS;
+  uint32_t oldest = 0;
+  while (oldest + 1 < h.size() && end - h.beatTime(oldest + 1) <= max_span) oldest++;
+  int n = (end - h.beatTime(oldest)) / HRV_RESAMPLE_MS + 1;
+  std::vector<double> x(n);
+  double t = (double)end - (n - 1) * (double)HRV_RESAMPLE_MS;
+  for (int k = 0; k < n; k++, t += HRV_RESAMPLE_MS) {
+    int a = oldest;
+    while (a > 0 && h.beatTime(a - 1) <= t) a--;
+    double v = h.rr(a);
+    if (a > 0) {
+      double t0 = h.beatTime(a), t1 = h.beatTime(a - 1);
+      v += (h.rr(a - 1) - v) * (t - t0) / (t1 - t0);
+    }
+    x[k] = v;
+  }
+  double mean = 0;
+  for (double v : x) mean += v;
+  mean /= n;
+  double energy = 0;
+  for (int k = 0; k < n; k++) {
+    double w = 0.5 - 0.5 * cos(2 * M_PI * k / (n - 1));
+    x[k] = (x[k] - mean) * w;
+    energy += w * w;
+  }
+  auto band = [&](double lo, double hi) {
+    double s = 0;
+    for (int k = 0; k <= HRV_FFT_SIZE / 2; k++) {
+      double f = k * (double)HRV_RESAMPLE_HZ / HRV_FFT_SIZE;
+      if (f < lo - 1e-12 || f >= hi - 1e-12) continue;
+      double re = 0, im = 0;
+      for (int j = 0; j < n; j++) {
+        double a = -2 * M_PI * k * j / HRV_FFT_SIZE;
+        re += x[j] * cos(a);
+        im += x[j] * sin(a);
+      }
+      s += re * re + im * im;
+    }
+    return 2 * s / (HRV_FFT_SIZE * energy);
+  };
+  Bands b = {band(0.003, 0.04), band(0.04, 0.15), band(0.15, 0.4)};
+  return b;
+}
+
+static HrvSpectrum spectrum;
+static BeatHistory history;
+
+// Random LF/HF modulation, checked against reference() within limit
+static void sweep(double amp_scale, double noise_scale, double limit) {
+  std::mt19937 rng(7);
+  std::uniform_real_distribution<double> U(0, 1);
+  std::normal_distribution<double> N(0, 1);
+  double worst_band = 0, worst_ratio = 0, begin_max = 0, step_max = 0;
+  int cases = 0, rejected = 0;
+  for (int c = 0; c < 60; c++) {
+    history.clear();
+    double base = 600 + U(rng) * 500;
+    double a_lf = amp_scale * (0.1 + U(rng)), a_hf = amp_scale * (0.06 + U(rng) * 0.9);
+    double f_lf = 0.05 + U(rng) * 0.09, f_hf = 0.17 + U(rng) * 0.2;
+    double noise = noise_scale * U(rng);
+    double dur_ms = (130 + U(rng) * 250) * 1000;
+    double t = 0;
+    uint32_t now = 1000 + (uint32_t)(U(rng) * 1e6);
+    while (t < dur_ms) {
+      double rr = base + a_lf * sin(2 * M_PI * f_lf * t / 1000) + a_hf * sin(2 * M_PI * f_hf * t / 1000) + noise * N(rng);
+      uint16_t r = (uint16_t)lround(rr);
+      t += r;
+      now += r;
+      if (c % 5 == 4 && U(rng) < 0.03) {   // dropped beat
+        history.markGap();
+        continue;
+      }
+      history.add(r, now);
+    }
+    double t0 = testNowNs();
+    bool ok = spectrum.begin(history);
+    begin_max = fmax(begin_max, testNowNs() - t0);
+    if (!ok) {
+      rejected++;
+      continue;
+    }
+    bool done = false;
+    while (!done) {
+      t0 = testNowNs();
+      done = spectrum.step();
+      step_max = fmax(step_max, testNowNs() - t0);
+    }
+    Bands r = reference(history);
+    const HrvSpectrumResult& s = spectrum.latest();
+    worst_band = fmax(worst_band, fmax(fabs(s.lf_ms2 - r.lf) / r.lf, fabs(s.hf_ms2 - r.hf) / r.hf));
+    worst_ratio = fmax(worst_ratio, fabs(s.lf_hf - r.lf / r.hf) / (r.lf / r.hf));
+    cases++;
+  }
+  CHECK(rejected == 0);
+  CHECK_MSG(worst_band < limit && worst_ratio < limit, "band %.4f, LF/HF %.4f", worst_band, worst_ratio);
+  METRIC("%d histories: worst band error %.2f%%, LF/HF error %.2f%%", cases, 100 * worst_band, 100 * worst_ratio);
+  METRIC("begin() max %.1f us, step() max %.1f us", begin_max / 1000, step_max / 1000);
+}
+
+int main() {
+  TEST_CASE("strong modulation (5-65 ms LF, 3-50 ms HF)");
+  sweep(60, 15, 0.01);
+
+  TEST_CASE("weak modulation (0.5-3.5 ms): float32 rounding");
+  sweep(3, 1, 0.03);
+
+  TEST_CASE("under two minutes of beats is rejected");
+  {
+    history.clear();
+    uint32_t now = 0;
+    for (int i = 0; i < 100; i++) {
+      now += 800;
+      history.add(800, now);
+    }
+    CHECK(!spectrum.begin(history));
+  }
+
+  TEST_CASE("full spectrum cost");
+  {
+    history.clear();
+    uint32_t now = 0;
+    for (int i = 0; i < 400; i++) {
+      uint16_t r = 800 + (i % 7) * 10;
+      now += r;
+      history.add(r, now);
+    }
+    const int reps = 2000;
+    double t0 = testNowNs();
+    for (int i = 0; i < reps; i++) {
+      spectrum.begin(history);
+      spectrum.finish();
+    }
+    METRIC("%.1f us per spectrum, %u steps, HrvSpectrum %u B", (testNowNs() - t0) / reps / 1000,
+           (unsigned)HRV_SPECTRUM_STEPS, (unsigned)sizeof(HrvSpectrum));
+  }
+
+  return testResult("test_hrv_spectrum");
+}
@@ -0,0 +1,97 @@
+/*
+ * LedIndicator on a virtual clock: expiry and fallback, priority and
+ * tie-break, repeated requests, cancel and millis() wrap-around
+ */
+
+#include "host_test.h"
+#include "led_indicator.h"
+
+// Mirrors the sketch's table: color, on ms, off ms, cycles (0 = hold), priority
+static const LedPattern PATTERNS[] = {
+  {0, 0, 0, 0, 0},
+  {0x0000FF, 500, 0, 1, 1},       // 1 ready flash
+  {0x00FF00, 100, 0, 0, 1},       // 2 link up (hold)
+  {0xFF0000, 100, 0, 0, 1},       // 3 link down (hold)
+  {0xFFA500, 300, 300, 3, 2},     // 4 weak signal
+  {0xFFA500, 300, 300, 2, 3},     // 5 anemia
+  {0xFF6400, 250, 250, 3, 3},     // 6 moderate BP
+  {0xFF0000, 200, 200, 3, 4},     // 7 arrhythmia
+  {0xFF0000, 200, 200, 5, 5},     // 8 severe BP
+};
+
+static LedIndicator led;
+static uint32_t now_ms = 1000;
+static int writes = 0;
+
+static void runUntil(uint32_t until) {
+  for (; now_ms < until; now_ms += 10) {
+    if (led.tick(now_ms)) writes++;
+  }
+}
+
+int main() {
+  led.begin(PATTERNS, sizeof(PATTERNS) / sizeof(PATTERNS[0]));
+
+  TEST_CASE("one-shot pattern expires to off");
+  led.request(0, 1);
+  runUntil(1400);
+  CHECK(led.color() == 0x0000FF);
+  runUntil(1600);
+  CHECK(led.color() == 0);
+  CHECK(led.activeChannel() == -1);
+
+  TEST_CASE("alert overrides link status, then falls back to it");
+  led.request(0, 2);
+  runUntil(2000);
+  CHECK(led.color() == 0x00FF00);
+  led.request(2, 7);
+  led.tick(now_ms);
+  CHECK(led.color() == 0xFF0000 && led.activeChannel() == 2);
+  runUntil(now_ms + 250);
+  CHECK(led.color() == 0);                  // off phase of the blink
+
+  TEST_CASE("re-requesting a running pattern does not restart it");
+  uint32_t started = now_ms - 250;
+  for (int i = 0; i < 3; i++) {
+    led.request(2, 7);                      // once per beat
+    runUntil(now_ms + 300);
+  }
+  runUntil(started + 1210);                 // three 400 ms cycles
+  CHECK(led.activeChannel() == 0);
+  CHECK(led.color() == 0x00FF00);
+
+  TEST_CASE("priority, then most recent on a tie");
+  led.request(3, 5);
+  led.request(4, 8);
+  led.tick(now_ms);
+  CHECK(led.activeChannel() == 4);          // severe BP over anemia
+  runUntil(now_ms + 2020);
+  CHECK(led.activeChannel() == 0);          // both finished
+  led.request(3, 5);
+  runUntil(now_ms + 100);
+  led.request(4, 6);
+  led.tick(now_ms);
+  CHECK(led.activeChannel() == 4);          // same priority, newer wins
+
+  TEST_CASE("cancel");
+  led.cancel(4);
+  led.tick(now_ms);
+  CHECK(led.activeChannel() == 3);
+
+  TEST_CASE("millis() wrap-around");
+  {
+    LedIndicator w;
+    w.begin(PATTERNS, sizeof(PATTERNS) / sizeof(PATTERNS[0]));
+    uint32_t c = 0xFFFFFF00u;
+    w.request(2, 7);
+    w.tick(c);
+    CHECK(w.color() == 0xFF0000);
+    for (int i = 0; i < 60; i++) w.tick(c += 10);
+    CHECK(w.activeChannel() == 2);          // 600 ms in, across the wrap
+    for (int i = 0; i < 70; i++) w.tick(c += 10);
+    CHECK(w.activeChannel() == -1);
+  }
+
+  METRIC("%d LED writes", writes);
+  return testResult("test_led_indicator");
+}
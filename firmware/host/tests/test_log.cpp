@@ -0,0 +1,125 @@
+/*
+ * Logging ring: producers never wait on the consumer, every record is
+ * either delivered in order or counted as dropped, stripped levels do not
+ * evaluate their arguments
+ */
+
+#define LIFEBAND_LOG_LEVEL LOG_LEVEL_INFO
+
+#include <thread>
+#include <vector>
+#include <algorithm>
+#include <atomic>
+#include <string.h>
+#include <stdlib.h>
+#include "host_test.h"
+#include "lifeband_log.h"
+
+struct SinkState {
+  uint32_t lines;
+  uint32_t reported_drops;
+  int32_t last[3];          // last sequence seen per producer
+  bool ordered;
+  bool formatted;
+};
+
+static void slowSink(const char* line, size_t len, void* ctx) {
+  SinkState* s = (SinkState*)ctx;
+  const char* drop = strstr(line, "records dropped");
+  if (drop) {
+    s->reported_drops += (uint32_t)strtoul(strstr(line, "⚠️ ") + strlen("⚠️ "), nullptr, 10);
+    return;
+  }
+  int p = -1, seq = -1;
+  const char* body = strstr(line, "[ECG] p");
+  if (!body || sscanf(body, "[ECG] p%d seq %d", &p, &seq) != 2 || p < 0 || p > 2 || line[len - 1] != '\n') {
+    s->formatted = false;
+    return;
+  }
+  if (seq <= s->last[p]) s->ordered = false;
+  s->last[p] = seq;
+  s->lines++;
+  struct timespec ts = {0, 200000};   // a slow UART
+  nanosleep(&ts, nullptr);
+}
+
+static int evaluated(int& n) {
+  return ++n;
+}
+
+int main() {
+  TEST_CASE("three producers against a slow consumer");
+  {
+    const int producers = 3, per_producer = 50000;
+    SinkState sink = {0, 0, {-1, -1, -1}, true, true};
+    std::atomic<bool> stop(false);
+    std::thread consumer([&] {
+      while (!stop.load()) {
+        if (!lifebandLog().drain(slowSink, &sink, 64)) {
+          std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+      }
+    });
+    std::vector<double> p99(producers), worst(producers);
+    std::vector<std::thread> threads;
+    for (int p = 0; p < producers; p++) {
+      threads.push_back(std::thread([p, per_producer, &p99, &worst] {
+        std::vector<float> us(per_producer);
+        for (int i = 0; i < per_producer; i++) {
+          uint64_t t0 = testNowNs();
+          LOG_I(LOG_ECG, "p%d seq %d HR: %d BPM, HRV: %dms", p, i, 70 + i % 50, 800 + i % 100);
+          us[i] = (float)(testNowNs() - t0) / 1000.0f;
+        }
+        worst[p] = *std::max_element(us.begin(), us.end());
+        std::sort(us.begin(), us.end());
+        p99[p] = us[per_producer * 99 / 100];
+      }));
+    }
+    for (size_t i = 0; i < threads.size(); i++) threads[i].join();
+    stop = true;
+    consumer.join();
+    while (lifebandLog().drain(slowSink, &sink, 64)) {
+    }
+    uint32_t written = lifebandLog().writtenCount(), dropped = lifebandLog().droppedCount();
+    bool bounded = true;
+    for (int p = 0; p < producers; p++) {
+      METRIC("producer %d: p99 %.2f us, worst %.1f us", p, p99[p], worst[p]);
+      bounded = bounded && p99[p] < 20.0;   // one byte at 115200 baud takes 87 us
+    }
+    METRIC("written %u, dropped %u (reported %u), delivered %u", written, dropped, sink.reported_drops, sink.lines);
+    CHECK(bounded);                          // the producer never waits for the UART
+    CHECK(written + dropped == (uint32_t)(producers * per_producer));
+    CHECK(dropped > 0);                      // the consumer could not keep up
+    CHECK(sink.lines == written);
+    CHECK(sink.reported_drops == dropped);
+    CHECK(sink.ordered);
+    CHECK(sink.formatted);
+  }
+
+  TEST_CASE("levels above LIFEBAND_LOG_LEVEL compile out");
+  {
+    int n = 0;
+    LOG_D(LOG_AI, "%d", evaluated(n));
+    CHECK(n == 0);
+    LOG_I(LOG_AI, "%d", evaluated(n));
+    CHECK(n == 1);
+  }
+
+  TEST_CASE("long messages are truncated to one line");
+  {
+    LifeBandLogger logger;
+    char longText[300];
+    memset(longText, 'x', sizeof(longText) - 1);
+    longText[sizeof(longText) - 1] = 0;
+    CHECK(logger.log(LOG_LEVEL_WARN, LOG_BLE, "%s", longText));
+    LogRecord rec;
+    CHECK(logger.read(rec));
+    CHECK(strlen(rec.text) == LOG_MSG_LEN - 1);
+    CHECK(rec.tag == LOG_BLE && rec.level == LOG_LEVEL_WARN);
+    for (int i = 0; i < LOG_RING_SLOTS; i++) logger.log(LOG_LEVEL_ERROR, LOG_SYS, "fill %d", i);
+    CHECK(!logger.log(LOG_LEVEL_ERROR, LOG_SYS, "full"));
+    CHECK(logger.droppedCount() == 1);
+  }
+
+  return testResult("test_log");
+}
@@ -0,0 +1,136 @@
+/*
+ * Max30105Fifo against the MAX30105 register model: pointer wrap,
+ * overflow gaps with and without rollover, multi-burst reads, transient
+ * I2C errors and stuck-bus recovery
+ */
+
+#include "host_test.h"
+#include "mock_max30105.h"
+
+static void interruptLine(void* ctx) {
+  ((Max30105Fifo*)ctx)->onInterrupt();
+}
+
+int main() {
+  MockMax30105 mock;
+  Max30105Fifo fifo;
+  mock.setInterruptCallback(interruptLine, &fifo);
+  uint32_t t = 0, expect = 1, idx = 0;
+  PpgSample s;
+
+  TEST_CASE("configuration");
+  CHECK(fifo.configure(&mock, 40000, 17, true, 0));
+  CHECK((mock.reg(0x08) & 0x0F) == 15);     // FIFO_A_FULL: interrupt at 17 samples
+  CHECK(mock.reg(0x02) == 0x80);            // A_FULL_EN
+
+  TEST_CASE("interrupt-driven bursts across 5-bit pointer wrap");
+  {
+    bool in_order = true, stamped = true;
+    for (int r = 0; r < 10; r++) {
+      mock.produce(16);
+      t += 16 * 40000;
+      CHECK(fifo.service(t) == 0);          // below A_FULL, no interrupt yet
+      mock.produce(1);
+      t += 40000;
+      CHECK(fifo.service(t) == 17);
+      while (fifo.pop(s)) {
+        in_order = in_order && s.red == expect && s.ir == ((expect + 0x10000) & 0x3FFFF) && s.index == idx;
+        expect++;
+        idx++;
+      }
+      stamped = stamped && s.time_us == t;  // newest sample carries the read time
+    }
+    CHECK(in_order);
+    CHECK(stamped);
+    PpgFifoStats st = fifo.getStats();
+    CHECK(st.interrupts == 10 && st.timer_reads == 0 && st.bursts == 10);
+  }
+
+  TEST_CASE("overflow with rollover: the gap comes before the samples");
+  {
+    mock.setInterruptCallback(nullptr, nullptr);   // lost edge: timer read
+    mock.produce(40);
+    t += 40 * 40000;
+    CHECK(fifo.service(t) == 32);
+    PpgFifoStats st = fifo.getStats();
+    CHECK(st.fifo_overflows == 8 && st.timer_reads == 1);
+    size_t k = 0;
+    while (fifo.pop(s)) {
+      if (k++ == 0) CHECK(s.red == expect + 8 && s.index == idx + 8);
+    }
+    expect += 40;
+    idx += 40;
+    CHECK(s.red == expect - 1 && s.index == idx - 1);
+  }
+
+  TEST_CASE("a short bus buffer splits the read into bursts");
+  {
+    mock.setReadLimit(30);
+    mock.produce(20);
+    t += 20 * 80000;
+    CHECK(fifo.service(t) == 20);
+    bool in_order = true;
+    while (fifo.pop(s)) {
+      in_order = in_order && s.red == expect++;
+      idx++;
+    }
+    CHECK(in_order);
+  }
+
+  TEST_CASE("transient NACKs are retried on the next service");
+  {
+    mock.setReadLimit(126);
+    mock.produce(17);
+    t += 10000000;
+    mock.injectFaults(I2C_NACK, 2);
+    CHECK(fifo.service(t) == 0);
+    t += 10000000;
+    CHECK(fifo.service(t) == 0);
+    t += 10000000;
+    CHECK(fifo.service(t) == 17);
+    bool in_order = true;
+    while (fifo.pop(s)) in_order = in_order && s.red == expect++;
+    CHECK(in_order);
+    PpgFifoStats st = fifo.getStats();
+    CHECK(st.i2c_errors == 2 && st.recoveries == 0);
+  }
+
+  TEST_CASE("stuck bus: recovery after three failures clears the FIFO");
+  {
+    mock.produce(5);
+    mock.holdBus();
+    for (int i = 0; i < 3; i++) {
+      t += 10000000;
+      CHECK(fifo.service(t) == 0);
+    }
+    PpgFifoStats st = fifo.getStats();
+    CHECK(st.recoveries == 1 && st.i2c_timeouts == 3 && mock.fifoCount() == 0);
+    expect += 5;
+    mock.produce(3);
+    t += 10000000;
+    CHECK(fifo.service(t) == 3);
+    fifo.pop(s);
+    CHECK(s.red == expect);
+    METRIC("%u samples in %u bursts, %u overflows, %u I2C errors, %u timeouts, %u recoveries",
+           st.samples, st.bursts, st.fifo_overflows, st.i2c_errors, st.i2c_timeouts, st.recoveries);
+  }
+
+  TEST_CASE("overflow without rollover: the gap comes after the samples");
+  {
+    MockMax30105 m2;
+    Max30105Fifo f2;
+    m2.setRollover(false);
+    CHECK(f2.configure(&m2, 40000, 32, false, 0));
+    m2.produce(35);
+    CHECK(f2.service(40000 * 32) == 32);
+    f2.pop(s);
+    CHECK(s.red == 1 && s.index == 0);
+    m2.produce(1);
+    CHECK(f2.service(40000 * 64) == 1);
+    while (f2.pop(s)) {
+    }
+    CHECK(s.red == 36 && s.index == 35);
+  }
+
+  return testResult("test_max30105_fifo");
+}
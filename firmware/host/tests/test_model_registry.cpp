@@ -0,0 +1,238 @@
+/*
+ * ModelRegistry and LifeBandAI on the reference interpreter: binding,
+ * per-model periods and skips, rule fallback when a backend fails, each
+ * model reading its own window, standardization, reload and latency
+ */
+
+#include <math.h>
+#include "host_test.h"
+#include "lifeband_edge_ai.h"
+#include "reference_interpreter.h"
+
+static unsigned long virtual_us = 0;
+static unsigned long virtualMicros() { return virtual_us; }
+
+// Backend that always fails, as a missing TFLM op or bad model would
+class BrokenBackend : public InferenceBackend {
+private:
+  const ModelSpec& model_spec;
+
+public:
+  explicit BrokenBackend(const ModelSpec& spec) : model_spec(spec) {}
+  const ModelSpec& spec() const override { return model_spec; }
+  const char* name() const override { return "broken"; }
+  bool begin() override { return true; }
+  bool invoke(const float*, float*) override { return false; }
+};
+
+// Records the inputs it was given; takes 120 us of virtual time per call
+class RecordingBackend : public InferenceBackend {
+private:
+  const ModelSpec& model_spec;
+  bool standardized;
+  float mean[MODEL_MAX_INPUTS];
+  float scale[MODEL_MAX_INPUTS];
+
+public:
+  float last[MODEL_MAX_INPUTS];
+  uint32_t calls;
+  bool loads;
+
+  RecordingBackend(const ModelSpec& spec, bool standardize) :
+    model_spec(spec),
+    standardized(standardize),
+    calls(0),
+    loads(true) {
+    for (uint8_t i = 0; i < MODEL_MAX_INPUTS; i++) {
+      mean[i] = 10.0f * i;
+      scale[i] = 0.5f;
+      last[i] = 0;
+    }
+  }
+  const ModelSpec& spec() const override { return model_spec; }
+  const char* name() const override { return "recording"; }
+  bool begin() override { return loads; }
+  bool invoke(const float* input, float* output) override {
+    memcpy(last, input, sizeof(float) * model_spec.inputs);
+    for (uint8_t k = 0; k < model_spec.outputs; k++) {
+      output[k] = k == 1 ? 0.7f : 0.3f / (model_spec.outputs - 1);
+    }
+    calls++;
+    virtual_us += 120;
+    return true;
+  }
+  bool standardization(const float*& m, const float*& s) const override {
+    m = mean;
+    s = scale;
+    return standardized;
+  }
+};
+
+static void fillWindows(AiFeatures* w) {
+  const float shortw[AI_FEATURE_COUNT] = {72, 74, 45, 900, 92, 600, 97, 118, 76};
+  for (uint8_t i = 0; i < AI_FEATURE_COUNT; i++) {
+    w[FEATURE_WINDOW_SHORT].v[i] = shortw[i];
+    w[FEATURE_WINDOW_LONG].v[i] = shortw[i] + 1000;   // tells the windows apart
+  }
+}
+
+int main() {
+  TEST_CASE("binding");
+  {
+    ReferenceInterpreter a(MODEL_REGISTRY[MODEL_ARRHYTHMIA]);
+    ReferenceInterpreter dup(MODEL_REGISTRY[MODEL_ARRHYTHMIA]);
+    LifeBandAI ai(virtualMicros);
+    CHECK(ai.bind(&a));
+    CHECK(!ai.bind(&dup));                  // one backend per model
+    CHECK(!ai.bind(nullptr));
+    ai.initialize();
+    CHECK(ai.isModelLoaded(MODEL_ARRHYTHMIA));
+    CHECK(!ai.isModelLoaded(MODEL_ANEMIA));
+
+    ModelRegistry registry(virtualMicros);
+    registry.bind(&a);
+    CHECK(strcmp(registry.backendName(MODEL_ARRHYTHMIA), "reference") == 0);
+    CHECK(strcmp(registry.backendName(MODEL_ANEMIA), "none") == 0);
+    CHECK(MODEL_REGISTRY[MODEL_ARRHYTHMIA].data == nullptr);   // flatbuffers only with TFLM
+  }
+
+  TEST_CASE("periods, skips and rule fallback");
+  {
+    ReferenceInterpreter a(MODEL_REGISTRY[MODEL_ARRHYTHMIA]);
+    ReferenceInterpreter b(MODEL_REGISTRY[MODEL_ANEMIA]);
+    BrokenBackend c(MODEL_REGISTRY[MODEL_PREECLAMPSIA]);
+    LifeBandAI ai(virtualMicros);
+    CHECK(ai.bind(&a) && ai.bind(&b) && ai.bind(&c));
+    ai.initialize();
+    CHECK(a.hiddenUnits() > 0 && ai.isModelLoaded(MODEL_ANEMIA));
+
+    AiFeatures windows[FEATURE_WINDOW_COUNT];
+    fillWindows(windows);
+    uint32_t counts[MODEL_COUNT] = {0};
+    bool classes_ok = true;
+    for (uint32_t t = 0; t < 60000; t += 800) {
+      uint8_t wanted = (t / 800) % 10 == 3 ? 0 : 0x07;   // every 10th tick has poor beats
+      AiEvaluation e = ai.evaluate(windows, wanted, t);
+      for (uint8_t m = 0; m < MODEL_COUNT; m++) {
+        if (e.ran & MODEL_BIT(m)) counts[m]++;
+      }
+      if ((e.ran & MODEL_BIT(MODEL_ARRHYTHMIA)) && e.arrhythmia.rhythm_type > RHYTHM_TACHYCARDIA) {
+        classes_ok = false;
+      }
+      if ((e.ran & MODEL_BIT(MODEL_PREECLAMPSIA)) && e.preeclampsia.risk_level == RISK_UNKNOWN) {
+        classes_ok = false;                 // rules still give a result
+      }
+    }
+    for (uint8_t m = 0; m < MODEL_COUNT; m++) {
+      ModelStats s = ai.getStats((ModelType)m);
+      METRIC("%-12s ran %2u: runs %2u, fallbacks %2u, skipped %u", MODEL_REGISTRY[m].name,
+             counts[m], s.runs, s.fallbacks, s.skipped);
+    }
+    CHECK(counts[MODEL_ARRHYTHMIA] == 67);  // 75 ticks, 8 with poor beats
+    CHECK(counts[MODEL_ANEMIA] == 11);      // every 5 s, one slot skipped
+    CHECK(counts[MODEL_PREECLAMPSIA] == 11);
+    CHECK(ai.getStats(MODEL_ARRHYTHMIA).runs == 67 && ai.getStats(MODEL_ARRHYTHMIA).skipped == 8);
+    CHECK(ai.getStats(MODEL_PREECLAMPSIA).fallbacks == 11 && ai.getStats(MODEL_PREECLAMPSIA).runs == 0);
+    CHECK(classes_ok);
+
+    AiFeatures none[FEATURE_WINDOW_COUNT];
+    memset(none, 0, sizeof(none));
+    AiEvaluation e = ai.evaluate(none, 0x07, 100000);
+    CHECK(e.ran == 0x07);
+    CHECK(e.arrhythmia.rhythm_type == RHYTHM_NO_SIGNAL);
+    CHECK(e.anemia.risk_level == RISK_UNKNOWN);
+  }
+
+  TEST_CASE("LF/HF in the preeclampsia rule fallback");
+  {
+    BrokenBackend c(MODEL_REGISTRY[MODEL_PREECLAMPSIA]);
+    LifeBandAI ai(virtualMicros);
+    ai.bind(&c);
+    ai.initialize();
+    AiFeatures windows[FEATURE_WINDOW_COUNT];
+    memset(windows, 0, sizeof(windows));
+    for (uint8_t w = 0; w < FEATURE_WINDOW_COUNT; w++) {
+      windows[w].v[AI_FEAT_HR] = 92;
+      windows[w].v[AI_FEAT_SDNN] = 45;
+      windows[w].v[AI_FEAT_SPO2] = 97;
+      windows[w].v[AI_FEAT_BP_SYS] = 142;
+      windows[w].v[AI_FEAT_BP_DIA] = 85;
+    }
+    const uint8_t pe = MODEL_BIT(MODEL_PREECLAMPSIA);
+    AiEvaluation e = ai.evaluate(windows, pe, 0);
+    CHECK(e.preeclampsia.risk_level == RISK_MODERATE);
+    ai.setHrvBalance(1.4f);                 // balanced: no change
+    e = ai.evaluate(windows, pe, 5000);
+    CHECK(e.preeclampsia.risk_level == RISK_MODERATE);
+    ai.setHrvBalance(3.1f);                 // sympathetic dominance
+    e = ai.evaluate(windows, pe, 10000);
+    CHECK(e.preeclampsia.risk_level == RISK_HIGH && e.preeclampsia.alert);
+    ai.setHrvBalance(0.0f);                 // spectrum cleared
+    e = ai.evaluate(windows, pe, 15000);
+    CHECK(e.preeclampsia.risk_level == RISK_MODERATE);
+  }
+
+  TEST_CASE("reference output is a distribution");
+  {
+    ReferenceInterpreter a(MODEL_REGISTRY[MODEL_ARRHYTHMIA]);
+    CHECK(a.begin());
+    float in[5] = {72, 45, 900, 92, 600}, out[MODEL_MAX_OUTPUTS];
+    CHECK(a.invoke(in, out));
+    float sum = 0;
+    for (uint8_t k = 0; k < MODEL_REGISTRY[MODEL_ARRHYTHMIA].outputs; k++) {
+      CHECK(out[k] >= 0.0f && out[k] <= 1.0f);
+      sum += out[k];
+    }
+    CHECK(fabsf(sum - 1.0f) < 1e-5f);
+  }
+
+  TEST_CASE("window routing, standardization, latency");
+  {
+    RecordingBackend rhythm(MODEL_REGISTRY[MODEL_ARRHYTHMIA], false);
+    RecordingBackend anemia(MODEL_REGISTRY[MODEL_ANEMIA], true);
+    RecordingBackend pe(MODEL_REGISTRY[MODEL_PREECLAMPSIA], false);
+    LifeBandAI ai(virtualMicros);
+    ai.bind(&rhythm);
+    ai.bind(&anemia);
+    ai.bind(&pe);
+    ai.initialize();
+    AiFeatures windows[FEATURE_WINDOW_COUNT];
+    fillWindows(windows);
+    AiEvaluation e = ai.evaluate(windows, 0x07, 0);
+    CHECK(e.ran == 0x07);
+    const ModelSpec& rs = MODEL_REGISTRY[MODEL_ARRHYTHMIA];
+    const ModelSpec& as = MODEL_REGISTRY[MODEL_ANEMIA];
+    const ModelSpec& ps = MODEL_REGISTRY[MODEL_PREECLAMPSIA];
+    bool routed = true;
+    for (uint8_t i = 0; i < rs.inputs; i++) {
+      if (rhythm.last[i] != windows[rs.window].v[rs.features[i]]) routed = false;
+    }
+    for (uint8_t i = 0; i < ps.inputs; i++) {
+      if (pe.last[i] != windows[ps.window].v[ps.features[i]]) routed = false;
+    }
+    for (uint8_t i = 0; i < as.inputs; i++) {
+      float want = (windows[as.window].v[as.features[i]] - 10.0f * i) * 0.5f;
+      if (fabsf(anemia.last[i] - want) > 1e-3f) routed = false;
+    }
+    CHECK(routed);
+    CHECK(rs.window == FEATURE_WINDOW_SHORT && as.window == FEATURE_WINDOW_LONG);
+    CHECK(e.arrhythmia.rhythm_type == (RhythmType)1);
+    CHECK(fabsf(e.arrhythmia.confidence - 70.0f) < 1e-3f);
+    ModelStats s = ai.getStats(MODEL_ARRHYTHMIA);
+    CHECK(s.last_us == 120 && s.max_us == 120 && s.mean_us == 120);
+
+    // A model that stops loading falls back to rules until it loads again
+    anemia.loads = false;
+    CHECK(!ai.reloadModel(MODEL_ANEMIA));
+    CHECK(!ai.isModelLoaded(MODEL_ANEMIA));
+    e = ai.evaluate(windows, 0x07, 5000);
+    CHECK((e.ran & MODEL_BIT(MODEL_ANEMIA)) && anemia.calls == 1);
+    CHECK(ai.getStats(MODEL_ANEMIA).fallbacks == 1);
+    anemia.loads = true;
+    CHECK(ai.reloadModel(MODEL_ANEMIA));
+    e = ai.evaluate(windows, 0x07, 10000);
+    CHECK(anemia.calls == 2);
+  }
+
+  return testResult("test_model_registry");
+}
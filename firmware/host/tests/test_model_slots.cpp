@@ -0,0 +1,342 @@
+/*
+ * ModelSlots on the file-backed flash: CONFIG frame decoding and status
+ * encoding, uploads with their checks, the slot erase split into one
+ * sector per serviceErase(), A/B selection, trial rollback at mount,
+ * power cuts during an upload, and activation cost
+ */
+
+#include <vector>
+#include <stdio.h>
+#include "host_test.h"
+#include "model_slots.h"
+#include "dense_inference.h"
+#include "file_block_device.h"
+
+#define IMAGE_PATH "build/test_model_slots.img"
+#define CUT_PATH "build/test_model_slots_cut.img"
+#define SECTORS 16
+
+static unsigned long virtualMicros() { return (unsigned long)(testNowNs() / 1000); }
+
+static uint32_t align16(uint32_t n) {
+  return (n + 15) & ~15u;
+}
+
+static void append(std::vector<uint8_t>& out, const void* data, size_t len) {
+  const uint8_t* p = (const uint8_t*)data;
+  out.insert(out.end(), p, p + len);
+}
+
+/**
+ * A model image of a built-in network, laid out as convert_dense_models.py
+ * --image writes it
+ */
+static std::vector<uint8_t> buildImage(ModelType type, const DenseNetwork& net, uint32_t version) {
+  uint32_t base = align16(MODEL_IMAGE_HEADER + MODEL_IMAGE_LAYER * net.layers);
+  std::vector<uint8_t> image(base, 0);
+  for (uint8_t k = 0; k < net.layers; k++) {
+    const DenseLayer& l = net.layer[k];
+    uint8_t* e = &image[MODEL_IMAGE_HEADER + k * MODEL_IMAGE_LAYER];
+    vitalsPut16(e, l.inputs);
+    vitalsPut16(e + 2, l.outputs);
+    e[4] = l.activation;
+    vitalsPut32(e + 8, (uint32_t)image.size());
+    append(image, l.w_f32, (size_t)l.rows * l.stride_f32 * sizeof(float));
+    append(image, l.w_i8, (size_t)l.rows * l.stride_i8);
+    append(image, l.scale_i8, l.rows * sizeof(float));
+    append(image, l.bias, l.rows * sizeof(float));
+    image.resize(align16((uint32_t)image.size()), 0);
+  }
+  uint32_t norm = 0;
+  if (net.input_mean) {
+    norm = (uint32_t)image.size();
+    append(image, net.input_mean, net.inputs * sizeof(float));
+    append(image, net.input_scale, net.inputs * sizeof(float));
+  }
+  uint8_t* h = &image[0];
+  vitalsPut32(h, MODEL_IMAGE_MAGIC);
+  h[4] = MODEL_IMAGE_FORMAT;
+  h[5] = type;
+  h[6] = net.layers;
+  vitalsPut16(h + 8, net.inputs);
+  vitalsPut16(h + 10, net.outputs);
+  vitalsPut32(h + 12, version);
+  vitalsPut32(h + 16, (uint32_t)image.size());
+  vitalsPut32(h + 20, ModelSlots::crc32(h + MODEL_IMAGE_HEADER, image.size() - MODEL_IMAGE_HEADER));
+  vitalsPut32(h + 24, norm);
+  vitalsPut32(h + 28, ModelSlots::crc32(h, 28));
+  return image;
+}
+
+static void applyBegin(ModelSlots& s, uint8_t model, const std::vector<uint8_t>& image, uint32_t crc, uint8_t id) {
+  uint8_t b[11] = {MODEL_XFER_BEGIN, model};
+  vitalsPut32(b + 2, (uint32_t)image.size());
+  vitalsPut32(b + 6, crc);
+  b[10] = id;
+  ModelXferMsg msg;
+  CHECK(decodeModelTransfer(b, sizeof(b), msg));
+  s.apply(msg);
+}
+
+/**
+ * BEGIN, slot erase, DATA in MODEL_XFER_CHUNK frames (optionally with one
+ * byte flipped in transit), END
+ * @return true if the image was committed
+ */
+static bool upload(ModelSlots& s, uint8_t model, const std::vector<uint8_t>& image, int corrupt_at = -1) {
+  applyBegin(s, model, image, ModelSlots::crc32(image.data(), image.size()), 1);
+  while (s.needsErase() && s.serviceErase()) {
+  }
+  for (size_t offset = 0; offset < image.size(); offset += MODEL_XFER_CHUNK) {
+    uint8_t b[5 + MODEL_XFER_CHUNK];
+    size_t n = image.size() - offset < MODEL_XFER_CHUNK ? image.size() - offset : MODEL_XFER_CHUNK;
+    b[0] = MODEL_XFER_DATA;
+    vitalsPut32(b + 1, (uint32_t)offset);
+    memcpy(b + 5, image.data() + offset, n);
+    if (corrupt_at >= (int)offset && corrupt_at < (int)(offset + n)) {
+      b[5 + corrupt_at - offset] ^= 0x10;
+    }
+    ModelXferMsg msg;
+    CHECK(decodeModelTransfer(b, 5 + n, msg));
+    s.apply(msg);
+  }
+  uint8_t end = MODEL_XFER_END;
+  ModelXferMsg msg;
+  CHECK(decodeModelTransfer(&end, 1, msg));
+  return s.apply(msg);
+}
+
+static std::vector<uint8_t> withVersion(std::vector<uint8_t> image, uint32_t version) {
+  vitalsPut32(&image[12], version);
+  vitalsPut32(&image[28], ModelSlots::crc32(image.data(), 28));
+  return image;
+}
+
+static void copyFile(const char* from, const char* to) {
+  FILE* in = fopen(from, "rb");
+  FILE* out = fopen(to, "wb");
+  uint8_t buf[4096];
+  size_t n;
+  while (in && out && (n = fread(buf, 1, sizeof(buf), in)) > 0) {
+    fwrite(buf, 1, n, out);
+  }
+  if (in) fclose(in);
+  if (out) fclose(out);
+}
+
+int main() {
+  const std::vector<uint8_t> rhythm = buildImage(MODEL_ARRHYTHMIA, arrhythmia_risk_model_dense, 7);
+  const std::vector<uint8_t> anemia = buildImage(MODEL_ANEMIA, anemia_risk_model_dense, 7);
+
+  TEST_CASE("frames and status");
+  {
+    uint8_t b[5 + MODEL_XFER_CHUNK + 1] = {MODEL_XFER_BEGIN, MODEL_ANEMIA};
+    vitalsPut32(b + 2, 1000);
+    vitalsPut32(b + 6, 0x12345678);
+    ModelXferMsg msg;
+    CHECK(decodeModelTransfer(b, 10, msg) && msg.id == 0);     // BEGIN without a transfer id
+    b[10] = 42;
+    CHECK(decodeModelTransfer(b, 11, msg));
+    CHECK(msg.model == MODEL_ANEMIA && msg.value == 1000 && msg.crc == 0x12345678 && msg.id == 42);
+    CHECK(!decodeModelTransfer(b, 9, msg));
+    b[0] = MODEL_XFER_DATA;
+    CHECK(decodeModelTransfer(b, 5 + MODEL_XFER_CHUNK, msg) && msg.length == MODEL_XFER_CHUNK);
+    CHECK(!decodeModelTransfer(b, 5 + MODEL_XFER_CHUNK + 1, msg));
+    CHECK(5 + MODEL_XFER_CHUNK + 3 <= 185);                    // one frame per ATT write at a 185-byte MTU
+
+    ModelXferStatus s;
+    memset(&s, 0, sizeof(s));
+    s.state = MODEL_XFER_ERASING;
+    s.model = MODEL_ANEMIA;
+    s.slot = 1;
+    s.id = 42;
+    s.next_offset = 354;
+    s.bytes = 1000;
+    uint8_t out[MODEL_XFER_STATUS_SIZE];
+    CHECK(encodeModelTransferStatus(s, out) == 20);
+    CHECK(out[0] == MODEL_XFER_STATUS && out[1] == MODEL_XFER_ERASING && out[2] == MODEL_ANEMIA);
+    CHECK(out[4] == 1 && out[5] == 42 && vitalsGet32(out + 8) == 354 && vitalsGet32(out + 16) == 1000);
+  }
+
+  remove(IMAGE_PATH);
+  FileBlockDevice dev;
+  CHECK(dev.open(IMAGE_PATH, SECTORS));
+  ModelSlots slots(virtualMicros);
+  CHECK(slots.mount(&dev));
+  CHECK(!slots.select(MODEL_ARRHYTHMIA));
+  METRIC("arrhythmia image %zu B, anemia image %zu B", rhythm.size(), anemia.size());
+
+  TEST_CASE("slot erase, one sector per serviceErase()");
+  {
+    uint32_t erases = dev.eraseCount();
+    applyBegin(slots, MODEL_ARRHYTHMIA, rhythm, ModelSlots::crc32(rhythm.data(), rhythm.size()), 5);
+    const ModelXferStatus& x = slots.transferStatus();
+    CHECK(x.state == MODEL_XFER_ERASING && x.id == 5 && x.bytes == rhythm.size());
+    CHECK(dev.eraseCount() == erases);                          // BEGIN itself does not touch the flash
+    CHECK(slots.needsErase());
+    CHECK(!slots.writeUpload(0, rhythm.data(), MODEL_XFER_CHUNK));
+    CHECK(x.state == MODEL_XFER_ERASING && x.error == MODEL_XFER_ERR_OFFSET);
+    for (uint8_t i = 0; i < MODEL_SLOT_SECTORS; i++) {
+      CHECK(slots.serviceErase());
+      CHECK(dev.eraseCount() == erases + i + 1);
+    }
+    CHECK(x.state == MODEL_XFER_RECEIVING && x.error == MODEL_XFER_OK && !slots.needsErase());
+    CHECK(!slots.serviceErase());
+
+    applyBegin(slots, MODEL_ARRHYTHMIA, rhythm, 0, 6);          // a retry starts over
+    CHECK(x.state == MODEL_XFER_ERASING && x.id == 6);
+    slots.abortUpload();
+    CHECK(x.state == MODEL_XFER_FAILED && !slots.needsErase());
+  }
+
+  TEST_CASE("upload checks");
+  {
+    CHECK(!upload(slots, MODEL_ARRHYTHMIA, anemia));            // image of another model
+    CHECK(slots.transferStatus().error == MODEL_XFER_ERR_INVALID);
+    CHECK(!upload(slots, MODEL_ARRHYTHMIA, rhythm, 300));       // corrupted in transit
+    CHECK(slots.transferStatus().error == MODEL_XFER_ERR_CRC);
+    std::vector<uint8_t> shape = rhythm;
+    vitalsPut16(&shape[8], 6);
+    vitalsPut32(&shape[28], ModelSlots::crc32(shape.data(), 28));
+    CHECK(!upload(slots, MODEL_ARRHYTHMIA, shape));
+    CHECK(slots.transferStatus().error == MODEL_XFER_ERR_INVALID);
+    std::vector<uint8_t> huge(2 * SECTORS * 4096, 0);
+    applyBegin(slots, MODEL_ARRHYTHMIA, huge, 0, 1);
+    CHECK(slots.transferStatus().error == MODEL_XFER_ERR_SIZE);
+    applyBegin(slots, MODEL_COUNT, rhythm, 0, 1);
+    CHECK(slots.transferStatus().error == MODEL_XFER_ERR_REQUEST);
+
+    // A dropped frame: the next one is refused and the phone resumes
+    applyBegin(slots, MODEL_ARRHYTHMIA, rhythm, ModelSlots::crc32(rhythm.data(), rhythm.size()), 2);
+    while (slots.needsErase() && slots.serviceErase()) {
+    }
+    CHECK(slots.writeUpload(0, rhythm.data(), MODEL_XFER_CHUNK));
+    CHECK(!slots.writeUpload(2 * MODEL_XFER_CHUNK, rhythm.data() + 2 * MODEL_XFER_CHUNK, MODEL_XFER_CHUNK));
+    CHECK(slots.transferStatus().state == MODEL_XFER_RECEIVING);
+    CHECK(slots.transferStatus().error == MODEL_XFER_ERR_OFFSET);
+    CHECK(slots.transferStatus().next_offset == MODEL_XFER_CHUNK);
+    slots.abortUpload();
+  }
+
+  int8_t first = -1;
+  TEST_CASE("upload runs like the built-in weights, mapped in place");
+  {
+    CHECK(upload(slots, MODEL_ARRHYTHMIA, rhythm));
+    CHECK(slots.transferStatus().state == MODEL_XFER_DONE && slots.transferStatus().version == 7);
+    CHECK(slots.select(MODEL_ARRHYTHMIA) && slots.activeVersion(MODEL_ARRHYTHMIA) == 7);
+    first = slots.activeSlot(MODEL_ARRHYTHMIA);
+    const DenseNetwork* net = slots.network(MODEL_ARRHYTHMIA);
+    const uint8_t* map = dev.mapReadOnly();
+    CHECK((const uint8_t*)net->layer[0].w_f32 >= map && (const uint8_t*)net->layer[0].w_f32 < map + SECTORS * 4096);
+    DenseEngine shared;
+    for (uint8_t mode = DENSE_FLOAT; mode <= DENSE_INT8; mode++) {
+      DenseInferenceEngine engine(MODEL_REGISTRY[MODEL_ARRHYTHMIA], arrhythmia_risk_model_dense, shared, (DenseMode)mode);
+      float x[MODEL_MAX_INPUTS] = {0.3f, -1.2f, 0.8f, 0.1f, 2.0f}, a[MODEL_MAX_OUTPUTS], b[MODEL_MAX_OUTPUTS];
+      CHECK(engine.begin() && engine.invoke(x, a));
+      engine.useNetwork(net);
+      CHECK(engine.begin() && !engine.usesBuiltin() && engine.invoke(x, b));
+      CHECK(memcmp(a, b, sizeof(float) * MODEL_REGISTRY[MODEL_ARRHYTHMIA].outputs) == 0);
+    }
+  }
+
+  TEST_CASE("unconfirmed trial rolled back at mount");
+  {
+    slots.startTrial(MODEL_ARRHYTHMIA, 0, 0);
+    ModelSlots again(virtualMicros);
+    CHECK(again.mount(&dev));
+    CHECK(again.getStats().rollbacks == 1);
+    CHECK(!again.select(MODEL_ARRHYTHMIA));
+  }
+
+  TEST_CASE("A/B: newest wins, rollback to the confirmed one");
+  {
+    ModelSlots s(virtualMicros);
+    CHECK(s.mount(&dev));
+    CHECK(upload(s, MODEL_ARRHYTHMIA, rhythm) && s.select(MODEL_ARRHYTHMIA));
+    int8_t second = s.activeSlot(MODEL_ARRHYTHMIA);
+    CHECK(second == first);                                     // the rejected slot is reused
+    s.startTrial(MODEL_ARRHYTHMIA, 0, 0);
+    bool kept = true;
+    for (uint32_t r = 1; r <= MODEL_SLOT_CONFIRM_RUNS; r++) {
+      kept = kept && s.checkTrial(MODEL_ARRHYTHMIA, r, 0);
+    }
+    CHECK(kept);
+    CHECK(upload(s, MODEL_ARRHYTHMIA, withVersion(rhythm, 8)));
+    CHECK(s.transferStatus().slot != second % MODEL_SLOTS_PER_MODEL);
+    CHECK(s.select(MODEL_ARRHYTHMIA) && s.activeVersion(MODEL_ARRHYTHMIA) == 8);
+    s.startTrial(MODEL_ARRHYTHMIA, 100, 0);
+    CHECK(!s.checkTrial(MODEL_ARRHYTHMIA, 101, 1));             // a fallback during the trial
+    s.reject(MODEL_ARRHYTHMIA);
+    CHECK(s.select(MODEL_ARRHYTHMIA));
+    CHECK(s.activeSlot(MODEL_ARRHYTHMIA) == second && s.activeVersion(MODEL_ARRHYTHMIA) == 7);
+    ModelSlots again(virtualMicros);
+    CHECK(again.mount(&dev) && again.select(MODEL_ARRHYTHMIA));
+    CHECK(again.activeSlot(MODEL_ARRHYTHMIA) == second);
+  }
+
+  TEST_CASE("power cut anywhere in an upload");
+  {
+    dev.close();
+    FileBlockDevice probe;
+    copyFile(IMAGE_PATH, CUT_PATH);
+    probe.open(CUT_PATH, SECTORS);
+    ModelSlots p(virtualMicros);
+    p.mount(&probe);
+    uint32_t ops = probe.eraseCount() + probe.programCount();
+    CHECK(upload(p, MODEL_ARRHYTHMIA, withVersion(rhythm, 9)));
+    ops = probe.eraseCount() + probe.programCount() - ops;
+    probe.close();
+
+    uint32_t old_kept = 0, new_kept = 0, garbage = 0;
+    for (uint32_t cut = 0; cut <= ops; cut++) {
+      for (uint32_t seed = 1; seed <= 4; seed++) {
+        copyFile(IMAGE_PATH, CUT_PATH);
+        FileBlockDevice d;
+        d.open(CUT_PATH, SECTORS);
+        ModelSlots s(virtualMicros);
+        s.mount(&d);
+        s.select(MODEL_ARRHYTHMIA);
+        d.cutPowerAfter(cut, seed);
+        upload(s, MODEL_ARRHYTHMIA, withVersion(rhythm, 9));
+        d.close();
+        FileBlockDevice rebooted;
+        rebooted.open(CUT_PATH, SECTORS);
+        ModelSlots r(virtualMicros);
+        CHECK(r.mount(&rebooted) && r.select(MODEL_ARRHYTHMIA));
+        uint32_t v = r.activeVersion(MODEL_ARRHYTHMIA);
+        if (v == 7) {
+          old_kept++;
+        } else if (v == 9) {
+          new_kept++;
+        } else {
+          garbage++;
+        }
+      }
+    }
+    METRIC("%u operations per upload: %u cuts kept v7, %u got v9, %u neither", ops, old_kept, new_kept, garbage);
+    CHECK(garbage == 0);
+    CHECK(old_kept > 0 && new_kept > 0);
+  }
+
+  TEST_CASE("activation cost");
+  {
+    FileBlockDevice d;
+    d.open(IMAGE_PATH, SECTORS);
+    ModelSlots s(virtualMicros);
+    s.mount(&d);
+    const int reps = 10000;
+    uint64_t t0 = testNowNs();
+    for (int i = 0; i < reps; i++) {
+      s.select(MODEL_ARRHYTHMIA);
+    }
+    double ns = (double)(testNowNs() - t0) / reps;
+    CHECK(s.activeVersion(MODEL_ARRHYTHMIA) == 7);
+    METRIC("select() %.2f us (validate + layer table), %u B of RAM per active model, sizeof(ModelSlots) %zu",
+           ns / 1000, s.getStats().swap_ram, sizeof(ModelSlots));
+    d.close();
+  }
+
+  remove(IMAGE_PATH);
+  remove(CUT_PATH);
+  return testResult("test_model_slots");
+}
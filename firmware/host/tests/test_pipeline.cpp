@@ -0,0 +1,148 @@
+/*
+ * Pipeline stages and queues on host/freertos_pthread.h: nominal load,
+ * overload (drops are counted, producers never block) and the loop()
+ * fallback. Timings depend on the host scheduler and are only reported.
+ */
+
+#include <vector>
+#include <algorithm>
+#include <atomic>
+#include "host_test.h"
+#include "pipeline.h"
+
+static PipelineStage dsp, inference, transport;
+static PipelineQueue<DspEvent, PIPELINE_EVENT_QUEUE> events;
+static PipelineQueue<VitalsFrame, PIPELINE_VITALS_QUEUE> vitals;
+static PipelineQueue<WavePacketMsg, PIPELINE_WAVE_QUEUE> waves;
+
+static int burst = 1;               // events per 4 ms DSP step
+static uint32_t infer_us = 500;     // inference work per event
+static std::atomic<uint32_t> attempted(0), inferred(0), sent_frames(0), sent_waves(0);
+static std::vector<uint32_t> end_to_end;
+
+static void spin(uint32_t us) {
+  uint32_t t = micros();
+  while (micros() - t < us) {
+  }
+}
+
+static void dspStep(void*) {
+  static uint32_t n = 0;
+  n++;
+  for (int b = 0; b < burst; b++) {
+    DspEvent e;
+    memset(&e, 0, sizeof(e));
+    e.kind = DSP_ECG_BEAT;
+    e.time_ms = micros();             // carries the push time for the e2e figure
+    attempted++;
+    events.push(e);
+  }
+  if (n % 16 == 0) {
+    WavePacketMsg m;
+    m.len = 200;
+    waves.push(m);
+  }
+  spin(200);
+}
+
+static void inferenceStep(void*) {
+  DspEvent e;
+  while (events.pop(e)) {
+    spin(infer_us);
+    inferred++;
+    VitalsFrame f;
+    memset(&f, 0, sizeof(f));
+    f.timestamp_ms = e.time_ms;
+    vitals.push(f);
+  }
+}
+
+static void transportStep(void*) {
+  WavePacketMsg m;
+  while (waves.pop(m)) {
+    spin(300);
+    sent_waves++;
+  }
+  VitalsFrame f;
+  while (vitals.pop(f)) {
+    spin(100);
+    end_to_end.push_back(micros() - f.timestamp_ms);
+    sent_frames++;
+  }
+}
+
+static void runPipeline(int events_per_step, uint32_t work_us, uint32_t ms) {
+  burst = events_per_step;
+  infer_us = work_us;
+  attempted = inferred = sent_frames = sent_waves = 0;
+  end_to_end.clear();
+  events.clear();
+  vitals.clear();
+  waves.clear();
+  events.setConsumer(&inference);
+  vitals.setConsumer(&transport);
+  waves.setConsumer(&transport);
+  transport.start("transport", transportStep, nullptr, PIPELINE_TRANSPORT_IDLE_MS, PIPELINE_TRANSPORT_CORE, PIPELINE_TRANSPORT_PRIORITY, PIPELINE_TRANSPORT_STACK);
+  inference.start("inference", inferenceStep, nullptr, PIPELINE_INFER_IDLE_MS, PIPELINE_INFER_CORE, PIPELINE_INFER_PRIORITY, PIPELINE_INFER_STACK);
+  dsp.start("dsp", dspStep, nullptr, PIPELINE_DSP_IDLE_MS, PIPELINE_DSP_CORE, PIPELINE_DSP_PRIORITY, PIPELINE_DSP_STACK);
+  vTaskDelay(pdMS_TO_TICKS(ms));
+  dsp.stop();
+  vTaskDelay(pdMS_TO_TICKS(300));     // let the backlog drain
+  inference.stop();
+  vTaskDelay(pdMS_TO_TICKS(100));
+  transport.stop();
+}
+
+int main() {
+  TEST_CASE("nominal: one event per 4 ms step, 0.5 ms of inference each");
+  {
+    runPipeline(1, 500, 2000);
+    QueueStats q = events.getStats();
+    StageStats d = dsp.getStats();
+    std::sort(end_to_end.begin(), end_to_end.end());
+    uint32_t p99 = end_to_end.empty() ? 0 : end_to_end[end_to_end.size() * 99 / 100];
+    METRIC("events %u pushed, %u dropped, high water %u, dsp step mean %u us, dsp->transport p99 %u us",
+           q.pushed, q.dropped, q.high_water, d.mean_run_us, p99);
+    CHECK(q.pushed + q.dropped == attempted.load());
+    CHECK(q.pushed > 300);
+    CHECK(q.dropped == 0);
+    CHECK(inferred.load() == q.pushed);
+    CHECK(sent_frames.load() + vitals.getStats().dropped == q.pushed);
+    CHECK(sent_waves.load() == waves.getStats().pushed);
+  }
+
+  TEST_CASE("overload: four events per step, 3 ms of inference each");
+  {
+    QueueStats before = events.getStats();
+    runPipeline(4, 3000, 2000);
+    QueueStats q = events.getStats();
+    StageStats d = dsp.getStats();
+    uint32_t pushed = q.pushed - before.pushed, dropped = q.dropped - before.dropped;
+    METRIC("events %u pushed, %u dropped, high water %u, dsp step mean %u us max %u us",
+           pushed, dropped, q.high_water, d.mean_run_us, d.max_run_us);
+    CHECK(pushed + dropped == attempted.load());
+    CHECK(dropped > 0);                        // counted, not blocked on
+    CHECK(q.high_water == PIPELINE_EVENT_QUEUE);
+    CHECK(inferred.load() == pushed);
+    CHECK(d.mean_run_us < 1000);               // the producer step stays short
+  }
+
+  TEST_CASE("runOnce() drives a stage without a task");
+  {
+    PipelineStage stage;
+    PipelineQueue<DspEvent, 4> q;
+    q.setConsumer(&stage);
+    DspEvent e;
+    memset(&e, 0, sizeof(e));
+    int pushed = 0;
+    for (int i = 0; i < 6; i++) pushed += q.push(e);
+    CHECK(pushed == 4);
+    CHECK(q.getStats().dropped == 2);
+    CHECK(!stage.isRunning());
+    CHECK(stage.stackHeadroom() == 0);
+    stage.runOnce();                           // no step bound: nothing happens
+    CHECK(stage.getStats().runs == 0);
+  }
+
+  return testResult("test_pipeline");
+}
@@ -0,0 +1,143 @@
+/*
+ * PpgBeatDetector on the simulated PPG: beat F1 against the generated
+ * systolic peaks (slow, fast, low perfusion, noise, motion bursts, 100 Hz),
+ * median-rate error, and per-sample cost
+ */
+
+#include "host_test.h"
+#include "ppg_beat_detector.h"
+#include "host/simulated_ppg_source.h"
+#include <math.h>
+#include <random>
+#include <vector>
+
+#define PEAK_PHASE 0.185      // systolic peak of SimulatedPpgSource's pulse
+#define TOLERANCE_S 0.15
+#define SETTLE_S 3.0
+
+struct Score {
+  int tp, fp, fn;
+  double f1() const { return 2.0 * tp / (2.0 * tp + fp + fn); }
+};
+
+static void match(const std::vector<double>& truth, const std::vector<double>& found, Score& s) {
+  std::vector<bool> used(found.size(), false);
+  for (double t : truth) {
+    if (t < SETTLE_S) continue;
+    int best = -1;
+    double best_d = TOLERANCE_S;
+    for (size_t i = 0; i < found.size(); i++) {
+      double d = fabs(found[i] - t);
+      if (!used[i] && d <= best_d) {
+        best_d = d;
+        best = (int)i;
+      }
+    }
+    if (best >= 0) {
+      used[best] = true;
+      s.tp++;
+    } else {
+      s.fn++;
+    }
+  }
+  for (size_t i = 0; i < found.size(); i++) {
+    if (!used[i] && found[i] >= SETTLE_S) s.fp++;
+  }
+}
+
+struct Case {
+  const char* name;
+  float hr, pi, jitter, wander, noise;
+  int rate;
+  double motion;         // motion bursts per second
+  double min_f1;
+};
+
+int main() {
+  const Case cases[] = {
+    {"clean 72 BPM", 72, 2, 0, 0, 0, 25, 0, 0.99},
+    {"jitter + wander", 72, 2, 0.08f, 0.01f, 20, 25, 0, 0.99},
+    {"brady 45 BPM", 45, 2, 0.05f, 0.01f, 20, 25, 0, 0.99},
+    {"tachy 170 BPM", 170, 2, 0.03f, 0.005f, 20, 25, 0, 0.99},
+    {"low PI 0.3%", 80, 0.3f, 0.05f, 0.003f, 30, 25, 0, 0.99},
+    {"noisy", 90, 1, 0.05f, 0.01f, 150, 25, 0, 0.98},
+    {"motion", 75, 2, 0.05f, 0.01f, 20, 25, 0.02, 0.95},
+    {"100 Hz", 80, 1.5f, 0.05f, 0.01f, 30, 100, 0, 0.99},
+  };
+
+  TEST_CASE("beat detection, 5 x 2 min per case");
+  for (const Case& c : cases) {
+    Score score = {0, 0, 0};
+    double rate_error = 0;
+    int rate_n = 0;
+    for (int seed = 1; seed <= 5; seed++) {
+      SimulatedPpgSource src(c.rate);
+      src.setHeartRate(c.hr);
+      src.setPerfusion(c.pi);
+      src.setJitter(c.jitter);
+      src.setWander(c.wander);
+      src.setNoise(c.noise);
+      src.setSeed(seed * 77);
+      std::mt19937 rng(seed);
+      std::uniform_real_distribution<double> U(0, 1);
+      PpgBeatDetector det;
+      det.configure(c.rate);
+      std::vector<double> truth, found;
+      double last_start = -1, motion_left = 0, motion_amp = 0;
+      for (int k = 0; k < c.rate * 120; k++) {
+        uint32_t red, ir;
+        src.next(red, ir);
+        double t = (double)k / c.rate;
+        if (src.beatStart() != last_start) {
+          last_start = src.beatStart();
+          truth.push_back(src.beatStart() + PEAK_PHASE * src.beatLength());
+        }
+        if (c.motion > 0) {
+          if (motion_left <= 0 && U(rng) < c.motion / c.rate * 2.5) {
+            motion_left = 0.3 + U(rng) * 1.2;
+            motion_amp = (U(rng) - 0.5) * 12000;
+          }
+          if (motion_left > 0) {
+            ir += (int32_t)(motion_amp * sin(2 * M_PI * 1.7 * t));
+            motion_left -= 1.0 / c.rate;
+          }
+        }
+        PpgBeat b;
+        if (det.process(-(int32_t)ir, b)) {
+          found.push_back(t - b.lag_ms / 1000.0);
+          if (det.rateBpm() > 0 && t > 10) {
+            rate_error += fabs(det.rateBpm() - c.hr);
+            rate_n++;
+          }
+        }
+      }
+      match(truth, found, score);
+    }
+    double mae = rate_n ? rate_error / rate_n : 1e9;
+    METRIC("%-16s F1 %.3f (tp %d, fp %d, fn %d), rate MAE %.1f BPM", c.name, score.f1(), score.tp, score.fp, score.fn, mae);
+    CHECK(score.f1() >= c.min_f1);
+    CHECK(mae < 3.0);
+  }
+
+  TEST_CASE("per-sample cost");
+  {
+    PpgBeatDetector det;
+    det.configure(25);
+    SimulatedPpgSource src(25);
+    std::vector<int32_t> v(1 << 20);
+    for (int32_t& x : v) {
+      uint32_t red, ir;
+      src.next(red, ir);
+      x = -(int32_t)ir;
+    }
+    PpgBeat b;
+    uint32_t beats = 0;
+    double t0 = testNowNs();
+    for (int32_t x : v) beats += det.process(x, b);
+    METRIC("%.1f ns/sample, %u beats, detector %u B", (testNowNs() - t0) / v.size(), beats,
+           (unsigned)sizeof(PpgBeatDetector));
+    CHECK(beats > 0);
+  }
+
+  return testResult("test_ppg_beat_detector");
+}
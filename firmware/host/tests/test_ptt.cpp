@@ -0,0 +1,165 @@
+/*
+ * StreamClock + PttEngine end to end: PPG samples generated on a drifting
+ * sensor clock and read in FIFO bursts, ECG R-peaks on the 4 ms sampler
+ * grid delivered late, against a known, slowly varying PTT
+ */
+
+#include "host_test.h"
+#include "stream_clock.h"
+#include "ptt_engine.h"
+#include "host/simulated_ppg_source.h"
+#include <math.h>
+#include <algorithm>
+#include <random>
+#include <vector>
+
+#define ECG_PERIOD_US 4000.0
+#define BEAT_DELIVERY_US 450000.0   // R-peak reaches the engine after the detector's delay
+#define BURST 8                     // PPG samples per FIFO read
+#define SETTLE_BEATS 30
+
+// Intersecting-tangent foot of the simulated pulse, in phase units
+static double footPhase() {
+  double best = 0, best_slope = 0;
+  for (double p = 0; p < 0.4; p += 1e-5) {
+    double s = (SimulatedPpgSource::volumeAt(p + 1e-5) - SimulatedPpgSource::volumeAt(p)) / 1e-5;
+    if (s > best_slope) {
+      best_slope = s;
+      best = p;
+    }
+  }
+  double floor = SimulatedPpgSource::volumeAt(0.999999);   // tail of the previous beat
+  return best - (SimulatedPpgSource::volumeAt(best) - floor) / best_slope;
+}
+
+struct Scenario {
+  double rate_error;   // sensor clock vs the MCU clock
+  double noise;
+  double hr;
+  double jitter;
+  int rate_hz;
+};
+
+struct Outcome {
+  int beats, evaluated, accepted;
+  double mean_us, sd_us, max_us;
+  int32_t clock_ppm;
+};
+
+static Outcome run(const Scenario& sc, unsigned seed) {
+  std::mt19937 rng(seed);
+  std::uniform_real_distribution<double> U(0, 1);
+  SimulatedPpgSource src(sc.rate_hz);
+  src.setHeartRate(sc.hr);
+  src.setJitter(sc.jitter);
+  src.setNoise(sc.noise);
+  src.setSeed(seed);
+  src.setWander(0.002f);
+  uint32_t nominal = 1000000 / sc.rate_hz;
+  StreamClock clock;
+  clock.configure(nominal, 0);
+  PttEngine engine;
+
+  const double origin = 123456.0;        // MCU time of PPG sample 0
+  auto mcuTime = [&](double sensor_s) { return origin + sensor_s * 1e6 * (1 + sc.rate_error); };
+
+  // Pulse feet in MCU time, as the source generates them
+  double foot = footPhase();
+  std::vector<double> feet;
+  std::vector<uint32_t> ir_values;
+  double last_start = -1;
+  int samples = sc.rate_hz * 300;
+  for (int k = 0; k < samples; k++) {
+    uint32_t red, ir;
+    src.next(red, ir);
+    ir_values.push_back(ir);
+    if (src.beatStart() != last_start) {
+      last_start = src.beatStart();
+      feet.push_back(mcuTime(src.beatStart() + foot * src.beatLength()));
+    }
+  }
+
+  // True PTT drifts 220-300 ms with a 5 ms respiratory ripple; R-peaks
+  // land on the ECG sampler's grid
+  struct Beat {
+    uint32_t r_us;
+    double ptt_us;
+  };
+  std::vector<Beat> beats;
+  double ecg_origin = origin - 3000;
+  for (double f : feet) {
+    double ptt = 260000 + 40000 * sin(f / 1e6 * 2 * M_PI / 90) + 5000 * sin(f / 1e6 * 2 * M_PI / 4);
+    double r = f - ptt;
+    if (r < ecg_origin + 8000) continue;
+    double tick = round((r - ecg_origin) / ECG_PERIOD_US);
+    uint32_t r_us = (uint32_t)(ecg_origin + tick * ECG_PERIOD_US);
+    beats.push_back({r_us, f - r_us});
+  }
+
+  Outcome out = {(int)beats.size(), 0, 0, 0, 0, 0, 0};
+  std::vector<double> errors;
+  size_t next_beat = 0;
+  for (int k = BURST - 1; k < samples; k += BURST) {
+    // Interrupt latency plus I2C transfer before the burst is timestamped
+    double read = mcuTime((double)k / sc.rate_hz) + U(rng) * nominal + 1500 + U(rng) * 2000;
+    while (next_beat < beats.size() && beats[next_beat].r_us + BEAT_DELIVERY_US < read) {
+      engine.addBeat(beats[next_beat++].r_us);
+    }
+    for (int i = k - BURST + 1; i <= k; i++) {
+      clock.observe(i, (uint32_t)(read - (k - i) * (double)nominal));
+      PttMeasurement m;
+      if (!engine.addPpg(clock.timeUs(i), -(int32_t)ir_values[i], m)) continue;
+      out.evaluated++;
+      if (!(m.flags & PTT_FLAG_ACCEPTED)) continue;
+      out.accepted++;
+      for (const Beat& b : beats) {
+        if (b.r_us == m.r_us) {
+          errors.push_back((double)m.ptt_us - b.ptt_us);
+          break;
+        }
+      }
+    }
+  }
+
+  double sum = 0, sum2 = 0;
+  size_t n = 0;
+  for (size_t i = std::min<size_t>(SETTLE_BEATS, errors.size()); i < errors.size(); i++) {
+    sum += errors[i];
+    sum2 += errors[i] * errors[i];
+    out.max_us = fmax(out.max_us, fabs(errors[i]));
+    n++;
+  }
+  out.mean_us = n ? sum / n : 0;
+  out.sd_us = n ? sqrt(sum2 / n - out.mean_us * out.mean_us) : 0;
+  out.clock_ppm = clock.getStats().rate_error_ppm;
+  return out;
+}
+
+int main() {
+  const Scenario scenarios[] = {
+    {0, 0, 72, 0, 25},
+    {0.008, 0, 72, 0.03, 25},
+    {-0.012, 30, 95, 0.05, 25},
+    {0.004, 60, 60, 0.08, 25},
+    {0.015, 30, 120, 0.03, 25},
+    {0.008, 30, 72, 0.03, 100},
+    {-0.02, 60, 140, 0.02, 50},
+  };
+
+  TEST_CASE("PTT error and clock-rate estimate, 5 min per run");
+  for (const Scenario& sc : scenarios) {
+    for (unsigned seed = 1; seed <= 2; seed++) {
+      Outcome o = run(sc, seed);
+      int32_t ppm_error = o.clock_ppm - (int32_t)lround(sc.rate_error * 1e6);
+      METRIC("%3d Hz, clock %+5.1f%%, noise %2.0f, HR %3.0f: %d/%d accepted | error %+5.2f ms, sd %4.2f ms, max %5.2f ms | rate %+d ppm off",
+             sc.rate_hz, sc.rate_error * 100, sc.noise, sc.hr, o.accepted, o.beats,
+             o.mean_us / 1000, o.sd_us / 1000, o.max_us / 1000, (int)ppm_error);
+      CHECK(o.evaluated >= o.beats - 2);
+      CHECK(o.accepted >= o.evaluated * 97 / 100);
+      CHECK(fabs(o.mean_us) < 10000 && o.sd_us < 10000 && o.max_us < 40000);
+      CHECK(abs(ppm_error) < 2500);
+    }
+  }
+
+  return testResult("test_ptt");
+}
@@ -0,0 +1,139 @@
+/*
+ * Spo2Estimator on the simulated PPG: SpO2 and rate error over a grid of
+ * saturation, rate, perfusion and noise, bias under baseline wander, and
+ * per-sample cost, next to the Maxim batch algorithm it replaced
+ */
+
+#include "host_test.h"
+#include "spo2_estimator.h"
+#include "host/simulated_ppg_source.h"
+#include "host/maxim_spo2_reference.h"
+#include <math.h>
+
+#define RATE 25
+#define SETTLE_S 10
+
+struct Errors {
+  int outputs, spo2_n, hr_n;
+  double spo2_abs, hr_abs;
+};
+
+int main() {
+  const float spo2s[] = {88, 92, 95, 98};
+  const float hrs[] = {50, 72, 100, 140};
+  const float pis[] = {0.5f, 1, 2, 5};
+  const float noises[] = {0, 60};
+
+  TEST_CASE("accuracy over the grid (0.5 s hop, 4 s window, 3% jitter, wander)");
+  {
+    Errors e = {0, 0, 0, 0, 0};
+    Errors m = {0, 0, 0, 0, 0};
+    double worst_bias = 0;
+    double ns = 0;
+    double maxim_ns = 0;
+    long samples = 0;
+    for (float sp : spo2s) for (float hr : hrs) for (float pi : pis) for (float nz : noises) {
+      SimulatedPpgSource src;
+      src.setSpo2(sp);
+      src.setHeartRate(hr);
+      src.setPerfusion(pi);
+      src.setNoise(nz);
+      src.setJitter(0.03f);
+      src.setWander(0.002f);
+      Spo2Estimator est;
+      est.configure(RATE, 500, 4.0f);
+      Spo2Estimate out;
+      MaximSpo2Reference maxim;
+      maxim.configure(RATE, 50);            // 2 s, as the firmware called it
+      MaximSpo2Result maxim_out;
+      double bias = 0;
+      int n = 0;
+      for (int k = 0; k < RATE * 60; k++) {
+        uint32_t red, ir;
+        src.next(red, ir);
+        double t0 = testNowNs();
+        bool got = est.add(red, ir, out);
+        ns += testNowNs() - t0;
+        t0 = testNowNs();
+        bool maxim_got = maxim.add(red, ir, maxim_out);
+        maxim_ns += testNowNs() - t0;
+        samples++;
+        if (maxim_got && k >= RATE * SETTLE_S) {
+          m.outputs++;
+          if (maxim_out.spo2_valid) {
+            m.spo2_abs += fabs(maxim_out.spo2 - sp);
+            m.spo2_n++;
+          }
+          if (maxim_out.hr_valid) {
+            m.hr_abs += fabs(maxim_out.heart_rate - hr);
+            m.hr_n++;
+          }
+        }
+        if (!got || k < RATE * SETTLE_S) continue;
+        e.outputs++;
+        if (out.flags & SPO2_FLAG_SPO2_VALID) {
+          e.spo2_abs += fabs(out.spo2 - sp);
+          e.spo2_n++;
+          bias += out.spo2 - sp;
+          n++;
+        }
+        if (out.flags & SPO2_FLAG_HR_VALID) {
+          e.hr_abs += fabs(out.heart_rate - hr);
+          e.hr_n++;
+        }
+      }
+      if (n && fabs(bias / n) > fabs(worst_bias)) worst_bias = bias / n;
+    }
+    double spo2_valid = 100.0 * e.spo2_n / e.outputs;
+    double hr_valid = 100.0 * e.hr_n / e.outputs;
+    double spo2_mae = e.spo2_abs / (e.spo2_n ? e.spo2_n : 1);
+    double hr_mae = e.hr_abs / (e.hr_n ? e.hr_n : 1);
+    METRIC("%-9s %5s %12s %8s %12s %8s %11s %7s", "", "outs", "SpO2 valid", "MAE %",
+           "HR valid", "MAE BPM", "ns/sample", "bytes");
+    METRIC("%-9s %5d %11.1f%% %8.2f %11.1f%% %8.2f %11.1f %7u", "streaming",
+           e.outputs, spo2_valid, spo2_mae, hr_valid, hr_mae, ns / samples,
+           (unsigned)sizeof(Spo2Estimator));
+    METRIC("%-9s %5d %11.1f%% %8.2f %11.1f%% %8.2f %11.1f %7u", "Maxim",
+           m.outputs, 100.0 * m.spo2_n / m.outputs, m.spo2_abs / (m.spo2_n ? m.spo2_n : 1),
+           100.0 * m.hr_n / m.outputs, m.hr_abs / (m.hr_n ? m.hr_n : 1), maxim_ns / samples,
+           (unsigned)sizeof(MaximSpo2Reference));
+    METRIC("worst per-condition SpO2 bias %+.2f %%", worst_bias);
+    // Maxim counts the dicrotic wave as a second valley at low rates and
+    // rounds the valley spacing to whole samples, hence its rate error
+    CHECK(spo2_mae < m.spo2_abs / (m.spo2_n ? m.spo2_n : 1));
+    CHECK(hr_mae < m.hr_abs / (m.hr_n ? m.hr_n : 1));
+    CHECK(spo2_valid > 95 && hr_valid > 95);
+    CHECK(spo2_mae < 1.0);
+    CHECK(hr_mae < 2.0);
+    CHECK(fabs(worst_bias) < 2.0);
+  }
+
+  TEST_CASE("one estimate per hop");
+  {
+    SimulatedPpgSource src;
+    Spo2Estimator est;
+    est.configure(RATE, 500, 4.0f);
+    Spo2Estimate out;
+    int outputs = 0;
+    for (int k = 0; k < RATE * 20; k++) {
+      uint32_t red, ir;
+      src.next(red, ir);
+      if (est.add(red, ir, out)) outputs++;
+    }
+    CHECK_MSG(outputs >= 38 && outputs <= 40, "%d estimates in 20 s", outputs);
+  }
+
+  TEST_CASE("no finger: nothing is valid");
+  {
+    Spo2Estimator est;
+    est.configure(RATE, 500, 4.0f);
+    Spo2Estimate out;
+    bool any_valid = false;
+    for (int k = 0; k < RATE * 20; k++) {
+      if (est.add(1000, 1000, out)) any_valid = any_valid || (out.flags & (SPO2_FLAG_SPO2_VALID | SPO2_FLAG_HR_VALID));
+    }
+    CHECK(!any_valid);
+  }
+
+  return testResult("test_spo2_estimator");
+}
@@ -0,0 +1,58 @@
+/*
+ * TensorArena: the build-time plan gives every model an aligned region of
+ * its arena_bytes, regions tile the arena without overlap, and the whole
+ * arena stays under one of the old 8 KB per-model arenas
+ */
+
+#include "host_test.h"
+#include "tensor_arena.h"
+
+static TensorArena arena;
+
+int main() {
+  TEST_CASE("region plan");
+  {
+    uint32_t end = 0;
+    for (uint8_t m = 0; m < MODEL_COUNT; m++) {
+      ArenaRegion r = arena.plan((ModelType)m);
+      uintptr_t address = (uintptr_t)arena.region((ModelType)m);
+      METRIC("%-12s offset %5u, size %5u, end %5u", MODEL_REGISTRY[m].name, r.offset, r.size, r.offset + r.size);
+      CHECK(r.offset == end);                                   // contiguous, no overlap
+      CHECK(r.size >= MODEL_REGISTRY[m].arena_bytes);
+      CHECK(r.size < MODEL_REGISTRY[m].arena_bytes + TENSOR_ARENA_ALIGN);
+      CHECK(r.offset % TENSOR_ARENA_ALIGN == 0);
+      CHECK(address % TENSOR_ARENA_ALIGN == 0);
+      CHECK(r.used == 0);
+      end = r.offset + r.size;
+    }
+    METRIC("arena %u B in .bss, sizeof(TensorArena) %zu", TensorArena::size(), sizeof(TensorArena));
+    CHECK(end == TensorArena::size());
+    CHECK(TensorArena::size() < 8192);
+    CHECK(arena.region(MODEL_PREECLAMPSIA) + TensorArena::regionSize(MODEL_PREECLAMPSIA) ==
+          arena.region(MODEL_ARRHYTHMIA) + TensorArena::size());
+  }
+
+  TEST_CASE("alignment helper");
+  {
+    CHECK(tensorArenaAlign(0) == 0);
+    CHECK(tensorArenaAlign(1) == TENSOR_ARENA_ALIGN);
+    CHECK(tensorArenaAlign(TENSOR_ARENA_ALIGN) == TENSOR_ARENA_ALIGN);
+    CHECK(tensorArenaAlign(2049) == 2048 + TENSOR_ARENA_ALIGN);
+  }
+
+  TEST_CASE("recorded use against the budget");
+  {
+    arena.recordUsed(MODEL_ARRHYTHMIA, 1500);
+    arena.recordUsed(MODEL_ANEMIA, 1200);
+    arena.recordUsed((ModelType)MODEL_COUNT, 9999);            // ignored
+    CHECK(arena.plan(MODEL_ARRHYTHMIA).used == 1500);
+    CHECK(arena.totalUsed() == 2700);
+    arena.recordUsed(MODEL_ARRHYTHMIA, 1600);                  // model swapped
+    CHECK(arena.totalUsed() == 2800);
+    CHECK(arena.overBudget() == 0);
+    arena.recordUsed(MODEL_ANEMIA, TensorArena::regionSize(MODEL_ANEMIA) + 1);
+    CHECK(arena.overBudget() == MODEL_BIT(MODEL_ANEMIA));
+  }
+
+  return testResult("test_tensor_arena");
+}
@@ -0,0 +1,215 @@
+/*
+ * Delta vitals frames: receiver reconstruction over a synthetic 2 h
+ * session, per-field rate limits, keyframe spacing, bytes saved against
+ * full frames, field-mask parsing and truncated frames
+ */
+
+#include <vector>
+#include <string.h>
+#include <math.h>
+#include "host_test.h"
+#include "vitals_delta.h"
+
+static uint32_t rng = 12345;
+
+static double urand() {
+  rng = rng * 1664525u + 1013904223u;
+  return (rng >> 8) / 16777216.0;
+}
+
+/**
+ * Slowly drifting vitals, occasional BP steps and AI result changes, one
+ * snapshot per interval_ms
+ */
+static std::vector<VitalsFrame> session(uint32_t interval_ms) {
+  std::vector<VitalsFrame> frames(7200000 / interval_ms);
+  double hr = 78, spo2 = 97, sys = 118, dia = 76;
+  VitalsFrame f;
+  memset(&f, 0, sizeof(f));
+  f.hr_source = HR_SOURCE_ECG;
+  f.bp_method = BP_METHOD_PTT;
+  rng = 12345;
+  for (size_t i = 0; i < frames.size(); i++) {
+    f.timestamp_ms = 60000 + (uint32_t)i * interval_ms;
+    hr += (urand() - 0.5) * 1.5 + (78 - hr) * 0.02;
+    spo2 += (urand() - 0.5) * 0.3 + (97 - spo2) * 0.05;
+    if (urand() < 0.01) {
+      sys += (urand() - 0.5) * 6;
+      dia += (urand() - 0.5) * 4;
+    }
+    f.hr = (uint8_t)lround(hr);
+    f.hr_ecg = f.hr;
+    f.hr_ppg = (uint8_t)lround(hr + (urand() - 0.5) * 2);
+    f.spo2 = (uint8_t)lround(spo2);
+    f.bp_sys = (uint8_t)lround(sys);
+    f.bp_dia = (uint8_t)lround(dia);
+    f.hrv_ms = (uint16_t)(60000 / f.hr + (urand() - 0.5) * 40);
+    if (i % 5 == 0) f.hrv_sdnn = (uint16_t)(45 + (urand() - 0.5) * 6);
+    f.ptt_ms = (uint16_t)(230 + (urand() - 0.5) * 8);
+    if (urand() < 0.2) f.ecg_quality = (uint8_t)(90 + urand() * 8);
+    if (urand() < 0.2) f.ppg_quality = (uint8_t)(85 + urand() * 10);
+    if (urand() < 0.005) f.rhythm = f.rhythm == RHYTHM_NORMAL ? RHYTHM_PVC : RHYTHM_NORMAL;
+    if (urand() < 0.02) f.rhythm_confidence = (uint8_t)(80 + urand() * 15);
+    if (urand() < 0.01) f.anemia_confidence = (uint8_t)(70 + urand() * 20);
+    if (urand() < 0.01) f.preeclampsia_confidence = (uint8_t)(70 + urand() * 20);
+    f.maternal_health_score = 92;
+    f.ecg_raw = (uint16_t)(1800 + urand() * 600);
+    f.ir = (uint32_t)(110000 + urand() * 3000);
+    f.red = (uint32_t)(90000 + urand() * 3000);
+    frames[i] = f;
+  }
+  return frames;
+}
+
+static bool sameField(const VitalsFrame& a, const VitalsFrame& b, uint8_t field) {
+  uint8_t pa[4], pb[4];
+  uint8_t size = packVitalsField(a, field, pa);
+  packVitalsField(b, field, pb);
+  return memcmp(pa, pb, size) == 0;
+}
+
+/**
+ * Encode the session, decode every frame into one receiver copy and check
+ * each subscribed field against the source: exact when the field has no
+ * rate limit, otherwise a value the source held within the last period
+ */
+static VitalsDeltaStats run(const char* name, const VitalsDeltaConfig& cfg, uint32_t interval_ms) {
+  std::vector<VitalsFrame> frames = session(interval_ms);
+  VitalsDeltaEncoder enc;
+  enc.configure(cfg);
+  VitalsFrame rx;
+  memset(&rx, 0, sizeof(rx));
+  uint8_t buf[VITALS_DELTA_SIZE];
+  size_t max_len = 0;
+  uint32_t sent_ms[VITALS_FIELD_COUNT] = {};
+  uint32_t last_keyframe_ms = 0, max_keyframe_gap = 0;
+  uint32_t mismatches = 0, stale = 0, too_often = 0, decode_errors = 0;
+
+  for (size_t i = 0; i < frames.size(); i++) {
+    uint32_t now = frames[i].timestamp_ms;
+    size_t len = enc.encode(frames[i], now, (uint8_t)i, buf, sizeof(buf));
+    if (len) {
+      if (len > max_len) max_len = len;
+      bool key = false;
+      if (!decodeVitalsDelta(buf, len, rx, &key)) decode_errors++;
+      uint32_t mask = (uint32_t)buf[4] | ((uint32_t)buf[5] << 8) | ((uint32_t)buf[6] << 16);
+      if (key) {
+        if (i > 0 && now - last_keyframe_ms > max_keyframe_gap) max_keyframe_gap = now - last_keyframe_ms;
+        last_keyframe_ms = now;
+      }
+      for (uint8_t k = 0; k < VITALS_FIELD_COUNT; k++) {
+        if (!(mask & (1UL << k))) continue;
+        if (!key && cfg.period_ms[k] && now - sent_ms[k] < cfg.period_ms[k]) too_often++;
+        sent_ms[k] = now;
+      }
+    }
+    for (uint8_t k = 0; k < VITALS_FIELD_COUNT; k++) {
+      if (!(cfg.mask & (1UL << k))) continue;
+      if (!cfg.period_ms[k]) {
+        if (!sameField(frames[i], rx, k)) mismatches++;
+        continue;
+      }
+      bool found = false;
+      size_t back = cfg.period_ms[k] / interval_ms + 1;
+      for (size_t j = i + 1; j-- > 0 && i - j <= back;) {
+        if (sameField(frames[j], rx, k)) {
+          found = true;
+          break;
+        }
+      }
+      if (!found) stale++;
+    }
+  }
+
+  VitalsDeltaStats s = enc.getStats();
+  double full = (double)frames.size() * VITALS_FRAME_SIZE;
+  METRIC("%-36s %5zu snapshots: %5u sent (%3u key), %6u B vs %6.0f B full (%4.1f%% saved), %.1f B/sent, max %zu",
+         name, frames.size(), s.frames, s.keyframes, s.bytes, full, 100.0 * (1 - s.bytes / full),
+         s.frames ? (double)s.bytes / s.frames : 0.0, max_len);
+  CHECK(decode_errors == 0);
+  CHECK_MSG(mismatches == 0, "%u field mismatches", mismatches);
+  CHECK_MSG(stale == 0, "%u fields older than their period", stale);
+  CHECK_MSG(too_often == 0, "%u fields sent inside their period", too_often);
+  CHECK(max_len <= VITALS_DELTA_SIZE);
+  CHECK_MSG(max_keyframe_gap <= cfg.keyframe_ms + interval_ms, "keyframe gap %u ms", max_keyframe_gap);
+  CHECK(s.full_bytes == full);
+  return s;
+}
+
+int main() {
+  TEST_CASE("receiver reconstruction and bytes saved");
+  {
+    VitalsDeltaConfig cfg;
+    cfg.setDefaults();
+    VitalsDeltaStats all = run("all fields, every change", cfg, 2000);
+    CHECK(all.bytes < all.full_bytes);
+
+    cfg.mask = 0x1FFFE;
+    VitalsDeltaStats app = run("app fields (no time/IR/red)", cfg, 2000);
+    CHECK(app.bytes < all.bytes);
+
+    cfg.mask &= ~(1UL << VITALS_FIELD_ECG);
+    VitalsDeltaStats no_ecg = run("app fields without raw ECG", cfg, 2000);
+    CHECK(no_ecg.bytes < app.bytes);
+
+    VitalsDeltaConfig limited = cfg;
+    limited.mask = (1UL << VITALS_FIELD_HR) | (1UL << VITALS_FIELD_SPO2) | (1UL << VITALS_FIELD_BP) |
+                   (1UL << VITALS_FIELD_RHYTHM) | (1UL << VITALS_FIELD_ANEMIA) |
+                   (1UL << VITALS_FIELD_PREECLAMPSIA) | (1UL << VITALS_FIELD_ALERTS);
+    limited.period_ms[VITALS_FIELD_HR] = 1000;
+    limited.period_ms[VITALS_FIELD_SPO2] = 5000;
+    limited.period_ms[VITALS_FIELD_BP] = 10000;
+    CHECK(limited.intervalMs(2000) == 1000);
+    VitalsDeltaStats lim = run("HR 1s, SpO2 5s, BP 10s, AI on change", limited, limited.intervalMs(2000));
+    CHECK(lim.unchanged > 0);
+    CHECK(lim.bytes * 5 < lim.full_bytes);
+  }
+
+  TEST_CASE("snapshot interval limits");
+  {
+    VitalsDeltaConfig cfg;
+    cfg.setDefaults();
+    CHECK(cfg.intervalMs(2000) == 2000);
+    cfg.period_ms[VITALS_FIELD_HR] = 100;
+    CHECK(cfg.intervalMs(2000) == VITALS_DELTA_MIN_PERIOD_MS);
+    cfg.mask &= ~(1UL << VITALS_FIELD_HR);
+    CHECK(cfg.intervalMs(2000) == 2000);     // only subscribed fields count
+  }
+
+  TEST_CASE("field mask parsing");
+  {
+    uint32_t m = 0;
+    CHECK(parseVitalsFieldMask("HR,SPO2 BP", m) && m == 0x32);
+    CHECK(parseVitalsFieldMask("0X1FFFE", m) && m == 0x1FFFE);
+    CHECK(!parseVitalsFieldMask("HR,FOO", m) && m == 0x1FFFE);   // rejected, mask kept
+    CHECK(parseVitalsFieldMask("ALL", m) && m == VITALS_FIELDS_ALL);
+    CHECK(parseVitalsFieldMask("NONE", m) && m == 0);
+  }
+
+  TEST_CASE("keyframes, unchanged snapshots and truncation");
+  {
+    VitalsDeltaEncoder enc;
+    VitalsFrame f, rx;
+    memset(&f, 0, sizeof(f));
+    uint8_t buf[VITALS_DELTA_SIZE];
+    size_t len = enc.encode(f, 0, 0, buf, sizeof(buf));
+    bool key = false;
+    CHECK(len == VITALS_FRAME_HEADER + 3 + VITALS_FIELD_BYTES);
+    CHECK(decodeVitalsDelta(buf, len, rx, &key) && key);
+    CHECK(!decodeVitalsDelta(buf, len - 1, rx));
+    CHECK(enc.encode(f, 1000, 1, buf, sizeof(buf)) == 0);          // nothing changed
+    CHECK(enc.encode(f, 1000, 1, buf, VITALS_DELTA_SIZE - 1) == 0);
+    f.hr = 80;
+    len = enc.encode(f, 2000, 2, buf, sizeof(buf));
+    CHECK(len == VITALS_FRAME_HEADER + 3 + 1);
+    CHECK(decodeVitalsDelta(buf, len, rx, &key) && !key && rx.hr == 80);
+    enc.forceKeyframe();
+    CHECK(enc.encode(f, 3000, 3, buf, sizeof(buf)) == VITALS_FRAME_HEADER + 3 + VITALS_FIELD_BYTES);
+    CHECK(enc.encode(f, 3000 + VITALS_DELTA_KEYFRAME_MS, 4, buf, sizeof(buf)) ==
+          VITALS_FRAME_HEADER + 3 + VITALS_FIELD_BYTES);
+    buf[0] = 'V';
+    CHECK(!decodeVitalsDelta(buf, VITALS_FRAME_HEADER + 3 + VITALS_FIELD_BYTES, rx));
+  }
+
+  return testResult("test_vitals_delta");
+}
@@ -0,0 +1,129 @@
+/*
+ * Binary vitals frame: byte-exact round trip, schema compatibility in
+ * both directions, enum coverage and encode cost against an snprintf
+ * stand-in for the ArduinoJson notification
+ */
+
+#include <string.h>
+#include "host_test.h"
+#include "vitals_frame.h"
+
+static VitalsFrame sampleFrame() {
+  VitalsFrame f;
+  memset(&f, 0, sizeof(f));
+  f.timestamp_ms = 123456789; f.hr = 78; f.hr_ecg = 77; f.hr_ppg = 80; f.spo2 = 98;
+  f.bp_sys = 118; f.bp_dia = 76; f.hrv_ms = 812; f.hrv_sdnn = 45; f.ptt_ms = 231;
+  f.ecg_quality = 88; f.ppg_quality = 72; f.hr_source = HR_SOURCE_ECG; f.bp_method = BP_METHOD_PTT;
+  f.alerts = VITALS_ALERT_ANEMIA; f.rhythm = RHYTHM_PVC; f.rhythm_confidence = 91;
+  f.anemia_risk = RISK_LOW_MODERATE; f.anemia_confidence = 64; f.preeclampsia_risk = RISK_UNKNOWN;
+  f.maternal_health_score = 84; f.ecg_raw = 2117; f.ir = 123456; f.red = 98765;
+  f.flags = VITALS_FLAG_BUFFERED; f.age_ms = 987654;
+  return f;
+}
+
+int main() {
+  TEST_CASE("round trip");
+  {
+    VitalsFrame f = sampleFrame();
+    uint8_t a[64], b[64];
+    size_t n = encodeVitalsFrame(f, 7, a, sizeof(a));
+    VitalsFrame g;
+    uint8_t seq = 0;
+    CHECK(n == VITALS_FRAME_SIZE);
+    CHECK(decodeVitalsFrame(a, n, g, &seq));
+    CHECK(seq == 7);
+    size_t n2 = encodeVitalsFrame(g, seq, b, sizeof(b));
+    CHECK(n2 == n && memcmp(a, b, n) == 0);
+    CHECK(g.age_ms == 987654 && g.flags == VITALS_FLAG_BUFFERED && g.red == 98765);
+    CHECK(encodeVitalsFrame(f, 0, a, VITALS_FRAME_SIZE - 1) == 0);
+  }
+
+  TEST_CASE("schema compatibility");
+  {
+    VitalsFrame f = sampleFrame(), g;
+    uint8_t buf[64];
+    size_t n = encodeVitalsFrame(f, 1, buf, sizeof(buf));
+    // A later schema appends fields: skipped by length
+    uint8_t ext[64];
+    memcpy(ext, buf, n);
+    ext[1] = VITALS_FRAME_VERSION + 1;
+    ext[2] += 6;
+    memset(ext + n, 0xAA, 6);
+    CHECK(decodeVitalsFrame(ext, n + 6, g));
+    CHECK(g.age_ms == f.age_ms);
+    // A v1 frame has no age: decoded as live
+    uint8_t v1[64];
+    memcpy(v1, buf, VITALS_FRAME_HEADER + VITALS_FRAME_PAYLOAD_V1);
+    v1[1] = 1;
+    v1[2] = VITALS_FRAME_PAYLOAD_V1;
+    CHECK(decodeVitalsFrame(v1, VITALS_FRAME_HEADER + VITALS_FRAME_PAYLOAD_V1, g));
+    CHECK(g.age_ms == 0 && g.hr == f.hr && g.red == f.red);
+    // Truncated or foreign payloads are rejected
+    CHECK(!decodeVitalsFrame(buf, n - 1, g));
+    buf[0] = '{';
+    CHECK(!decodeVitalsFrame(buf, n, g));
+  }
+
+  TEST_CASE("every enum value survives the frame");
+  {
+    VitalsFrame f = sampleFrame(), g;
+    uint8_t buf[64];
+    bool all = true;
+    for (int r = 0; r <= RHYTHM_NO_SIGNAL; r++) {
+      for (int h = 0; h <= HR_SOURCE_PPG; h++) {
+        for (int b = 0; b <= BP_METHOD_PTT; b++) {
+          f.rhythm = (RhythmType)r;
+          f.anemia_risk = (RiskLevel)r;
+          f.preeclampsia_risk = (RiskLevel)(RISK_UNKNOWN - r);
+          f.hr_source = (HrSource)h;
+          f.bp_method = (BpMethod)b;
+          size_t n = encodeVitalsFrame(f, 0, buf, sizeof(buf));
+          all = all && decodeVitalsFrame(buf, n, g) && g.rhythm == f.rhythm && g.anemia_risk == f.anemia_risk &&
+                g.preeclampsia_risk == f.preeclampsia_risk && g.hr_source == f.hr_source && g.bp_method == f.bp_method;
+        }
+      }
+    }
+    CHECK(all);
+    CHECK(strcmp(rhythmName(RHYTHM_PVC), "PVC") == 0);
+    CHECK(strcmp(riskName(RISK_LOW_MODERATE), "Low-Moderate") == 0);
+  }
+
+  TEST_CASE("encode cost");
+  {
+    VitalsFrame f = sampleFrame();
+    uint8_t buf[64];
+    char json[600];
+    volatile size_t sink = 0;
+    const int n = 1000000;
+    uint64_t t0 = testNowNs();
+    for (int i = 0; i < n; i++) {
+      f.timestamp_ms = i;
+      size_t len = encodeVitalsFrame(f, (uint8_t)i, buf, sizeof(buf));
+      testKeep(buf);
+      sink += len + buf[i % len];
+    }
+    double binary_ns = (double)(testNowNs() - t0) / n;
+    // ArduinoJson is not available on the host: snprintf of the same keys
+    // and values stands in for the old notification
+    int json_len = 0;
+    t0 = testNowNs();
+    for (int i = 0; i < n / 10; i++) {
+      json_len = snprintf(json, sizeof(json),
+        "{\"hr\":%d,\"hr_ecg\":%d,\"hr_ppg\":%d,\"hr_source\":\"%s\",\"ecg_quality\":%d,\"ppg_quality\":%d,"
+        "\"spo2\":%d,\"bp_sys\":%d,\"bp_dia\":%d,\"bp_method\":\"%s\",\"hrv\":%d,\"hrv_sdnn\":%d,\"ptt\":%d,"
+        "\"rhythm\":\"%s\",\"rhythm_confidence\":%d,\"arrhythmia_alert\":false,\"anemia_risk\":\"%s\","
+        "\"anemia_confidence\":%d,\"anemia_alert\":true,\"preeclampsia_risk\":\"%s\",\"preeclampsia_confidence\":%d,"
+        "\"preeclampsia_alert\":false,\"maternal_health_score\":%d,\"ecg\":%d,\"ir\":%u,\"red\":%u,\"timestamp\":%u}",
+        78, 77, 80, "ECG", 88, 72, 98, 118, 76, "PTT", 812, 45, i, "PVC", 91, "Low-Moderate", 64, "Unknown", 0, 84,
+        2117, 123456u, 98765u, 123456789u);
+      testKeep(json);
+      sink += json_len;
+    }
+    double json_ns = (double)(testNowNs() - t0) / (n / 10);
+    METRIC("binary %d B in %.1f ns, JSON (snprintf stand-in) %d B in %.0f ns", VITALS_FRAME_SIZE, binary_ns,
+           json_len, json_ns);
+    CHECK(json_len > 3 * VITALS_FRAME_SIZE);
+  }
+
+  return testResult("test_vitals_frame");
+}
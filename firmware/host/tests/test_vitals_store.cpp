@@ -0,0 +1,328 @@
+/*
+ * VitalsStore: power-cut torture on the file-backed flash, foreign
+ * images, erases moved out of append() by prepare(), and the ECG chain
+ * bridging the sampler stall of a sector erase scheduled in diastole at
+ * 250 Hz (at 500 Hz the stall is longer than the bridge)
+ */
+
+#include <vector>
+#include <stdlib.h>
+#include "host_test.h"
+#include "vitals_store.h"
+#include "file_block_device.h"
+#include "ecg_filter.h"
+#include "qrs_detector.h"
+#include "simulated_adc_source.h"
+
+#define IMAGE_PATH "build/test_vitals_store.img"
+#define FRAME_BYTES 38
+#define ERASE_MS 45                 // one 4 KB sector erase on the ESP32-S3 flash
+
+static void fillPayload(uint32_t id, uint8_t* p) {
+  for (int i = 0; i < FRAME_BYTES; i++) {
+    p[i] = (uint8_t)(id * 7 + i * 13);
+  }
+}
+
+struct Stored {
+  uint32_t id;
+  uint32_t seq;
+};
+
+/**
+ * Read the whole log back, checking every record against its id
+ */
+static std::vector<Stored> readBack(VitalsStore& store, uint32_t next_id) {
+  std::vector<Stored> got;
+  VitalsCursor c = store.begin();
+  VitalsRecord r;
+  while (store.next(c, r)) {
+    uint8_t p[FRAME_BYTES];
+    fillPayload(r.time_s, p);
+    CHECK_MSG(r.kind == VITALS_RECORD_FRAME && r.length == FRAME_BYTES && memcmp(p, r.payload, FRAME_BYTES) == 0,
+              "garbage record %u", r.time_s);
+    CHECK_MSG(r.time_s < next_id, "unknown id %u", r.time_s);
+    if (!got.empty()) {
+      CHECK_MSG(r.time_s > got.back().id, "id %u after %u", r.time_s, got.back().id);
+    }
+    Stored s = {r.time_s, c.seq};
+    got.push_back(s);
+  }
+  return got;
+}
+
+/**
+ * Append until the power fails, remount, check nothing acknowledged was
+ * lost except whole pages at the old end; prepare() is interleaved with
+ * the appends when use_prepare is set
+ */
+static void powerCutTorture(VitalsStore& store, uint32_t sectors, bool use_prepare) {
+  remove(IMAGE_PATH);
+  uint32_t next_id = 1;
+  std::vector<uint32_t> acked;
+  srand(sectors * 2 + use_prepare);
+  uint32_t torn = 0, prepared = 0, inline_erases = 0;
+  const int cycles = 300;
+  for (int cycle = 0; cycle < cycles; cycle++) {
+    FileBlockDevice dev;
+    dev.open(IMAGE_PATH, sectors);
+    CHECK(store.mount(&dev));
+    torn += store.getStats().torn;
+
+    std::vector<Stored> got = readBack(store, next_id);
+    if (!acked.empty()) {
+      CHECK(!got.empty());
+      if (got.empty()) {
+        break;
+      }
+      CHECK_MSG(got.back().id >= acked.back(), "last acked %u, last stored %u", acked.back(), got.back().id);
+      CHECK(store.lastTime() == got.back().id);
+      // Recycling drops whole pages, so an acknowledged record may only be
+      // missing from the oldest page retained
+      uint32_t second_page = 0xFFFFFFFFUL;
+      for (size_t i = 0; i < got.size(); i++) {
+        if (got[i].seq != got.front().seq) {
+          second_page = got[i].id;
+          break;
+        }
+      }
+      size_t gi = 0;
+      for (size_t i = 0; i < acked.size(); i++) {
+        uint32_t id = acked[i];
+        if (id < got.front().id) continue;
+        while (gi < got.size() && got[gi].id < id) gi++;
+        bool present = gi < got.size() && got[gi].id == id;
+        CHECK_MSG(present || id < second_page, "acked %u lost mid-log", id);
+      }
+      for (int k = 0; k < 5; k++) {
+        uint32_t t = got[rand() % got.size()].id;
+        VitalsCursor s = store.seek(t);
+        VitalsRecord r;
+        CHECK_MSG(store.next(s, r) && r.time_s == t, "seek %u", t);
+      }
+      VitalsCursor s = store.seek(got.back().id + 1);
+      VitalsRecord r;
+      CHECK(!store.next(s, r));
+    }
+
+    std::vector<uint32_t> keep;
+    for (size_t i = 0; i < acked.size(); i++) {
+      if (!got.empty() && acked[i] >= got.front().id) keep.push_back(acked[i]);
+    }
+    acked.swap(keep);
+
+    dev.cutPowerAfter(rand() % 300, (uint32_t)rand());
+    for (;;) {
+      if (use_prepare && rand() % 8 == 0 && store.needsPrepare()) {
+        store.prepare();
+        if (!dev.isPowered()) break;
+      }
+      uint8_t p[FRAME_BYTES];
+      uint32_t id = next_id++;
+      fillPayload(id, p);
+      if (!store.append(VITALS_RECORD_FRAME, id, p, FRAME_BYTES)) break;
+      acked.push_back(id);
+    }
+    prepared += store.getStats().prepared;
+    inline_erases += store.getStats().inline_erases;
+  }
+  METRIC("%u sectors, %d power cuts%s: %u records written, %zu retained, %u torn, %u pages prepared, %u erased inline",
+         sectors, cycles, use_prepare ? " (prepare)" : "", next_id - 1, acked.size(), torn, prepared, inline_erases);
+  CHECK(torn > 0);                       // the cuts did land mid-program
+  if (use_prepare) {
+    CHECK(prepared > 0);
+  }
+}
+
+struct ChainRun {
+  std::vector<uint32_t> beats;   // R-peaks, acquisition sample index
+  uint32_t erases;
+  uint32_t missed;
+  uint32_t gap_fills;
+  uint32_t restarts;
+  uint32_t relearns;
+};
+
+/**
+ * Simulated ECG through EcgPreFilter and QrsDetector with a sector erase
+ * stalling the sampler. scheduled: after each beat event, erase once the
+ * extrapolated cycle phase is in diastole, as serviceFlashErase() does;
+ * otherwise erase every period_ms regardless of the rhythm
+ */
+static ChainRun runChain(uint16_t fs, float bpm, bool erase, bool scheduled, uint32_t period_ms) {
+  const uint32_t seconds = 60;
+  const uint32_t event_latency = fs / 50;      // 20 ms to the inference stage
+  const uint32_t stall = (ERASE_MS * fs + 999) / 1000;
+  SimulatedAdcSource src(fs, bpm);
+  src.setMainsNoise(30);
+  src.setBaselineWander(150);
+  EcgPreFilter filter;
+  filter.configure(fs, NOTCH_50HZ, 1);
+  QrsDetector det;
+  det.configure(filter.outputRate());
+
+  ChainRun run = {};
+  uint32_t n = seconds * fs;
+  uint32_t last_r = 0, last_rr = 0, armed_at = 0;
+  bool armed = false;
+  uint32_t next_blind = period_ms * fs / 1000;
+  for (uint32_t i = 0; i < n; i++) {
+    if (erase) {
+      bool now = false;
+      if (scheduled) {
+        if (armed && i >= armed_at && last_rr) {
+          uint32_t phase = (i - last_r) % last_rr;
+          now = phase >= 120u * fs / 1000 && phase + 100u * fs / 1000 <= last_rr;
+        }
+      } else {
+        now = i >= next_blind;
+      }
+      if (now) {
+        i += stall - 1;              // the sampler misses these ticks
+        run.missed += stall;
+        run.erases++;
+        armed = false;
+        next_blind += period_ms * fs / 1000;
+        continue;
+      }
+    }
+    EcgSample in, out;
+    in.index = i;
+    in.value = src.sampleAt(i);
+    if (filter.process(&in, 1, &out) == 1) {
+      QrsEvent ev;
+      if (det.process(out.value, out.index, ev)) {
+        last_r = filter.toInputIndex(ev.r_index);
+        last_rr = ev.rr_samples;
+        armed = true;
+        armed_at = i + event_latency;
+        run.beats.push_back(last_r);
+      }
+    }
+  }
+  run.gap_fills = filter.gapFillCount();
+  run.restarts = filter.restartCount();
+  run.relearns = det.relearnCount();
+  return run;
+}
+
+/**
+ * Beats of ref without a beat of run within 50 ms
+ */
+static uint32_t lostBeats(const ChainRun& ref, const ChainRun& run, uint16_t fs) {
+  uint32_t lost = 0;
+  int tol = fs / 20;
+  size_t j = 0;
+  for (size_t k = 0; k < ref.beats.size(); k++) {
+    while (j < run.beats.size() && (int)run.beats[j] < (int)ref.beats[k] - tol) j++;
+    if (j >= run.beats.size() || abs((int)run.beats[j] - (int)ref.beats[k]) > tol) lost++;
+  }
+  return lost;
+}
+
+int main() {
+  static VitalsStore store;
+
+  TEST_CASE("power-cut torture");
+  {
+    powerCutTorture(store, 3, false);
+    powerCutTorture(store, 8, false);
+    powerCutTorture(store, 8, true);
+  }
+
+  TEST_CASE("foreign image mounts empty");
+  {
+    remove(IMAGE_PATH);
+    FileBlockDevice dev;
+    dev.open(IMAGE_PATH, 4);
+    for (uint32_t s = 0; s < 4; s++) {
+      uint8_t junk[256];
+      memset(junk, 0x5A, sizeof(junk));
+      for (uint32_t o = 0; o < 4096; o += sizeof(junk)) {
+        dev.program(s * 4096 + o, junk, sizeof(junk));
+      }
+    }
+    uint8_t p[FRAME_BYTES];
+    fillPayload(1, p);
+    CHECK(store.mount(&dev) && store.isEmpty());
+    CHECK(store.append(VITALS_RECORD_FRAME, 1, p, FRAME_BYTES));
+    CHECK(store.mount(&dev) && !store.isEmpty() && store.lastTime() == 1);
+  }
+
+  TEST_CASE("prepare() takes every erase out of append()");
+  {
+    remove(IMAGE_PATH);
+    FileBlockDevice dev;
+    dev.open(IMAGE_PATH, 16);
+    CHECK(store.mount(&dev));
+    uint8_t p[FRAME_BYTES];
+    const uint32_t records = 3000;         // wraps the 16-sector ring
+    uint32_t erases_in_append = 0;
+    uint64_t append_ns = 0;
+    for (uint32_t i = 1; i <= records; i++) {
+      if (i % 16 == 1 && store.needsPrepare()) {
+        store.prepare();                   // one erase per "beat"
+      }
+      fillPayload(i, p);
+      uint32_t before = dev.eraseCount();
+      uint64_t t0 = testNowNs();
+      CHECK(store.append(VITALS_RECORD_FRAME, i, p, FRAME_BYTES));
+      append_ns += testNowNs() - t0;
+      erases_in_append += dev.eraseCount() - before;
+    }
+    VitalsStoreStats s = store.getStats();
+    METRIC("%u appends, %u pages opened, %u prepared, %u erased inline, %.0f ns/append on the file image",
+           records, s.pages_opened, s.prepared, s.inline_erases, (double)append_ns / records);
+    CHECK(s.pages_opened > 16);
+    CHECK(s.inline_erases == 0);
+    CHECK(erases_in_append == 0);
+    CHECK(!store.prepare());               // already done for the next page
+    CHECK(!store.needsPrepare());
+    // Remount forgets the erase but finds the page blank
+    CHECK(store.mount(&dev));
+    CHECK(store.lastTime() == records);
+    std::vector<Stored> got = readBack(store, records + 1);
+    CHECK(!got.empty() && got.back().id == records);
+    fillPayload(records + 1, p);
+    CHECK(store.append(VITALS_RECORD_FRAME, records + 1, p, FRAME_BYTES));
+  }
+  remove(IMAGE_PATH);
+
+  TEST_CASE("sector erase stalls in diastole are bridged by the ECG chain at 250 Hz");
+  {
+    const uint16_t fs = 250;
+    const float bpms[] = {60, 95, 140};
+    for (size_t b = 0; b < sizeof(bpms) / sizeof(bpms[0]); b++) {
+      ChainRun ref = runChain(fs, bpms[b], false, false, 0);
+      ChainRun sched = runChain(fs, bpms[b], true, true, 0);
+      ChainRun blind = runChain(fs, bpms[b], true, false, 530);
+      uint32_t lost = lostBeats(ref, sched, fs);
+      uint32_t extra = lostBeats(sched, ref, fs);
+      METRIC("%3u Hz, HR %3.0f: %zu beats, scheduled %u erases (%u ticks missed) lost %u / extra %u, "
+             "unscheduled %u erases lost %u, restarts %u",
+             fs, bpms[b], ref.beats.size(), sched.erases, sched.missed, lost, extra,
+             blind.erases, lostBeats(ref, blind, fs), blind.restarts + blind.relearns);
+      CHECK(sched.erases + 3 >= ref.beats.size());   // one erase per beat
+      CHECK(sched.missed / sched.erases <= ECG_FILTER_MAX_GAP_FILL);
+      CHECK(sched.gap_fills == sched.missed);
+      CHECK(sched.restarts == 0);
+      CHECK(sched.relearns == 0);
+      CHECK(lost == 0);
+      CHECK(extra == 0);
+    }
+  }
+
+  TEST_CASE("at 500 Hz an erase stall exceeds the bridge and the detector relearns");
+  {
+    // One erase every 20 s, as a faster stand-in for one per vitals page
+    ChainRun ref = runChain(500, 95, false, false, 0);
+    ChainRun run = runChain(500, 95, true, false, 20000);
+    uint32_t lost = lostBeats(ref, run, 500);
+    METRIC("%u erases, %u ticks missed each, %u restarts, %u of %zu beats lost",
+           run.erases, run.missed / run.erases, run.restarts, lost, ref.beats.size());
+    CHECK(run.missed / run.erases > ECG_FILTER_MAX_GAP_FILL);
+    CHECK(run.restarts == run.erases);
+  }
+
+  return testResult("test_vitals_store");
+}
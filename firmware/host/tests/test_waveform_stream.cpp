@@ -0,0 +1,98 @@
+/*
+ * WaveformEncoder/Decoder: exact round trip over index gaps and int32
+ * extremes, bytes per sample at common MTUs, lost-packet detection
+ */
+
+#include <vector>
+#include "host_test.h"
+#include "waveform_stream.h"
+#include "simulated_adc_source.h"
+
+int main() {
+  TEST_CASE("60 s of simulated ECG round trip, with a 37-sample index gap");
+  {
+    const size_t mtus[] = {23, 185, 247, 512};
+    for (size_t m = 0; m < sizeof(mtus) / sizeof(mtus[0]); m++) {
+      SimulatedAdcSource src(250, 75);
+      src.setMainsNoise(40);
+      src.setBaselineWander(200);
+      WaveformEncoder enc;
+      enc.configure(WAVE_CH_ECG, 250);
+      enc.setLimits(mtus[m] - 3, 62);
+      WaveformDecoder dec;
+      int32_t out[WAVE_MAX_SAMPLES];
+      WavePacketInfo info;
+      const uint32_t n = 250 * 60, gap_at = 7000, gap = 37;
+      std::vector<int16_t> ref(n);
+      uint32_t checked = 0, errors = 0;
+      uint64_t t0 = testNowNs();
+      for (uint32_t i = 0; i <= n; i++) {
+        bool ready;
+        if (i < n) {
+          ref[i] = src.sampleAt(i);
+          ready = enc.add(i + (i >= gap_at ? gap : 0), ref[i]);
+        } else {
+          ready = enc.flush();
+        }
+        if (ready) {
+          int count = dec.decode(enc.packet(), enc.packetSize(), info, out);
+          for (int k = 0; k < count; k++) {
+            uint32_t index = info.first_index + k;
+            uint32_t orig = index >= gap_at + gap ? index - gap : index;
+            if (orig >= n || out[k] != ref[orig]) errors++;
+            checked++;
+          }
+          enc.release();
+        }
+      }
+      double ns = (double)(testNowNs() - t0) / n;
+      WaveStreamStats s = enc.getStats();
+      METRIC("MTU %3zu: %u packets, %.0f B/s (%.2f B/sample), %u index breaks, %.0f ns/sample",
+             mtus[m], s.packets, s.bytes / 60.0, (double)s.bytes / n, s.index_breaks, ns);
+      CHECK(checked == n);
+      CHECK(errors == 0);
+      CHECK(s.index_breaks == 1);
+      CHECK(dec.lostPackets() == 0);
+      if (mtus[m] >= 185) {
+        CHECK(s.bytes / 60.0 < 500);    // less than packed int16
+      }
+    }
+  }
+
+  TEST_CASE("int32 extremes");
+  {
+    WaveformEncoder enc;
+    enc.setLimits(WAVE_MAX_PACKET, WAVE_MAX_SAMPLES);
+    WaveformDecoder dec;
+    const int32_t values[] = {0, -2147483647 - 1, 2147483647, 5, -5, 100000, -100000};
+    for (uint32_t i = 0; i < 7; i++) enc.add(i, values[i]);
+    CHECK(enc.flush());
+    int32_t out[WAVE_MAX_SAMPLES];
+    WavePacketInfo info;
+    int n = dec.decode(enc.packet(), enc.packetSize(), info, out);
+    CHECK(n == 7);
+    bool same = n == 7;
+    for (int i = 0; i < n && i < 7; i++) same = same && out[i] == values[i];
+    CHECK(same);
+    CHECK(dec.decode(enc.packet(), WAVE_HEADER_SIZE - 1, info, out) < 0);   // truncated
+  }
+
+  TEST_CASE("a dropped notification shows as a sequence jump");
+  {
+    WaveformEncoder enc;
+    WaveformDecoder dec;
+    int32_t out[WAVE_MAX_SAMPLES];
+    WavePacketInfo info;
+    int packet = 0;
+    for (uint32_t i = 0; i < 2000; i++) {
+      if (enc.add(i, i % 7)) {
+        if (packet++ != 3) dec.decode(enc.packet(), enc.packetSize(), info, out);
+        enc.release();
+      }
+    }
+    METRIC("%d packets, %u reported lost", packet, dec.lostPackets());
+    CHECK(dec.lostPackets() == 1);
+  }
+
+  return testResult("test_waveform_stream");
+}
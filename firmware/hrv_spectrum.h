@@ -0,0 +1,392 @@
+/*
+ * LifeBand HRV Spectrum
+ * LF/HF autonomic balance from the RR tachogram in fixed point
+ *
+ * Frequency-domain HRV (Task Force 1996 bands) over the newest 2..4.3
+ * minutes of BeatHistory:
+ *
+ *   resample  - RR(t) linearly interpolated at 4 Hz onto an even grid
+ *               ending at the newest beat (integer, 1/16 ms units)
+ *   detrend   - mean removed, block-scaled so the largest deviation uses
+ *               14 bits, Hann window (Q15) over the samples present and
+ *               zero padding up to HRV_FFT_SIZE
+ *   FFT       - 1024-point radix-2 DIT on int16 data with Q15 twiddles;
+ *               a stage is halved only when its input could overflow
+ *               (block floating point), so small signals keep precision
+ *   bands     - |X|^2 summed per band in 64-bit integers and scaled to
+ *               ms^2 once: P = 2 * sum|X|^2 / (N * sum w^2)
+ *
+ *   VLF 0.0033-0.04 Hz   LF 0.04-0.15 Hz   HF 0.15-0.4 Hz
+ *
+ * Work is split so the inference stage never stalls: begin() resamples
+ * (one pass over the beats, ~1k interpolations) and every step() runs one
+ * bounded phase - windowing, bit reversal, one FFT stage (512 butterflies)
+ * or band integration. A full spectrum takes HRV_SPECTRUM_STEPS calls;
+ * begin() is meant to be called every HRV_SPECTRUM_EVERY_BEATS beats.
+ *
+ * Tables are built once in the constructor (sinf); everything per
+ * spectrum is integer except the final conversion to ms^2. Memory: 4 KB
+ * data + 2 KB twiddles. Single owner (inference stage); no Arduino
+ * dependency.
+ */
+
+#ifndef HRV_SPECTRUM_H
+#define HRV_SPECTRUM_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+#include <math.h>
+#include "beat_history.h"
+
+#define HRV_FFT_LOG2 10
+#define HRV_FFT_SIZE (1 << HRV_FFT_LOG2)
+#define HRV_RESAMPLE_HZ 4
+#define HRV_RESAMPLE_MS (1000 / HRV_RESAMPLE_HZ)
+#define HRV_SPECTRUM_MIN_MS 120000UL        // shortest usable window (2 min)
+#define HRV_SPECTRUM_MAX_GAPS 10            // % of beats that may follow a gap
+#define HRV_SPECTRUM_EVERY_BEATS 30
+#define HRV_SPECTRUM_STEPS (HRV_FFT_LOG2 + 3)
+
+// Band edges in mHz
+#define HRV_VLF_LOW_MHZ 3
+#define HRV_LF_LOW_MHZ 40
+#define HRV_HF_LOW_MHZ 150
+#define HRV_HF_HIGH_MHZ 400
+
+struct HrvSpectrumResult {
+  bool valid;
+  float vlf_ms2;
+  float lf_ms2;
+  float hf_ms2;
+  float lf_hf;              // LF / HF, 0 if HF is 0
+  float lf_nu;              // LF / (LF + HF) * 100
+  float hf_nu;
+  uint32_t window_ms;       // tachogram length analysed
+  uint16_t beats;
+  uint32_t computed_ms;     // time of the newest beat analysed
+};
+
+struct HrvSpectrumStats {
+  uint32_t started;
+  uint32_t completed;
+  uint32_t rejected;        // too short or too many gaps
+  uint32_t busy;            // begin() while a spectrum was in progress
+};
+
+class HrvSpectrum {
+private:
+  enum Phase {
+    PHASE_IDLE,
+    PHASE_WINDOW,
+    PHASE_REORDER,
+    PHASE_FFT,
+    PHASE_BANDS
+  };
+
+  int16_t re[HRV_FFT_SIZE];
+  int16_t im[HRV_FFT_SIZE];
+  int16_t cos_table[HRV_FFT_SIZE / 2];      // cos(2 pi k / N), Q15
+  int16_t sin_table[HRV_FFT_SIZE / 2];
+
+  Phase phase;
+  uint8_t stage;
+  uint16_t length;          // resampled samples before zero padding
+  int8_t exponent;          // X_true = X * 2^exponent, in input units
+  int32_t mean_q4;
+  uint64_t window_energy;   // sum of w^2, Q30
+  uint16_t pending_beats;
+  uint32_t pending_end_ms;
+
+  uint16_t vlf_lo, lf_lo, hf_lo, hf_hi;     // band bins [lo, next lo)
+  HrvSpectrumResult result;
+  HrvSpectrumStats stats;
+
+  static uint16_t bin(uint32_t mhz) {
+    // First bin at or above mhz: k = ceil(f * N / fs)
+    uint32_t fs_mhz = HRV_RESAMPLE_HZ * 1000UL;
+    return (uint16_t)((mhz * HRV_FFT_SIZE + fs_mhz - 1) / fs_mhz);
+  }
+
+  static int16_t saturate(int32_t v) {
+    return v > 32767 ? 32767 : v < -32768 ? -32768 : (int16_t)v;
+  }
+
+  /**
+   * cos(2 pi * p / 2^16) in Q15 from the twiddle table
+   */
+  int16_t cosine(uint16_t p) const {
+    uint32_t idx = ((uint32_t)p * HRV_FFT_SIZE) >> 16;
+    if (idx > HRV_FFT_SIZE / 2) {
+      idx = HRV_FFT_SIZE - idx;              // cos(2 pi - x) = cos(x)
+    }
+    return idx == HRV_FFT_SIZE / 2 ? -32767 : cos_table[idx];
+  }
+
+  /**
+   * Resample the newest beats onto the 4 Hz grid; re[] holds RR in 1/16 ms
+   * @return samples written, 0 if the history cannot be used
+   */
+  uint16_t resample(const BeatHistory& history) {
+    uint32_t beats = history.size();
+    if (beats < 2) {
+      return 0;
+    }
+    uint32_t end_ms = history.beatTime(0);
+    uint32_t max_span = (uint32_t)(HRV_FFT_SIZE - 1) * HRV_RESAMPLE_MS;
+
+    // Oldest beat inside the analysis window
+    uint32_t oldest = 0;
+    uint32_t gaps = 0;
+    while (oldest + 1 < beats && end_ms - history.beatTime(oldest + 1) <= max_span) {
+      if (!history.adjacent(oldest)) {
+        gaps++;
+      }
+      oldest++;
+    }
+    uint32_t span = end_ms - history.beatTime(oldest);
+    if (span < HRV_SPECTRUM_MIN_MS || gaps * 100 > (oldest + 1) * HRV_SPECTRUM_MAX_GAPS) {
+      return 0;
+    }
+
+    uint16_t n = (uint16_t)(span / HRV_RESAMPLE_MS + 1);
+    uint32_t t = end_ms - (uint32_t)(n - 1) * HRV_RESAMPLE_MS;
+    uint32_t age = oldest;
+    int64_t sum = 0;
+    for (uint16_t k = 0; k < n; k++, t += HRV_RESAMPLE_MS) {
+      while (age > 0 && history.beatTime(age - 1) <= t) {
+        age--;
+      }
+      int32_t v = (int32_t)history.rr(age) << 4;
+      if (age > 0) {
+        uint32_t t0 = history.beatTime(age);
+        uint32_t dt = history.beatTime(age - 1) - t0;
+        int32_t dv = ((int32_t)history.rr(age - 1) << 4) - v;
+        v += (int32_t)((int64_t)dv * (int32_t)(t - t0) / (int32_t)dt);
+      }
+      re[k] = (int16_t)v;                    // RR <= 2000 ms fits 1/16 ms
+      sum += v;
+    }
+    mean_q4 = (int32_t)(sum / n);
+    pending_beats = (uint16_t)(oldest + 1);
+    pending_end_ms = end_ms;
+    return n;
+  }
+
+  /**
+   * Remove the mean, scale to 14 bits and apply the Hann window
+   */
+  void applyWindow() {
+    int32_t peak = 1;
+    for (uint16_t k = 0; k < length; k++) {
+      int32_t d = re[k] - mean_q4;
+      if (d < 0) d = -d;
+      if (d > peak) peak = d;
+    }
+    // Shift left or right so that 2^13 <= peak << shift < 2^14
+    int8_t shift = 0;
+    while ((peak << shift) < (1 << 13)) shift++;
+    while (shift <= 0 && (peak >> -shift) >= (1 << 14)) shift--;
+    exponent = (int8_t)(-shift);
+
+    window_energy = 0;
+    uint32_t denom = length > 1 ? length - 1 : 1;
+    for (uint16_t k = 0; k < HRV_FFT_SIZE; k++) {
+      int32_t x = 0;
+      if (k < length) {
+        // w = 0.5 - 0.5 cos(2 pi k / (L - 1))
+        uint16_t p = (uint16_t)(((uint32_t)k << 16) / denom);
+        int32_t w = (32768 - cosine(p)) >> 1;
+        if (w > 32767) w = 32767;
+        int32_t d = re[k] - mean_q4;
+        d = shift >= 0 ? d << shift : d >> -shift;
+        x = (d * w) >> 15;
+        window_energy += (uint64_t)(w * w);
+      }
+      re[k] = (int16_t)x;
+      im[k] = 0;
+    }
+  }
+
+  void bitReverse() {
+    for (uint16_t i = 1, j = 0; i < HRV_FFT_SIZE; i++) {
+      uint16_t bit = HRV_FFT_SIZE >> 1;
+      for (; j & bit; bit >>= 1) {
+        j ^= bit;
+      }
+      j |= bit;
+      if (i < j) {
+        int16_t tr = re[i]; re[i] = re[j]; re[j] = tr;
+        int16_t ti = im[i]; im[i] = im[j]; im[j] = ti;
+      }
+    }
+  }
+
+  /**
+   * One radix-2 stage; halves the data first if it could overflow
+   */
+  void fftStage(uint8_t s) {
+    int32_t peak = 0;
+    for (uint16_t k = 0; k < HRV_FFT_SIZE; k++) {
+      int32_t a = re[k] < 0 ? -re[k] : re[k];
+      int32_t b = im[k] < 0 ? -im[k] : im[k];
+      if (a > peak) peak = a;
+      if (b > peak) peak = b;
+    }
+    // |a + w b| per component <= (1 + sqrt 2) * peak
+    uint8_t scale = peak >= (1 << 13) ? 1 : 0;
+    exponent += scale;
+
+    uint16_t half = 1 << s;
+    uint16_t stride = HRV_FFT_SIZE >> (s + 1);
+    for (uint16_t start = 0; start < HRV_FFT_SIZE; start += 2 * half) {
+      for (uint16_t j = 0; j < half; j++) {
+        int32_t c = cos_table[j * stride];
+        int32_t sn = sin_table[j * stride];
+        uint16_t a = start + j;
+        uint16_t b = a + half;
+        // t = b * e^(-i theta)
+        int32_t tr = (re[b] * c + im[b] * sn) >> 15;
+        int32_t ti = (im[b] * c - re[b] * sn) >> 15;
+        int32_t ar = re[a];
+        int32_t ai = im[a];
+        re[a] = saturate((ar + tr) >> scale);
+        im[a] = saturate((ai + ti) >> scale);
+        re[b] = saturate((ar - tr) >> scale);
+        im[b] = saturate((ai - ti) >> scale);
+      }
+    }
+  }
+
+  uint64_t bandSum(uint16_t lo, uint16_t hi) const {
+    uint64_t sum = 0;
+    for (uint16_t k = lo; k < hi && k <= HRV_FFT_SIZE / 2; k++) {
+      sum += (uint32_t)((int32_t)re[k] * re[k]) + (uint32_t)((int32_t)im[k] * im[k]);
+    }
+    return sum;
+  }
+
+  void integrateBands() {
+    // ms^2 = 2 * sum|X|^2 * 2^(2 exponent) / (16^2 * N * sum w^2)
+    float scale = 2.0f * ldexpf(1.0f, 2 * exponent) /
+                  (256.0f * HRV_FFT_SIZE * ((float)window_energy / (1UL << 30)));
+    result.vlf_ms2 = bandSum(vlf_lo, lf_lo) * scale;
+    result.lf_ms2 = bandSum(lf_lo, hf_lo) * scale;
+    result.hf_ms2 = bandSum(hf_lo, hf_hi) * scale;
+    result.lf_hf = result.hf_ms2 > 0.0f ? result.lf_ms2 / result.hf_ms2 : 0.0f;
+    float total = result.lf_ms2 + result.hf_ms2;
+    result.lf_nu = total > 0.0f ? 100.0f * result.lf_ms2 / total : 0.0f;
+    result.hf_nu = total > 0.0f ? 100.0f * result.hf_ms2 / total : 0.0f;
+    result.window_ms = (uint32_t)(length - 1) * HRV_RESAMPLE_MS;
+    result.beats = pending_beats;
+    result.computed_ms = pending_end_ms;
+    result.valid = window_energy > 0;
+  }
+
+public:
+  HrvSpectrum() :
+    phase(PHASE_IDLE),
+    stage(0),
+    length(0),
+    exponent(0),
+    mean_q4(0),
+    window_energy(0),
+    pending_beats(0),
+    pending_end_ms(0) {
+    for (uint16_t k = 0; k < HRV_FFT_SIZE / 2; k++) {
+      float a = 2.0f * 3.14159265f * k / HRV_FFT_SIZE;
+      cos_table[k] = saturate((int32_t)lroundf(cosf(a) * 32767.0f));
+      sin_table[k] = saturate((int32_t)lroundf(sinf(a) * 32767.0f));
+    }
+    vlf_lo = bin(HRV_VLF_LOW_MHZ);
+    lf_lo = bin(HRV_LF_LOW_MHZ);
+    hf_lo = bin(HRV_HF_LOW_MHZ);
+    hf_hi = bin(HRV_HF_HIGH_MHZ);
+    clear();
+  }
+
+  void clear() {
+    phase = PHASE_IDLE;
+    memset(&result, 0, sizeof(result));
+    memset(&stats, 0, sizeof(stats));
+  }
+
+  /**
+   * Start a spectrum over the newest beats (resampling happens here, so
+   * the history may change before the remaining steps run)
+   * @return false if busy or the history is too short / has too many gaps
+   */
+  bool begin(const BeatHistory& history) {
+    if (phase != PHASE_IDLE) {
+      stats.busy++;
+      return false;
+    }
+    length = resample(history);
+    if (length == 0) {
+      stats.rejected++;
+      return false;
+    }
+    stats.started++;
+    phase = PHASE_WINDOW;
+    return true;
+  }
+
+  /**
+   * Run one bounded phase
+   * @return true when this call completed a spectrum
+   */
+  bool step() {
+    switch (phase) {
+      case PHASE_IDLE:
+        return false;
+      case PHASE_WINDOW:
+        applyWindow();
+        phase = PHASE_REORDER;
+        return false;
+      case PHASE_REORDER:
+        bitReverse();
+        stage = 0;
+        phase = PHASE_FFT;
+        return false;
+      case PHASE_FFT:
+        fftStage(stage);
+        if (++stage == HRV_FFT_LOG2) {
+          phase = PHASE_BANDS;
+        }
+        return false;
+      case PHASE_BANDS:
+        integrateBands();
+        stats.completed++;
+        phase = PHASE_IDLE;
+        return true;
+    }
+    return false;
+  }
+
+  /**
+   * Run all remaining phases (host tools, tests)
+   */
+  bool finish() {
+    while (phase != PHASE_IDLE) {
+      if (step()) {
+        return true;
+      }
+    }
+    return false;
+  }
+
+  bool busy() const { return phase != PHASE_IDLE; }
+
+  /**
+   * Last completed spectrum (valid == false before the first one)
+   */
+  const HrvSpectrumResult& latest() const {
+    return result;
+  }
+
+  HrvSpectrumStats getStats() const {
+    return stats;
+  }
+};
+
+#endif // HRV_SPECTRUM_H
@@ -0,0 +1,177 @@
+/*
+ * LifeBand LED Indicator
+ * Time-driven blink patterns with priority arbitration, never blocks
+ *
+ * Replaces rgbBlink(), which held the calling task in delay() for up to
+ * two seconds per alert. A pattern is a descriptor (color, on/off time,
+ * number of cycles, priority) from a table supplied by the sketch. Each
+ * source of indication owns a channel (link status, signal quality, one
+ * per alert type); request() starts a pattern on a channel and returns
+ * immediately, tick(now) decides what the LED shows.
+ *
+ * Arbitration: among the channels with an active pattern the highest
+ * priority wins, ties go to the most recently started one. A finite
+ * pattern (cycles > 0) expires on its own and the LED falls back to the
+ * next channel; cycles == 0 holds until cancelled. Requesting the pattern
+ * that is already running on a channel does not restart it, so alerts
+ * raised on every beat do not keep the blink in its first phase.
+ *
+ * request()/cancel() may be called from any task: each channel has a
+ * one-byte mailbox, last request wins. tick() and everything it touches
+ * belong to one context (loop()). No Arduino dependency: the sketch writes
+ * the color to the NeoPixel when tick() reports a change.
+ */
+
+#ifndef LED_INDICATOR_H
+#define LED_INDICATOR_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <atomic>
+
+#define LED_MAX_CHANNELS 8
+#define LED_PATTERN_NONE 0        // table entry 0 is reserved for "off"
+#define LED_NO_REQUEST 0xFF       // mailbox empty
+
+struct LedPattern {
+  uint32_t rgb;                   // 0xRRGGBB while on
+  uint16_t on_ms;
+  uint16_t off_ms;                // 0 with cycles == 0: solid color
+  uint8_t cycles;                 // on/off repetitions, 0 = until cancelled
+  uint8_t priority;               // higher wins
+};
+
+class LedIndicator {
+private:
+  struct Channel {
+    uint8_t pattern;              // LED_PATTERN_NONE when idle
+    uint32_t start_ms;
+  };
+
+  const LedPattern* table;
+  uint8_t table_size;
+
+  std::atomic<uint8_t> mailbox[LED_MAX_CHANNELS];
+  Channel channels[LED_MAX_CHANNELS];
+  uint32_t output_rgb;
+  int8_t winner;                  // channel shown, -1 = none
+
+  /**
+   * @return true while the pattern on ch has cycles left at now
+   */
+  bool isActive(const Channel& ch, uint32_t now) const {
+    if (ch.pattern == LED_PATTERN_NONE) {
+      return false;
+    }
+    const LedPattern& p = table[ch.pattern];
+    if (p.cycles == 0) {
+      return true;
+    }
+    uint32_t period = (uint32_t)p.on_ms + p.off_ms;
+    return now - ch.start_ms < period * p.cycles;
+  }
+
+  uint32_t colorAt(const Channel& ch, uint32_t now) const {
+    const LedPattern& p = table[ch.pattern];
+    uint32_t period = (uint32_t)p.on_ms + p.off_ms;
+    if (p.off_ms == 0 || period == 0) {
+      return p.rgb;
+    }
+    return ((now - ch.start_ms) % period) < p.on_ms ? p.rgb : 0;
+  }
+
+public:
+  LedIndicator() : table(nullptr), table_size(0), output_rgb(0), winner(-1) {
+    for (uint8_t i = 0; i < LED_MAX_CHANNELS; i++) {
+      mailbox[i].store(LED_NO_REQUEST, std::memory_order_relaxed);
+      channels[i].pattern = LED_PATTERN_NONE;
+      channels[i].start_ms = 0;
+    }
+  }
+
+  /**
+   * @param patterns: descriptor table, entry 0 unused (LED_PATTERN_NONE)
+   */
+  void begin(const LedPattern* patterns, uint8_t count) {
+    table = patterns;
+    table_size = count;
+  }
+
+  /**
+   * Start a pattern on a channel (any task, never blocks)
+   */
+  void request(uint8_t channel, uint8_t pattern) {
+    if (channel < LED_MAX_CHANNELS && pattern < table_size) {
+      mailbox[channel].store(pattern, std::memory_order_release);
+    }
+  }
+
+  void cancel(uint8_t channel) {
+    request(channel, LED_PATTERN_NONE);
+  }
+
+  /**
+   * Advance to now: apply requests, expire patterns, arbitrate
+   * @return true if the LED color changed and must be written
+   */
+  bool tick(uint32_t now) {
+    if (!table) {
+      return false;
+    }
+
+    int8_t best = -1;
+    for (uint8_t i = 0; i < LED_MAX_CHANNELS; i++) {
+      Channel& ch = channels[i];
+      uint8_t req = mailbox[i].exchange(LED_NO_REQUEST, std::memory_order_acquire);
+      if (req != LED_NO_REQUEST) {
+        if (req != ch.pattern || !isActive(ch, now)) {
+          ch.pattern = req;
+          ch.start_ms = now;
+        }
+      }
+
+      if (!isActive(ch, now)) {
+        ch.pattern = LED_PATTERN_NONE;
+        continue;
+      }
+      if (best < 0) {
+        best = i;
+        continue;
+      }
+      const Channel& cur = channels[best];
+      uint8_t prio = table[ch.pattern].priority;
+      uint8_t best_prio = table[cur.pattern].priority;
+      if (prio > best_prio ||
+          (prio == best_prio && (int32_t)(ch.start_ms - cur.start_ms) > 0)) {
+        best = i;
+      }
+    }
+
+    winner = best;
+    uint32_t rgb = best >= 0 ? colorAt(channels[best], now) : 0;
+    if (rgb == output_rgb) {
+      return false;
+    }
+    output_rgb = rgb;
+    return true;
+  }
+
+  uint32_t color() const { return output_rgb; }
+  uint8_t red() const { return (uint8_t)(output_rgb >> 16); }
+  uint8_t green() const { return (uint8_t)(output_rgb >> 8); }
+  uint8_t blue() const { return (uint8_t)output_rgb; }
+
+  /**
+   * Channel currently shown, -1 if the LED is idle
+   */
+  int8_t activeChannel() const { return winner; }
+
+  /**
+   * Pattern running on a channel as of the last tick()
+   */
+  uint8_t channelPattern(uint8_t channel) const {
+    return channel < LED_MAX_CHANNELS ? channels[channel].pattern : LED_PATTERN_NONE;
+  }
+};
+
+#endif // LED_INDICATOR_H
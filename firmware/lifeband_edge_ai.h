@@ -8,41 +8,64 @@
  * 3. detectPreeclampsia() - Preeclampsia detection
  * 
  * Each method automatically falls back to rule-based detection if TFLite fails
+ *
+ * evaluate() runs them together once per feature tick: the caller passes
+ * the windowed AiFeatures vectors (feature_window.h) and says which models
+ * it wants; ModelRegistry picks the ones that are due and each runs on the
+ * backend bound to it against its own window (see model_registry.h).
+ * Per-model run, fallback and latency counters come from getStats().
+ *
+ * The models run on the dense engine (dense_inference.h) unless the
+ * sketch is built with LIFEBAND_USE_TFLM; any other InferenceBackend can
+ * be bound too, e.g. host/reference_interpreter.h.
  */
 
 #ifndef LIFEBAND_EDGE_AI_H
 #define LIFEBAND_EDGE_AI_H
 
-// Use EloquentTinyML for real TensorFlow Lite inference
+#if defined(ARDUINO) && defined(LIFEBAND_USE_TFLM)
 #include "tflite_inference_eloquent.h"
+#else
+#include "dense_inference.h"
+#endif
+#include "lifeband_types.h"
+#include "lifeband_log.h"
 
 // Result structures
 struct ArrhythmiaResult {
-  String rhythm_type;      // "Normal", "AFib", "PVC", "Bradycardia", "Tachycardia"
+  RhythmType rhythm_type;  // Normal, AFib, PVC, Bradycardia, Tachycardia (rhythmName())
   float confidence;        // 0-100
   bool is_critical;        // Requires immediate attention
 };
 
 struct AnemiaResult {
-  String risk_level;       // "Low", "Moderate", "High", "Critical"
+  RiskLevel risk_level;    // Low, Moderate, High, Critical (riskName())
   float confidence;        // 0-100
   bool alert;              // Alert flag
 };
 
 struct PreeclampsiaResult {
-  String risk_level;       // "Low", "Moderate", "High", "Critical"
+  RiskLevel risk_level;    // Low, Moderate, High, Critical (riskName())
   float confidence;        // 0-100
   bool alert;              // Alert flag
 };
 
+// One evaluate() call: only the models in `ran` carry a new result
+struct AiEvaluation {
+  uint8_t ran;             // MODEL_BIT mask
+  ArrhythmiaResult arrhythmia;
+  AnemiaResult anemia;
+  PreeclampsiaResult preeclampsia;
+};
+
 class LifeBandAI {
 private:
-  // TFLite inference engines (one per model)
-  TFLiteInferenceEngine arrhythmia_engine;
-  TFLiteInferenceEngine anemia_engine;
-  TFLiteInferenceEngine preeclampsia_engine;
+  // Inference backends (one per model, bound by the caller) and their schedule
+  ModelRegistry models;
+  uint8_t loaded_models;   // MODEL_BIT mask
   
   bool use_tflite;  // Enable/disable TFLite (falls back to rules if false)
+  float hrv_lf_hf;  // Newest LF/HF (hrv_spectrum.h) for the preeclampsia rules, 0 = none
   
   // === FALLBACK: RULE-BASED DETECTION (ORIGINAL CODE) ===
   
@@ -51,31 +74,31 @@ private:
     result.is_critical = false;
     
     if (hr < 50 && hr > 0) {
-      result.rhythm_type = "Bradycardia";
+      result.rhythm_type = RHYTHM_BRADYCARDIA;
       result.confidence = 85.0 + (50 - hr) * 0.5;
       if (hr < 40) {
         result.is_critical = true;
         result.confidence = 95.0;
       }
     } else if (hr > 100) {
-      result.rhythm_type = "Tachycardia";
+      result.rhythm_type = RHYTHM_TACHYCARDIA;
       result.confidence = 80.0 + (hr - 100) * 0.3;
       if (hr > 150) {
         result.is_critical = true;
         result.confidence = 95.0;
       }
     } else if (rr_variance > 2000 && hrv_sdnn > 80) {
-      result.rhythm_type = "AFib";
+      result.rhythm_type = RHYTHM_AFIB;
       result.confidence = 75.0;
       result.is_critical = true;
     } else if (qrs_width > 120 && hrv_sdnn < 600) {
-      result.rhythm_type = "PVC";
+      result.rhythm_type = RHYTHM_PVC;
       result.confidence = 70.0 + ((qrs_width - 120) * 0.2);
       if (qrs_width > 140) {
         result.is_critical = true;
       }
     } else {
-      result.rhythm_type = "Normal";
+      result.rhythm_type = RHYTHM_NORMAL;
       result.confidence = 90.0;
     }
     
@@ -116,24 +139,24 @@ private:
     }
     
     if (risk_score >= 70) {
-      result.risk_level = "Critical";
+      result.risk_level = RISK_CRITICAL;
       result.alert = true;
     } else if (risk_score >= 50) {
-      result.risk_level = "High";
+      result.risk_level = RISK_HIGH;
       result.alert = true;
     } else if (risk_score >= 30) {
-      result.risk_level = "Moderate";
+      result.risk_level = RISK_MODERATE;
       result.alert = false;
     } else {
-      result.risk_level = "Low";
+      result.risk_level = RISK_LOW;
       result.alert = false;
     }
     
-    result.confidence = min(risk_score, 95.0f);
+    result.confidence = (risk_score < 95.0f ? risk_score : 95.0f);
     return result;
   }
   
-  PreeclampsiaResult detectPreeclampsia_RuleBased(int bp_sys, int bp_dia, int hr, int hrv_sdnn, int spo2) {
+  PreeclampsiaResult detectPreeclampsia_RuleBased(int bp_sys, int bp_dia, int hr, int hrv_sdnn, int spo2, float lf_hf) {
     PreeclampsiaResult result;
     float risk_score = 0.0;
     
@@ -159,6 +182,12 @@ private:
       risk_score += 12.0;
     }
     
+    // Sympathetic dominance: LF/HF runs higher in preeclampsia than in
+    // normotensive pregnancy (0 while no spectrum is available)
+    if (lf_hf >= 2.5f) {
+      risk_score += 12.0;
+    }
+    
     if (spo2 < 94 && bp_sys >= 140) {
       risk_score += 15.0;
       result.alert = true;
@@ -170,52 +199,96 @@ private:
     }
     
     if (risk_score >= 80) {
-      result.risk_level = "Critical";
+      result.risk_level = RISK_CRITICAL;
       result.alert = true;
     } else if (risk_score >= 60) {
-      result.risk_level = "High";
+      result.risk_level = RISK_HIGH;
       result.alert = true;
     } else if (risk_score >= 40) {
-      result.risk_level = "Moderate";
+      result.risk_level = RISK_MODERATE;
       result.alert = false;
     } else {
-      result.risk_level = "Low";
+      result.risk_level = RISK_LOW;
       result.alert = false;
     }
     
-    result.confidence = min(risk_score, 95.0f);
+    result.confidence = (risk_score < 95.0f ? risk_score : 95.0f);
     return result;
   }
   
 public:
-  LifeBandAI() : use_tflite(true) {}
+  explicit LifeBandAI(MicrosClock micros_clock) :
+    models(micros_clock),
+    loaded_models(0),
+    use_tflite(true),
+    hrv_lf_hf(0.0f) {
+  }
   
   /**
-   * Initialize all AI models
-   * @return true if TFLite models loaded successfully (falls back to rules if false)
+   * Attach the backend for one model (before initialize())
+   */
+  bool bind(InferenceBackend* backend) {
+    return models.bind(backend);
+  }
+  
+  /**
+   * Load all bound models
+   * @return true (models that fail to load use rule-based detection)
    */
   bool initialize() {
-    Serial.println("\n[AI] Initializing Edge AI Engine...");
-    Serial.println("[AI] Loading TensorFlow Lite models...");
-    
-    bool arr_ok = arrhythmia_engine.initModel(MODEL_ARRHYTHMIA);
-    bool ane_ok = anemia_engine.initModel(MODEL_ANEMIA);
-    bool pre_ok = preeclampsia_engine.initModel(MODEL_PREECLAMPSIA);
-    
-    if (arr_ok && ane_ok && pre_ok) {
-      use_tflite = true;
-      Serial.println("[AI] ✓✓✓ TensorFlow Lite models loaded successfully!");
-      Serial.println("[AI] ✓ Arrhythmia Detection: ACTIVE");
-      Serial.println("[AI] ✓ Anemia Risk Assessment: ACTIVE");
-      Serial.println("[AI] ✓ Preeclampsia Detection: ACTIVE");
-      return true;
+    LOG_I(LOG_AI, "Initializing Edge AI Engine...");
+    loaded_models = models.begin();
+    use_tflite = loaded_models != 0;
+    for (uint8_t i = 0; i < MODEL_COUNT; i++) {
+      LOG_I(LOG_AI, "%s: %s", MODEL_REGISTRY[i].name,
+            (loaded_models & MODEL_BIT(i)) ? models.backendName((ModelType)i) : "rule-based fallback");
+    }
+    // Return TRUE anyway - rule-based AI is fully functional!
+    return true;
+  }
+  
+  /**
+   * Reload one model after its backend was given new weights
+   * @return false if it did not load (the model uses rules until it does)
+   */
+  bool reloadModel(ModelType type) {
+    bool ok = models.reload(type);
+    if (ok) {
+      loaded_models |= MODEL_BIT(type);
     } else {
-      use_tflite = false;
-      Serial.println("[AI] ⚠️ TFLite failed - using rule-based fallback");
-      Serial.println("[AI] Rule-based detection: ACTIVE");
-      // Return TRUE anyway - rule-based AI is fully functional!
-      return true;
+      loaded_models &= ~MODEL_BIT(type);
     }
+    use_tflite = loaded_models != 0;
+    return ok;
+  }
+  
+  /**
+   * Newest HRV spectrum for the preeclampsia rule fallback
+   * @param lf_hf: LF/HF ratio, 0 while no spectrum is valid
+   */
+  void setHrvBalance(float lf_hf) {
+    hrv_lf_hf = lf_hf;
+  }
+  
+  /**
+   * Run every model that is wanted and due, each on its window's features
+   * @param windows: FEATURE_WINDOW_COUNT vectors (FeatureExtractor::emit())
+   * @param wanted: MODEL_BIT mask of models with usable input (signal quality)
+   * @return results; only models in ran were evaluated
+   */
+  AiEvaluation evaluate(const AiFeatures* windows, uint8_t wanted, uint32_t now_ms) {
+    AiEvaluation result;
+    result.ran = models.due(wanted, now_ms);
+    if (result.ran & MODEL_BIT(MODEL_ARRHYTHMIA)) {
+      result.arrhythmia = detectArrhythmia(windows[MODEL_REGISTRY[MODEL_ARRHYTHMIA].window]);
+    }
+    if (result.ran & MODEL_BIT(MODEL_ANEMIA)) {
+      result.anemia = detectAnemia(windows[MODEL_REGISTRY[MODEL_ANEMIA].window]);
+    }
+    if (result.ran & MODEL_BIT(MODEL_PREECLAMPSIA)) {
+      result.preeclampsia = detectPreeclampsia(windows[MODEL_REGISTRY[MODEL_PREECLAMPSIA].window]);
+    }
+    return result;
   }
   
   /**
@@ -223,56 +296,37 @@ public:
    * Input: HR, HRV_SDNN, RR_Variance, QRS_Width, R_Peak_Amplitude
    * Output: Rhythm classification + confidence
    */
-  ArrhythmiaResult detectArrhythmia(int hr, int hrv_sdnn, int rr_variance, int qrs_width, int r_amplitude) {
+  ArrhythmiaResult detectArrhythmia(const AiFeatures& f) {
     ArrhythmiaResult result;
+    int hr = (int)f.v[AI_FEAT_ECG_HR];
     
     // Validate inputs
     if (hr == 0) {
-      result.rhythm_type = "NoSignal";
+      models.skip(MODEL_ARRHYTHMIA);
+      result.rhythm_type = RHYTHM_NO_SIGNAL;
       result.confidence = 0.0;
       result.is_critical = false;
       return result;
     }
     
-    // Use TFLite if available
-    if (use_tflite && arrhythmia_engine.isReady()) {
-      float input[5] = {
-        (float)hr,
-        (float)hrv_sdnn,
-        (float)rr_variance,
-        (float)qrs_width,
-        (float)r_amplitude
-      };
+    ModelOutput output;
+    if (models.run(MODEL_ARRHYTHMIA, f, output)) {
+      // Class index order matches RhythmType
+      result.rhythm_type = (RhythmType)output.predicted;
+      result.confidence = output.confidence;
       
-      float output[5] = {0};  // 5 classes
-      bool success = arrhythmia_engine.invoke(input, 5, output, 5);
+      // Critical if not normal and high confidence
+      result.is_critical = (output.predicted != 0 && output.confidence > 80.0);
       
-      if (success) {
-        // Get predicted class
-        int predicted_class = arrhythmia_engine.getPredictedClass(output, 5);
-        float confidence = arrhythmia_engine.getConfidence(output, 5);
-        
-        // Map class index to rhythm type
-        const char* rhythm_types[] = {"Normal", "AFib", "PVC", "Bradycardia", "Tachycardia"};
-        result.rhythm_type = rhythm_types[predicted_class];
-        result.confidence = confidence;
-        
-        // Critical if not normal and high confidence
-        result.is_critical = (predicted_class != 0 && confidence > 80.0);
-        
-        Serial.print("[AI-ARRHYTHMIA] TFLite inference -> ");
-        Serial.print(result.rhythm_type);
-        Serial.print(" (");
-        Serial.print((int)result.confidence);
-        Serial.println("%)");
-        
-        return result;
-      }
+      LOG_D(LOG_AI, "Arrhythmia: %s inference -> %s (%d%%)", models.backendName(MODEL_ARRHYTHMIA),
+            rhythmName(result.rhythm_type), (int)result.confidence);
+      return result;
     }
     
     // Fallback to rule-based
-    Serial.println("[AI-ARRHYTHMIA] Using rule-based fallback");
-    return detectArrhythmia_RuleBased(hr, hrv_sdnn, rr_variance, qrs_width, r_amplitude);
+    LOG_D(LOG_AI, "Arrhythmia: using rule-based fallback");
+    return detectArrhythmia_RuleBased(hr, (int)f.v[AI_FEAT_SDNN], (int)f.v[AI_FEAT_RR_VARIANCE],
+                                      (int)f.v[AI_FEAT_QRS_WIDTH], (int)f.v[AI_FEAT_R_AMPLITUDE]);
   }
   
   /**
@@ -280,113 +334,93 @@ public:
    * Input: SpO2, HR, HRV_SDNN, BP_Systolic, BP_Diastolic
    * Output: Risk level + confidence
    */
-  AnemiaResult detectAnemia(int spo2, int hr, int hrv_sdnn, int bp_sys, int bp_dia) {
+  AnemiaResult detectAnemia(const AiFeatures& f) {
     AnemiaResult result;
+    int spo2 = (int)f.v[AI_FEAT_SPO2];
+    int hr = (int)f.v[AI_FEAT_HR];
     
     if (spo2 == 0 && hr == 0) {
-      result.risk_level = "Unknown";
+      models.skip(MODEL_ANEMIA);
+      result.risk_level = RISK_UNKNOWN;
       result.confidence = 0.0;
       result.alert = false;
       return result;
     }
     
-    if (use_tflite && anemia_engine.isReady()) {
-      float input[5] = {
-        (float)spo2,
-        (float)hr,
-        (float)hrv_sdnn,
-        (float)bp_sys,
-        (float)bp_dia
-      };
+    ModelOutput output;
+    if (models.run(MODEL_ANEMIA, f, output)) {
+      // Class index order matches RiskLevel
+      result.risk_level = (RiskLevel)output.predicted;
+      result.confidence = output.confidence;
+      result.alert = (output.predicted >= 2);  // High or Critical
       
-      float output[4] = {0};  // 4 risk levels
-      bool success = anemia_engine.invoke(input, 5, output, 4);
-      
-      if (success) {
-        int predicted_class = anemia_engine.getPredictedClass(output, 4);
-        float confidence = anemia_engine.getConfidence(output, 4);
-        
-        const char* risk_levels[] = {"Low", "Moderate", "High", "Critical"};
-        result.risk_level = risk_levels[predicted_class];
-        result.confidence = confidence;
-        result.alert = (predicted_class >= 2);  // High or Critical
-        
-        Serial.print("[AI-ANEMIA] TFLite inference -> ");
-        Serial.print(result.risk_level);
-        Serial.print(" (");
-        Serial.print((int)result.confidence);
-        Serial.println("%)");
-        
-        return result;
-      }
+      LOG_D(LOG_AI, "Anemia: %s inference -> %s (%d%%)", models.backendName(MODEL_ANEMIA),
+            riskName(result.risk_level), (int)result.confidence);
+      return result;
     }
     
-    Serial.println("[AI-ANEMIA] Using rule-based fallback");
-    return detectAnemia_RuleBased(spo2, hr, hrv_sdnn, bp_sys, bp_dia);
+    LOG_D(LOG_AI, "Anemia: using rule-based fallback");
+    return detectAnemia_RuleBased(spo2, hr, (int)f.v[AI_FEAT_SDNN],
+                                  (int)f.v[AI_FEAT_BP_SYS], (int)f.v[AI_FEAT_BP_DIA]);
   }
   
   /**
    * PREECLAMPSIA DETECTION (TFLite or Rule-based)
-   * Input: BP_Systolic, BP_Diastolic, HR, HRV_SDNN, SpO2
+   * Input: BP_Systolic, BP_Diastolic, HR, HRV_SDNN, SpO2 (+ LF/HF for the rules)
    * Output: Risk level + confidence
    */
-  PreeclampsiaResult detectPreeclampsia(int bp_sys, int bp_dia, int hr, int hrv_sdnn, int spo2) {
+  PreeclampsiaResult detectPreeclampsia(const AiFeatures& f) {
     PreeclampsiaResult result;
+    int bp_sys = (int)f.v[AI_FEAT_BP_SYS];
+    int hr = (int)f.v[AI_FEAT_HR];
     
     if (bp_sys == 0 || hr == 0) {
-      result.risk_level = "Unknown";
+      models.skip(MODEL_PREECLAMPSIA);
+      result.risk_level = RISK_UNKNOWN;
       result.confidence = 0.0;
       result.alert = false;
       return result;
     }
     
-    if (use_tflite && preeclampsia_engine.isReady()) {
-      float input[5] = {
-        (float)bp_sys,
-        (float)bp_dia,
-        (float)hr,
-        (float)hrv_sdnn,
-        (float)spo2
-      };
+    ModelOutput output;
+    if (models.run(MODEL_PREECLAMPSIA, f, output)) {
+      // Class index order matches RiskLevel
+      result.risk_level = (RiskLevel)output.predicted;
+      result.confidence = output.confidence;
+      result.alert = (output.predicted >= 2);
       
-      float output[4] = {0};
-      bool success = preeclampsia_engine.invoke(input, 5, output, 4);
-      
-      if (success) {
-        int predicted_class = preeclampsia_engine.getPredictedClass(output, 4);
-        float confidence = preeclampsia_engine.getConfidence(output, 4);
-        
-        const char* risk_levels[] = {"Low", "Moderate", "High", "Critical"};
-        result.risk_level = risk_levels[predicted_class];
-        result.confidence = confidence;
-        result.alert = (predicted_class >= 2);
-        
-        Serial.print("[AI-PREECLAMPSIA] TFLite inference -> ");
-        Serial.print(result.risk_level);
-        Serial.print(" (");
-        Serial.print((int)result.confidence);
-        Serial.println("%)");
-        
-        return result;
-      }
+      LOG_D(LOG_AI, "Preeclampsia: %s inference -> %s (%d%%)", models.backendName(MODEL_PREECLAMPSIA),
+            riskName(result.risk_level), (int)result.confidence);
+      return result;
     }
     
-    Serial.println("[AI-PREECLAMPSIA] Using rule-based fallback");
-    return detectPreeclampsia_RuleBased(bp_sys, bp_dia, hr, hrv_sdnn, spo2);
+    LOG_D(LOG_AI, "Preeclampsia: using rule-based fallback");
+    return detectPreeclampsia_RuleBased(bp_sys, (int)f.v[AI_FEAT_BP_DIA], hr,
+                                        (int)f.v[AI_FEAT_SDNN], (int)f.v[AI_FEAT_SPO2], hrv_lf_hf);
   }
   
   bool isTFLiteActive() {
     return use_tflite;
   }
   
+  bool isModelLoaded(ModelType type) const {
+    return (loaded_models & MODEL_BIT(type)) != 0;
+  }
+  
+  ModelStats getStats(ModelType type) const {
+    return models.getStats(type);
+  }
+  
   // Alias methods for compatibility
   bool begin() {
     return initialize();
   }
   
-  String getMode() {
-    if (use_tflite) {
-      return "TFLite Inference (using rule-based fallback)";
+  const char* getMode() {
+    if (loaded_models == MODEL_BIT(MODEL_COUNT) - 1) {
+      return "Model Inference";
+    } else if (use_tflite) {
+      return "Model Inference (rule-based fallback for some models)";
     } else {
       return "Rule-based AI Detection";
     }
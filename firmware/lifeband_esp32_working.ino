@@ -14,60 +14,243 @@
   #include <Wire.h>
   #include <math.h>
   #include "MAX30105.h"
-  #include "spo2_algorithm.h"
   #include <Adafruit_NeoPixel.h>
+  #include "ecg_acquisition.h"
+  #include "ecg_filter.h"
+  #include "qrs_detector.h"
+  #include "waveform_stream.h"
+  #include "vitals_frame.h"
+  #include "lifeband_log.h"
+  #include "pipeline.h"
+  #include "led_indicator.h"
+  #include "ble_link.h"
+  #include "max30105_fifo.h"
+  #include "spo2_estimator.h"
+  #include "beat_history.h"
+  #include "feature_window.h"
+  #include "hrv_spectrum.h"
+  #include "stream_clock.h"
+  #include "ptt_engine.h"
+  #include "ppg_beat_detector.h"
+  #include "beat_quality.h"
+  #include "vitals_store.h"
+  #include "vitals_delta.h"
+  #include "alert_channel.h"
+  #include "model_slots.h"
 
    // === TENSORFLOW LITE EDGE AI ===
    // Edge AI includes
    #include "lifeband_edge_ai.h"
  
-   // Initialize Edge AI engine
-   LifeBandEdgeAI edgeAI;
+   // Initialize Edge AI engine: one backend per model, scheduled by edgeAI.
+   // Default: dense networks from models_h/<name>_dense.h on one shared
+   // DenseEngine (LIFEBAND_DENSE_MODE). LIFEBAND_USE_TFLM: TFLite Micro in
+   // one static arena planned from MODEL_REGISTRY.
+  #ifdef LIFEBAND_USE_TFLM
+   TensorArena tensorArena;
+   TFLiteInferenceEngine arrhythmiaEngine(MODEL_REGISTRY[MODEL_ARRHYTHMIA], tensorArena);
+   TFLiteInferenceEngine anemiaEngine(MODEL_REGISTRY[MODEL_ANEMIA], tensorArena);
+   TFLiteInferenceEngine preeclampsiaEngine(MODEL_REGISTRY[MODEL_PREECLAMPSIA], tensorArena);
+  #else
+   DenseEngine denseEngine;
+   DenseInferenceEngine arrhythmiaEngine(MODEL_REGISTRY[MODEL_ARRHYTHMIA], arrhythmia_risk_model_dense,
+                                         denseEngine, LIFEBAND_DENSE_MODE);
+   DenseInferenceEngine anemiaEngine(MODEL_REGISTRY[MODEL_ANEMIA], anemia_risk_model_dense,
+                                     denseEngine, LIFEBAND_DENSE_MODE);
+   DenseInferenceEngine preeclampsiaEngine(MODEL_REGISTRY[MODEL_PREECLAMPSIA], preeclampsia_risk_model_dense,
+                                           denseEngine, LIFEBAND_DENSE_MODE);
+   DenseInferenceEngine* denseEngines[MODEL_COUNT] = { &arrhythmiaEngine, &anemiaEngine, &preeclampsiaEngine };
+  #endif
+   LifeBandEdgeAI edgeAI(micros);
    bool aiEngineReady = false;
 
   #define RGB_PIN 48
   Adafruit_NeoPixel rgb(1, RGB_PIN, NEO_GRB + NEO_KHZ800);
 
+  // LED indication: requested from any task, driven by led.tick() in loop()
+  enum LedChannel {
+    LED_CH_STATUS = 0,    // boot / link state
+    LED_CH_SIGNAL = 1,    // ECG electrode quality
+    LED_CH_RHYTHM = 2,    // arrhythmia alert
+    LED_CH_ANEMIA = 3,    // anemia alert
+    LED_CH_BP = 4         // hypertension alerts
+  };
+
+  enum LedPatternId {
+    LED_READY = 1,
+    LED_CONNECTED,
+    LED_DISCONNECTED,
+    LED_WEAK_SIGNAL,
+    LED_ANEMIA,
+    LED_HYPERTENSION,
+    LED_ARRHYTHMIA,
+    LED_SEVERE_HYPERTENSION,
+    LED_PATTERN_COUNT
+  };
+
+  static const LedPattern LED_PATTERNS[LED_PATTERN_COUNT] = {
+    //  color     on   off  cycles prio
+    { 0x000000,   0,   0, 0, 0 },   // LED_PATTERN_NONE
+    { 0x0000FF, 500,   0, 1, 1 },   // LED_READY: blue for 0.5 s after boot
+    { 0x00FF00, 100,   0, 0, 1 },   // LED_CONNECTED: solid green
+    { 0xFF0000, 100,   0, 0, 1 },   // LED_DISCONNECTED: solid red
+    { 0xFFA500, 300, 300, 3, 2 },   // LED_WEAK_SIGNAL
+    { 0xFFA500, 300, 300, 2, 3 },   // LED_ANEMIA
+    { 0xFF6400, 250, 250, 3, 3 },   // LED_HYPERTENSION (>= 140/90)
+    { 0xFF0000, 200, 200, 3, 4 },   // LED_ARRHYTHMIA
+    { 0xFF0000, 200, 200, 5, 5 }    // LED_SEVERE_HYPERTENSION (>= 160/110)
+  };
+
+  LedIndicator led;
+
   static const char* DEVICE_NAME = "LIFEBAND-S3";
   static const NimBLEUUID SERVICE_UUID("c0de0001-73f3-4b4c-8f61-1aa7a6d5beef");
   static const NimBLEUUID VITALS_CHAR_UUID("c0de0002-73f3-4b4c-8f61-1aa7a6d5beef");
   static const NimBLEUUID CONFIG_CHAR_UUID("c0de0003-73f3-4b4c-8f61-1aa7a6d5beef");
+  static const NimBLEUUID WAVEFORM_CHAR_UUID("c0de0004-73f3-4b4c-8f61-1aa7a6d5beef");
+  static const NimBLEUUID ALERT_CHAR_UUID("c0de0005-73f3-4b4c-8f61-1aa7a6d5beef");
 
   NimBLEServer* bleServer = nullptr;
   NimBLECharacteristic* vitalsChar = nullptr;
-  bool deviceConnected = false;
-  bool notifyEnabled = false;
-  bool streamingEnabled = false;
+  NimBLECharacteristic* configChar = nullptr;   // also read back: model transfer status
+  NimBLECharacteristic* waveformChar = nullptr;
+  NimBLECharacteristic* alertChar = nullptr;
+  volatile bool alertNotifyEnabled = false;
+  volatile bool pendingAlertResend = false;  // Phone (re)subscribed: resend unacknowledged alerts
+  // Written by NimBLE host callbacks, read by the pipeline stages on both cores
+  std::atomic<bool> deviceConnected(false);
+  BleLinkMonitor linkMonitor;        // Reconnect and first-notify latency
+  // Raised by onDisconnect(); loop() owns link-loss handling and advertising
+  std::atomic<bool> linkLostPending(false);
+  std::atomic<uint32_t> linkLostMs(0);
+  std::atomic<bool> notifyEnabled(false);
+  std::atomic<bool> streamingEnabled(false);
 
   unsigned long lastSend = 0;
   const unsigned long SEND_INTERVAL_MS = 2000;  // 2 seconds for stable live streaming
 
-  #define ECG_PIN 4
+  // Vitals notification format (CONFIG "FORMAT BINARY|DELTA|JSON"); JSON is for debugging
+  enum VitalsFormat { FORMAT_BINARY = 0, FORMAT_JSON = 1, FORMAT_DELTA = 2 };
+  volatile VitalsFormat vitalsFormat = FORMAT_BINARY;
+  uint8_t vitalsSeq = 0;
+
+  // Delta subscription (CONFIG "FIELDS", "RATE", "KEYFRAME"), edited by the BLE task
+  VitalsDeltaConfig deltaConfig;
+  volatile bool pendingDeltaConfig = false;   // Applied by the transport stage
+  volatile bool pendingKeyframe = false;      // New subscriber: next delta frame is a keyframe
+  volatile uint32_t vitalsIntervalMs = SEND_INTERVAL_MS;  // Snapshot interval; shorter if a field asks
+  VitalsDeltaEncoder vitalsDelta;             // Transport stage
+  unsigned long lastLogged = 0;               // Last snapshot shown on serial and logged to flash
+
+  // Offline vitals log on the raw SPIFFS partition (inference stage)
+  #define BACKLOG_FRAMES_PER_STEP 2   // Replay rate: ~40 frames/s at the 50 ms inference step
+  PartitionBlockDevice vitalsFlash;
+  VitalsStore vitalsStore;
+  bool vitalsStoreReady = false;
+  uint32_t vitalsStoreBaseS = 0;      // Store time at boot (no RTC: continues the last boot's clock)
+  VitalsCursor backlogCursor;         // Oldest frame not yet delivered to the phone
+  VitalsCursor backlogStop;           // Log end when the phone came back; later frames went live
+  bool backlogPending = false;
+  bool backlogReplaying = false;
+  uint32_t backlogSent = 0;
+  uint8_t loggedAiClass[3] = {0xFF, 0xFF, 0xFF};  // Last AI result written to the log, per model
+
+  // A sector erase stalls the flash cache on both cores, ECG sampler
+  // included (~45 ms, 11 ticks at 250 Hz). Erases run one sector per beat,
+  // timed from the last R-R so the gap falls in diastole, where the filter
+  // and detector bridge it (ECG_FILTER_MAX_GAP_FILL), or when no beats
+  // arrive. At 500 Hz the ~22 missed ticks exceed the bridge and the
+  // detector relearns after each erase
+  #define FLASH_ERASE_AFTER_R_MS 120   // QRS and ST segment clear of the erase
+  #define FLASH_ERASE_GUARD_MS 100     // Erase time plus QRS onset before the next expected R
+  #define FLASH_ERASE_IDLE_MS 3000     // No ECG beats for this long: erase whenever needed
+  unsigned long lastEcgRMs = 0;        // millis() of the last R-peak
+  uint16_t lastEcgRrMs = 0;
+  unsigned long lastEcgBeatMs = 0;     // millis() the last ECG beat event was handled
+  bool flashEraseArmed = false;        // A beat arrived since the last erase
+  bool flashEraseMeasuring = false;    // Sampler gap of the last erase not read yet
+  uint32_t flashEraseMissedBefore = 0;
+  uint32_t flashErases = 0;
+  uint32_t flashEraseGapLast = 0;      // ECG ticks missed across the last erase
+  uint32_t flashEraseGapMax = 0;
 
-  MAX30105 maxSensor;
+  #define ECG_PIN 4
+  #define ECG_SAMPLE_RATE_HZ 250   // Timer-driven AD8232 sampling (250 or 500 Hz)
+  #define ECG_BLOCK_SIZE 32        // Samples drained from the ring per block
+  #define ECG_MAINS_NOTCH NOTCH_50HZ  // Local mains frequency (CONFIG "NOTCH 50|60|OFF")
+  #define ECG_DECIMATION 1         // 2 = sample at 500 Hz, detect at 250 Hz
+
+  EcgAcquisition ecgAcq;
+  bool ecgAcqReady = false;
+  EcgPreFilter ecgFilter;           // Notch + baseline removal ahead of the detector
+  volatile int pendingNotchHz = -1; // Notch change requested over BLE, applied by the DSP stage
+
+  // Raw waveform streaming (CONFIG "WAVE ON|PPG|OFF")
+  #define PPG_SAMPLE_RATE_HZ 25     // MAX30105: 100 Hz with 4-sample averaging
+  enum WaveMode { WAVE_OFF = 0, WAVE_ECG = 1, WAVE_ECG_PPG = 2 };
+  WaveMode waveMode = WAVE_OFF;
+  volatile int pendingWaveMode = -1;  // Requested over BLE, applied by the DSP stage
+  volatile uint16_t peerMtu = 23;     // Negotiated ATT MTU
+  WaveformEncoder ecgWave;
+  WaveformEncoder irWave;
+  WaveformEncoder redWave;
+  uint32_t ppgSampleIndex = 0;
+
+  #define PPG_SDA_PIN 11
+  #define PPG_SCL_PIN 12
+  #define PPG_INT_PIN -1            // MAX30105 INT (open drain); -1 = not wired, FIFO read on a timer
+  #define PPG_I2C_TIMEOUT_MS 10
+  #define PPG_GROUP_DELAY_US 15000  // 4-sample average at 100 Hz: centre 1.5 raw periods back
+
+  MAX30105 maxSensor;               // Configuration only; samples come from ppgFifo
+  WireMax30105Bus ppgBus(Wire, PPG_SDA_PIN, PPG_SCL_PIN, I2C_SPEED_FAST, PPG_I2C_TIMEOUT_MS);
+  Max30105Fifo ppgFifo;
+  StreamClock ppgClock;             // PPG sample index -> micros(), shared timebase with the ECG
+  PttEngine pttEngine;              // R-peak -> pulse foot pairing (DSP stage)
+  PpgBeatDetector ppgBeats;         // PPG systolic peaks and rate (DSP stage)
+  BeatQuality<32> ecgQuality;       // ECG beat-template SQI: 256 ms around the R-peak
+  BeatQuality<16> ppgQuality;       // PPG beat-template SQI: 640 ms around the systolic peak
   bool sensorReady = false;
-
-  uint32_t irBuffer[50];
-  uint32_t redBuffer[50];
+  volatile uint32_t latestIR = 0;   // Last MAX30105 sample, written by the DSP stage
+  volatile uint32_t latestRed = 0;
+
+  // === TASK PIPELINE ===
+  // DSP (core 1) -> dspEvents -> inference (core 0) -> vitalsQueue -> transport (core 0)
+  // DSP (core 1) -> waveQueue -> transport
+  // inference -> alertQueue -> transport (acks: BLE task -> alertChannel -> transport)
+  PipelineStage dspStage;
+  PipelineStage inferenceStage;
+  PipelineStage transportStage;
+  PipelineQueue<DspEvent, PIPELINE_EVENT_QUEUE> dspEvents;
+  PipelineQueue<VitalsFrame, PIPELINE_VITALS_QUEUE> vitalsQueue;
+  PipelineQueue<WavePacketMsg, PIPELINE_WAVE_QUEUE> waveQueue;
+  PipelineQueue<AlertEvent, PIPELINE_ALERT_QUEUE> alertQueue;
+  AlertChannel alertChannel;         // Transport stage: unacknowledged alerts, retransmission
+  bool pipelineReady = false;        // false: loop() runs the stage steps itself
+  volatile bool pendingStreamReset = false;  // CONFIG RESET, applied by the inference stage
+
+  // Uploaded models: A/B slots in the "models" partition, used in place (dense engine only)
+  PartitionBlockDevice modelFlash;
+  ModelSlots modelSlots(micros);     // Inference stage
+  PipelineQueue<ModelXferMsg, PIPELINE_MODEL_QUEUE> modelXferQueue;   // CONFIG upload frames
+  std::atomic<uint8_t> pendingModelRollback(0);  // CONFIG MODEL ROLLBACK: MODEL_BIT mask
+
+  #define SPO2_HOP_MS 500             // New SpO2/PPG HR estimate every 0.5 s
+  #define SPO2_WINDOW_S 4.0f          // DC/AC averaging window (also the warm-up)
+  Spo2Estimator spo2Estimator;        // Owned by the DSP stage
+  float perfusionIndex = 0.0f;        // IR AC/DC in %, from the last PPG window
   int32_t spo2Value = 0;
   int8_t validSPO2 = 0;
-  int32_t heartRateValue = 0;
+  int32_t heartRateValue = 0;         // SpO2 window rate; ppgHeartRate comes from the pulse detector
   int8_t validHeartRate = 0;
 
-  unsigned long lastECGPeak = 0;
-  unsigned long lastPPGPeak = 0;
-  unsigned long lastHeartBeat = 0;
   float ptt_ms = 0;
   int hrv_ms = 0;
   bool bpFromPTT = false;  // Track if BP came from PTT (more accurate)
 
   bool ecgPeakDetected = false;
-  int ecgThreshold = 600;  // Adjusted for AD8232 (typical range 0-1023 for 3.3V ADC)
-  int ecgBaseline = 512;   // Baseline for AD8232 output
-  bool autoCalibrating = true;  // Auto-calibration flag
-  unsigned long calibrationStart = 0;
-  int minECG = 4095;
-  int maxECG = 0;
+  QrsDetector qrsDetector;      // Streaming Pan-Tompkins R-peak detector
+  bool ecgLearning = true;      // Detector is (re)learning its adaptive thresholds
 
   float bp_sys = 120;
   float bp_dia = 80;
@@ -77,7 +260,7 @@
   float bp_dia_ecg = 80;
   float bp_sys_ptt = 120;
   float bp_dia_ptt = 80;
-  String bpMethodUsed = "ECG";  // Track which method was sent
+  BpMethod bpMethodUsed = BP_METHOD_ECG;  // Track which method was sent
 
   // ECG waveform analysis for BP estimation
   int ecgPeakAmplitude = 0;     // R-peak amplitude
@@ -88,7 +271,10 @@
   const int AVG_SAMPLES = 5;
   int hrHistory[AVG_SAMPLES] = {0};
   int spo2History[AVG_SAMPLES] = {0};
-  int rrIntervals[AVG_SAMPLES] = {0};  // R-R intervals for HRV
+  BeatHistory beatHistory;           // 5 minutes of R-R intervals with running HRV (inference stage)
+  FeatureExtractor featureWindows;   // 30 s / 5 min model inputs, one emission per second (inference stage)
+  HrvSpectrum hrvSpectrum;           // LF/HF over the newest 2-4 minutes, one phase per inference step
+  uint16_t beatsSinceSpectrum = 0;
   int historyIndex = 0;
 
   // Initialize with baseline values
@@ -98,195 +284,190 @@
   int ppgHeartRate = 0;    // Heart rate from MAX30105 PPG
   float ecgReliability = 0.0;  // ECG signal quality score (0-100)
   float ppgReliability = 0.0;  // PPG signal quality score (0-100)
-  String reliableSource = "NONE";  // Which sensor is more reliable
+  int ecgBeatQuality = 0;      // Running beat-template SQI (0-100) from the DSP stage
+  int ppgBeatQuality = 0;
+  unsigned long ecgQualityMs = 0;    // Time of the last scored beat
+  unsigned long ppgQualityMs = 0;
+  uint32_t aiSkippedLowQuality = 0;  // Inferences not run on poor beats
+  #define SQI_STALE_MS 3000        // No scored beat for this long: quality 0
+  #define SQI_AI_MIN 60            // Beat SQI needed to run Edge AI inference
+  HrSource reliableSource = HR_SOURCE_NONE;  // Which sensor is more reliable
 
   // === EDGE AI: ECG Arrhythmia Detection ===
-  String rhythmType = "Normal";      // AI classification: Normal, AFib, PVC, Bradycardia, Tachycardia
+  RhythmType rhythmType = RHYTHM_NORMAL;  // AI classification: Normal, AFib, PVC, Bradycardia, Tachycardia
   float rhythmConfidence = 0.0;      // AI confidence score (0-100)
   bool arrhythmiaAlert = false;      // Critical alert flag
-  int rrIntervalVariance = 0;        // R-R interval variance for irregularity detection
   unsigned long lastRhythmCheck = 0; // Last AI inference time
 
   // === EDGE AI: Pregnancy Health Monitoring ===
-  String anemiaRisk = "Low";         // Anemia risk: Low, Moderate, High, Critical
+  RiskLevel anemiaRisk = RISK_LOW;   // Anemia risk: Low, Moderate, High, Critical
   float anemiaConfidence = 0.0;      // Anemia detection confidence (0-100)
   bool anemiaAlert = false;          // Anemia alert flag
 
-  String preeclampsiaRisk = "Low";   // Preeclampsia risk: Low, Moderate, High, Critical
+  RiskLevel preeclampsiaRisk = RISK_LOW;  // Preeclampsia risk: Low, Moderate, High, Critical
   float preeclampsiaConfidence = 0.0; // Preeclampsia detection confidence (0-100)
   bool preeclampsiaAlert = false;    // Preeclampsia alert flag
 
   int maternalHealthScore = 100;     // Overall maternal health score (0-100)
-  unsigned long lastPregnancyCheck = 0; // Last pregnancy AI check
+  uint8_t activeAlerts[ALERT_SEVERE_BP + 1] = {0};  // Raised alert per AlertType: severity << 4 | value, 0 = clear
 
   void resetStreamingState();
   void startStreamingSession(const char* reason = nullptr);
   void stopStreamingSession(const char* reason = nullptr);
+  void handleLinkLoss(const char* reason, uint32_t lostAt);
+  void reportFirstNotify();
   void handleControlCommand(const String& command);
   void updateFallbackBP();
+  int currentBeatQuality(int quality, unsigned long atMs);
+  void logAiResult(uint8_t model, uint8_t resultClass, float confidence, bool alert);
+  void updateAlert(AlertType type, bool active, AlertSeverity severity, uint8_t value, float confidence);
 
   void rgbColor(uint8_t r, uint8_t g, uint8_t b) {
     rgb.setPixelColor(0, rgb.Color(r, g, b));
     rgb.show();
   }
 
-  void rgbBlink(uint8_t r, uint8_t g, uint8_t b, int times, int delayMs) {
-    for (int i = 0; i < times; i++) {
-      rgbColor(r, g, b);
-      delay(delayMs);
-      rgbColor(0, 0, 0);
-      delay(delayMs);
-    }
-  }
-
-  bool detectECGPeak(int ecgValue) {
-    static bool peakFound = false;
-    static int lastEcg = 0;
-    static int maxPeak = 0;
-    static unsigned long lastPeakTime = 0;
-    static unsigned long peakStartTime = 0;
-    
-    // Detect rising edge crossing threshold
-    if (ecgValue > ecgThreshold && lastEcg <= ecgThreshold && !peakFound) {
-      peakFound = true;
-      maxPeak = ecgValue;
-      peakStartTime = millis();
-    }
+  void handleECGBeat(const DspEvent& beat) {
+    // Beat timing comes from sample indices, immune to task scheduling jitter
+    unsigned long beatMs = beat.time_ms;
+    ecgQRSWidth = beat.qrs_ms;
+    ecgPeakAmplitude = beat.amplitude;
     
-    // Track maximum during peak
-    if (peakFound && ecgValue > maxPeak) {
-      maxPeak = ecgValue;
-    }
-    
-    // Detect falling edge - R-peak detected
-    if (peakFound && ecgValue < ecgThreshold - 100) {
-      peakFound = false;
-      unsigned long now = millis();
+    // First beat after (re)learning has no R-R interval yet
+    if (beat.rr_ms == 0) {
+      beatHistory.markGap();
+    } else {
+      int rrInterval = beat.rr_ms;
+      hrv_ms = rrInterval;
       
-      // Calculate QRS width (time from peak start to peak end)
-      ecgQRSWidth = now - peakStartTime;
-      ecgPeakAmplitude = maxPeak - ecgBaseline;
+      // Calculate instantaneous heart rate from R-R interval
+      ecgHeartRate = 60000 / rrInterval;  // Convert ms to BPM
       
-      // Ignore too-fast peaks (noise rejection - minimum 300ms between beats = 200 BPM max)
-      if (now - lastPeakTime > 300) {
-        // Calculate R-R interval
-        if (lastHeartBeat > 0) {
-          int rrInterval = now - lastHeartBeat;
-          hrv_ms = rrInterval;
-          
-          // Store R-R interval for HRV calculation
-          rrIntervals[historyIndex % AVG_SAMPLES] = rrInterval;
-          
-          // Calculate instantaneous heart rate from R-R interval
-          ecgHeartRate = 60000 / rrInterval;  // Convert ms to BPM
-          
-          // Validate heart rate range
-          if (ecgHeartRate >= 40 && ecgHeartRate <= 200) {
-            hrHistory[historyIndex % AVG_SAMPLES] = ecgHeartRate;
-            currentHR = getAverageHR();  // Update with moving average
-            lastValidHR = currentHR;
-            
-            // Only use ECG-based BP if PTT hasn't calculated recently
-            // Reset PTT flag after 5 seconds (PTT is more accurate when available)
-            static unsigned long lastPTTTime = 0;
-            if (bpFromPTT) {
-              lastPTTTime = millis();
-              bpFromPTT = false;  // Reset flag
-            }
-            
-            // Use ECG-based BP if no PTT in last 5 seconds
-            if (millis() - lastPTTTime > 5000) {
-              calculateBPFromECG();
-            }
-            
-            // Run AI arrhythmia detection every heartbeat
-            classifyCardiacRhythm();
-            
-            // Run pregnancy health AI every 5 seconds (less frequent)
-            if (millis() - lastPregnancyCheck > 5000) {
-              detectAnemia();
-              detectPreeclampsia();
-              calculateMaternalHealthScore();
-              lastPregnancyCheck = millis();
-            }
-          }
+      // Validate heart rate range
+      if (ecgHeartRate < 40 || ecgHeartRate > 200) {
+        beatHistory.markGap();    // keep implausible intervals out of HRV
+      } else {
+        // HRV statistics are updated once per beat, readers use the snapshot
+        beatHistory.add((uint16_t)rrInterval, beatMs);
+        featureWindows.addBeat(beatMs, (uint16_t)rrInterval, (uint16_t)ecgQRSWidth, (uint16_t)ecgPeakAmplitude);
+        if (++beatsSinceSpectrum >= HRV_SPECTRUM_EVERY_BEATS) {
+          beatsSinceSpectrum = 0;
+          hrvSpectrum.begin(beatHistory);   // FFT runs in later inference steps
         }
         
-        lastHeartBeat = now;
-        lastECGPeak = now;
-        lastPeakTime = now;
+        hrHistory[historyIndex % AVG_SAMPLES] = ecgHeartRate;
+        currentHR = getAverageHR();  // Update with moving average
+        lastValidHR = currentHR;
+        
+        // Only use ECG-based BP if PTT hasn't calculated recently
+        // Reset PTT flag after 5 seconds (PTT is more accurate when available)
+        static unsigned long lastPTTTime = 0;
+        if (bpFromPTT) {
+          lastPTTTime = millis();
+          bpFromPTT = false;  // Reset flag
+        }
         
-        lastEcg = ecgValue;
-        return true;
+        // Use ECG-based BP if no PTT in last 5 seconds
+        if (millis() - lastPTTTime > 5000) {
+          calculateBPFromECG();
+        }
       }
     }
     
-    lastEcg = ecgValue;
-    return false;
+    LOG_D(LOG_ECG, "✓ R-peak! HR: %d BPM, HRV: %dms, Amplitude: %d, QRS: %dms%s",
+          currentHR, hrv_ms, ecgPeakAmplitude, ecgQRSWidth,
+          (beat.flags & DSP_FLAG_SEARCH_BACK) ? " (search-back)" : "");
   }
 
-  bool detectPPGPeak(long irValue) {
-    static long lastIR = 0;
-    static long peakIR = 0;
-    static bool rising = false;
+  void processECGSample(int16_t ecgFiltered, uint32_t sampleIndex) {
+    QrsEvent beat;
+    bool isBeat = qrsDetector.process(ecgFiltered, sampleIndex, beat);
+    unsigned long sampleMs = ecgAcq.sampleTimeMs(ecgFilter.toInputIndex(sampleIndex));
     
-    if (irValue > lastIR + 500) {
-      rising = true;
-      if (irValue > peakIR) {
-        peakIR = irValue;
+    // Adaptive thresholds replace the fixed 3-second min/max calibration
+    if (ecgLearning != qrsDetector.isLearning()) {
+      ecgLearning = qrsDetector.isLearning();
+      if (ecgLearning) {
+        LOG_I(LOG_ECG, "No beats for 3s - re-learning detector thresholds...");
+      } else {
+        int range = qrsDetector.learningRange();
+        LOG_I(LOG_ECG, "✓ Detector thresholds learned | Signal level: %ld | Noise level: %ld | Range: %d",
+              (long)qrsDetector.signalLevel(), (long)qrsDetector.noiseLevel(), range);
+        
+        DspEvent learned = {};
+        learned.kind = DSP_ECG_LEARNED;
+        learned.amplitude = (int16_t)range;
+        learned.time_ms = sampleMs;
+        dspEvents.push(learned);
       }
     }
     
-    if (rising && irValue < lastIR - 500) {
-      rising = false;
-      lastPPGPeak = millis();
-      peakIR = 0;
-      lastIR = irValue;
-      return true;
+    static unsigned long lastBeatMs = 0;
+    if (isBeat) {
+      DspEvent event = {};
+      event.kind = DSP_ECG_BEAT;
+      event.flags = beat.search_back ? DSP_FLAG_SEARCH_BACK : 0;
+      event.rr_ms = (uint16_t)qrsDetector.samplesToMs(beat.rr_samples);
+      event.qrs_ms = (uint16_t)qrsDetector.samplesToMs(beat.qrs_samples);
+      event.amplitude = beat.amplitude;
+      event.time_ms = ecgAcq.sampleTimeMs(ecgFilter.toInputIndex(beat.r_index));
+      dspEvents.push(event);
+      pttEngine.addBeat(ecgAcq.sampleTimeUs(ecgFilter.toInputIndex(beat.r_index)));
+      ecgQuality.addBeat(beat.r_index);
+      lastBeatMs = sampleMs;
     }
     
-    lastIR = irValue;
-    return false;
+    // Beats are scored once the window after the R-peak has arrived
+    BeatScore score;
+    if (ecgQuality.addSample(sampleIndex, ecgFiltered, score)) {
+      DspEvent quality = {};
+      quality.kind = DSP_ECG_SQI;
+      quality.flags = score.learning ? DSP_FLAG_SQI_LEARNING : 0;
+      quality.amplitude = score.quality;
+      quality.time_ms = sampleMs;
+      dspEvents.push(quality);
+    }
+    
+    // Debug: Print raw ECG every 2 seconds if no peaks detected
+    static unsigned long lastECGDebug = 0;
+    if (!ecgLearning && sampleMs - lastECGDebug >= 2000 && sampleMs - lastBeatMs >= 2000) {
+      LOG_D(LOG_ECG, "No peaks detected. Filtered value: %d | Threshold: %ld | Noise level: %ld",
+            ecgFiltered, (long)qrsDetector.threshold(), (long)qrsDetector.noiseLevel());
+      lastECGDebug = sampleMs;
+    }
   }
 
-  void computePTTandBP() {
+  void computePTTandBP(uint32_t pttUs) {
     // Blood Pressure estimation from PTT (Pulse Transit Time)
-    // PTT = time between ECG R-peak and PPG peak at finger
+    // PTT = time between ECG R-peak and PPG pulse foot at finger (ptt_engine.h)
     // Shorter PTT = higher BP (stiffer arteries)
+    float currentPTT = pttUs / 1000.0f;
     
-    if (lastECGPeak > 0 && lastPPGPeak > lastECGPeak) {
-      unsigned long currentPTT = lastPPGPeak - lastECGPeak;
-      
-      // Validate PTT range (typical: 150-350ms for arm-to-finger)
-      if (currentPTT >= 150 && currentPTT <= 400) {
-        ptt_ms = currentPTT;
-        
-        // Empirical BP estimation formulas with added variability
-        bp_sys_ptt = 180.0 - (ptt_ms * 0.25) + random(-5, 5);   // Add ±5 mmHg variation
-        bp_dia_ptt = 110.0 - (ptt_ms * 0.15) + random(-3, 3);   // Add ±3 mmHg variation
-        
-        // Clamp to physiological ranges
-        if (bp_sys_ptt < 90) bp_sys_ptt = 90;
-        if (bp_sys_ptt > 180) bp_sys_ptt = 180;
-        if (bp_dia_ptt < 60) bp_dia_ptt = 60;
-        if (bp_dia_ptt > 120) bp_dia_ptt = 120;
-        
-        // Ensure diastolic is always lower than systolic
-        if (bp_dia_ptt >= bp_sys_ptt - 20) {
-          bp_dia_ptt = bp_sys_ptt - 25;
-        }
-        
-        bpFromPTT = true;  // Mark that BP came from PTT method
-        
-        Serial.print("[BP-PTT] PTT: ");
-        Serial.print(ptt_ms);
-        Serial.print("ms -> BP: ");
-        Serial.print((int)bp_sys_ptt);
-        Serial.print("/");
-        Serial.print((int)bp_dia_ptt);
-        Serial.println(" mmHg");
-      }
+    // Validate PTT range (typical: 150-350ms for arm-to-finger)
+    if (currentPTT < 150 || currentPTT > 400) {
+      return;
+    }
+    ptt_ms = currentPTT;
+    
+    // Empirical BP estimation formulas with added variability
+    bp_sys_ptt = 180.0 - (ptt_ms * 0.25) + random(-5, 5);   // Add ±5 mmHg variation
+    bp_dia_ptt = 110.0 - (ptt_ms * 0.15) + random(-3, 3);   // Add ±3 mmHg variation
+    
+    // Clamp to physiological ranges
+    if (bp_sys_ptt < 90) bp_sys_ptt = 90;
+    if (bp_sys_ptt > 180) bp_sys_ptt = 180;
+    if (bp_dia_ptt < 60) bp_dia_ptt = 60;
+    if (bp_dia_ptt > 120) bp_dia_ptt = 120;
+    
+    // Ensure diastolic is always lower than systolic
+    if (bp_dia_ptt >= bp_sys_ptt - 20) {
+      bp_dia_ptt = bp_sys_ptt - 25;
     }
+    
+    bpFromPTT = true;  // Mark that BP came from PTT method
+    
+    LOG_D(LOG_BP, "PTT: %.1fms -> BP: %d/%d mmHg",
+          ptt_ms, (int)bp_sys_ptt, (int)bp_dia_ptt);
   }
 
   void calculateBPFromECG() {
@@ -295,12 +476,12 @@
 
       int effectiveHR = currentHR > 0 ? currentHR : (ecgHeartRate > 0 ? ecgHeartRate : (ppgHeartRate > 0 ? ppgHeartRate : 0));
       if (effectiveHR == 0) {
-        Serial.println("[BP-ECG] Skipping update - no heart rate data");
+        LOG_D(LOG_BP, "ECG estimate skipped - no heart rate data");
         return;
       }
 
       // Calculate HRV ratio (variability indicator)
-      int hrvSDNN = calculateHRV();
+      int hrvSDNN = sdnnMs();
       int effectiveRR = hrv_ms > 0 ? hrv_ms : (60000 / effectiveHR);
       if (effectiveRR <= 0) {
         effectiveRR = 800;
@@ -364,19 +545,9 @@
         bp_dia_ecg = bp_sys_ecg - 25.0f;
       }
 
-      Serial.print("[BP-ECG] HR:");
-      Serial.print(effectiveHR);
-      Serial.print(" SDNN:");
-      Serial.print(hrvSDNN);
-      Serial.print(" Amp:");
-      Serial.print(ecgPeakAmplitude);
-      Serial.print(" QRS:");
-      Serial.print(ecgQRSWidth);
-      Serial.print("ms -> BP:");
-      Serial.print((int)bp_sys_ecg);
-      Serial.print("/");
-      Serial.print((int)bp_dia_ecg);
-      Serial.println(" mmHg");
+      LOG_D(LOG_BP, "ECG HR:%d SDNN:%d Amp:%d QRS:%dms -> BP:%d/%d mmHg",
+            effectiveHR, hrvSDNN, ecgPeakAmplitude, ecgQRSWidth,
+            (int)bp_sys_ecg, (int)bp_dia_ecg);
     }
 
 
@@ -414,60 +585,6 @@ void updateFallbackBP() {
   bp_sys_ecg = (bp_sys_ecg * 0.8f) + 0.2f * 120.0f;
   bp_dia_ecg = (bp_dia_ecg * 0.8f) + 0.2f * 80.0f;
 }
-  void updateSpO2andHR() {
-    if (!sensorReady) {
-      Serial.println("[SENSOR] Skipping update - sensor not ready");
-      return;
-    }
-    
-    Serial.println("[SENSOR] Reading MAX30102...");
-    
-    for (byte i = 0; i < 50; i++) {
-      while (maxSensor.available() == false) {
-        maxSensor.check();
-      }
-      
-      redBuffer[i] = maxSensor.getRed();
-      irBuffer[i] = maxSensor.getIR();
-      maxSensor.nextSample();
-    }
-    
-    maxim_heart_rate_and_oxygen_saturation(
-      irBuffer, 50,
-      redBuffer,
-      &spo2Value, &validSPO2,
-      &heartRateValue, &validHeartRate
-    );
-    
-    if (validHeartRate && heartRateValue > 40 && heartRateValue < 200) {
-      ppgHeartRate = heartRateValue;  // Store PPG heart rate separately
-      Serial.print("[SENSOR] Valid PPG HR detected: ");
-      Serial.println(heartRateValue);
-    }
-    
-    if (validSPO2 && spo2Value > 70 && spo2Value <= 100) {
-      spo2History[historyIndex] = spo2Value;
-      Serial.print("[SENSOR] Valid SpO2 detected: ");
-      Serial.println(spo2Value);
-    }
-    
-    historyIndex = (historyIndex + 1) % AVG_SAMPLES;
-    
-    // Update SpO2 (independent from HR)
-    int avgSPO2 = getAverageSPO2();
-    if (avgSPO2 > 0) currentSPO2 = avgSPO2;
-    
-    // Select most reliable heart rate source
-    selectReliableHeartRate();
-    
-    Serial.print("[SENSOR] Final HR: ");
-    Serial.print(currentHR);
-    Serial.print(" (from ");
-    Serial.print(reliableSource);
-    Serial.print("), SpO2: ");
-    Serial.println(currentSPO2);
-  }
-
   int getAverageHR() {
     int sum = 0;
     int count = 0;
@@ -492,35 +609,29 @@ void updateFallbackBP() {
     return count > 0 ? sum / count : 0;
   }
 
+  /**
+   * Running beat SQI, or 0 if no beat was scored recently
+   */
+  int currentBeatQuality(int quality, unsigned long atMs) {
+    return millis() - atMs < SQI_STALE_MS ? quality : 0;
+  }
+
   void calculateECGReliability() {
     // Calculate ECG signal quality based on multiple factors
     float score = 0.0;
     
-    // Factor 1: Peak amplitude consistency (0-40 points)
-    if (ecgPeakAmplitude >= 200 && ecgPeakAmplitude <= 800) {
-      score += 40.0;  // Ideal range
-    } else if (ecgPeakAmplitude >= 100 && ecgPeakAmplitude <= 1000) {
-      score += 25.0;  // Acceptable
-    } else if (ecgPeakAmplitude > 0) {
-      score += 10.0;  // Weak signal
-    }
-    
-    // Factor 2: QRS width (0-20 points)
-    if (ecgQRSWidth >= 60 && ecgQRSWidth <= 120) {
-      score += 20.0;  // Normal QRS duration
-    } else if (ecgQRSWidth > 40 && ecgQRSWidth <= 150) {
-      score += 10.0;  // Acceptable
-    }
+    // Factor 1: Beat morphology vs the learned template (0-60 points)
+    score += currentBeatQuality(ecgBeatQuality, ecgQualityMs) * 0.6f;
     
-    // Factor 3: Heart rate validity (0-20 points)
+    // Factor 2: Heart rate validity (0-20 points)
     if (ecgHeartRate >= 50 && ecgHeartRate <= 150) {
       score += 20.0;  // Normal range
     } else if (ecgHeartRate >= 40 && ecgHeartRate <= 200) {
       score += 10.0;  // Extended range
     }
     
-    // Factor 4: R-R interval consistency (0-20 points)
-    int hrvSDNN = calculateHRV();
+    // Factor 3: R-R interval consistency (0-20 points)
+    int hrvSDNN = sdnnMs();
     if (hrvSDNN > 0 && hrvSDNN < 100) {
       score += 20.0;  // Good variability, consistent beats
     } else if (hrvSDNN >= 100 && hrvSDNN < 200) {
@@ -534,25 +645,13 @@ void updateFallbackBP() {
     // Calculate PPG signal quality based on MAX30105 readings
     float score = 0.0;
     
-    // Factor 1: IR signal strength (0-30 points)
-    long irValue = sensorReady ? maxSensor.getIR() : 0;
-    if (irValue >= 50000 && irValue <= 200000) {
-      score += 30.0;  // Good finger contact
-    } else if (irValue >= 20000 && irValue <= 250000) {
-      score += 15.0;  // Acceptable
-    } else if (irValue > 10000) {
-      score += 5.0;   // Weak signal
-    }
-    
-    // Factor 2: Red signal strength (0-20 points)
-    long redValue = sensorReady ? maxSensor.getRed() : 0;
-    if (redValue >= 30000 && redValue <= 150000) {
-      score += 20.0;  // Good for SpO2
-    } else if (redValue >= 10000 && redValue <= 200000) {
-      score += 10.0;  // Acceptable
+    // Factor 1: Pulse morphology vs the learned template, with a finger
+    // on the sensor (0-50 points)
+    if (sensorReady && latestIR >= SPO2_FINGER_DC) {
+      score += currentBeatQuality(ppgBeatQuality, ppgQualityMs) * 0.5f;
     }
     
-    // Factor 3: Algorithm validity flags (0-30 points)
+    // Factor 2: Algorithm validity flags (0-30 points)
     if (validHeartRate) {
       score += 15.0;
     }
@@ -560,7 +659,7 @@ void updateFallbackBP() {
       score += 15.0;
     }
     
-    // Factor 4: Heart rate validity (0-20 points)
+    // Factor 3: Heart rate validity (0-20 points)
     if (ppgHeartRate >= 50 && ppgHeartRate <= 150) {
       score += 20.0;  // Normal range
     } else if (ppgHeartRate >= 40 && ppgHeartRate <= 200) {
@@ -577,48 +676,33 @@ void updateFallbackBP() {
     
     // Determine which sensor is more reliable
     if (ecgReliability > ppgReliability && ecgHeartRate > 0) {
-      reliableSource = "ECG";
+      reliableSource = HR_SOURCE_ECG;
       currentHR = ecgHeartRate;
     } else if (ppgReliability > ecgReliability && ppgHeartRate > 0) {
-      reliableSource = "PPG";
+      reliableSource = HR_SOURCE_PPG;
       currentHR = ppgHeartRate;
     } else if (ecgHeartRate > 0 && ppgHeartRate == 0) {
-      reliableSource = "ECG";
+      reliableSource = HR_SOURCE_ECG;
       currentHR = ecgHeartRate;
     } else if (ppgHeartRate > 0 && ecgHeartRate == 0) {
-      reliableSource = "PPG";
+      reliableSource = HR_SOURCE_PPG;
       currentHR = ppgHeartRate;
     } else if (ecgHeartRate > 0) {
       // If equal reliability, prefer ECG for medical accuracy
-      reliableSource = "ECG";
+      reliableSource = HR_SOURCE_ECG;
       currentHR = ecgHeartRate;
     } else if (ppgHeartRate > 0) {
-      reliableSource = "PPG";
+      reliableSource = HR_SOURCE_PPG;
       currentHR = ppgHeartRate;
     } else {
-      reliableSource = "NONE";
+      reliableSource = HR_SOURCE_NONE;
       currentHR = 0;
     }
     
     // Log reliability comparison
-    Serial.println("\n[RELIABILITY CHECK]");
-    Serial.print("ECG HR: ");
-    Serial.print(ecgHeartRate);
-    Serial.print(" BPM (Quality: ");
-    Serial.print(ecgReliability);
-    Serial.println("/100)");
-    
-    Serial.print("PPG HR: ");
-    Serial.print(ppgHeartRate);
-    Serial.print(" BPM (Quality: ");
-    Serial.print(ppgReliability);
-    Serial.println("/100)");
-    
-    Serial.print("Selected: ");
-    Serial.print(reliableSource);
-    Serial.print(" -> Final HR: ");
-    Serial.print(currentHR);
-    Serial.println(" BPM\n");
+    LOG_D(LOG_SYS, "Reliability: ECG %d BPM (Q%d) | PPG %d BPM (Q%d) -> %s, HR %d BPM",
+          ecgHeartRate, (int)ecgReliability, ppgHeartRate, (int)ppgReliability,
+          hrSourceName(reliableSource), currentHR);
   }
 
   void resetStreamingState() {
@@ -628,6 +712,7 @@ void updateFallbackBP() {
     ppgHeartRate = 0;
     spo2Value = 0;
     heartRateValue = 0;
+    perfusionIndex = 0.0f;
     hrv_ms = 0;
     ptt_ms = 0;
     arrhythmiaAlert = false;
@@ -641,40 +726,38 @@ void updateFallbackBP() {
     bp_dia_ecg = 80;
     bp_sys_ptt = 120;
     bp_dia_ptt = 80;
-    bpMethodUsed = "ECG";
+    bpMethodUsed = BP_METHOD_ECG;
     for (int i = 0; i < AVG_SAMPLES; i++) {
       hrHistory[i] = 0;
       spo2History[i] = 0;
-      rrIntervals[i] = 0;
     }
+    ecgBeatQuality = 0;
+    ppgBeatQuality = 0;
+    beatHistory.clear();
+    featureWindows.clear();
+    hrvSpectrum.clear();
+    edgeAI.setHrvBalance(0.0f);
+    beatsSinceSpectrum = 0;
     historyIndex = 0;
     lastSend = 0;
-    Serial.println("[STREAM] Cleared vitals history buffers");
+    LOG_I(LOG_SYS, "Cleared vitals history buffers");
   }
 
   void startStreamingSession(const char* reason) {
+    pendingKeyframe = true;
     if (!streamingEnabled) {
       streamingEnabled = true;
       lastSend = 0;
-      Serial.print("[STREAM] Vitals streaming enabled");
-      if (reason) {
-        Serial.print(" (source: ");
-        Serial.print(reason);
-        Serial.print(")");
-      }
-      Serial.print(" at ");
-      Serial.print(SEND_INTERVAL_MS / 1000);
-      Serial.println("s interval");
+      LOG_I(LOG_BLE, "Vitals streaming enabled (source: %s) at %lus interval",
+            reason ? reason : "-", (unsigned long)(SEND_INTERVAL_MS / 1000));
     } else if (reason) {
-      Serial.print("[STREAM] Streaming already active (source: ");
-      Serial.print(reason);
-      Serial.println(")");
+      LOG_I(LOG_BLE, "Streaming already active (source: %s)", reason);
     }
 
     if (!deviceConnected) {
-      Serial.println("[STREAM] Waiting for BLE connection before notifications");
+      LOG_I(LOG_BLE, "Waiting for BLE connection before notifications");
     } else if (!notifyEnabled) {
-      Serial.println("[STREAM] Waiting for notifications to be enabled before sending data");
+      LOG_I(LOG_BLE, "Waiting for notifications to be enabled before sending data");
     }
   }
 
@@ -683,13 +766,16 @@ void updateFallbackBP() {
       return;
     }
     streamingEnabled = false;
-    Serial.print("[STREAM] Vitals streaming disabled");
-    if (reason) {
-      Serial.print(" (source: ");
-      Serial.print(reason);
-      Serial.print(")");
-    }
-    Serial.println();
+    LOG_I(LOG_BLE, "Vitals streaming disabled (source: %s)", reason ? reason : "-");
+  }
+
+  /**
+   * BLE task: hand the delta subscription to transport and pick the
+   * snapshot interval it needs
+   */
+  void applyDeltaConfig() {
+    vitalsIntervalMs = vitalsFormat == FORMAT_DELTA ? deltaConfig.intervalMs(SEND_INTERVAL_MS) : SEND_INTERVAL_MS;
+    pendingDeltaConfig = true;
   }
 
   void handleControlCommand(const String& command) {
@@ -698,12 +784,11 @@ void updateFallbackBP() {
     normalized.toUpperCase();
 
     if (normalized.length() == 0) {
-      Serial.println("[CONFIG] Empty command ignored");
+      LOG_W(LOG_BLE, "Empty command ignored");
       return;
     }
 
-    Serial.print("[CONFIG] Command: ");
-    Serial.println(normalized);
+    LOG_I(LOG_BLE, "Command: %s", normalized.c_str());
 
     if (normalized == "START") {
       startStreamingSession("CONFIG START");
@@ -711,195 +796,223 @@ void updateFallbackBP() {
       stopStreamingSession("CONFIG STOP");
     } else if (normalized == "RESET") {
       stopStreamingSession("CONFIG RESET");
-      resetStreamingState();
+      pendingStreamReset = true;   // inference stage owns the vitals history
+      inferenceStage.notify();
       if (notifyEnabled) {
         startStreamingSession("CONFIG RESET");
       }
+    } else if (normalized == "FORMAT BINARY") {
+      vitalsFormat = FORMAT_BINARY;
+      applyDeltaConfig();
+      LOG_I(LOG_BLE, "Vitals format: binary frame");
+    } else if (normalized == "FORMAT DELTA") {
+      vitalsFormat = FORMAT_DELTA;
+      applyDeltaConfig();
+      LOG_I(LOG_BLE, "Vitals format: delta frames");
+    } else if (normalized == "FORMAT JSON") {
+      vitalsFormat = FORMAT_JSON;
+      applyDeltaConfig();
+      LOG_I(LOG_BLE, "Vitals format: JSON (debug)");
+    } else if (normalized.startsWith("FIELDS")) {
+      // FIELDS ALL | NONE | 0x<mask> | HR,SPO2,BP,...
+      String arg = normalized.substring(6);
+      arg.trim();
+      uint32_t mask = 0;
+      if (parseVitalsFieldMask(arg.c_str(), mask)) {
+        deltaConfig.mask = mask;
+        applyDeltaConfig();
+        LOG_I(LOG_BLE, "Delta fields: 0x%lX", (unsigned long)mask);
+      } else {
+        LOG_W(LOG_BLE, "Invalid field list: %s", arg.c_str());
+      }
+    } else if (normalized.startsWith("RATE")) {
+      // RATE <field> <ms> | CHANGE: minimum spacing of a field's updates
+      String arg = normalized.substring(4);
+      arg.trim();
+      int space = arg.indexOf(' ');
+      String name = space > 0 ? arg.substring(0, space) : arg;
+      String value = space > 0 ? arg.substring(space + 1) : String("");
+      value.trim();
+      int field = vitalsFieldIndex(name.c_str(), name.length());
+      long periodMs = value == "CHANGE" ? 0 : value.toInt();
+      if (field < 0 || (value != "CHANGE" && (periodMs < VITALS_DELTA_MIN_PERIOD_MS || periodMs > 60000))) {
+        LOG_W(LOG_BLE, "Invalid rate: %s", arg.c_str());
+      } else {
+        deltaConfig.period_ms[field] = (uint16_t)periodMs;
+        applyDeltaConfig();
+      }
+    } else if (normalized.startsWith("KEYFRAME")) {
+      // KEYFRAME <ms> | OFF
+      String arg = normalized.substring(8);
+      arg.trim();
+      long periodMs = arg == "OFF" ? 0 : arg.toInt();
+      if (arg != "OFF" && (periodMs < 1000 || periodMs > 60000)) {
+        LOG_W(LOG_BLE, "Invalid keyframe interval: %s", arg.c_str());
+      } else {
+        deltaConfig.keyframe_ms = (uint16_t)periodMs;
+        applyDeltaConfig();
+      }
+    } else if (normalized == "WAVE ON" || normalized == "WAVE ECG") {
+      pendingWaveMode = WAVE_ECG;
+    } else if (normalized == "WAVE PPG" || normalized == "WAVE ALL") {
+      pendingWaveMode = WAVE_ECG_PPG;
+    } else if (normalized == "WAVE OFF") {
+      pendingWaveMode = WAVE_OFF;
+    } else if (normalized.startsWith("MODEL ROLLBACK")) {
+      // MODEL ROLLBACK <ARRHYTHMIA|ANEMIA|PREECLAMPSIA>: reject the running uploaded image
+      String arg = normalized.substring(14);
+      arg.trim();
+      int model = -1;
+      for (uint8_t m = 0; m < MODEL_COUNT; m++) {
+        if (arg.equalsIgnoreCase(MODEL_REGISTRY[m].name)) {
+          model = m;
+        }
+      }
+      if (model < 0) {
+        LOG_W(LOG_BLE, "Unknown model: %s", arg.c_str());
+      } else {
+        pendingModelRollback.fetch_or(MODEL_BIT(model));
+        inferenceStage.notify();
+      }
+    } else if (normalized.startsWith("NOTCH")) {
+      String arg = normalized.substring(5);
+      arg.trim();
+      if (arg == "50") {
+        pendingNotchHz = NOTCH_50HZ;
+      } else if (arg == "60") {
+        pendingNotchHz = NOTCH_60HZ;
+      } else if (arg == "OFF") {
+        pendingNotchHz = NOTCH_OFF;
+      } else {
+        LOG_W(LOG_BLE, "Invalid notch setting: %s", arg.c_str());
+      }
     } else {
-      Serial.print("[CONFIG] Unknown command: ");
-      Serial.println(normalized);
+      LOG_W(LOG_BLE, "Unknown command: %s", normalized.c_str());
     }
   }
 
-  int calculateHRV() {
-    // Calculate SDNN (Standard Deviation of R-R intervals)
-    // This is a measure of heart rate variability
-    int validCount = 0;
-    long sum = 0;
-    
-    // Calculate mean
-    for (int i = 0; i < AVG_SAMPLES; i++) {
-      if (rrIntervals[i] > 0) {
-        sum += rrIntervals[i];
-        validCount++;
-      }
+  /**
+   * SDNN of the beat history window (cached per beat, free to call)
+   */
+  int sdnnMs() {
+    return (int)lroundf(beatHistory.snapshot().sdnn_ms);
+  }
+
+  /**
+   * Edge AI once per feature tick: the windowed vectors (30 s for rhythm,
+   * 5 min for pregnancy health), then every model that is due (arrhythmia
+   * each tick, pregnancy health every 5 s) back-to-back. Models are only
+   * wanted while beats look like beats; the previous result stands while
+   * the signal is poor.
+   */
+  void runEdgeAI(const AiFeatures* windows) {
+    if (!aiEngineReady) {
+      return;
     }
-    
-    if (validCount < 2) return 0;  // Need at least 2 values
-    
-    long mean = sum / validCount;
-    
-    // Calculate variance
-    long variance = 0;
-    for (int i = 0; i < AVG_SAMPLES; i++) {
-      if (rrIntervals[i] > 0) {
-        long diff = rrIntervals[i] - mean;
-        variance += (diff * diff);
-      }
+    int ecgSqi = currentBeatQuality(ecgBeatQuality, ecgQualityMs);
+    int ppgSqi = currentBeatQuality(ppgBeatQuality, ppgQualityMs);
+    uint8_t wanted = 0;
+    if (ecgSqi >= SQI_AI_MIN) {
+      wanted |= MODEL_BIT(MODEL_ARRHYTHMIA);
+    } else {
+      aiSkippedLowQuality++;
+    }
+    if (ecgSqi >= SQI_AI_MIN || ppgSqi >= SQI_AI_MIN) {
+      wanted |= MODEL_BIT(MODEL_ANEMIA) | MODEL_BIT(MODEL_PREECLAMPSIA);
     }
-    variance = variance / validCount;
-    rrIntervalVariance = variance;  // Store for AI detection
     
-    // Return standard deviation (approximation)
-    return (int)sqrt(variance);
+    AiEvaluation ai = edgeAI.evaluate(windows, wanted, millis());
+    int hrvSDNN = sdnnMs();
+    if (ai.ran & MODEL_BIT(MODEL_ARRHYTHMIA)) {
+      classifyCardiacRhythm(ai.arrhythmia, hrvSDNN);
+    }
+    if (ai.ran & MODEL_BIT(MODEL_ANEMIA)) {
+      detectAnemia(ai.anemia, hrvSDNN);
+    }
+    if (ai.ran & MODEL_BIT(MODEL_PREECLAMPSIA)) {
+      detectPreeclampsia(ai.preeclampsia, hrvSDNN);
+    }
+    if (ai.ran & (MODEL_BIT(MODEL_ANEMIA) | MODEL_BIT(MODEL_PREECLAMPSIA))) {
+      calculateMaternalHealthScore();
+    }
   }
 
-  void classifyCardiacRhythm() {
+  void classifyCardiacRhythm(const ArrhythmiaResult& result, int hrvSDNN) {
   // === TENSORFLOW LITE EDGE AI: ARRHYTHMIA DETECTION ===
-  if (!aiEngineReady || ecgHeartRate == 0) {
-    rhythmType = "NoSignal";
-    rhythmConfidence = 0.0;
-    arrhythmiaAlert = false;
-    return;
-  }
-  
-  // Call TFLite AI detection
-  int hrvSDNN = calculateHRV();
-  ArrhythmiaResult result = edgeAI.detectArrhythmia(
-    ecgHeartRate,
-    hrvSDNN,
-    rrIntervalVariance,
-    ecgQRSWidth,
-    ecgPeakAmplitude
-  );
-  
   // Update global state
   rhythmType = result.rhythm_type;
   rhythmConfidence = result.confidence;
   arrhythmiaAlert = result.is_critical;
+  logAiResult(VITALS_AI_ARRHYTHMIA, rhythmType, rhythmConfidence, arrhythmiaAlert);
+  updateAlert(ALERT_ARRHYTHMIA, arrhythmiaAlert, ALERT_CRITICAL, rhythmType, rhythmConfidence);
   
   // === LOGGING - CRITICAL ALERTS ONLY ===
   if (result.is_critical) {
-    Serial.println("\n[AI-ARRHYTHMIA] 🚨 CRITICAL ALERT");
-    Serial.print("Detected: ");
-    Serial.print(result.rhythm_type);
-    Serial.print(" (Confidence: ");
-    Serial.print((int)result.confidence);
-    Serial.println("%)");
-    Serial.print("HR: ");
-    Serial.print(ecgHeartRate);
-    Serial.print(" BPM, HRV: ");
-    Serial.print(hrvSDNN);
-    Serial.print(", QRS: ");
-    Serial.print(ecgQRSWidth);
-    Serial.println("ms");
-    Serial.println("[AI-ARRHYTHMIA] Medical attention recommended!");
-    rgbBlink(255, 0, 0, 3, 200);
+    LOG_W(LOG_AI, "🚨 ARRHYTHMIA: %s (Confidence: %d%%) HR: %d BPM, HRV: %d, QRS: %dms - medical attention recommended",
+          rhythmName(result.rhythm_type), (int)result.confidence,
+          ecgHeartRate, hrvSDNN, ecgQRSWidth);
+    led.request(LED_CH_RHYTHM, LED_ARRHYTHMIA);
   }
 }
 
-  void detectAnemia() {
+  void detectAnemia(const AnemiaResult& result, int hrvSDNN) {
   // === TENSORFLOW LITE EDGE AI: ANEMIA DETECTION ===
-  if (!aiEngineReady || (currentSPO2 == 0 && currentHR == 0)) {
-    anemiaRisk = "Unknown";
-    anemiaConfidence = 0.0;
-    anemiaAlert = false;
-    return;
-  }
-  
-  // Call TFLite AI detection
-  int hrvSDNN = calculateHRV();
-  AnemiaResult result = edgeAI.detectAnemia(
-    currentSPO2,
-    currentHR,
-    hrvSDNN,
-    (int)bp_sys,
-    (int)bp_dia
-  );
-  
   // Update global state
   anemiaRisk = result.risk_level;
   anemiaConfidence = result.confidence;
   anemiaAlert = result.alert;
+  logAiResult(VITALS_AI_ANEMIA, anemiaRisk, anemiaConfidence, anemiaAlert);
+  updateAlert(ALERT_ANEMIA, anemiaAlert, anemiaRisk == RISK_CRITICAL ? ALERT_CRITICAL : ALERT_WARNING,
+              anemiaRisk, anemiaConfidence);
   
   // === LOGGING - CRITICAL ALERTS ONLY ===
   if (result.alert) {
-    Serial.println("\n[AI-ANEMIA] 🚨 CRITICAL ALERT");
-    Serial.print("Risk Level: ");
-    Serial.print(result.risk_level);
-    Serial.print(" (Confidence: ");
-    Serial.print((int)result.confidence);
-    Serial.println("%)");
-    Serial.print("SpO2: ");
-    Serial.print(currentSPO2);
-    Serial.print("%, HR: ");
-    Serial.print(currentHR);
-    Serial.print(" BPM, HRV: ");
-    Serial.println(hrvSDNN);
-    Serial.println("[AI-ANEMIA] Immediate medical evaluation needed!");
-    Serial.println("[AI-ANEMIA] Recommend: CBC test (Hemoglobin/Hematocrit)");
-    rgbBlink(255, 165, 0, 2, 300);
+    LOG_W(LOG_AI, "🚨 ANEMIA: %s risk (Confidence: %d%%) SpO2: %d%%, HR: %d BPM, HRV: %d",
+          riskName(result.risk_level), (int)result.confidence,
+          currentSPO2, currentHR, hrvSDNN);
+    LOG_W(LOG_AI, "Anemia: immediate evaluation needed - recommend CBC (Hemoglobin/Hematocrit)");
+    led.request(LED_CH_ANEMIA, LED_ANEMIA);
   }
 }
 
-  void detectPreeclampsia() {
+  void detectPreeclampsia(const PreeclampsiaResult& result, int hrvSDNN) {
   // === TENSORFLOW LITE EDGE AI: PREECLAMPSIA DETECTION ===
-  if (!aiEngineReady || bp_sys == 0 || currentHR == 0) {
-    preeclampsiaRisk = "Unknown";
-    preeclampsiaConfidence = 0.0;
-    preeclampsiaAlert = false;
-    return;
-  }
-  
-  // Call TFLite AI detection
-  int hrvSDNN = calculateHRV();
-  PreeclampsiaResult result = edgeAI.detectPreeclampsia(
-    (int)bp_sys,
-    (int)bp_dia,
-    currentHR,
-    hrvSDNN,
-    currentSPO2
-  );
-  
   // Update global state
   preeclampsiaRisk = result.risk_level;
   preeclampsiaConfidence = result.confidence;
   preeclampsiaAlert = result.alert;
-  
-  // === REAL-TIME BP SPIKE ALERT ===
-  if (bp_sys >= 160 || bp_dia >= 110) {
-    rgbBlink(255, 0, 0, 5, 200);
-    Serial.println("\n[BP-ALERT] 🚨 SEVERE HYPERTENSION!");
-    Serial.print("BP: ");
-    Serial.print((int)bp_sys);
-    Serial.print("/");
-    Serial.print((int)bp_dia);
-    Serial.println(" mmHg - SEEK IMMEDIATE MEDICAL CARE!");
-  } else if (bp_sys >= 140 || bp_dia >= 90) {
-    rgbBlink(255, 100, 0, 3, 250);
-  }
+  logAiResult(VITALS_AI_PREECLAMPSIA, preeclampsiaRisk, preeclampsiaConfidence, preeclampsiaAlert);
+  updateAlert(ALERT_PREECLAMPSIA, preeclampsiaAlert,
+              preeclampsiaRisk == RISK_CRITICAL ? ALERT_CRITICAL : ALERT_WARNING,
+              preeclampsiaRisk, preeclampsiaConfidence);
   
   // === LOGGING - CRITICAL ALERTS ONLY ===
   if (result.alert) {
-    Serial.println("\n[AI-PREECLAMPSIA] 🚨 CRITICAL ALERT");
-    Serial.print("Risk Level: ");
-    Serial.print(result.risk_level);
-    Serial.print(" (Confidence: ");
-    Serial.print((int)result.confidence);
-    Serial.println("%)");
-    Serial.print("BP: ");
-    Serial.print((int)bp_sys);
-    Serial.print("/");
-    Serial.print((int)bp_dia);
-    Serial.print(" mmHg, HR: ");
-    Serial.print(currentHR);
-    Serial.print(" BPM, HRV: ");
-    Serial.println(hrvSDNN);
-    Serial.println("[AI-PREECLAMPSIA] Urgent medical attention required!");
-    Serial.println("[AI-PREECLAMPSIA] Recommend: BP monitoring, protein urine test");
+    LOG_W(LOG_AI, "🚨 PREECLAMPSIA: %s risk (Confidence: %d%%) BP: %d/%d mmHg, HR: %d BPM, HRV: %d",
+          riskName(result.risk_level), (int)result.confidence,
+          (int)bp_sys, (int)bp_dia, currentHR, hrvSDNN);
+    LOG_W(LOG_AI, "Preeclampsia: urgent attention required - recommend BP monitoring, protein urine test");
   }
 }
 
+  /**
+   * Inference stage: real-time BP spike alert, checked on every BP update
+   * so it does not depend on a preeclampsia model being loaded or due
+   */
+  void checkBloodPressureAlert() {
+    bool severeBP = bp_sys >= 160 || bp_dia >= 110;
+    if (severeBP && activeAlerts[ALERT_SEVERE_BP] == 0) {
+      LOG_W(LOG_BP, "🚨 SEVERE HYPERTENSION! BP: %d/%d mmHg - SEEK IMMEDIATE MEDICAL CARE!",
+            (int)bp_sys, (int)bp_dia);
+    }
+    updateAlert(ALERT_SEVERE_BP, severeBP, ALERT_CRITICAL, 0, 100);
+    if (severeBP) {
+      led.request(LED_CH_BP, LED_SEVERE_HYPERTENSION);
+    } else if (bp_sys >= 140 || bp_dia >= 90) {
+      led.request(LED_CH_BP, LED_HYPERTENSION);
+    }
+  }
+
   void calculateMaternalHealthScore() {
     // === OVERALL MATERNAL HEALTH SCORE (0-100) ===
     // Combines all AI detections into single health metric
@@ -907,18 +1020,18 @@ void updateFallbackBP() {
     int baseScore = 100;
     
     // Deduct points for each risk factor
-    if (anemiaRisk == "Critical") baseScore -= 40;
-    else if (anemiaRisk == "High") baseScore -= 30;
-    else if (anemiaRisk == "Moderate") baseScore -= 20;
-    else if (anemiaRisk == "Low-Moderate") baseScore -= 10;
+    if (anemiaRisk == RISK_CRITICAL) baseScore -= 40;
+    else if (anemiaRisk == RISK_HIGH) baseScore -= 30;
+    else if (anemiaRisk == RISK_MODERATE) baseScore -= 20;
+    else if (anemiaRisk == RISK_LOW_MODERATE) baseScore -= 10;
     
-    if (preeclampsiaRisk == "Critical") baseScore -= 40;
-    else if (preeclampsiaRisk == "High") baseScore -= 30;
-    else if (preeclampsiaRisk == "Moderate") baseScore -= 20;
-    else if (preeclampsiaRisk == "Low-Moderate") baseScore -= 10;
+    if (preeclampsiaRisk == RISK_CRITICAL) baseScore -= 40;
+    else if (preeclampsiaRisk == RISK_HIGH) baseScore -= 30;
+    else if (preeclampsiaRisk == RISK_MODERATE) baseScore -= 20;
+    else if (preeclampsiaRisk == RISK_LOW_MODERATE) baseScore -= 10;
     
     if (arrhythmiaAlert) baseScore -= 15;
-    else if (rhythmType != "Normal") baseScore -= 8;
+    else if (rhythmType != RHYTHM_NORMAL) baseScore -= 8;
     
     // Signal quality penalty
     if (ecgReliability < 50 || ppgReliability < 50) baseScore -= 5;
@@ -928,30 +1041,277 @@ void updateFallbackBP() {
     // Log only significant changes or critical scores
     static int lastScore = 100;
     if (maternalHealthScore < 50 || abs(maternalHealthScore - lastScore) > 20) {
-      Serial.print("\n[MATERNAL-HEALTH] Score: ");
-      Serial.print(maternalHealthScore);
-      Serial.println("/100");
+      LOG_I(LOG_AI, "Maternal health score: %d/100", maternalHealthScore);
       
       if (maternalHealthScore < 50) {
-        Serial.println("[MATERNAL-HEALTH] 🚨 CRITICAL - Multiple risk factors!");
+        LOG_W(LOG_AI, "🚨 Maternal health CRITICAL - multiple risk factors!");
       }
       
       lastScore = maternalHealthScore;
     }
   }
 
-  void sendVitals() {
-    if (!deviceConnected || !vitalsChar) {
+  /**
+   * DSP stage: hand a finished packet to the transport stage
+   */
+  void queueWaveformPacket(WaveformEncoder& encoder) {
+    if (!encoder.hasPacket()) {
       return;
     }
+    if (deviceConnected) {
+      static WavePacketMsg msg;
+      msg.len = (uint16_t)encoder.packetSize();
+      memcpy(msg.data, encoder.packet(), msg.len);
+      waveQueue.push(msg);
+    }
+    encoder.release();
+  }
+
+  void applyWaveMode(WaveMode mode) {
+    // Push out whatever is buffered before changing mode
+    if (waveMode != WAVE_OFF) {
+      if (ecgWave.flush()) queueWaveformPacket(ecgWave);
+      if (irWave.flush()) queueWaveformPacket(irWave);
+      if (redWave.flush()) queueWaveformPacket(redWave);
+    }
+
+    size_t payload = peerMtu > 3 ? peerMtu - 3 : WAVE_MIN_PACKET;
+    ecgWave.configure(WAVE_CH_ECG, ecgAcq.sampleRate());
+    ecgWave.setLimits(payload, ecgAcq.sampleRate() / 4);   // <= 250 ms per packet
+    irWave.configure(WAVE_CH_PPG_IR, PPG_SAMPLE_RATE_HZ);
+    irWave.setLimits(payload, PPG_SAMPLE_RATE_HZ / 2);     // <= 500 ms per packet
+    redWave.configure(WAVE_CH_PPG_RED, PPG_SAMPLE_RATE_HZ);
+    redWave.setLimits(payload, PPG_SAMPLE_RATE_HZ / 2);
+    waveMode = mode;
+
+    if (mode == WAVE_OFF) {
+      LOG_I(LOG_BLE, "Waveform streaming OFF");
+    } else {
+      LOG_I(LOG_BLE, "Waveform streaming %s, %u-byte packets",
+            mode == WAVE_ECG_PPG ? "ECG + PPG" : "ECG", (unsigned)payload);
+    }
+  }
+
+  /**
+   * Snapshot the current vitals into one frame (shared by both formats)
+   */
+  void fillVitalsFrame(VitalsFrame& f, int hrvSDNN, int ecgRaw, long irRaw, long redRaw) {
+    f.timestamp_ms = millis();
+    f.hr = vitalsClamp(currentHR, 255);
+    f.hr_ecg = vitalsClamp(ecgHeartRate, 255);
+    f.hr_ppg = vitalsClamp(ppgHeartRate, 255);
+    f.spo2 = vitalsClamp(currentSPO2, 100);
+    f.bp_sys = vitalsClamp((long)bp_sys, 255);
+    f.bp_dia = vitalsClamp((long)bp_dia, 255);
+    f.hrv_ms = vitalsClamp(hrv_ms, 65535);
+    f.hrv_sdnn = vitalsClamp(hrvSDNN, 65535);
+    f.ptt_ms = vitalsClamp((long)ptt_ms, 65535);
+    f.ecg_quality = vitalsClamp((long)ecgReliability, 100);
+    f.ppg_quality = vitalsClamp((long)ppgReliability, 100);
+    f.hr_source = reliableSource;
+    f.bp_method = bpMethodUsed;
+    f.alerts = (arrhythmiaAlert ? VITALS_ALERT_ARRHYTHMIA : 0) |
+               (anemiaAlert ? VITALS_ALERT_ANEMIA : 0) |
+               (preeclampsiaAlert ? VITALS_ALERT_PREECLAMPSIA : 0);
+    f.rhythm = rhythmType;
+    f.rhythm_confidence = vitalsClamp((long)rhythmConfidence, 100);
+    f.anemia_risk = anemiaRisk;
+    f.anemia_confidence = vitalsClamp((long)anemiaConfidence, 100);
+    f.preeclampsia_risk = preeclampsiaRisk;
+    f.preeclampsia_confidence = vitalsClamp((long)preeclampsiaConfidence, 100);
+    f.maternal_health_score = vitalsClamp(maternalHealthScore, 100);
+    f.ecg_raw = vitalsClamp(ecgRaw, 4095);
+    f.ir = vitalsClamp(irRaw, 0x3FFFF);
+    f.red = vitalsClamp(redRaw, 0x3FFFF);
+    f.flags = 0;
+    f.age_ms = 0;
+  }
+
+  /**
+   * Debug format: the original keyed JSON, built from the same snapshot
+   */
+  void sendVitalsJson(const VitalsFrame& f) {
+    StaticJsonDocument<512> doc;
+    
+    doc["hr"] = f.hr;                   // From most reliable source (ECG or PPG)
+    doc["hr_ecg"] = f.hr_ecg;           // ECG-based heart rate
+    doc["hr_ppg"] = f.hr_ppg;           // PPG-based heart rate
+    doc["hr_source"] = hrSourceName(f.hr_source);  // "ECG", "PPG", or "NONE"
+    doc["ecg_quality"] = f.ecg_quality; // ECG signal quality (0-100)
+    doc["ppg_quality"] = f.ppg_quality; // PPG signal quality (0-100)
+    doc["spo2"] = f.spo2;               // From MAX30105 algorithm
+    doc["bp_sys"] = f.bp_sys;           // Blood pressure systolic
+    doc["bp_dia"] = f.bp_dia;           // Blood pressure diastolic
+    doc["bp_method"] = bpMethodName(f.bp_method);  // Which BP method was sent
+    doc["hrv"] = f.hrv_ms;              // Latest R-R interval
+    doc["hrv_sdnn"] = f.hrv_sdnn;       // HRV variability metric
+    doc["ptt"] = f.ptt_ms;              // Pulse Transit Time
+    
+    // === EDGE AI: Arrhythmia Detection ===
+    doc["rhythm"] = rhythmName(f.rhythm);
+    doc["rhythm_confidence"] = f.rhythm_confidence;
+    doc["arrhythmia_alert"] = (f.alerts & VITALS_ALERT_ARRHYTHMIA) != 0;
+    
+    // === EDGE AI: Pregnancy Health Monitoring ===
+    doc["anemia_risk"] = riskName(f.anemia_risk);
+    doc["anemia_confidence"] = f.anemia_confidence;
+    doc["anemia_alert"] = (f.alerts & VITALS_ALERT_ANEMIA) != 0;
+    
+    doc["preeclampsia_risk"] = riskName(f.preeclampsia_risk);
+    doc["preeclampsia_confidence"] = f.preeclampsia_confidence;
+    doc["preeclampsia_alert"] = (f.alerts & VITALS_ALERT_PREECLAMPSIA) != 0;
+    
+    doc["maternal_health_score"] = f.maternal_health_score;
+    
+    doc["ecg"] = f.ecg_raw;             // Raw ECG signal (0-4095)
+    doc["ir"] = f.ir;                   // MAX30105 IR value
+    doc["red"] = f.red;                 // MAX30105 Red value
+    doc["timestamp"] = f.timestamp_ms;
+    if (f.flags & VITALS_FLAG_BUFFERED) {
+      doc["buffered"] = true;           // Replayed from the offline log
+      doc["age_ms"] = f.age_ms;
+    }
+    
+    char jsonBuffer[512];
+    size_t length = serializeJson(doc, jsonBuffer, sizeof(jsonBuffer));
+    
+    vitalsChar->setValue((const uint8_t*)jsonBuffer, length);
+    vitalsChar->notify();
+    reportFirstNotify();
+    LOG_D(LOG_BLE, "✓ JSON sent (%u bytes)", (unsigned)length);
+  }
+
+  /**
+   * Inference stage: push an alert to transport when it is first detected,
+   * or when its severity or class changes while it stays active
+   */
+  void updateAlert(AlertType type, bool active, AlertSeverity severity, uint8_t value, float confidence) {
+    uint8_t state = active ? (uint8_t)((severity << 4) | (value & 0x0F)) : 0;
+    if (state == activeAlerts[type]) {
+      return;
+    }
+    activeAlerts[type] = state;
+    if (!active) {
+      return;
+    }
+    AlertEvent event;
+    event.type = type;
+    event.severity = severity;
+    event.value = value;
+    event.confidence = vitalsClamp((long)confidence, 100);
+    event.hr = vitalsClamp(currentHR, 255);
+    event.spo2 = vitalsClamp(currentSPO2, 100);
+    event.bp_sys = vitalsClamp((long)bp_sys, 255);
+    event.bp_dia = vitalsClamp((long)bp_dia, 255);
+    event.time_ms = millis();
+    event.detect_us = micros();
+    if (!alertQueue.push(event)) {
+      LOG_W(LOG_AI, "Alert queue full - alert type %u not sent", (unsigned)type);
+    }
+  }
+
+  /**
+   * Seconds on the offline log's clock
+   */
+  uint32_t vitalsStoreTime() {
+    return vitalsStoreBaseS + millis() / 1000;
+  }
+
+  /**
+   * Inference stage: log an AI result when its class or alert changes; every
+   * logged frame already carries the latest results, so this keeps the
+   * transitions without a flash write per inference
+   */
+  void logAiResult(uint8_t model, uint8_t resultClass, float confidence, bool alert) {
+    uint8_t state = (uint8_t)(resultClass | (alert ? 0x80 : 0));
+    if (!vitalsStoreReady || loggedAiClass[model] == state) {
+      return;
+    }
+    loggedAiClass[model] = state;
+    uint8_t payload[4] = { model, resultClass, (uint8_t)vitalsClamp((long)confidence, 100), (uint8_t)(alert ? 1 : 0) };
+    vitalsStore.append(VITALS_RECORD_AI, vitalsStoreTime(), payload, sizeof(payload));
+  }
+
+  /**
+   * Inference stage: append a frame to the offline log and track the span
+   * the phone has not seen
+   */
+  void logVitalsFrame(const VitalsFrame& frame, bool linkUp) {
+    if (!vitalsStoreReady) {
+      return;
+    }
+    if (!linkUp && !backlogPending) {
+      backlogCursor = vitalsStore.end();
+      backlogPending = true;
+      backlogSent = 0;
+    } else if (linkUp && backlogPending && !backlogReplaying) {
+      backlogStop = vitalsStore.end();     // frames from here on are sent live
+      backlogReplaying = true;
+    }
+    uint8_t buf[VITALS_FRAME_SIZE];
+    encodeVitalsFrame(frame, 0, buf, sizeof(buf));
+    vitalsStore.append(VITALS_RECORD_FRAME, vitalsStoreTime(), buf + VITALS_FRAME_HEADER, VITALS_FRAME_PAYLOAD_V1);
+  }
+
+  /**
+   * Inference stage: send frames logged while the phone was away, a few per
+   * step, always leaving a queue slot for the live frame
+   */
+  void replayVitalsBacklog() {
+    VitalsRecord record;
+    uint8_t sent = 0;
+    while (sent < BACKLOG_FRAMES_PER_STEP && vitalsQueue.depth() + 1 < vitalsQueue.capacity()) {
+      if (!vitalsStore.next(backlogCursor, record, &backlogStop)) {
+        LOG_I(LOG_SYS, "Offline backlog delivered: %lu frames", (unsigned long)backlogSent);
+        backlogPending = false;
+        backlogReplaying = false;
+        return;
+      }
+      if (record.kind != VITALS_RECORD_FRAME) {
+        continue;
+      }
+      uint8_t buf[VITALS_FRAME_HEADER + VITALS_STORE_PAYLOAD];
+      buf[0] = VITALS_FRAME_MAGIC;
+      buf[1] = 1;
+      buf[2] = record.length;
+      buf[3] = 0;
+      memcpy(buf + VITALS_FRAME_HEADER, record.payload, record.length);
+      VitalsFrame frame;
+      if (!decodeVitalsFrame(buf, VITALS_FRAME_HEADER + record.length, frame)) {
+        continue;
+      }
+      frame.flags |= VITALS_FLAG_BUFFERED;
+      frame.age_ms = (vitalsStoreTime() - record.time_s) * 1000UL;
+      vitalsQueue.push(frame);
+      backlogSent++;
+      sent++;
+    }
+  }
+
+  /**
+   * Inference stage: snapshot the vitals every vitalsIntervalMs and hand them
+   * to transport while the phone is listening; show and log them every
+   * SEND_INTERVAL_MS
+   */
+  void publishVitals() {
+    bool linkUp = deviceConnected && notifyEnabled && vitalsChar;
+    if (linkUp && backlogReplaying) {
+      replayVitalsBacklog();
+    } else if (!linkUp) {
+      backlogReplaying = false;             // resume from the cursor next time
+    }
 
     unsigned long now = millis();
     
-    // Send every 2 seconds
-    if (now - lastSend < SEND_INTERVAL_MS) {
+    // Every 2 seconds, faster if a delta subscription asks for it
+    if (now - lastSend < vitalsIntervalMs) {
       return;
     }
     lastSend = now;
+    bool logTick = lastLogged == 0 || now - lastLogged >= SEND_INTERVAL_MS;
+    if (logTick) {
+      lastLogged = now;
+    }
     
     // === BP SELECTION: Only ECG or PTT (no PPG BP) ===
     // Prefer PTT if available (more accurate), otherwise use ECG
@@ -959,117 +1319,703 @@ void updateFallbackBP() {
     if (ptt_ms > 0 && ptt_ms >= 150 && ptt_ms <= 400) {
       bp_sys = bp_sys_ptt;
       bp_dia = bp_dia_ptt;
-      bpMethodUsed = "PTT";
+      bpMethodUsed = BP_METHOD_PTT;
     } else {
       bp_sys = bp_sys_ecg;
       bp_dia = bp_dia_ecg;
-      bpMethodUsed = "ECG";
+      bpMethodUsed = BP_METHOD_ECG;
     }
+    checkBloodPressureAlert();
     
     
     // === SERIAL MONITOR VITALS DISPLAY ===
-    Serial.println("\n========== VITALS DISPLAY ==========");
-    Serial.print("HR: ");
-    Serial.print(currentHR);
-    Serial.print(" BPM (Source: ");
-    Serial.print(reliableSource);
-    Serial.println(")");
-    
-    Serial.print("SpO2: ");
-    Serial.print(currentSPO2);
-    Serial.println("%");
-    
-    Serial.println("\n--- BP CALCULATIONS ---");
-    Serial.print("[BP-ECG]  ");
-    Serial.print((int)bp_sys_ecg);
-    Serial.print("/");
-    Serial.print((int)bp_dia_ecg);
-    Serial.println(" mmHg");
+    int hrvSDNN = sdnnMs();
+    const HrvSnapshot& hrv = beatHistory.snapshot();
+    if (logTick) {
+      LOG_I(LOG_SYS, "HR: %d BPM (%s) | SpO2: %d%% | HRV: %dms, SDNN: %d | Score: %d/100",
+            currentHR, hrSourceName(reliableSource), currentSPO2,
+            hrv_ms, hrvSDNN, maternalHealthScore);
+      LOG_D(LOG_ECG, "HRV over %lu s (%u beats): SDNN %.1f ms, RMSSD %.1f ms, pNN50 %.1f%%",
+            (unsigned long)(hrv.span_ms / 1000), (unsigned)hrv.beats,
+            hrv.sdnn_ms, hrv.rmssd_ms, hrv.pnn50);
+      if (ptt_ms > 0 && ptt_ms >= 150 && ptt_ms <= 400) {
+        LOG_I(LOG_BP, "Sent %d/%d mmHg (%s) | ECG %d/%d | PTT %d/%d (PTT: %dms)",
+              (int)bp_sys, (int)bp_dia, bpMethodName(bpMethodUsed),
+              (int)bp_sys_ecg, (int)bp_dia_ecg, (int)bp_sys_ptt, (int)bp_dia_ptt, (int)ptt_ms);
+      } else {
+        LOG_I(LOG_BP, "Sent %d/%d mmHg (%s) | ECG %d/%d | PTT not available",
+              (int)bp_sys, (int)bp_dia, bpMethodName(bpMethodUsed),
+              (int)bp_sys_ecg, (int)bp_dia_ecg);
+      }
+    }
     
-    if (ptt_ms > 0 && ptt_ms >= 150 && ptt_ms <= 400) {
-      Serial.print("[BP-PTT]  ");
-      Serial.print((int)bp_sys_ptt);
-      Serial.print("/");
-      Serial.print((int)bp_dia_ptt);
-      Serial.print(" mmHg (PTT: ");
-      Serial.print((int)ptt_ms);
-      Serial.println("ms)");
+    // Raw sensor values as last seen by the DSP stage (no ADC/I2C access here)
+    int ecgRaw = ecgAcq.latestValue();
+    long irRaw = sensorReady ? (long)latestIR : 0;
+    long redRaw = sensorReady ? (long)latestRed : 0;
+    
+    VitalsFrame frame;
+    fillVitalsFrame(frame, hrvSDNN, ecgRaw, irRaw, redRaw);
+    if (logTick) {
+      logVitalsFrame(frame, linkUp);
+    }
+    if (linkUp) {
+      vitalsQueue.push(frame);
+    }
+  }
+
+  void handleDspEvent(const DspEvent& event) {
+    switch (event.kind) {
+      case DSP_ECG_BEAT:
+        handleECGBeat(event);
+        lastEcgBeatMs = millis();
+        lastEcgRMs = event.time_ms;
+        lastEcgRrMs = event.rr_ms;
+        flashEraseArmed = true;
+        break;
+        
+      case DSP_ECG_LEARNED:
+        // Alert if signal is too weak
+        if (event.amplitude < 100) {
+          LOG_W(LOG_ECG, "WARNING: Weak signal! Check electrode connections.");
+          led.request(LED_CH_SIGNAL, LED_WEAK_SIGNAL);
+        }
+        break;
+        
+      case DSP_PTT:
+        computePTTandBP(event.ptt_us);
+        break;
+        
+      case DSP_ECG_SQI:
+        ecgBeatQuality = event.amplitude;
+        ecgQualityMs = millis();
+        break;
+        
+      case DSP_PPG_SQI:
+        ppgBeatQuality = event.amplitude;
+        ppgQualityMs = millis();
+        break;
+        
+      case DSP_PPG_BEAT:
+        // The pulse detector is the only PPG heart rate source; the SpO2
+        // window's rate stays in heartRateValue
+        if (event.hr > 40 && event.hr < 200) {
+          ppgHeartRate = event.hr;
+          LOG_D(LOG_PPG, "PPG HR: %d", ppgHeartRate);
+          selectReliableHeartRate();
+        }
+        break;
+        
+      case DSP_PPG_WINDOW: {
+        validHeartRate = (event.flags & DSP_FLAG_HR_VALID) ? 1 : 0;
+        validSPO2 = (event.flags & DSP_FLAG_SPO2_VALID) ? 1 : 0;
+        heartRateValue = event.hr;
+        spo2Value = event.spo2;
+        perfusionIndex = event.amplitude / 100.0f;
+        
+        // Feed PPG-derived HR into history if ECG isn’t providing data
+        if (ecgHeartRate == 0 && ppgHeartRate > 0) {
+          hrHistory[historyIndex] = ppgHeartRate;
+        }
+
+        if (validSPO2 && spo2Value > 70 && spo2Value <= 100) {
+          spo2History[historyIndex] = spo2Value;
+          int avgSPO2 = getAverageSPO2();
+          if (avgSPO2 > 0) {
+            currentSPO2 = avgSPO2;
+            LOG_D(LOG_PPG, "SpO2: %d%% (PI %.2f%%)", currentSPO2, perfusionIndex);
+          }
+        }
+
+        historyIndex = (historyIndex + 1) % AVG_SAMPLES;
+
+        if (validHeartRate || validSPO2) {
+          selectReliableHeartRate();
+        }
+        break;
+      }
+    }
+  }
+
+  /**
+   * DSP stage: process one MAX30105 sample from the FIFO ring
+   * @param sampleMs: millis() the sample was taken
+   * @param sampleUs: micros() the sample was taken (PPG clock)
+   */
+  void processPPGSample(uint32_t red, uint32_t ir, uint32_t sampleMs, uint32_t sampleUs) {
+    latestRed = red;
+    latestIR = ir;
+    
+    if (waveMode == WAVE_ECG_PPG) {
+      if (irWave.add(ppgSampleIndex, (int32_t)ir)) queueWaveformPacket(irWave);
+      if (redWave.add(ppgSampleIndex, (int32_t)red)) queueWaveformPacket(redWave);
+    }
+    ppgSampleIndex++;
+    
+    // Pair queued R-peaks with the pulse foot that follows them
+    // (absorption rises with blood volume, so the pulse is -IR)
+    PttMeasurement ptt;
+    if (pttEngine.addPpg(sampleUs, -(int32_t)ir, ptt) && (ptt.flags & PTT_FLAG_ACCEPTED) &&
+        ir >= SPO2_FINGER_DC) {
+      DspEvent transit = {};
+      transit.kind = DSP_PTT;
+      transit.ptt_us = ptt.ptt_us;
+      transit.time_ms = sampleMs;
+      dspEvents.push(transit);
+    }
+    
+    // Streaming SpO2 / PPG HR / perfusion, one estimate per hop;
+    // start from the new DC level when a finger is placed
+    static bool fingerOn = false;
+    bool finger = ir >= SPO2_FINGER_DC;
+    if (finger && !fingerOn) {
+      spo2Estimator.reset();
+      ppgBeats.reset();
+      ppgQuality.reset();
+    }
+    fingerOn = finger;
+    
+    // Systolic peaks on every sample: per-beat interval and median rate
+    PpgBeat beat;
+    if (ppgBeats.process(-(int32_t)ir, beat) && finger) {
+      DspEvent pulse = {};
+      pulse.kind = DSP_PPG_BEAT;
+      pulse.rr_ms = beat.ibi_ms;
+      pulse.hr = (int16_t)lroundf(ppgBeats.rateBpm());
+      pulse.time_ms = sampleMs - beat.lag_ms;
+      dspEvents.push(pulse);
+      ppgQuality.addBeat(ppgSampleIndex - 1 - (beat.lag_ms * PPG_SAMPLE_RATE_HZ + 500) / 1000);
+    }
+    
+    // Pulse shape is scored on the band-passed signal the peaks came from
+    float filtered = ppgBeats.filtered();
+    if (filtered > 32767.0f) filtered = 32767.0f;
+    if (filtered < -32768.0f) filtered = -32768.0f;
+    BeatScore score;
+    if (ppgQuality.addSample(ppgSampleIndex - 1, (int16_t)lroundf(filtered), score) && finger) {
+      DspEvent quality = {};
+      quality.kind = DSP_PPG_SQI;
+      quality.flags = score.learning ? DSP_FLAG_SQI_LEARNING : 0;
+      quality.amplitude = score.quality;
+      quality.time_ms = sampleMs;
+      dspEvents.push(quality);
+    }
+    
+    Spo2Estimate estimate;
+    if (spo2Estimator.add(red, ir, estimate)) {
+      DspEvent window = {};
+      window.kind = DSP_PPG_WINDOW;
+      window.flags = ((estimate.flags & SPO2_FLAG_HR_VALID) ? DSP_FLAG_HR_VALID : 0) |
+                     ((estimate.flags & SPO2_FLAG_SPO2_VALID) ? DSP_FLAG_SPO2_VALID : 0);
+      window.hr = (int16_t)lroundf(estimate.heart_rate);
+      window.spo2 = (int16_t)lroundf(estimate.spo2);
+      window.amplitude = (int16_t)vitalsClamp(lroundf(estimate.perfusion_index * 100.0f), 32767);
+      window.time_ms = sampleMs;
+      dspEvents.push(window);
+    }
+  }
+
+  /**
+   * DSP stage: burst-read the MAX30105 FIFO if due (I2C stays on this core)
+   */
+  void pollPPGSensor() {
+    ppgFifo.service(micros());
+    
+    // Read-time estimates steer the PPG clock; samples are timed by index
+    uint32_t nowUs = micros();
+    uint32_t nowMs = millis();
+    PpgSample sample;
+    while (ppgFifo.pop(sample)) {
+      ppgClock.observe(sample.index, sample.time_us);
+      uint32_t sampleUs = ppgClock.timeUs(sample.index);
+      processPPGSample(sample.red, sample.ir, nowMs - (int32_t)(nowUs - sampleUs) / 1000, sampleUs);
+    }
+  }
+
+  // ==================== PIPELINE STAGES ====================
+
+  /**
+   * Core 1: apply DSP config, poll the PPG sensor, filter and detect ECG beats
+   */
+  void dspStep(void* arg) {
+    // Waveform mode changes arrive on the BLE task
+    if (pendingWaveMode >= 0) {
+      applyWaveMode((WaveMode)pendingWaveMode);
+      pendingWaveMode = -1;
+    }
+    
+    // Notch changes arrive on the BLE task; apply them between blocks
+    if (pendingNotchHz >= 0) {
+      // Output indices continue past the change; the detector and the SQI
+      // template restart on the re-primed signal
+      ecgFilter.setNotch((MainsNotch)pendingNotchHz);
+      qrsDetector.reset();
+      ecgQuality.reset();
+      if (pendingNotchHz == NOTCH_OFF) {
+        LOG_I(LOG_ECG, "Mains notch set to OFF");
+      } else {
+        LOG_I(LOG_ECG, "Mains notch set to %d Hz", (int)pendingNotchHz);
+      }
+      pendingNotchHz = -1;
+    }
+    
+    if (sensorReady) {
+      pollPPGSensor();
+    }
+    
+    // Fallback: poll the ADC here if the sampling timer could not start
+    if (!ecgAcqReady) {
+      uint32_t due = ecgAcq.ticksDue(micros());
+      if (due > 0) {
+        ecgAcq.onTicks(due, micros(), analogRead(ECG_PIN));
+      }
+    }
+    
+    // Drain fixed-rate ECG samples captured by the acquisition task,
+    // filter them block-wise and feed the R-peak detector
+    static EcgSample ecgBlock[ECG_BLOCK_SIZE];
+    static EcgSample ecgFiltered[ECG_BLOCK_SIZE];
+    size_t ecgCount;
+    while ((ecgCount = ecgAcq.readBlock(ecgBlock, ECG_BLOCK_SIZE)) > 0) {
+      if (waveMode != WAVE_OFF) {
+        for (size_t i = 0; i < ecgCount; i++) {
+          if (ecgWave.add(ecgBlock[i].index, ecgBlock[i].value)) {
+            queueWaveformPacket(ecgWave);
+          }
+        }
+      }
+      size_t filteredCount = ecgFilter.process(ecgBlock, ecgCount, ecgFiltered);
+      for (size_t i = 0; i < filteredCount; i++) {
+        processECGSample(ecgFiltered[i].value, ecgFiltered[i].index);
+      }
+    }
+  }
+
+  /**
+   * Put a model's newest usable slot (or its built-in weights) into service.
+   * An image the engine refuses is rejected and the previous one tried, so
+   * this always ends on something that loads. Logs the swap time and the
+   * RAM it used: heap low-water mark and inference stack headroom.
+   */
+  void activateStoredModel(ModelType type, const char* reason) {
+  #ifndef LIFEBAND_USE_TFLM
+    uint32_t heapBefore = ESP.getFreeHeap();
+    unsigned long start = micros();
+    bool stored = modelSlots.select(type);
+    denseEngines[type]->useNetwork(modelSlots.network(type));
+    while (!edgeAI.reloadModel(type) && stored) {
+      modelSlots.reject(type);
+      stored = modelSlots.select(type);
+      denseEngines[type]->useNetwork(modelSlots.network(type));
+    }
+    unsigned long elapsed = micros() - start;
+    ModelStats model = edgeAI.getStats(type);
+    modelSlots.startTrial(type, model.runs, model.fallbacks);
+    if (stored) {
+      LOG_I(LOG_AI, "%s model v%lu from slot %c (%s) in %lu us | heap %lu -> %lu B (min %lu), layer table %lu B, stack headroom %lu B",
+            MODEL_REGISTRY[type].name, (unsigned long)modelSlots.activeVersion(type),
+            'A' + modelSlots.activeSlot(type) % MODEL_SLOTS_PER_MODEL, reason, elapsed,
+            (unsigned long)heapBefore, (unsigned long)ESP.getFreeHeap(), (unsigned long)ESP.getMinFreeHeap(),
+            (unsigned long)modelSlots.getStats().swap_ram, (unsigned long)inferenceStage.stackHeadroom());
     } else {
-      Serial.println("[BP-PTT]  Not available");
-    }
-    
-    Serial.print("\n[BP-SENT] ");
-    Serial.print((int)bp_sys);
-    Serial.print("/");
-    Serial.print((int)bp_dia);
-    Serial.print(" mmHg (Method: ");
-    Serial.print(bpMethodUsed);
-    Serial.println(")");
-    
-    Serial.print("\nHRV: ");
-    Serial.print(hrv_ms);
-    Serial.print("ms, SDNN: ");
-    int hrvSDNN = calculateHRV();
-    Serial.println(hrvSDNN);
-    
-    Serial.print("Maternal Health Score: ");
-    Serial.print(maternalHealthScore);
-    Serial.println("/100");
-    Serial.println("====================================\n");
-    
-    
-    // Read raw sensor values
-    int ecgRaw = analogRead(ECG_PIN);
-    long irRaw = sensorReady ? maxSensor.getIR() : 0;
-    long redRaw = sensorReady ? maxSensor.getRed() : 0;
-    
-    // Build JSON payload
-    StaticJsonDocument<384> doc;
-    
-    doc["hr"] = currentHR;              // From most reliable source (ECG or PPG)
-    doc["hr_ecg"] = ecgHeartRate;       // ECG-based heart rate
-    doc["hr_ppg"] = ppgHeartRate;       // PPG-based heart rate
-    doc["hr_source"] = reliableSource;  // Which source was used ("ECG", "PPG", or "NONE")
-    doc["ecg_quality"] = (int)ecgReliability;  // ECG signal quality (0-100)
-    doc["ppg_quality"] = (int)ppgReliability;  // PPG signal quality (0-100)
-    doc["spo2"] = currentSPO2;          // From MAX30105 algorithm
-    doc["bp_sys"] = (int)bp_sys;        // Blood pressure systolic (randomly selected)
-    doc["bp_dia"] = (int)bp_dia;        // Blood pressure diastolic (randomly selected)
-    doc["bp_method"] = bpMethodUsed;    // Which BP method was sent
-    doc["hrv"] = hrv_ms;                // Latest R-R interval
-    doc["hrv_sdnn"] = calculateHRV();   // HRV variability metric
-    doc["ptt"] = (int)ptt_ms;           // Pulse Transit Time
+      LOG_I(LOG_AI, "%s model: built-in weights (%s)", MODEL_REGISTRY[type].name, reason);
+    }
+  #endif
+  }
+
+  void publishModelTransferStatus() {
+    uint8_t status[MODEL_XFER_STATUS_SIZE];
+    encodeModelTransferStatus(modelSlots.transferStatus(), status);
+    if (configChar) {
+      configChar->setValue(status, sizeof(status));
+    }
+  }
+
+  /**
+   * Inference stage: apply upload frames, rollbacks and trial results
+   */
+  void serviceModelSlots() {
+    static ModelXferMsg msg;
+    while (modelXferQueue.pop(msg)) {
+      if (modelSlots.apply(msg)) {
+        const ModelXferStatus& xfer = modelSlots.transferStatus();
+        ModelType type = (ModelType)xfer.model;
+        activateStoredModel(type, "upload");
+        if (modelSlots.activeSlot(type) != type * MODEL_SLOTS_PER_MODEL + xfer.slot) {
+          modelSlots.uploadNotActivated();
+        }
+      }
+      publishModelTransferStatus();
+    }
     
-    // === EDGE AI: Arrhythmia Detection ===
-    doc["rhythm"] = rhythmType;         // AI classification: Normal, AFib, PVC, etc.
-    doc["rhythm_confidence"] = (int)rhythmConfidence;  // AI confidence (0-100)
-    doc["arrhythmia_alert"] = arrhythmiaAlert;  // Critical alert flag
+    uint8_t rollback = pendingModelRollback.exchange(0);
+    for (uint8_t m = 0; m < MODEL_COUNT; m++) {
+      ModelType type = (ModelType)m;
+      if ((rollback & MODEL_BIT(m)) && modelSlots.activeSlot(type) >= 0) {
+        modelSlots.reject(type);
+        activateStoredModel(type, "rollback");
+      }
+      ModelStats model = edgeAI.getStats(type);
+      if (!modelSlots.checkTrial(type, model.runs, model.fallbacks)) {
+        LOG_W(LOG_AI, "%s model v%lu failed its trial - rolling back", MODEL_REGISTRY[m].name,
+              (unsigned long)modelSlots.activeVersion(type));
+        modelSlots.reject(type);
+        activateStoredModel(type, "trial failed");
+      }
+    }
+  }
+
+  /**
+   * Inference stage: run at most one pending sector erase per beat (a model
+   * upload's slot first, then the vitals log), in the diastole of the
+   * current cycle, and measure the ECG ticks it cost on the
+   * next step, once the sampler has caught up. Beat events arrive after the
+   * filter delay, so the cycle phase is extrapolated from the last R-R
+   */
+  void serviceFlashErase() {
+    if (flashEraseMeasuring) {
+      flashEraseMeasuring = false;
+      flashEraseGapLast = ecgAcq.getStats().missed_ticks - flashEraseMissedBefore;
+      if (flashEraseGapLast > flashEraseGapMax) {
+        flashEraseGapMax = flashEraseGapLast;
+        LOG_D(LOG_SYS, "Flash erase: %lu ECG ticks missed (max so far)", (unsigned long)flashEraseGapMax);
+      }
+    }
+    bool slotErase = modelSlots.needsErase();
+    if (!slotErase && (!vitalsStoreReady || !vitalsStore.needsPrepare())) {
+      return;
+    }
+    unsigned long now = millis();
+    if (now - lastEcgBeatMs < FLASH_ERASE_IDLE_MS) {
+      if (!flashEraseArmed || lastEcgRrMs == 0) {
+        return;
+      }
+      uint32_t phase = (uint32_t)(now - lastEcgRMs) % lastEcgRrMs;
+      if (phase < FLASH_ERASE_AFTER_R_MS || phase + FLASH_ERASE_GUARD_MS > lastEcgRrMs) {
+        return;
+      }
+    }
+    flashEraseArmed = false;
+    flashEraseMissedBefore = ecgAcq.getStats().missed_ticks;
+    if (slotErase) {
+      modelSlots.serviceErase();
+      publishModelTransferStatus();
+    } else {
+      vitalsStore.prepare();
+    }
+    flashErases++;
+    flashEraseMeasuring = true;
+  }
+
+  /**
+   * Core 0: turn DSP events into vitals and AI results
+   */
+  void inferenceStep(void* arg) {
+    if (pendingStreamReset) {
+      resetStreamingState();
+      pendingStreamReset = false;
+    }
+    serviceModelSlots();
     
-    // === EDGE AI: Pregnancy Health Monitoring ===
-    doc["anemia_risk"] = anemiaRisk;    // Anemia risk level
-    doc["anemia_confidence"] = (int)anemiaConfidence;  // Anemia confidence
-    doc["anemia_alert"] = anemiaAlert;  // Anemia critical alert
+    DspEvent event;
+    while (dspEvents.pop(event)) {
+      handleDspEvent(event);
+    }
+    serviceFlashErase();
+    
+    // Model inputs on a fixed cadence, whatever the beat rate
+    unsigned long now = millis();
+    if (featureWindows.due(now)) {
+      featureWindows.addVitals(now, currentHR, currentSPO2, bp_sys, bp_dia);
+      runEdgeAI(featureWindows.emit(now));
+    }
     
-    doc["preeclampsia_risk"] = preeclampsiaRisk;  // Preeclampsia risk level
-    doc["preeclampsia_confidence"] = (int)preeclampsiaConfidence;  // Confidence
-    doc["preeclampsia_alert"] = preeclampsiaAlert;  // Preeclampsia critical alert
+    // One bounded spectrum phase per step keeps beat handling responsive
+    if (hrvSpectrum.step()) {
+      const HrvSpectrumResult& lfhf = hrvSpectrum.latest();
+      LOG_D(LOG_ECG, "HRV spectrum over %lu s: LF %.0f ms2, HF %.0f ms2, LF/HF %.2f",
+            (unsigned long)(lfhf.window_ms / 1000), lfhf.lf_ms2, lfhf.hf_ms2, lfhf.lf_hf);
+      edgeAI.setHrvBalance(lfhf.valid ? lfhf.lf_hf : 0.0f);  // preeclampsia rules
+    }
     
-    doc["maternal_health_score"] = maternalHealthScore;  // Overall health (0-100)
+    publishVitals();
+  }
+
+  void reportFirstNotify() {
+    uint32_t latency = linkMonitor.onNotify(millis());
+    if (latency > 0) {
+      LOG_I(LOG_BLE, "First notify %lu ms after %s", (unsigned long)latency,
+            linkMonitor.isReconnect() ? "reconnect" : "connect");
+    }
+  }
+
+  /**
+   * Core 0: the only stage that calls notify()
+   */
+  void transportStep(void* arg) {
+    // Alerts first: pushed as soon as they are detected, resent until acknowledged
+    AlertEvent alert;
+    while (alertQueue.pop(alert)) {
+      alertChannel.accept(alert, millis());
+    }
+    if (pendingAlertResend) {
+      pendingAlertResend = false;
+      alertChannel.resendAll(millis());
+    }
+    if (deviceConnected && alertNotifyEnabled && alertChar) {
+      uint8_t alertFrame[ALERT_FRAME_SIZE];
+      size_t length;
+      while ((length = alertChannel.poll(millis(), micros(), alertFrame, sizeof(alertFrame))) > 0) {
+        alertChar->setValue(alertFrame, length);
+        alertChar->notify();
+      }
+    }
     
-    doc["ecg"] = ecgRaw;                // Raw ECG signal (0-4095)
-    doc["ir"] = (int)irRaw;             // MAX30105 IR value
-    doc["red"] = (int)redRaw;           // MAX30105 Red value
-    doc["timestamp"] = millis();
+    static WavePacketMsg packet;
+    while (waveQueue.pop(packet)) {
+      if (deviceConnected && waveformChar) {
+        waveformChar->setValue(packet.data, packet.len);
+        waveformChar->notify();
+        reportFirstNotify();
+      }
+    }
     
-    String jsonString;
-    serializeJson(doc, jsonString);
+    if (pendingDeltaConfig) {
+      pendingDeltaConfig = false;            // cleared first: a write during the copy is applied again
+      vitalsDelta.configure(deltaConfig);
+    }
+    if (pendingKeyframe) {
+      pendingKeyframe = false;
+      vitalsDelta.forceKeyframe();
+    }
     
-    // Send notification - SEND RAW JSON
-    vitalsChar->setValue(jsonString.c_str());
-    vitalsChar->notify();
-    Serial.print("[BLE] ✓ Data sent (");
-    Serial.print(jsonString.length());
-    Serial.println(" bytes)\n");
+    VitalsFrame frame;
+    while (vitalsQueue.pop(frame)) {
+      if (!deviceConnected || !vitalsChar) {
+        continue;
+      }
+      if (vitalsFormat == FORMAT_JSON) {
+        sendVitalsJson(frame);
+        continue;
+      }
+      if (vitalsFormat == FORMAT_DELTA && !(frame.flags & VITALS_FLAG_BUFFERED)) {
+        uint8_t delta[VITALS_DELTA_SIZE];
+        size_t length = vitalsDelta.encode(frame, frame.timestamp_ms, vitalsSeq, delta, sizeof(delta));
+        if (length == 0) {
+          continue;                          // nothing changed
+        }
+        vitalsSeq++;
+        vitalsChar->setValue(delta, length);
+        vitalsChar->notify();
+        reportFirstNotify();
+        LOG_D(LOG_BLE, "✓ Delta sent (%u bytes)", (unsigned)length);
+        continue;
+      }
+      uint8_t payload[VITALS_FRAME_SIZE];
+      size_t length = encodeVitalsFrame(frame, vitalsSeq++, payload, sizeof(payload));
+      vitalsChar->setValue(payload, length);
+      vitalsChar->notify();
+      reportFirstNotify();
+      LOG_D(LOG_BLE, "✓ Frame sent (%u bytes)", (unsigned)length);
+    }
+  }
+
+  bool startPipeline() {
+    dspEvents.setConsumer(&inferenceStage);
+    vitalsQueue.setConsumer(&transportStage);
+    waveQueue.setConsumer(&transportStage);
+    alertQueue.setConsumer(&transportStage);
+    modelXferQueue.setConsumer(&inferenceStage);
+    
+    // Consumers first, so nothing is produced into a queue nobody drains.
+    // Every stage is started even if one fails, so loop() can run all steps.
+    bool transportOk = transportStage.start("transport", transportStep, nullptr, PIPELINE_TRANSPORT_IDLE_MS,
+                                            PIPELINE_TRANSPORT_CORE, PIPELINE_TRANSPORT_PRIORITY, PIPELINE_TRANSPORT_STACK);
+    bool inferenceOk = inferenceStage.start("inference", inferenceStep, nullptr, PIPELINE_INFER_IDLE_MS,
+                                            PIPELINE_INFER_CORE, PIPELINE_INFER_PRIORITY, PIPELINE_INFER_STACK);
+    bool dspOk = dspStage.start("dsp", dspStep, nullptr, ecgAcqReady ? PIPELINE_DSP_IDLE_MS : 1,
+                                PIPELINE_DSP_CORE, PIPELINE_DSP_PRIORITY, PIPELINE_DSP_STACK);
+    if (transportOk && inferenceOk && dspOk) {
+      return true;
+    }
+    dspStage.stop();
+    inferenceStage.stop();
+    transportStage.stop();
+    return false;
+  }
+
+  /**
+   * Boot memory budget: model working memory (the static TFLM arena as
+   * budgeted and as used, or the dense engine scratch), heap, and stack
+   * headroom of the stage tasks and loop()
+   */
+  void reportMemoryBudget() {
+  #ifdef LIFEBAND_USE_TFLM
+    LOG_I(LOG_SYS, "Memory: tensor arena %lu B static, %lu B used by loaded models",
+          (unsigned long)TensorArena::size(), (unsigned long)tensorArena.totalUsed());
+    for (uint8_t m = 0; m < MODEL_COUNT; m++) {
+      ArenaRegion region = tensorArena.plan((ModelType)m);
+      LOG_I(LOG_SYS, "  %-12s @%5lu  %5lu B budget, %5lu B used", MODEL_REGISTRY[m].name,
+            (unsigned long)region.offset, (unsigned long)region.size, (unsigned long)region.used);
+      if (tensorArena.overBudget() & MODEL_BIT(m)) {
+        LOG_E(LOG_SYS, "  %s uses %lu B of a %lu B provisional arena budget - raise MODEL_ARENA_BUDGET",
+              MODEL_REGISTRY[m].name, (unsigned long)region.used, (unsigned long)region.size);
+      }
+    }
+  #else
+    LOG_I(LOG_SYS, "Memory: dense engine %lu B static scratch, weights in flash",
+          (unsigned long)sizeof(DenseEngine));
+  #endif
+    LOG_I(LOG_SYS, "Memory: heap %lu/%lu B free (min %lu, largest block %lu)",
+          (unsigned long)ESP.getFreeHeap(), (unsigned long)ESP.getHeapSize(),
+          (unsigned long)ESP.getMinFreeHeap(), (unsigned long)ESP.getMaxAllocHeap());
+    LOG_I(LOG_SYS, "Memory: stack headroom dsp %lu/%u, inference %lu/%u, transport %lu/%u, loop %lu B",
+          (unsigned long)dspStage.stackHeadroom(), (unsigned)PIPELINE_DSP_STACK,
+          (unsigned long)inferenceStage.stackHeadroom(), (unsigned)PIPELINE_INFER_STACK,
+          (unsigned long)transportStage.stackHeadroom(), (unsigned)PIPELINE_TRANSPORT_STACK,
+          (unsigned long)uxTaskGetStackHighWaterMark(nullptr));
+  }
+
+  void logPipelineStats() {
+    QueueStats ev = dspEvents.getStats();
+    QueueStats vq = vitalsQueue.getStats();
+    QueueStats wq = waveQueue.getStats();
+    StageStats dsp = dspStage.getStats();
+    StageStats inf = inferenceStage.getStats();
+    LOG_D(LOG_SYS, "Pipeline events %lu (drop %lu, depth max %lu, lat avg/max %lu/%lu us) | vitals drop %lu | wave drop %lu, depth max %lu",
+          (unsigned long)ev.pushed, (unsigned long)ev.dropped, (unsigned long)ev.high_water,
+          (unsigned long)ev.mean_latency_us, (unsigned long)ev.max_latency_us,
+          (unsigned long)vq.dropped, (unsigned long)wq.dropped, (unsigned long)wq.high_water);
+    LOG_D(LOG_SYS, "Stage run avg/max: dsp %lu/%lu us, inference %lu/%lu us | stack headroom dsp %lu, inference %lu, transport %lu B",
+          (unsigned long)dsp.mean_run_us, (unsigned long)dsp.max_run_us,
+          (unsigned long)inf.mean_run_us, (unsigned long)inf.max_run_us,
+          (unsigned long)dspStage.stackHeadroom(), (unsigned long)inferenceStage.stackHeadroom(),
+          (unsigned long)transportStage.stackHeadroom());
+
+    if (ecgAcqReady) {
+      AcquisitionStats acqStats = ecgAcq.getStats();
+      LOG_D(LOG_ECG, "ACQ: %u Hz, missed %lu, overruns %lu, latency max/avg %lu/%lu us | %lu flash erases, gap last/max %lu/%lu ticks",
+            (unsigned)ecgAcq.sampleRate(), (unsigned long)acqStats.missed_ticks,
+            (unsigned long)acqStats.overruns, (unsigned long)acqStats.max_latency_us,
+            (unsigned long)acqStats.mean_latency_us, (unsigned long)flashErases,
+            (unsigned long)flashEraseGapLast, (unsigned long)flashEraseGapMax);
+    }
+    if (sensorReady) {
+      PpgFifoStats ppg = ppgFifo.getStats();
+      LOG_D(LOG_PPG, "FIFO: %lu samples in %lu bursts (%lu irq, %lu timer), overflow %lu, ring overrun %lu, i2c err %lu (timeout %lu), recoveries %lu, max %lu us",
+            (unsigned long)ppg.samples, (unsigned long)ppg.bursts, (unsigned long)ppg.interrupts,
+            (unsigned long)ppg.timer_reads, (unsigned long)ppg.fifo_overflows, (unsigned long)ppg.ring_overruns,
+            (unsigned long)ppg.i2c_errors, (unsigned long)ppg.i2c_timeouts, (unsigned long)ppg.recoveries,
+            (unsigned long)ppg.max_service_us);
+      StreamClockStats clock = ppgClock.getStats();
+      PttStats ptt = pttEngine.getStats();
+      LOG_D(LOG_BP, "PTT: %lu beats, %lu accepted, %lu outliers, %lu no foot, %lu dropped | median %lu us | PPG clock %ld ppm, step %ld us",
+            (unsigned long)ptt.beats, (unsigned long)ptt.accepted, (unsigned long)ptt.outliers,
+            (unsigned long)ptt.no_foot, (unsigned long)ptt.dropped, (unsigned long)pttEngine.medianUs(),
+            (long)clock.rate_error_ppm, (long)clock.last_step_us);
+      PpgBeatStats pulse = ppgBeats.getStats();
+      LOG_D(LOG_PPG, "PPG beats: %lu (%lu after a gap), %lu refractory | %.1f BPM, envelope %.0f",
+            (unsigned long)pulse.beats, (unsigned long)pulse.gaps, (unsigned long)pulse.refractory,
+            ppgBeats.rateBpm(), ppgBeats.envelopeLevel());
+    }
+    BeatQualityStats ecgSqiStats = ecgQuality.getStats();
+    BeatQualityStats ppgSqiStats = ppgQuality.getStats();
+    LOG_D(LOG_SYS, "Beat SQI: ECG %u (%lu scored, %lu poor, %lu relearns) | PPG %u (%lu scored, %lu poor, %lu relearns) | AI skipped %lu",
+          (unsigned)ecgQuality.quality(), (unsigned long)ecgSqiStats.scored, (unsigned long)ecgSqiStats.poor,
+          (unsigned long)ecgSqiStats.relearns, (unsigned)ppgQuality.quality(), (unsigned long)ppgSqiStats.scored,
+          (unsigned long)ppgSqiStats.poor, (unsigned long)ppgSqiStats.relearns, (unsigned long)aiSkippedLowQuality);
+    for (uint8_t m = 0; m < MODEL_COUNT; m++) {
+      ModelStats model = edgeAI.getStats((ModelType)m);
+      LOG_D(LOG_AI, "%s model: %s, %lu runs, %lu fallbacks, %lu skipped | invoke last/avg/max %lu/%lu/%lu us",
+            MODEL_REGISTRY[m].name, model.loaded ? "loaded" : "rules", (unsigned long)model.runs,
+            (unsigned long)model.fallbacks, (unsigned long)model.skipped,
+            (unsigned long)model.last_us, (unsigned long)model.mean_us, (unsigned long)model.max_us);
+    }
+    FeatureWindowStats windowStats = featureWindows.getStats();
+    const AiFeatures& shortWindow = featureWindows.latest(FEATURE_WINDOW_SHORT);
+    LOG_D(LOG_AI, "Features: %lu emitted, %lu beats, %lu late, %lu restarts | 30 s: HR %.1f, SDNN %.1f ms, QRS %.1f ms",
+          (unsigned long)windowStats.emitted, (unsigned long)windowStats.beats,
+          (unsigned long)windowStats.late, (unsigned long)windowStats.restarts,
+          shortWindow.v[AI_FEAT_ECG_HR], shortWindow.v[AI_FEAT_SDNN], shortWindow.v[AI_FEAT_QRS_WIDTH]);
+    if (modelSlots.isMounted()) {
+      ModelSlotStats slots = modelSlots.getStats();
+      LOG_D(LOG_AI, "Model slots: %lu activations (last %lu us, max %lu us), %lu uploads, %lu rollbacks, %lu invalid",
+            (unsigned long)slots.activations, (unsigned long)slots.last_activate_us,
+            (unsigned long)slots.max_activate_us, (unsigned long)slots.uploads,
+            (unsigned long)slots.rollbacks, (unsigned long)slots.invalid);
+    }
+    if (waveMode != WAVE_OFF) {
+      WaveStreamStats waveStats = ecgWave.getStats();
+      LOG_D(LOG_BLE, "Waveform: %lu ECG packets, %.2f B/sample, dropped %lu",
+            (unsigned long)waveStats.packets,
+            waveStats.samples ? (double)waveStats.bytes / waveStats.samples : 0.0,
+            (unsigned long)waveStats.dropped);
+    }
+    LinkStats link = linkMonitor.getStats();
+    if (link.connects > 0) {
+      LOG_D(LOG_BLE, "Link: %lu connects, %lu drops | readvertise last/max %lu/%lu ms | first notify last/avg/max %lu/%lu/%lu ms",
+            (unsigned long)link.connects, (unsigned long)link.disconnects,
+            (unsigned long)link.readvertise.last_ms, (unsigned long)link.readvertise.max_ms,
+            (unsigned long)link.first_notify.last_ms, (unsigned long)link.first_notify.mean_ms,
+            (unsigned long)link.first_notify.max_ms);
+    }
+    AlertStats alerts = alertChannel.getStats();
+    if (alerts.raised > 0) {
+      LOG_D(LOG_BLE, "Alerts: %lu raised, %lu sent (%lu retransmits), %lu acked, %u pending, %lu evicted | detect->notify last/avg/max %lu/%lu/%lu us | ack avg/max %lu/%lu ms",
+            (unsigned long)alerts.raised, (unsigned long)alerts.sent, (unsigned long)alerts.retransmits,
+            (unsigned long)alerts.acked, (unsigned)alertChannel.pendingCount(), (unsigned long)alerts.evicted,
+            (unsigned long)alerts.notify.last_us, (unsigned long)alerts.notify.mean_us, (unsigned long)alerts.notify.max_us,
+            (unsigned long)(alerts.ack.mean_us / 1000), (unsigned long)(alerts.ack.max_us / 1000));
+    }
+    if (vitalsFormat == FORMAT_DELTA) {
+      VitalsDeltaStats delta = vitalsDelta.getStats();
+      LOG_D(LOG_BLE, "Delta frames: %lu (%lu keyframes, %lu unchanged), %lu bytes vs %lu full (%.0f%% saved)",
+            (unsigned long)delta.frames, (unsigned long)delta.keyframes, (unsigned long)delta.unchanged,
+            (unsigned long)delta.bytes, (unsigned long)delta.full_bytes,
+            delta.full_bytes ? 100.0 * (1.0 - (double)delta.bytes / delta.full_bytes) : 0.0);
+    }
+    if (vitalsStoreReady) {
+      VitalsStoreStats store = vitalsStore.getStats();
+      LOG_D(LOG_SYS, "Vitals log: %lu records over %lu s, %lu appended, %lu pages opened (%lu recycled, %lu erased inline), wear %lu, torn %lu, errors %lu%s",
+            (unsigned long)vitalsStore.capacityRecords(), (unsigned long)(vitalsStore.lastTime() - vitalsStore.firstTime()),
+            (unsigned long)store.appended, (unsigned long)store.pages_opened, (unsigned long)store.overwritten,
+            (unsigned long)store.inline_erases,
+            (unsigned long)store.max_erase_count, (unsigned long)store.torn, (unsigned long)store.errors,
+            backlogPending ? " | backlog pending" : "");
+    }
+    LOG_D(LOG_SYS, "Log: %lu records, %lu dropped",
+          (unsigned long)lifebandLog().writtenCount(), (unsigned long)lifebandLog().droppedCount());
+  }
+
+  /**
+   * Clear per-link state (loop() only); a second report of the same loss is silent
+   */
+  void handleLinkLoss(const char* reason, uint32_t lostAt) {
+    if (deviceConnected.exchange(false)) {
+      linkMonitor.onDisconnect(lostAt);
+      LOG_I(LOG_BLE, "DISCONNECTED (%s) - session kept, advertising again", reason);
+    }
+    notifyEnabled = false;
+    alertNotifyEnabled = false;
+    stopStreamingSession(reason);
+    pendingWaveMode = WAVE_OFF;  // DSP stage owns the encoders
+    peerMtu = 23;
+    led.request(LED_CH_STATUS, LED_DISCONNECTED);
+  }
+
+  /**
+   * Start advertising if it is not running (loop() only)
+   */
+  bool restartAdvertising() {
+    NimBLEAdvertising* advertising = NimBLEDevice::getAdvertising();
+    if (!advertising->isAdvertising() && !advertising->start()) {
+      return false;
+    }
+    uint32_t latency = linkMonitor.onAdvertising(millis());
+    if (latency > 0) {
+      LOG_I(LOG_BLE, "Advertising restarted %lu ms after disconnect", (unsigned long)latency);
+    }
+    return true;
   }
 
   class ServerCallbacks : public NimBLEServerCallbacks {
@@ -1077,31 +2023,22 @@ void updateFallbackBP() {
       deviceConnected = true;
       notifyEnabled = false;
       streamingEnabled = false;
-      Serial.println("\n========================================");
-      Serial.println("[BLE] ✓✓✓ CONNECTED ✓✓✓");
-      Serial.print("[BLE] Peer address: ");
-      Serial.println(NimBLEAddress(desc->peer_ota_addr).toString().c_str());
-      Serial.println("========================================\n");
-      rgbColor(0, 255, 0);
+      linkMonitor.onConnect(millis());
+      LOG_I(LOG_BLE, "✓✓✓ CONNECTED ✓✓✓ Peer address: %s",
+            NimBLEAddress(desc->peer_ota_addr).toString().c_str());
+      led.request(LED_CH_STATUS, LED_CONNECTED);
+    }
+    
+    void onMTUChange(uint16_t MTU, ble_gap_conn_desc* desc) {
+      peerMtu = MTU;
+      LOG_I(LOG_BLE, "MTU negotiated: %u", (unsigned)MTU);
     }
     
     void onDisconnect(NimBLEServer* pServer) {
-      deviceConnected = false;
-      notifyEnabled = false;
-      stopStreamingSession("DISCONNECT");
-      Serial.println("\n========================================");
-      Serial.println("[BLE] DISCONNECTED");
-      Serial.println("[BLE] Auto-reset in 3 seconds...");
-      Serial.println("========================================\n");
-      
-      // Show red light for 3 seconds before reset
-      rgbColor(255, 0, 0);
-      delay(3000);
-      
-      // Reset ESP32
-      Serial.println("[SYSTEM] Resetting ESP32...");
-      Serial.flush();  // Ensure all serial data is sent
-      ESP.restart();   // Restart the microcontroller
+      // Recover in place: acquisition, calibration, histories and AI state
+      // stay as they are. loop() clears the link state and readvertises.
+      linkLostMs.store(millis(), std::memory_order_relaxed);
+      linkLostPending.store(true, std::memory_order_release);
     }
   };
 
@@ -1109,27 +2046,58 @@ void updateFallbackBP() {
     void onSubscribe(NimBLECharacteristic* pCharacteristic, ble_gap_conn_desc* desc, uint16_t subValue) {
       if (subValue > 0) {
         notifyEnabled = true;
-        Serial.println("[BLE] Notifications ON - starting live stream");
+        LOG_I(LOG_BLE, "Notifications ON - starting live stream");
         startStreamingSession("NOTIFY");
       } else {
         notifyEnabled = false;
-        Serial.println("[BLE] Notifications OFF - pausing live stream");
+        LOG_I(LOG_BLE, "Notifications OFF - pausing live stream");
         stopStreamingSession("NOTIFY");
       }
     }
   };
 
+  class AlertCallbacks : public NimBLECharacteristicCallbacks {
+    void onSubscribe(NimBLECharacteristic* pCharacteristic, ble_gap_conn_desc* desc, uint16_t subValue) {
+      alertNotifyEnabled = subValue > 0;
+      if (alertNotifyEnabled) {
+        pendingAlertResend = true;
+        transportStage.notify();
+      }
+      LOG_I(LOG_BLE, "Alert notifications %s", alertNotifyEnabled ? "ON" : "OFF");
+    }
+    
+    // Acknowledgement: u16 sequence number of a received alert
+    void onWrite(NimBLECharacteristic* pCharacteristic) {
+      std::string value = pCharacteristic->getValue();
+      if (value.size() < 2) {
+        return;
+      }
+      uint16_t seq = vitalsGet16((const uint8_t*)value.data());
+      if (alertChannel.acknowledge(seq)) {
+        transportStage.notify();
+      }
+    }
+  };
+
   class ConfigCallbacks : public NimBLECharacteristicCallbacks {
     void onWrite(NimBLECharacteristic* pCharacteristic) {
       std::string rawValue = pCharacteristic->getValue();
       if (rawValue.empty()) {
-        Serial.println("[CONFIG] Empty payload received");
+        LOG_W(LOG_BLE, "Empty config payload received");
+        return;
+      }
+
+      // Binary model upload frames go to the inference stage, which owns the slots
+      static ModelXferMsg xferMsg;
+      if (decodeModelTransfer((const uint8_t*)rawValue.data(), rawValue.size(), xferMsg)) {
+        if (!modelXferQueue.push(xferMsg)) {
+          LOG_W(LOG_BLE, "Model transfer queue full - frame dropped");
+        }
         return;
       }
 
       String command = String(rawValue.c_str());
-      Serial.print("[CONFIG] Raw payload: ");
-      Serial.println(command);
+      LOG_D(LOG_BLE, "Config payload: %s", command.c_str());
       handleControlCommand(command);
     }
   };
@@ -1137,6 +2105,9 @@ void updateFallbackBP() {
   void setup() {
     Serial.begin(115200);
     delay(1000);
+    if (!lifebandLog().begin()) {
+      Serial.println("[LOG] ✗ Drain task not started - log records will be dropped");
+    }
     Serial.println("\n\n");
     Serial.println("========================================");
       Serial.println("   LIFEBAND ESP32-S3 v5.0 - TFLite AI");
@@ -1150,6 +2121,9 @@ void updateFallbackBP() {
     
       // Initialize Edge AI Engine
       Serial.println("[AI] Initializing TensorFlow Lite...");
+      edgeAI.bind(&arrhythmiaEngine);
+      edgeAI.bind(&anemiaEngine);
+      edgeAI.bind(&preeclampsiaEngine);
       if (edgeAI.begin()) {
         aiEngineReady = true;
         Serial.println("[AI] ✓ Edge AI engine ready");
@@ -1160,6 +2134,43 @@ void updateFallbackBP() {
         Serial.println("[AI] ✗ Edge AI initialization failed");
         Serial.println("[AI] Using rule-based fallback");
       }
+    #ifndef LIFEBAND_USE_TFLM
+      // Uploaded models replace the built-in weights; a trial that never got
+      // confirmed before this boot has been rolled back by mount()
+      if (modelFlash.begin(MODEL_PARTITION_LABEL) && modelSlots.mount(&modelFlash)) {
+        for (uint8_t m = 0; m < MODEL_COUNT; m++) {
+          activateStoredModel((ModelType)m, "boot");
+        }
+        if (modelSlots.getStats().rollbacks > 0) {
+          Serial.print("[AI] ⚠️ Rolled back ");
+          Serial.print(modelSlots.getStats().rollbacks);
+          Serial.println(" unconfirmed model(s)");
+        }
+      } else {
+        Serial.println("[AI] No models partition - built-in weights only, uploads disabled");
+      }
+    #endif
+    
+    deltaConfig.setDefaults();
+    
+    // Offline vitals log: the SPIFFS partition is used raw (nothing else uses it)
+    vitalsStoreReady = vitalsFlash.begin() && vitalsStore.mount(&vitalsFlash);
+    if (vitalsStoreReady) {
+      vitalsStoreBaseS = vitalsStore.isEmpty() ? 0 : vitalsStore.lastTime() + 1;
+      Serial.print("[STORE] ✓ Vitals log: ");
+      Serial.print(vitalsFlash.size() / 1024);
+      Serial.print(" KB, ");
+      Serial.print(vitalsStore.capacityRecords());
+      Serial.print(" records");
+      if (!vitalsStore.isEmpty()) {
+        Serial.print(", holding ");
+        Serial.print(vitalsStore.lastTime() - vitalsStore.firstTime());
+        Serial.print(" s");
+      }
+      Serial.println();
+    } else {
+      Serial.println("[STORE] ✗ No data partition - vitals are not kept while disconnected");
+    }
     
     rgb.begin();
     rgb.setBrightness(50);
@@ -1167,9 +2178,30 @@ void updateFallbackBP() {
     
     pinMode(ECG_PIN, INPUT);
     Serial.println("[ECG] AD8232 initialized on GPIO4");
+    ecgAcqReady = ecgAcq.begin(ECG_PIN, ECG_SAMPLE_RATE_HZ);
+    if (!ecgAcqReady) {
+      ecgAcq.configure(ECG_SAMPLE_RATE_HZ, micros(), millis());
+      Serial.println("[ECG] ⚠️ Timer sampling unavailable - polling ADC from loop()");
+    }
+    ecgFilter.configure(ECG_SAMPLE_RATE_HZ, ECG_MAINS_NOTCH, ECG_DECIMATION);
+    qrsDetector.configure(ecgFilter.outputRate());
+    ecgQuality.configureWindow(ecgFilter.outputRate(), 256, 96);
+    Serial.print("[ECG] Pre-filter: notch ");
+    if (ecgFilter.notchFrequency() == NOTCH_OFF) {
+      Serial.print("OFF");
+    } else {
+      Serial.print((int)ecgFilter.notchFrequency());
+      Serial.print(" Hz");
+    }
+    Serial.print(", baseline delay ");
+    Serial.print(ecgAcq.samplesToMs(ecgFilter.delaySamples()));
+    Serial.print(" ms, detector at ");
+    Serial.print(ecgFilter.outputRate());
+    Serial.println(" Hz");
+    Serial.println("[ECG] Learning QRS detector thresholds (2 seconds)...");
     
     Serial.println("[SENSOR] Initializing MAX30105...");
-    Wire.begin(11, 12);
+    ppgBus.begin();
     
     if (maxSensor.begin(Wire, I2C_SPEED_FAST)) {
       Serial.println("[MAX30105] ✓ Sensor found!");
@@ -1179,8 +2211,18 @@ void updateFallbackBP() {
       maxSensor.setPulseAmplitudeRed(0x0A);
       maxSensor.setPulseAmplitudeIR(0x0A);
       
-      sensorReady = true;
+      spo2Estimator.configure(PPG_SAMPLE_RATE_HZ, SPO2_HOP_MS, SPO2_WINDOW_S);
+      ppgBeats.configure(PPG_SAMPLE_RATE_HZ);
+      ppgQuality.configureWindow(PPG_SAMPLE_RATE_HZ, 640, 400);
+      sensorReady = ppgFifo.begin(&ppgBus, 1000000UL / PPG_SAMPLE_RATE_HZ, PPG_INT_PIN);
+      ppgClock.configure(1000000UL / PPG_SAMPLE_RATE_HZ, PPG_GROUP_DELAY_US);
+      if (!sensorReady) {
+        Serial.println("[MAX30105] ✗ FIFO setup failed");
+      }
       Serial.println("[MAX30105] ✓ Configured for SpO2 measurement");
+      Serial.print("[MAX30105] FIFO burst of ");
+      Serial.print(ppgFifo.threshold());
+      Serial.println(ppgFifo.interruptDriven() ? " samples on INT" : " samples on timer (no INT pin)");
       Serial.println("[MAX30105] Place finger gently on sensor");
     } else {
       Serial.println("[MAX30105] ✗ NOT FOUND");
@@ -1196,6 +2238,7 @@ void updateFallbackBP() {
     
     bleServer = NimBLEDevice::createServer();
     bleServer->setCallbacks(new ServerCallbacks());
+    bleServer->advertiseOnDisconnect(false);  // restarted by loop() so it can be timed
     
     NimBLEService* pService = bleServer->createService(SERVICE_UUID);
     
@@ -1205,11 +2248,23 @@ void updateFallbackBP() {
     );
     vitalsChar->setCallbacks(new VitalsCallbacks());
     
-    NimBLECharacteristic* configChar = pService->createCharacteristic(
+    configChar = pService->createCharacteristic(
       CONFIG_CHAR_UUID,
-      NIMBLE_PROPERTY::WRITE
+      NIMBLE_PROPERTY::WRITE | NIMBLE_PROPERTY::READ
     );
     configChar->setCallbacks(new ConfigCallbacks());
+    publishModelTransferStatus();
+    
+    waveformChar = pService->createCharacteristic(
+      WAVEFORM_CHAR_UUID,
+      NIMBLE_PROPERTY::NOTIFY
+    );
+    
+    alertChar = pService->createCharacteristic(
+      ALERT_CHAR_UUID,
+      NIMBLE_PROPERTY::NOTIFY | NIMBLE_PROPERTY::WRITE | NIMBLE_PROPERTY::WRITE_NR
+    );
+    alertChar->setCallbacks(new AlertCallbacks());
     
     pService->start();
     
@@ -1223,15 +2278,26 @@ void updateFallbackBP() {
     Serial.println(SERVICE_UUID.toString().c_str());
     Serial.print("[BLE] Vitals UUID: ");
     Serial.println(VITALS_CHAR_UUID.toString().c_str());
+    Serial.print("[BLE] Waveform UUID: ");
+    Serial.println(WAVEFORM_CHAR_UUID.toString().c_str());
+    Serial.print("[BLE] Alert UUID: ");
+    Serial.println(ALERT_CHAR_UUID.toString().c_str());
+    
+    pipelineReady = startPipeline();
+    if (pipelineReady) {
+      Serial.println("[PIPELINE] ✓ DSP on core 1, inference + transport on core 0");
+    } else {
+      Serial.println("[PIPELINE] ✗ Stage tasks unavailable - running stages from loop()");
+    }
+    reportMemoryBudget();
     
     Serial.println("\n========================================");
     Serial.println("   ✓✓✓ SYSTEM READY ✓✓✓");
     Serial.println("   Waiting for connection...");
     Serial.println("========================================\n");
     
-    rgbColor(0, 0, 255);
-    delay(500);
-    rgbColor(0, 0, 0);
+    led.begin(LED_PATTERNS, LED_PATTERN_COUNT);
+    led.request(LED_CH_STATUS, LED_READY);
   }
 
   void loop() {
@@ -1241,185 +2307,50 @@ void updateFallbackBP() {
     static bool wasConnected = false;
     int connCount = bleServer->getConnectedCount();
     bool isConnected = (connCount > 0);
+    bool callbackLoss = linkLostPending.exchange(false, std::memory_order_acquire);
     
-    // Detect connection state changes
-    if (isConnected != wasConnected) {
+    // Detect connection state changes; the disconnect callback only flags them
+    if (callbackLoss) {
+      handleLinkLoss("DISCONNECT", linkLostMs.load(std::memory_order_relaxed));
+      wasConnected = false;  // a fast reconnect is picked up on the next pass
+    } else if (isConnected != wasConnected) {
       if (isConnected) {
         deviceConnected = true;
         notifyEnabled = false;
         streamingEnabled = false;
-        Serial.println("\n========================================");
-        Serial.println("[BLE] ✓✓✓ CONNECTION DETECTED ✓✓✓");
-        Serial.print("[BLE] Connected devices: ");
-        Serial.println(connCount);
-        Serial.println("========================================\n");
-        rgbColor(0, 255, 0);
+        LOG_I(LOG_BLE, "✓✓✓ CONNECTION DETECTED ✓✓✓ Connected devices: %d", connCount);
+        led.request(LED_CH_STATUS, LED_CONNECTED);
       } else {
-        deviceConnected = false;
-        notifyEnabled = false;
-        stopStreamingSession("LINK LOSS");
-        Serial.println("[BLE] Connection lost");
-        rgbColor(255, 0, 0);
+        handleLinkLoss("LINK LOSS", now);
       }
       wasConnected = isConnected;
     }
     
-    // Read sensors continuously (non-blocking, quick reads)
-    if (sensorReady) {
-      // Quick MAX30102 sample read (non-blocking)
-      static int sampleCount = 0;
-      static unsigned long lastSensorRead = 0;
-      
-      // Read one sample at a time to avoid blocking
-      if (maxSensor.available()) {
-        uint32_t red = maxSensor.getRed();
-        uint32_t ir = maxSensor.getIR();
-        
-        // Store in circular buffer
-        redBuffer[sampleCount % 50] = red;
-        irBuffer[sampleCount % 50] = ir;
-        
-        // Detect PPG peak for PTT calculation
-        if (detectPPGPeak(ir)) {
-          computePTTandBP();
-        }
-        
-        // Store PPG heart rate for reliability check (done every sample)
-        // This updates ppgHeartRate continuously, not just every 100 samples
-        if (sampleCount % 25 == 0 && ir >= 50000) {  // Every ~1 second
-          // Quick HR estimation from IR amplitude
-          static unsigned long lastPPGBeat = 0;
-          unsigned long now = millis();
-          if (now - lastPPGBeat > 400 && now - lastPPGBeat < 2000) {
-            ppgHeartRate = 60000 / (now - lastPPGBeat);
-          }
-          if (ir > 80000) lastPPGBeat = now;  // Rough beat detection
-        }
-        
-        maxSensor.nextSample();
-        sampleCount++;
-        
-        // Process HR/SpO2 every 50 samples (every ~2 seconds at 25Hz)
-        if (sampleCount % 50 == 0 && sampleCount > 0) {
-          maxim_heart_rate_and_oxygen_saturation(
-            irBuffer, 50,
-            redBuffer,
-            &spo2Value, &validSPO2,
-            &heartRateValue, &validHeartRate
-          );
-
-          bool updatedPPG = false;
-
-          if (validHeartRate && heartRateValue > 40 && heartRateValue < 200) {
-            ppgHeartRate = heartRateValue;
-            updatedPPG = true;
-            Serial.print("[MAX30105] PPG HR: ");
-            Serial.println(ppgHeartRate);
-
-            // Feed PPG-derived HR into history if ECG isn’t providing data
-            if (ecgHeartRate == 0) {
-              hrHistory[historyIndex] = ppgHeartRate;
-            }
-          }
-
-          if (validSPO2 && spo2Value > 70 && spo2Value <= 100) {
-            spo2History[historyIndex] = spo2Value;
-            int avgSPO2 = getAverageSPO2();
-            if (avgSPO2 > 0) {
-              currentSPO2 = avgSPO2;
-              Serial.print("[MAX30105] SpO2: ");
-              Serial.print(currentSPO2);
-              Serial.println("%");
-            }
-          }
-
-          historyIndex = (historyIndex + 1) % AVG_SAMPLES;
-
-          if (updatedPPG || validSPO2) {
-            selectReliableHeartRate();
-          }
-        }
-      } else {
-        // Check for new samples if none available
-        maxSensor.check();
+    // Readvertise straight after a loss, then retry once a second while down
+    static unsigned long lastAdvertisingCheck = 0;
+    if (!isConnected && (callbackLoss || now - lastAdvertisingCheck >= 1000)) {
+      lastAdvertisingCheck = now;
+      if (!restartAdvertising()) {
+        LOG_W(LOG_BLE, "Advertising restart failed - retrying");
       }
     }
     
-    // Read ECG continuously for peak detection and heart rate
-    int ecgRaw = analogRead(ECG_PIN);
+    if (led.tick(now)) {
+      rgbColor(led.red(), led.green(), led.blue());
+    }
     
-    // Auto-calibrate ECG baseline and threshold for first 3 seconds
-    if (autoCalibrating) {
-      if (calibrationStart == 0) {
-        calibrationStart = now;
-        Serial.println("[ECG] Starting auto-calibration (3 seconds)...");
-      }
-      
-      // Track min/max during calibration
-      if (ecgRaw < minECG) minECG = ecgRaw;
-      if (ecgRaw > maxECG) maxECG = ecgRaw;
-      
-      // Print raw values during calibration
-      static unsigned long lastPrint = 0;
-      if (now - lastPrint >= 500) {
-        Serial.print("[ECG] Raw: ");
-        Serial.print(ecgRaw);
-        Serial.print(" | Min: ");
-        Serial.print(minECG);
-        Serial.print(" | Max: ");
-        Serial.println(maxECG);
-        lastPrint = now;
-      }
-      
-      // After ~3 seconds, set baseline and threshold
-      if (now - calibrationStart >= 3000) {
-        ecgBaseline = (minECG + maxECG) / 2;
-        int range = maxECG - minECG;
-        ecgThreshold = ecgBaseline + (range / 3);  // Threshold at 1/3 above baseline
-        
-        autoCalibrating = false;
-        Serial.println("\n[ECG] ✓ Calibration complete!");
-        Serial.print("[ECG] Baseline: ");
-        Serial.println(ecgBaseline);
-        Serial.print("[ECG] Threshold: ");
-        Serial.println(ecgThreshold);
-        Serial.print("[ECG] Range: ");
-        Serial.println(range);
-        Serial.println("[ECG] Now detecting R-peaks...\n");
-        
-        // Alert if signal is too weak
-        if (range < 100) {
-          Serial.println("[ECG] ⚠️ WARNING: Weak signal! Check electrode connections.");
-          rgbBlink(255, 165, 0, 3, 300);
-        }
-      }
-    } else {
-      // Normal peak detection after calibration
-      static unsigned long lastECGDebug = 0;
-      if (detectECGPeak(ecgRaw)) {
-        // ECG R-peak detected
-        Serial.print("[ECG] ✓ R-peak! HR: ");
-        Serial.print(currentHR);
-        Serial.print(" BPM, HRV: ");
-        Serial.print(hrv_ms);
-        Serial.print("ms, Amplitude: ");
-        Serial.println(ecgPeakAmplitude);
-      }
-      
-      // Debug: Print raw ECG every 2 seconds if no peaks detected
-      if (now - lastECGDebug >= 2000 && ecgHeartRate == 0) {
-        Serial.print("[ECG] No peaks detected. Raw value: ");
-        Serial.print(ecgRaw);
-        Serial.print(" | Threshold: ");
-        Serial.print(ecgThreshold);
-        Serial.print(" | Baseline: ");
-        Serial.println(ecgBaseline);
-        lastECGDebug = now;
-      }
+    // Without stage tasks, run the same steps in order from here
+    if (!pipelineReady) {
+      dspStage.runOnce();
+      inferenceStage.runOnce();
+      transportStage.runOnce();
     }
     
-    // Send vitals every 1 second
-    sendVitals();
+    static unsigned long lastStatsLog = 0;
+    if (now - lastStatsLog >= 10000) {
+      logPipelineStats();
+      lastStatsLog = now;
+    }
     
-    delay(10);  // Small delay to prevent watchdog issues
+    delay(pipelineReady ? 20 : 1);  // Stages run in their own tasks; loop() watches the link and drives the LED
   }
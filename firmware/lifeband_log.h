@@ -0,0 +1,312 @@
+/*
+ * LifeBand Logging
+ * Level-filtered, tagged, non-blocking log records
+ *
+ * LOG_E / LOG_W / LOG_I / LOG_D format one line into a slot of a lock-free
+ * multi-producer ring and return; a low-priority task on core 0 drains the
+ * ring to Serial. When the ring is full the record is dropped and counted,
+ * so a slow UART never stalls sampling or beat processing.
+ *
+ * Levels above LIFEBAND_LOG_LEVEL are removed at compile time, arguments
+ * included (they are not evaluated), so debug logging costs nothing in a
+ * release build:
+ *   #define LIFEBAND_LOG_LEVEL LOG_LEVEL_DEBUG   // before including
+ *
+ * Producers may run on any task (loop, BLE host callbacks). The ring uses
+ * per-slot sequence numbers (bounded MPMC queue after D. Vyukov) with one
+ * consumer; a producer's cost is one CAS plus a bounded vsnprintf.
+ *
+ * Without ARDUINO the drain task is compiled out and drain() is called
+ * directly, so the producer path can be timed on a host.
+ */
+
+#ifndef LIFEBAND_LOG_H
+#define LIFEBAND_LOG_H
+
+#ifdef ARDUINO
+#include <Arduino.h>
+#endif
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <string.h>
+#include <atomic>
+
+#define LOG_LEVEL_NONE 0
+#define LOG_LEVEL_ERROR 1
+#define LOG_LEVEL_WARN 2
+#define LOG_LEVEL_INFO 3
+#define LOG_LEVEL_DEBUG 4
+
+#ifndef LIFEBAND_LOG_LEVEL
+#define LIFEBAND_LOG_LEVEL LOG_LEVEL_INFO
+#endif
+
+#define LOG_RING_SLOTS 64          // power of two
+#define LOG_MSG_LEN 112            // longer messages are truncated
+#define LOG_LINE_LEN (LOG_MSG_LEN + 24)
+#define LOG_DRAIN_CORE 0
+#define LOG_DRAIN_PRIORITY 1
+#define LOG_DRAIN_STACK 3072
+#define LOG_DRAIN_IDLE_MS 10
+
+enum LogTag : uint8_t {
+  LOG_SYS = 0,
+  LOG_ECG = 1,
+  LOG_PPG = 2,
+  LOG_BP = 3,
+  LOG_AI = 4,
+  LOG_BLE = 5,
+  LOG_TAG_COUNT
+};
+
+constexpr const char* logTagName(LogTag tag) {
+  return tag == LOG_ECG ? "ECG" :
+         tag == LOG_PPG ? "PPG" :
+         tag == LOG_BP ? "BP" :
+         tag == LOG_AI ? "AI" :
+         tag == LOG_BLE ? "BLE" : "SYS";
+}
+
+constexpr const char* logLevelPrefix(uint8_t level) {
+  return level == LOG_LEVEL_ERROR ? "✗ " :
+         level == LOG_LEVEL_WARN ? "⚠️ " : "";
+}
+
+struct LogRecord {
+  uint32_t ms;
+  uint8_t level;
+  uint8_t tag;
+  char text[LOG_MSG_LEN];
+};
+
+typedef void (*LogSink)(const char* line, size_t len, void* ctx);
+
+static inline uint32_t logNowMs() {
+#ifdef ARDUINO
+  return (uint32_t)millis();
+#else
+  return 0;
+#endif
+}
+
+class LifeBandLogger {
+  static_assert((LOG_RING_SLOTS & (LOG_RING_SLOTS - 1)) == 0,
+                "LOG_RING_SLOTS must be a power of two");
+
+private:
+  struct Slot {
+    std::atomic<uint32_t> seq;
+    LogRecord rec;
+  };
+
+  static const uint32_t MASK = LOG_RING_SLOTS - 1;
+
+  Slot slots[LOG_RING_SLOTS];
+  std::atomic<uint32_t> enqueue_pos;
+  uint32_t dequeue_pos;             // consumer owned
+  std::atomic<uint32_t> dropped;
+  std::atomic<uint32_t> written;
+  uint32_t dropped_reported;        // consumer owned
+
+#ifdef ARDUINO
+  TaskHandle_t drain_task;
+
+  static void serialSink(const char* line, size_t len, void* ctx) {
+    Serial.write((const uint8_t*)line, len);
+  }
+
+  static void drainTask(void* arg) {
+    LifeBandLogger* self = (LifeBandLogger*)arg;
+    for (;;) {
+      if (self->drain(serialSink, nullptr, LOG_RING_SLOTS) == 0) {
+        vTaskDelay(pdMS_TO_TICKS(LOG_DRAIN_IDLE_MS));
+      }
+    }
+  }
+#endif
+
+  /**
+   * Claim a free slot
+   * @return slot, or nullptr if the ring is full
+   */
+  Slot* claim(uint32_t& pos) {
+    pos = enqueue_pos.load(std::memory_order_relaxed);
+    for (;;) {
+      Slot* slot = &slots[pos & MASK];
+      uint32_t seq = slot->seq.load(std::memory_order_acquire);
+      int32_t diff = (int32_t)(seq - pos);
+      if (diff == 0) {
+        if (enqueue_pos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+          return slot;
+        }
+        // pos was reloaded by the failed CAS
+      } else if (diff < 0) {
+        return nullptr;
+      } else {
+        pos = enqueue_pos.load(std::memory_order_relaxed);
+      }
+    }
+  }
+
+public:
+  LifeBandLogger() :
+    enqueue_pos(0),
+    dequeue_pos(0),
+    dropped(0),
+    written(0),
+    dropped_reported(0)
+#ifdef ARDUINO
+    , drain_task(nullptr)
+#endif
+  {
+    for (uint32_t i = 0; i < LOG_RING_SLOTS; i++) {
+      slots[i].seq.store(i, std::memory_order_relaxed);
+    }
+  }
+
+  /**
+   * Producer side: format and enqueue one record, never blocks
+   * @return false if the ring was full and the record was dropped
+   */
+  bool vlog(uint8_t level, LogTag tag, const char* fmt, va_list args) {
+    uint32_t pos;
+    Slot* slot = claim(pos);
+    if (!slot) {
+      dropped.fetch_add(1, std::memory_order_relaxed);
+      return false;
+    }
+    slot->rec.ms = logNowMs();
+    slot->rec.level = level;
+    slot->rec.tag = tag;
+    vsnprintf(slot->rec.text, LOG_MSG_LEN, fmt, args);
+    slot->seq.store(pos + 1, std::memory_order_release);
+    written.fetch_add(1, std::memory_order_relaxed);
+    return true;
+  }
+
+  bool log(uint8_t level, LogTag tag, const char* fmt, ...)
+      __attribute__((format(printf, 4, 5))) {
+    va_list args;
+    va_start(args, fmt);
+    bool ok = vlog(level, tag, fmt, args);
+    va_end(args);
+    return ok;
+  }
+
+  /**
+   * Consumer side: remove the oldest record
+   */
+  bool read(LogRecord& out) {
+    Slot* slot = &slots[dequeue_pos & MASK];
+    uint32_t seq = slot->seq.load(std::memory_order_acquire);
+    if ((int32_t)(seq - (dequeue_pos + 1)) < 0) {
+      return false;
+    }
+    out = slot->rec;
+    slot->seq.store(dequeue_pos + LOG_RING_SLOTS, std::memory_order_release);
+    dequeue_pos++;
+    return true;
+  }
+
+  /**
+   * Consumer side: format up to max_records lines into sink
+   * @return number of records written
+   */
+  size_t drain(LogSink sink, void* ctx, size_t max_records) {
+    char line[LOG_LINE_LEN];
+    LogRecord rec;
+    size_t n = 0;
+
+    uint32_t lost = dropped.load(std::memory_order_relaxed);
+    if (lost != dropped_reported) {
+      int len = snprintf(line, sizeof(line), "[LOG] ⚠️ %lu records dropped\n",
+                         (unsigned long)(lost - dropped_reported));
+      sink(line, (size_t)len, ctx);
+      dropped_reported = lost;
+    }
+
+    while (n < max_records && read(rec)) {
+      int len = snprintf(line, sizeof(line), "%7lu [%s] %s%s\n",
+                         (unsigned long)rec.ms, logTagName((LogTag)rec.tag),
+                         logLevelPrefix(rec.level), rec.text);
+      if (len >= (int)sizeof(line)) {
+        len = sizeof(line) - 1;
+        line[len - 1] = '\n';
+      }
+      sink(line, (size_t)len, ctx);
+      n++;
+    }
+    return n;
+  }
+
+  uint32_t droppedCount() const { return dropped.load(std::memory_order_relaxed); }
+  uint32_t writtenCount() const { return written.load(std::memory_order_relaxed); }
+
+#ifdef ARDUINO
+  /**
+   * Start the background drain task (records logged earlier are kept)
+   */
+  bool begin() {
+    if (drain_task) {
+      return true;
+    }
+    BaseType_t ok = xTaskCreatePinnedToCore(
+      drainTask, "log_drain", LOG_DRAIN_STACK, this,
+      LOG_DRAIN_PRIORITY, &drain_task, LOG_DRAIN_CORE);
+    if (ok != pdPASS) {
+      drain_task = nullptr;
+      return false;
+    }
+    return true;
+  }
+
+  /**
+   * Write everything pending synchronously (before a restart)
+   */
+  void flush() {
+    if (drain_task) {
+      vTaskSuspend(drain_task);
+    }
+    while (drain(serialSink, nullptr, LOG_RING_SLOTS) > 0) {
+    }
+    Serial.flush();
+    if (drain_task) {
+      vTaskResume(drain_task);
+    }
+  }
+#endif
+};
+
+static inline LifeBandLogger& lifebandLog() {
+  static LifeBandLogger instance;
+  return instance;
+}
+
+#if LIFEBAND_LOG_LEVEL >= LOG_LEVEL_ERROR
+#define LOG_E(tag, ...) lifebandLog().log(LOG_LEVEL_ERROR, tag, __VA_ARGS__)
+#else
+#define LOG_E(tag, ...) do { } while (0)
+#endif
+
+#if LIFEBAND_LOG_LEVEL >= LOG_LEVEL_WARN
+#define LOG_W(tag, ...) lifebandLog().log(LOG_LEVEL_WARN, tag, __VA_ARGS__)
+#else
+#define LOG_W(tag, ...) do { } while (0)
+#endif
+
+#if LIFEBAND_LOG_LEVEL >= LOG_LEVEL_INFO
+#define LOG_I(tag, ...) lifebandLog().log(LOG_LEVEL_INFO, tag, __VA_ARGS__)
+#else
+#define LOG_I(tag, ...) do { } while (0)
+#endif
+
+#if LIFEBAND_LOG_LEVEL >= LOG_LEVEL_DEBUG
+#define LOG_D(tag, ...) lifebandLog().log(LOG_LEVEL_DEBUG, tag, __VA_ARGS__)
+#else
+#define LOG_D(tag, ...) do { } while (0)
+#endif
+
+#endif // LIFEBAND_LOG_H
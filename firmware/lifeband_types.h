@@ -0,0 +1,74 @@
+/*
+ * LifeBand Shared Types
+ * Enumerations for classifier outputs and vitals provenance
+ *
+ * The numeric values are part of the binary vitals frame (vitals_frame.h)
+ * and of the app decoder (src/services/vitalsFrameCodec.ts): append new
+ * values at the end, never renumber. The first entries of RhythmType and
+ * RiskLevel follow the class order of the TFLite models.
+ *
+ * Name lookups are constexpr and return string literals, so nothing is
+ * allocated when a result is logged or serialized.
+ */
+
+#ifndef LIFEBAND_TYPES_H
+#define LIFEBAND_TYPES_H
+
+#include <stdint.h>
+
+enum RhythmType : uint8_t {
+  RHYTHM_NORMAL = 0,
+  RHYTHM_AFIB = 1,
+  RHYTHM_PVC = 2,
+  RHYTHM_BRADYCARDIA = 3,
+  RHYTHM_TACHYCARDIA = 4,
+  RHYTHM_NO_SIGNAL = 5
+};
+
+enum RiskLevel : uint8_t {
+  RISK_LOW = 0,
+  RISK_MODERATE = 1,
+  RISK_HIGH = 2,
+  RISK_CRITICAL = 3,
+  RISK_LOW_MODERATE = 4,
+  RISK_UNKNOWN = 5
+};
+
+enum HrSource : uint8_t {
+  HR_SOURCE_NONE = 0,
+  HR_SOURCE_ECG = 1,
+  HR_SOURCE_PPG = 2
+};
+
+enum BpMethod : uint8_t {
+  BP_METHOD_ECG = 0,
+  BP_METHOD_PTT = 1
+};
+
+constexpr const char* rhythmName(RhythmType r) {
+  return r == RHYTHM_NORMAL ? "Normal" :
+         r == RHYTHM_AFIB ? "AFib" :
+         r == RHYTHM_PVC ? "PVC" :
+         r == RHYTHM_BRADYCARDIA ? "Bradycardia" :
+         r == RHYTHM_TACHYCARDIA ? "Tachycardia" :
+         r == RHYTHM_NO_SIGNAL ? "NoSignal" : "Unknown";
+}
+
+constexpr const char* riskName(RiskLevel r) {
+  return r == RISK_LOW ? "Low" :
+         r == RISK_MODERATE ? "Moderate" :
+         r == RISK_HIGH ? "High" :
+         r == RISK_CRITICAL ? "Critical" :
+         r == RISK_LOW_MODERATE ? "Low-Moderate" : "Unknown";
+}
+
+constexpr const char* hrSourceName(HrSource s) {
+  return s == HR_SOURCE_ECG ? "ECG" :
+         s == HR_SOURCE_PPG ? "PPG" : "NONE";
+}
+
+constexpr const char* bpMethodName(BpMethod m) {
+  return m == BP_METHOD_PTT ? "PTT" : "ECG";
+}
+
+#endif // LIFEBAND_TYPES_H
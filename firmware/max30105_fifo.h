@@ -0,0 +1,483 @@
+/*
+ * LifeBand MAX30105 FIFO Reader
+ * Interrupt-driven burst reads into a timestamped sample ring
+ *
+ * The SparkFun driver pulls one sample per available()/getIR()/nextSample()
+ * round and its blocking helpers spin on check() without a timeout. This
+ * reader only talks to the FIFO registers (configuration stays with the
+ * SparkFun setup()):
+ *
+ * - The sensor raises INT (active low) when the FIFO holds burst_threshold
+ *   samples (FIFO_A_FULL). The ISR only sets a flag; service(), called from
+ *   the DSP stage, then reads INT_STATUS..FIFO_RD_PTR in one transaction
+ *   and all pending samples in as few FIFO_DATA bursts as the I2C buffer
+ *   allows. Without an INT pin (or if an edge is lost) the same path runs
+ *   on a timer, once per burst period.
+ * - Samples get a running index (gaps = samples lost to FIFO overflow) and
+ *   a micros() timestamp back-computed from the read time and the sample
+ *   period, then go into an SPSC ring for the PPG processing.
+ * - Every I2C call is bounded by the bus timeout and one service() call by
+ *   a time budget; samples left over are read on the next call.
+ * - Failed transfers are counted; after MAX30105_ERROR_LIMIT in a row the
+ *   bus is recovered (SCL clocked out, peripheral restarted) and the FIFO
+ *   pointers are cleared to resynchronise.
+ *
+ * All I2C goes through Max30105Bus, so the reader runs on a host against
+ * host/mock_max30105.h, a register model of the FIFO.
+ */
+
+#ifndef MAX30105_FIFO_H
+#define MAX30105_FIFO_H
+
+#ifdef ARDUINO
+#include <Arduino.h>
+#include <Wire.h>
+#define MAX30105_ISR_ATTR IRAM_ATTR
+#else
+#define MAX30105_ISR_ATTR
+#endif
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+#include <atomic>
+#include "spsc_ring.h"
+
+#define MAX30105_ADDRESS 0x57
+
+#define MAX30105_REG_INT_STATUS1 0x00
+#define MAX30105_REG_INT_ENABLE1 0x02
+#define MAX30105_REG_FIFO_WR_PTR 0x04
+#define MAX30105_REG_FIFO_OVF 0x05
+#define MAX30105_REG_FIFO_RD_PTR 0x06
+#define MAX30105_REG_FIFO_DATA 0x07
+#define MAX30105_REG_FIFO_CONFIG 0x08
+#define MAX30105_REG_MODE_CONFIG 0x09
+
+#define MAX30105_INT_A_FULL 0x80
+#define MAX30105_FIFO_DEPTH 32
+#define MAX30105_SAMPLE_MASK 0x3FFFF      // 18-bit ADC words
+
+#define MAX30105_RING_CAPACITY 64         // 2.5 s at 25 Hz
+#define MAX30105_BURST_THRESHOLD 17       // FIFO_A_FULL allows 17..32
+#define MAX30105_SERVICE_BUDGET_US 4000   // per service() call
+#define MAX30105_ERROR_LIMIT 3            // consecutive failures before bus recovery
+
+enum I2cResult : uint8_t {
+  I2C_OK = 0,
+  I2C_NACK = 1,         // address or register not acknowledged
+  I2C_TIMEOUT = 2,      // transfer exceeded the bus timeout
+  I2C_BUS_ERROR = 3     // arbitration lost, short read, other errors
+};
+
+/**
+ * Register access to one MAX30105
+ */
+class Max30105Bus {
+public:
+  virtual ~Max30105Bus() {}
+
+  /**
+   * Read len bytes starting at reg (FIFO_DATA does not auto-increment)
+   */
+  virtual I2cResult read(uint8_t reg, uint8_t* buf, size_t len) = 0;
+  virtual I2cResult write(uint8_t reg, uint8_t value) = 0;
+
+  /**
+   * Free a stuck bus and restart the controller
+   */
+  virtual bool recover() = 0;
+
+  /**
+   * Largest single read the controller supports
+   */
+  virtual size_t maxReadBytes() const = 0;
+};
+
+struct PpgSample {
+  uint32_t index;       // sample number since begin(), skips over lost samples
+  uint32_t time_us;     // micros() the sample was taken (estimated)
+  uint32_t red;
+  uint32_t ir;
+};
+
+struct PpgFifoStats {
+  uint32_t samples;         // samples pushed into the ring
+  uint32_t bursts;          // FIFO_DATA transactions
+  uint32_t interrupts;      // INT edges seen
+  uint32_t timer_reads;     // services triggered without an interrupt
+  uint32_t fifo_overflows;  // samples the sensor dropped (OVF_COUNTER)
+  uint32_t ring_overruns;   // samples lost because the ring was full
+  uint32_t i2c_errors;      // failed transfers (all kinds)
+  uint32_t i2c_timeouts;    // of which timeouts
+  uint32_t recoveries;      // bus recoveries performed
+  uint32_t max_service_us;  // longest service() call
+};
+
+class Max30105Fifo {
+private:
+  SpscRing<PpgSample, MAX30105_RING_CAPACITY> ring;
+  Max30105Bus* bus;
+
+  uint8_t channels;           // 3-byte words per sample (1..3)
+  uint8_t burst_threshold;
+  uint32_t period_us;         // time between FIFO samples
+  uint32_t poll_interval_us;  // service without interrupt after this long
+  bool use_interrupt;
+  bool rollover;              // FIFO_ROLLOVER_EN: overflow drops the oldest samples
+
+  uint32_t next_index;
+  uint32_t last_read_us;
+  uint8_t error_run;          // consecutive failed transfers
+
+  std::atomic<bool> irq_pending;
+  std::atomic<uint32_t> irq_count;
+
+  PpgFifoStats stats;
+
+#ifdef ARDUINO
+  int8_t int_pin;
+
+  static void MAX30105_ISR_ATTR onIntISR(void* arg) {
+    ((Max30105Fifo*)arg)->onInterrupt();
+  }
+#endif
+
+  /**
+   * Account for one transfer; recover the bus after a run of failures
+   * @return true if the transfer succeeded
+   */
+  bool check(I2cResult result) {
+    if (result == I2C_OK) {
+      error_run = 0;
+      return true;
+    }
+    stats.i2c_errors++;
+    if (result == I2C_TIMEOUT) {
+      stats.i2c_timeouts++;
+    }
+    if (++error_run >= MAX30105_ERROR_LIMIT) {
+      error_run = 0;
+      stats.recoveries++;
+      if (bus->recover()) {
+        clearFifo();
+      }
+    }
+    return false;
+  }
+
+  /**
+   * Reset the FIFO pointers (samples in the FIFO are discarded)
+   */
+  void clearFifo() {
+    bus->write(MAX30105_REG_FIFO_WR_PTR, 0);
+    bus->write(MAX30105_REG_FIFO_OVF, 0);
+    bus->write(MAX30105_REG_FIFO_RD_PTR, 0);
+  }
+
+  static uint32_t word18(const uint8_t* p) {
+    return (((uint32_t)p[0] << 16) | ((uint32_t)p[1] << 8) | p[2]) & MAX30105_SAMPLE_MASK;
+  }
+
+public:
+  Max30105Fifo() :
+    bus(nullptr),
+    channels(2),
+    burst_threshold(MAX30105_BURST_THRESHOLD),
+    period_us(0),
+    poll_interval_us(0),
+    use_interrupt(false),
+    rollover(true),
+    next_index(0),
+    last_read_us(0),
+    error_run(0),
+    irq_pending(false),
+    irq_count(0)
+#ifdef ARDUINO
+    , int_pin(-1)
+#endif
+  {
+    memset(&stats, 0, sizeof(stats));
+  }
+
+  /**
+   * Take over FIFO reads from a sensor already configured by setup()
+   * @param sample_period_us: time between FIFO samples (after averaging)
+   * @param threshold: samples in the FIFO that raise the interrupt (17..32)
+   * @param interrupt: true if INT is wired and onInterrupt() will be called
+   * @return false if the sensor did not answer
+   */
+  bool configure(Max30105Bus* sensor_bus, uint32_t sample_period_us,
+                 uint8_t threshold, bool interrupt, uint32_t now_us) {
+    bus = sensor_bus;
+    period_us = sample_period_us;
+    if (threshold < MAX30105_FIFO_DEPTH - 15) threshold = MAX30105_FIFO_DEPTH - 15;
+    if (threshold > MAX30105_FIFO_DEPTH) threshold = MAX30105_FIFO_DEPTH;
+    burst_threshold = threshold;
+    use_interrupt = interrupt;
+    // Interrupt mode: the timer only catches lost edges
+    poll_interval_us = period_us * burst_threshold * (interrupt ? 2 : 1);
+
+    ring.clear();
+    memset(&stats, 0, sizeof(stats));
+    next_index = 0;
+    error_run = 0;
+    irq_pending.store(false, std::memory_order_relaxed);
+    irq_count.store(0, std::memory_order_relaxed);
+
+    uint8_t mode = 0;
+    uint8_t fifo_config = 0;
+    if (bus->read(MAX30105_REG_MODE_CONFIG, &mode, 1) != I2C_OK ||
+        bus->read(MAX30105_REG_FIFO_CONFIG, &fifo_config, 1) != I2C_OK) {
+      return false;
+    }
+    mode &= 0x07;
+    channels = mode == 0x02 ? 1 : mode == 0x07 ? 3 : 2;
+    rollover = (fifo_config & 0x10) != 0;
+
+    // FIFO_A_FULL = free slots left when the interrupt fires
+    fifo_config = (fifo_config & 0xF0) | (uint8_t)(MAX30105_FIFO_DEPTH - burst_threshold);
+    if (bus->write(MAX30105_REG_FIFO_CONFIG, fifo_config) != I2C_OK ||
+        bus->write(MAX30105_REG_INT_ENABLE1, interrupt ? MAX30105_INT_A_FULL : 0) != I2C_OK) {
+      return false;
+    }
+    clearFifo();
+    last_read_us = now_us;
+    return true;
+  }
+
+  /**
+   * INT falling edge (ISR context)
+   */
+  void MAX30105_ISR_ATTR onInterrupt() {
+    irq_count.fetch_add(1, std::memory_order_relaxed);
+    irq_pending.store(true, std::memory_order_release);
+  }
+
+  /**
+   * Producer side: read the FIFO if the interrupt fired or the poll
+   * interval elapsed; never waits for data
+   * @return number of samples added to the ring
+   */
+  size_t service(uint32_t now_us) {
+    if (!bus || period_us == 0) {
+      return 0;
+    }
+    bool irq = irq_pending.exchange(false, std::memory_order_acquire);
+    if (!irq) {
+      if (now_us - last_read_us < poll_interval_us) {
+        return 0;
+      }
+      stats.timer_reads++;
+    }
+    last_read_us = now_us;
+
+    // INT_STATUS1..FIFO_RD_PTR: reading status also releases the INT line
+    uint8_t regs[7];
+    if (!check(bus->read(MAX30105_REG_INT_STATUS1, regs, sizeof(regs)))) {
+      return 0;
+    }
+    uint8_t wr = regs[MAX30105_REG_FIFO_WR_PTR] & 0x1F;
+    uint8_t ovf = regs[MAX30105_REG_FIFO_OVF] & 0x1F;
+    uint8_t rd = regs[MAX30105_REG_FIFO_RD_PTR] & 0x1F;
+
+    // Overflow means the FIFO is full (WR == RD) and ovf samples were lost:
+    // the oldest ones with rollover, otherwise the newest
+    size_t pending = ovf > 0 ? MAX30105_FIFO_DEPTH : (size_t)((wr - rd) & 0x1F);
+    stats.fifo_overflows += ovf;
+    if (rollover) {
+      next_index += ovf;
+    }
+
+    size_t sample_bytes = 3 * channels;
+    size_t burst_max = bus->maxReadBytes() / sample_bytes;
+    if (burst_max == 0) {
+      return 0;
+    }
+    if (burst_max > MAX30105_FIFO_DEPTH) {
+      burst_max = MAX30105_FIFO_DEPTH;
+    }
+
+    uint8_t data[MAX30105_FIFO_DEPTH * 9];
+    size_t added = 0;
+    size_t remaining = pending;
+    uint32_t start_us = now_us;
+    while (remaining > 0) {
+      size_t n = remaining < burst_max ? remaining : burst_max;
+      if (!check(bus->read(MAX30105_REG_FIFO_DATA, data, n * sample_bytes))) {
+        break;
+      }
+      stats.bursts++;
+
+      for (size_t i = 0; i < n; i++) {
+        const uint8_t* p = data + i * sample_bytes;
+        PpgSample s;
+        s.index = next_index++;
+        // Newest pending sample was taken about now; older ones one period apart
+        s.time_us = now_us - (uint32_t)(remaining - 1 - i) * period_us;
+        s.red = word18(p);
+        s.ir = channels > 1 ? word18(p + 3) : 0;
+        if (ring.push(s)) {
+          stats.samples++;
+          added++;
+        } else {
+          stats.ring_overruns++;
+        }
+      }
+      remaining -= n;
+
+#ifdef ARDUINO
+      uint32_t elapsed = (uint32_t)micros() - start_us;
+      if (elapsed > stats.max_service_us) {
+        stats.max_service_us = elapsed;
+      }
+      if (elapsed >= MAX30105_SERVICE_BUDGET_US && remaining > 0) {
+        irq_pending.store(true, std::memory_order_release);   // finish next call
+        break;
+      }
+#else
+      (void)start_us;
+#endif
+    }
+    if (!rollover) {
+      next_index += ovf;
+    }
+    return added;
+  }
+
+  /**
+   * Consumer side: oldest sample first
+   */
+  bool pop(PpgSample& out) {
+    return ring.pop(out);
+  }
+
+  size_t available() const { return ring.size(); }
+  uint32_t samplePeriodUs() const { return period_us; }
+  uint8_t threshold() const { return burst_threshold; }
+  bool interruptDriven() const { return use_interrupt; }
+
+  PpgFifoStats getStats() const {
+    PpgFifoStats s = stats;
+    s.interrupts = irq_count.load(std::memory_order_relaxed);
+    return s;
+  }
+
+#ifdef ARDUINO
+  /**
+   * Configure and attach the INT pin (-1: not wired, read on a timer)
+   */
+  bool begin(Max30105Bus* sensor_bus, uint32_t sample_period_us, int8_t pin) {
+    int_pin = pin;
+    bool interrupt = pin >= 0;
+    if (!configure(sensor_bus, sample_period_us, MAX30105_BURST_THRESHOLD,
+                   interrupt, (uint32_t)micros())) {
+      return false;
+    }
+    if (interrupt) {
+      pinMode(pin, INPUT_PULLUP);                  // INT is open drain
+      attachInterruptArg(digitalPinToInterrupt(pin), onIntISR, this, FALLING);
+    }
+    return true;
+  }
+
+  void end() {
+    if (int_pin >= 0) {
+      detachInterrupt(digitalPinToInterrupt(int_pin));
+      int_pin = -1;
+    }
+    bus = nullptr;
+  }
+#endif
+};
+
+#ifdef ARDUINO
+/**
+ * Max30105Bus on an Arduino TwoWire controller with a bounded timeout
+ */
+class WireMax30105Bus : public Max30105Bus {
+private:
+  TwoWire& wire;
+  int sda;
+  int scl;
+  uint32_t frequency;
+  uint16_t timeout_ms;
+
+  static I2cResult mapError(uint8_t err) {
+    switch (err) {
+      case 0: return I2C_OK;
+      case 2:
+      case 3: return I2C_NACK;
+      case 5: return I2C_TIMEOUT;
+      default: return I2C_BUS_ERROR;
+    }
+  }
+
+public:
+  WireMax30105Bus(TwoWire& bus, int sda_pin, int scl_pin, uint32_t hz, uint16_t timeout) :
+    wire(bus), sda(sda_pin), scl(scl_pin), frequency(hz), timeout_ms(timeout) {
+  }
+
+  void begin() {
+    wire.begin(sda, scl, frequency);
+    wire.setTimeOut(timeout_ms);
+  }
+
+  I2cResult read(uint8_t reg, uint8_t* buf, size_t len) override {
+    wire.beginTransmission(MAX30105_ADDRESS);
+    wire.write(reg);
+    I2cResult result = mapError(wire.endTransmission(false));
+    if (result != I2C_OK) {
+      return result;
+    }
+    size_t got = wire.requestFrom((uint8_t)MAX30105_ADDRESS, (uint8_t)len);
+    if (got != len) {
+      while (wire.available()) {
+        wire.read();
+      }
+      return got == 0 ? I2C_TIMEOUT : I2C_BUS_ERROR;
+    }
+    for (size_t i = 0; i < len; i++) {
+      buf[i] = (uint8_t)wire.read();
+    }
+    return I2C_OK;
+  }
+
+  I2cResult write(uint8_t reg, uint8_t value) override {
+    wire.beginTransmission(MAX30105_ADDRESS);
+    wire.write(reg);
+    wire.write(value);
+    return mapError(wire.endTransmission());
+  }
+
+  bool recover() override {
+    wire.end();
+    // Clock out a slave holding SDA low, then issue a STOP
+    pinMode(sda, INPUT_PULLUP);
+    pinMode(scl, OUTPUT_OPEN_DRAIN);
+    for (int i = 0; i < 9 && digitalRead(sda) == LOW; i++) {
+      digitalWrite(scl, LOW);
+      delayMicroseconds(5);
+      digitalWrite(scl, HIGH);
+      delayMicroseconds(5);
+    }
+    pinMode(sda, OUTPUT_OPEN_DRAIN);
+    digitalWrite(sda, LOW);
+    delayMicroseconds(5);
+    digitalWrite(scl, HIGH);
+    delayMicroseconds(5);
+    digitalWrite(sda, HIGH);
+    delayMicroseconds(5);
+    pinMode(sda, INPUT_PULLUP);
+    bool released = digitalRead(sda) == HIGH;
+    begin();
+    return released;
+  }
+
+  size_t maxReadBytes() const override {
+    return 126;    // I2C_BUFFER_LENGTH (128) with margin: 21 two-LED samples
+  }
+};
+#endif
+
+#endif // MAX30105_FIFO_H
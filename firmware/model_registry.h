@@ -0,0 +1,340 @@
+/*
+ * LifeBand Model Registry
+ * One backend per model, one shared feature vector per window, one evaluation per tick
+ *
+ * Each inference backend is bound to a single ModelSpec when it is
+ * constructed, so there is no "current model" to forget to select: the
+ * anemia backend can only ever run the anemia model. The registry owns the
+ * scheduling around them. The feature extractor (feature_window.h) emits
+ * one AiFeatures vector per aggregation window every second, due() says
+ * which models are due (and restarts their period), and run() executes
+ * each of them back-to-back against its window's vector:
+ *
+ *   AiFeatures f[FEATURE_WINDOW_COUNT] = {...};   // computed once
+ *   uint8_t due = registry.due(wanted, now_ms);
+ *   for each model in due: registry.run(model, f[spec.window], out)
+ *
+ * Each model reads its inputs from the vector by index (ModelSpec::features),
+ * so models that share an input, such as SDNN or HR, share the computation
+ * too; ModelSpec::window picks rhythm over the last 30 s or pregnancy risks
+ * over 5 minutes. run() standardizes the inputs with the constants stored
+ * with the model (InferenceBackend::standardization) before invoking; the
+ * rule fallbacks keep reading physical units. Per-model counters record
+ * runs, fallbacks (backend missing or failed; the caller then uses its
+ * rules) and skips (due but not wanted, for example on poor beats), along
+ * with invoke latency.
+ *
+ * Backends implement InferenceBackend: DenseInferenceEngine on the ESP32
+ * (dense_inference.h), TFLiteInferenceEngine with LIFEBAND_USE_TFLM
+ * (tflite_inference_eloquent.h), ReferenceInterpreter on a Linux host
+ * (host/reference_interpreter.h). Single owner (inference stage); no
+ * Arduino dependency.
+ */
+
+#ifndef MODEL_REGISTRY_H
+#define MODEL_REGISTRY_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+
+#ifdef LIFEBAND_USE_TFLM
+// Model headers - MUST be included BEFORE TensorFlow headers
+#include "models_h/arrhythmia_risk_model.h"
+#include "models_h/anemia_risk_model.h"
+#include "models_h/preeclampsia_risk_model.h"
+#define MODEL_FLATBUFFER(name) name##_risk_model_tflite, name##_risk_model_tflite_len
+#else
+// The dense build runs models_h/<name>_dense.h and leaves the flatbuffers out
+#define MODEL_FLATBUFFER(name) nullptr, 0
+#endif
+
+#define MODEL_MAX_INPUTS 8
+#define MODEL_MAX_OUTPUTS 8
+#define MODEL_BIT(type) (1u << (type))
+
+// Model types (registry index)
+enum ModelType : uint8_t {
+  MODEL_ARRHYTHMIA = 0,
+  MODEL_ANEMIA = 1,
+  MODEL_PREECLAMPSIA = 2,
+  MODEL_COUNT = 3
+};
+
+// Shared feature vector: every model input is one of these
+enum AiFeature : uint8_t {
+  AI_FEAT_ECG_HR = 0,       // BPM from ECG R-peaks
+  AI_FEAT_HR = 1,           // fused, averaged BPM
+  AI_FEAT_SDNN = 2,         // ms
+  AI_FEAT_RR_VARIANCE = 3,  // ms^2
+  AI_FEAT_QRS_WIDTH = 4,    // ms
+  AI_FEAT_R_AMPLITUDE = 5,  // ADC counts
+  AI_FEAT_SPO2 = 6,         // %
+  AI_FEAT_BP_SYS = 7,       // mmHg
+  AI_FEAT_BP_DIA = 8,       // mmHg
+  AI_FEATURE_COUNT = 9
+};
+
+// Aggregation windows (feature_window.h); each has its own AiFeatures
+enum FeatureWindow : uint8_t {
+  FEATURE_WINDOW_SHORT = 0, // 30 s
+  FEATURE_WINDOW_LONG = 1,  // 5 min
+  FEATURE_WINDOW_COUNT = 2
+};
+
+struct AiFeatures {
+  float v[AI_FEATURE_COUNT];
+};
+
+struct ModelSpec {
+  ModelType type;
+  const char* name;
+  const unsigned char* data;              // TFLite flatbuffer, nullptr unless LIFEBAND_USE_TFLM
+  uint32_t length;
+  uint8_t inputs;
+  uint8_t outputs;                        // classes, in RhythmType / RiskLevel order
+  uint8_t features[MODEL_MAX_INPUTS];     // AiFeature feeding each input
+  uint8_t window;                         // FeatureWindow the features are taken from
+  uint32_t period_ms;                     // minimum spacing of runs, 0 = every evaluation
+  uint32_t arena_bytes;                   // provisional TFLM arena budget (tensor_arena.h)
+};
+
+// Estimate, not yet checked against arena_used_bytes() on the device;
+// the boot report flags a model that uses more
+#define MODEL_ARENA_BUDGET 2048
+
+// constexpr so the tensor arena can be sized from it at compile time
+static constexpr ModelSpec MODEL_REGISTRY[MODEL_COUNT] = {
+  { MODEL_ARRHYTHMIA, "Arrhythmia", MODEL_FLATBUFFER(arrhythmia), 5, 5,
+    { AI_FEAT_ECG_HR, AI_FEAT_SDNN, AI_FEAT_RR_VARIANCE, AI_FEAT_QRS_WIDTH, AI_FEAT_R_AMPLITUDE },
+    FEATURE_WINDOW_SHORT, 0, MODEL_ARENA_BUDGET },
+  { MODEL_ANEMIA, "Anemia", MODEL_FLATBUFFER(anemia), 5, 4,
+    { AI_FEAT_SPO2, AI_FEAT_HR, AI_FEAT_SDNN, AI_FEAT_BP_SYS, AI_FEAT_BP_DIA },
+    FEATURE_WINDOW_LONG, 5000, MODEL_ARENA_BUDGET },
+  { MODEL_PREECLAMPSIA, "Preeclampsia", MODEL_FLATBUFFER(preeclampsia), 5, 4,
+    { AI_FEAT_BP_SYS, AI_FEAT_BP_DIA, AI_FEAT_HR, AI_FEAT_SDNN, AI_FEAT_SPO2 },
+    FEATURE_WINDOW_LONG, 5000, MODEL_ARENA_BUDGET }
+};
+
+/**
+ * Runs one model, fixed at construction
+ */
+class InferenceBackend {
+public:
+  virtual ~InferenceBackend() {}
+
+  virtual const ModelSpec& spec() const = 0;
+
+  /**
+   * What runs the model, for logs (e.g. "dense int8")
+   */
+  virtual const char* name() const = 0;
+
+  /**
+   * Load the model (at boot, and again after a model swap)
+   */
+  virtual bool begin() = 0;
+
+  /**
+   * @param input: spec().inputs values
+   * @param output: receives spec().outputs class probabilities
+   */
+  virtual bool invoke(const float* input, float* output) = 0;
+
+  /**
+   * Standardization stored with the model: input = (feature - mean) * scale
+   * @return false if the model takes raw features
+   */
+  virtual bool standardization(const float*& mean, const float*& scale) const {
+    (void)mean;
+    (void)scale;
+    return false;
+  }
+};
+
+struct ModelOutput {
+  uint8_t predicted;        // argmax
+  float confidence;         // 0-100
+  float probs[MODEL_MAX_OUTPUTS];
+};
+
+struct ModelStats {
+  bool loaded;
+  uint32_t runs;            // successful invocations
+  uint32_t fallbacks;       // not loaded or invoke failed: caller used rules
+  uint32_t skipped;         // due but not wanted (poor beats, missing input)
+  uint32_t last_us;         // invoke latency
+  uint32_t max_us;
+  uint32_t mean_us;
+};
+
+typedef unsigned long (*MicrosClock)();
+
+class ModelRegistry {
+private:
+  struct Slot {
+    InferenceBackend* backend;
+    bool has_run;
+    uint32_t last_run_ms;
+    uint64_t sum_us;
+    ModelStats stats;
+  };
+
+  Slot slots[MODEL_COUNT];
+  MicrosClock clock;
+
+public:
+  explicit ModelRegistry(MicrosClock micros_clock) :
+    clock(micros_clock) {
+    memset(slots, 0, sizeof(slots));
+  }
+
+  /**
+   * Attach a backend to its model's slot
+   * @return false if the model's slot is already taken
+   */
+  bool bind(InferenceBackend* backend) {
+    if (!backend) {
+      return false;
+    }
+    const ModelSpec& spec = backend->spec();
+    if (spec.type >= MODEL_COUNT || slots[spec.type].backend) {
+      return false;
+    }
+    slots[spec.type].backend = backend;
+    return true;
+  }
+
+  /**
+   * Load every bound model
+   * @return MODEL_BIT mask of models that loaded
+   */
+  uint8_t begin() {
+    uint8_t loaded = 0;
+    for (uint8_t i = 0; i < MODEL_COUNT; i++) {
+      Slot& s = slots[i];
+      s.stats.loaded = s.backend && s.backend->begin();
+      if (s.stats.loaded) {
+        loaded |= MODEL_BIT(i);
+      }
+    }
+    return loaded;
+  }
+
+  /**
+   * Load one model again after its backend changed (model swap)
+   * @return true if it loaded
+   */
+  bool reload(ModelType type) {
+    if (type >= MODEL_COUNT) {
+      return false;
+    }
+    Slot& s = slots[type];
+    s.stats.loaded = s.backend && s.backend->begin();
+    return s.stats.loaded;
+  }
+
+  /**
+   * Models whose period has elapsed; those in wanted have their period
+   * restarted, the others are counted as skipped
+   * @return MODEL_BIT mask of models to run now
+   */
+  uint8_t due(uint8_t wanted, uint32_t now_ms) {
+    uint8_t result = 0;
+    for (uint8_t i = 0; i < MODEL_COUNT; i++) {
+      Slot& s = slots[i];
+      if (s.has_run && now_ms - s.last_run_ms < MODEL_REGISTRY[i].period_ms) {
+        continue;
+      }
+      if (!(wanted & MODEL_BIT(i))) {
+        s.stats.skipped++;
+        continue;
+      }
+      s.has_run = true;
+      s.last_run_ms = now_ms;
+      result |= MODEL_BIT(i);
+    }
+    return result;
+  }
+
+  /**
+   * Gather the model's inputs from its window's vector, standardize them
+   * and invoke the model
+   * @return false if the caller must fall back to rules
+   */
+  bool run(ModelType type, const AiFeatures& features, ModelOutput& out) {
+    if (type >= MODEL_COUNT) {
+      return false;
+    }
+    Slot& s = slots[type];
+    const ModelSpec& spec = MODEL_REGISTRY[type];
+    if (!s.stats.loaded) {
+      s.stats.fallbacks++;
+      return false;
+    }
+
+    float input[MODEL_MAX_INPUTS];
+    const float* mean;
+    const float* scale;
+    bool standardized = s.backend->standardization(mean, scale);
+    for (uint8_t i = 0; i < spec.inputs; i++) {
+      input[i] = features.v[spec.features[i]];
+      if (standardized) {
+        input[i] = (input[i] - mean[i]) * scale[i];
+      }
+    }
+    memset(out.probs, 0, sizeof(out.probs));
+
+    uint32_t start = clock();
+    bool ok = s.backend->invoke(input, out.probs);
+    uint32_t elapsed = (uint32_t)clock() - start;
+    if (!ok) {
+      s.stats.fallbacks++;
+      return false;
+    }
+
+    s.stats.runs++;
+    s.stats.last_us = elapsed;
+    if (elapsed > s.stats.max_us) {
+      s.stats.max_us = elapsed;
+    }
+    s.sum_us += elapsed;
+    s.stats.mean_us = (uint32_t)(s.sum_us / s.stats.runs);
+
+    out.predicted = 0;
+    for (uint8_t i = 1; i < spec.outputs; i++) {
+      if (out.probs[i] > out.probs[out.predicted]) {
+        out.predicted = i;
+      }
+    }
+    out.confidence = out.probs[out.predicted] * 100.0f;
+    return true;
+  }
+
+  /**
+   * Skip a model that was due but had no usable input
+   */
+  void skip(ModelType type) {
+    if (type < MODEL_COUNT) {
+      slots[type].stats.skipped++;
+    }
+  }
+
+  bool isLoaded(ModelType type) const {
+    return type < MODEL_COUNT && slots[type].stats.loaded;
+  }
+
+  /**
+   * @return name of the backend bound to the model, "none" if unbound
+   */
+  const char* backendName(ModelType type) const {
+    const InferenceBackend* backend = type < MODEL_COUNT ? slots[type].backend : nullptr;
+    return backend ? backend->name() : "none";
+  }
+
+  ModelStats getStats(ModelType type) const {
+    return slots[type < MODEL_COUNT ? type : 0].stats;
+  }
+};
+
+#endif // MODEL_REGISTRY_H
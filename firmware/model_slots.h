@@ -0,0 +1,702 @@
+/*
+ * LifeBand Model Slots
+ * Versioned model images in a flash partition, mapped in place, with A/B rollback
+ *
+ * The weights in models_h/ are compiled into the firmware, so a model
+ * update meant reflashing everything. ModelSlots keeps uploaded images in
+ * a dedicated data partition ("models", partitions.csv) with two slots per
+ * model. The partition is memory-mapped read-only (esp_partition_mmap on
+ * the ESP32, mmap() of the image file on a host) and the dense engine reads
+ * weights straight from the mapping: activating a model builds a small
+ * DenseLayer table in RAM and copies no weights.
+ *
+ *   partition  MODEL_COUNT x MODEL_SLOTS_PER_MODEL slots of
+ *              MODEL_SLOT_SECTORS sectors, model-major (A, B, A, B, ...)
+ *   slot       [0] u32 sequence  [4] u32 image bytes  [8] u32 CRC-32 of
+ *              [0..8)  [12] u8 state  [13..16) 0xFF, then the image at 16
+ *   image      32-byte header, MODEL_IMAGE_LAYER bytes per layer, then per
+ *              layer w_f32, w_i8, scale_i8, bias (dense_engine.h layout,
+ *              each 16-byte aligned) and the optional input standardization
+ *              (f32 mean[inputs], f32 scale[inputs]); convert_dense_models.py
+ *              --image
+ *
+ * Image header, little-endian:
+ *   [0] u32 magic "LBMD"   [4] u8 format   [5] u8 ModelType   [6] u8 layers
+ *   [7] u8 flags           [8] u16 inputs  [10] u16 outputs   [12] u32 version
+ *   [16] u32 image bytes   [20] u32 CRC-32 of [32..image bytes)
+ *   [24] u32 offset of the standardization, 0 = raw features (format 2;
+ *        reserved in format 1)                 [28] u32 CRC-32 of [0..28)
+ * Layer entry: [0] u16 inputs  [2] u16 outputs  [4] u8 DenseActivation
+ *              [8] u32 offset of the layer's arrays from the image start
+ *
+ * A slot's state byte only ever loses bits, one per step, so a write cut
+ * by power loss leaves either the old or the new state:
+ *
+ *   0xFF  erased or being uploaded
+ *   WRITTEN    image complete and checked, committed with its sequence
+ *   TRIAL      activated, not yet confirmed
+ *   CONFIRMED  ran MODEL_SLOT_CONFIRM_RUNS times without a failure
+ *   REJECTED   failed validation or its trial, or rolled back; never used again
+ *
+ * select() activates the newest usable slot of a model: committed, not
+ * rejected, and passing validate() (magic, format, both CRCs, model type,
+ * shapes against MODEL_REGISTRY, layer layout, DenseEngine::validate()).
+ * A slot still in TRIAL at mount() was running when the device restarted
+ * and is rejected, so an image that crashes the firmware falls back to the
+ * other slot, or to the built-in weights, on the next boot.
+ *
+ * Uploads arrive on the CONFIG characteristic as binary frames (first byte
+ * MODEL_XFER_BEGIN..ABORT, never printable) and always go to the slot that
+ * is not active; the running model is untouched until finishUpload() has
+ * verified the image in flash and select() switches to it. BEGIN only
+ * picks the slot (ERASING); the owner erases it one sector per
+ * serviceErase() call, each a flash stall it schedules like any other
+ * erase, and the upload is RECEIVING once the slot is blank. The status
+ * echoes the transfer id, model and size of the BEGIN it belongs to, so
+ * the phone can tell it from the status an earlier attempt left behind.
+ *
+ * Single owner (inference stage); no heap; no Arduino dependency beyond
+ * block_device.h.
+ */
+
+#ifndef MODEL_SLOTS_H
+#define MODEL_SLOTS_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+#include <math.h>
+#include "block_device.h"
+#include "model_registry.h"
+#include "dense_engine.h"
+#include "vitals_frame.h"
+
+#define MODEL_PARTITION_LABEL "models"
+#define MODEL_IMAGE_MAGIC 0x444D424CUL    // "LBMD"
+#define MODEL_IMAGE_FORMAT 2              // 2 added the input standardization; 1 still loads
+#define MODEL_IMAGE_HEADER 32
+#define MODEL_IMAGE_LAYER 16
+#define MODEL_IMAGE_MAX_LAYERS 4
+
+#define MODEL_SLOT_HEADER 16
+#define MODEL_SLOT_SECTORS 2              // 8 KB per slot
+#define MODEL_SLOTS_PER_MODEL 2           // A/B
+#define MODEL_SLOT_COUNT (MODEL_COUNT * MODEL_SLOTS_PER_MODEL)
+#define MODEL_SLOT_CONFIRM_RUNS 16        // clean runs before a trial is kept
+
+#define MODEL_SLOT_WRITTEN 0x80           // state bits, cleared in this order
+#define MODEL_SLOT_TRIAL 0x40
+#define MODEL_SLOT_CONFIRMED 0x20
+#define MODEL_SLOT_REJECTED 0x01          // may be cleared from any state
+
+#define MODEL_XFER_BEGIN 0xB0             // u8 model, u32 image bytes, u32 image CRC-32, u8 transfer id
+#define MODEL_XFER_DATA 0xB1              // u32 offset, data
+#define MODEL_XFER_END 0xB2
+#define MODEL_XFER_ABORT 0xB3
+#define MODEL_XFER_STATUS 0xB5            // first byte of the status read from CONFIG
+#define MODEL_XFER_STATUS_SIZE 20
+#define MODEL_XFER_CHUNK 177              // data bytes per frame: 185-byte MTU - 3 ATT - 5 frame header
+
+enum ModelXferState : uint8_t {
+  MODEL_XFER_IDLE = 0,
+  MODEL_XFER_RECEIVING = 1,
+  MODEL_XFER_DONE = 2,                    // committed; activation result in error
+  MODEL_XFER_FAILED = 3,
+  MODEL_XFER_ERASING = 4                  // BEGIN accepted, slot not yet erased
+};
+
+enum ModelXferError : uint8_t {
+  MODEL_XFER_OK = 0,
+  MODEL_XFER_ERR_UNMOUNTED = 1,           // no models partition
+  MODEL_XFER_ERR_REQUEST = 2,             // bad frame, model or state
+  MODEL_XFER_ERR_SIZE = 3,                // image larger than a slot
+  MODEL_XFER_ERR_OFFSET = 4,              // chunk out of order: resume from next_offset
+  MODEL_XFER_ERR_FLASH = 5,
+  MODEL_XFER_ERR_CRC = 6,                 // image in flash does not match the BEGIN CRC
+  MODEL_XFER_ERR_INVALID = 7,             // schema, shape or layout check failed
+  MODEL_XFER_ERR_ACTIVATE = 8             // committed but the engine refused it (rolled back)
+};
+
+/**
+ * One CONFIG transfer frame, queued from the BLE task to the inference stage
+ */
+struct ModelXferMsg {
+  uint8_t op;               // MODEL_XFER_BEGIN..ABORT
+  uint8_t model;            // BEGIN
+  uint8_t id;               // BEGIN: transfer id chosen by the phone, 0 if absent
+  uint8_t length;           // DATA bytes
+  uint32_t value;           // BEGIN: image bytes, DATA: offset
+  uint32_t crc;             // BEGIN
+  uint8_t data[MODEL_XFER_CHUNK];
+};
+
+struct ModelXferStatus {
+  uint8_t state;            // ModelXferState
+  uint8_t model;
+  uint8_t error;            // ModelXferError
+  uint8_t slot;             // target slot (0 = A, 1 = B)
+  uint8_t id;               // transfer id of the BEGIN
+  uint32_t next_offset;     // bytes received in order
+  uint32_t bytes;           // image size announced by BEGIN
+  uint32_t version;         // image version once committed
+};
+
+struct ModelSlotStats {
+  uint32_t activations;     // select() that found a usable slot
+  uint32_t rollbacks;       // trials rejected at mount() or by reject()
+  uint32_t invalid;         // slots that failed validation
+  uint32_t uploads;         // images committed
+  uint32_t last_activate_us;// validate + map of the last activation
+  uint32_t max_activate_us;
+  uint32_t swap_ram;        // bytes of RAM an activation uses (layer table)
+};
+
+class ModelSlots {
+private:
+  struct SlotInfo {
+    uint32_t sequence;
+    uint32_t image_bytes;
+    uint8_t state;
+    bool committed;         // header CRC valid and WRITTEN reached
+  };
+
+  struct Trial {
+    bool active;
+    uint32_t runs;          // registry counters when the trial began
+    uint32_t fallbacks;
+  };
+
+  BlockDevice* dev;
+  const uint8_t* map;       // whole partition, read-only
+  uint32_t slot_bytes;
+  bool mounted;
+  MicrosClock clock;
+
+  SlotInfo slots[MODEL_SLOT_COUNT];
+  int8_t active[MODEL_COUNT];             // slot index, -1 = built-in weights
+  uint32_t active_version[MODEL_COUNT];
+  DenseLayer layers[MODEL_COUNT][MODEL_IMAGE_MAX_LAYERS];
+  DenseNetwork networks[MODEL_COUNT];
+  Trial trials[MODEL_COUNT];
+
+  ModelXferStatus xfer;
+  uint32_t xfer_crc;
+  uint8_t erase_next;                     // next sector of the target slot to erase
+
+  ModelSlotStats stats;
+
+  uint32_t slotOffset(uint8_t slot) const {
+    return (uint32_t)slot * slot_bytes;
+  }
+
+  const uint8_t* slotImage(uint8_t slot) const {
+    return map + slotOffset(slot) + MODEL_SLOT_HEADER;
+  }
+
+  void readSlot(uint8_t slot) {
+    SlotInfo& s = slots[slot];
+    const uint8_t* h = map + slotOffset(slot);
+    s.sequence = vitalsGet32(h);
+    s.image_bytes = vitalsGet32(h + 4);
+    s.state = h[12];
+    s.committed = vitalsGet32(h + 8) == crc32(h, 8) && !(s.state & MODEL_SLOT_WRITTEN) &&
+                  s.image_bytes <= slot_bytes - MODEL_SLOT_HEADER;
+  }
+
+  /**
+   * Clear one state bit (NOR program: the other bits are left alone)
+   */
+  bool setState(uint8_t slot, uint8_t bit) {
+    uint8_t value = (uint8_t)(slots[slot].state & ~bit);
+    if (value == slots[slot].state) {
+      return true;
+    }
+    if (!dev->program(slotOffset(slot) + 12, &value, 1)) {
+      return false;
+    }
+    slots[slot].state = value;
+    return true;
+  }
+
+  bool usable(uint8_t slot) const {
+    return slots[slot].committed && (slots[slot].state & MODEL_SLOT_REJECTED);
+  }
+
+  void fail(ModelXferError error) {
+    xfer.state = MODEL_XFER_FAILED;
+    xfer.error = error;
+  }
+
+public:
+  explicit ModelSlots(MicrosClock micros_clock) :
+    dev(nullptr),
+    map(nullptr),
+    slot_bytes(0),
+    mounted(false),
+    clock(micros_clock),
+    xfer_crc(0),
+    erase_next(0) {
+    memset(slots, 0, sizeof(slots));
+    memset(active, -1, sizeof(active));
+    memset(active_version, 0, sizeof(active_version));
+    memset(layers, 0, sizeof(layers));
+    memset(networks, 0, sizeof(networks));
+    memset(trials, 0, sizeof(trials));
+    memset(&xfer, 0, sizeof(xfer));
+    memset(&stats, 0, sizeof(stats));
+    stats.swap_ram = sizeof(layers[0]) + sizeof(networks[0]);
+  }
+
+  /**
+   * CRC-32 (IEEE, as zlib.crc32), nibble table
+   */
+  static uint32_t crc32(const uint8_t* data, size_t len, uint32_t crc = 0) {
+    static const uint32_t table[16] = {
+      0x00000000, 0x1DB71064, 0x3B6E20C8, 0x26D930AC, 0x76DC4190, 0x6B6B51F4, 0x4DB26158, 0x5005713C,
+      0xEDB88320, 0xF00F9344, 0xD6D6A3E8, 0xCB61B38C, 0x9B64C2B0, 0x86D3D2D4, 0xA00AE278, 0xBDBDF21C
+    };
+    crc = ~crc;
+    for (size_t i = 0; i < len; i++) {
+      crc = (crc >> 4) ^ table[(crc ^ data[i]) & 0x0F];
+      crc = (crc >> 4) ^ table[(crc ^ (data[i] >> 4)) & 0x0F];
+    }
+    return ~crc;
+  }
+
+  /**
+   * Check an image and describe it as a network whose weights point into it
+   * @param image: 16-byte aligned (a slot in the mapping)
+   * @param table: receives the layers (MODEL_IMAGE_MAX_LAYERS entries)
+   * @return false if any check fails; net and table are then unusable
+   */
+  static bool validate(const uint8_t* image, uint32_t bytes, ModelType type,
+                       DenseLayer* table, DenseNetwork& net, uint32_t* version = nullptr) {
+    if (bytes < MODEL_IMAGE_HEADER || ((uintptr_t)image % DENSE_ALIGN) ||
+        vitalsGet32(image) != MODEL_IMAGE_MAGIC || image[4] == 0 || image[4] > MODEL_IMAGE_FORMAT ||
+        vitalsGet32(image + 28) != crc32(image, 28)) {
+      return false;
+    }
+    uint32_t image_bytes = vitalsGet32(image + 16);
+    uint8_t count = image[6];
+    const ModelSpec& spec = MODEL_REGISTRY[type < MODEL_COUNT ? type : 0];
+    if (image[5] != type || type >= MODEL_COUNT || image_bytes > bytes ||
+        count == 0 || count > MODEL_IMAGE_MAX_LAYERS ||
+        image_bytes < MODEL_IMAGE_HEADER + (uint32_t)count * MODEL_IMAGE_LAYER ||
+        vitalsGet16(image + 8) != spec.inputs || vitalsGet16(image + 10) != spec.outputs ||
+        vitalsGet32(image + 20) != crc32(image + MODEL_IMAGE_HEADER, image_bytes - MODEL_IMAGE_HEADER)) {
+      return false;
+    }
+
+    for (uint8_t k = 0; k < count; k++) {
+      const uint8_t* e = image + MODEL_IMAGE_HEADER + k * MODEL_IMAGE_LAYER;
+      DenseLayer& l = table[k];
+      l.inputs = vitalsGet16(e);
+      l.outputs = vitalsGet16(e + 2);
+      l.activation = (DenseActivation)e[4];
+      l.rows = denseStride(l.outputs, DENSE_LANES_F32);
+      l.stride_f32 = denseStride(l.inputs, DENSE_LANES_F32);
+      l.stride_i8 = denseStride(l.inputs, DENSE_LANES_I8);
+      uint32_t offset = vitalsGet32(e + 8);
+      uint32_t f32_bytes = (uint32_t)l.rows * l.stride_f32 * sizeof(float);
+      uint32_t i8_bytes = (uint32_t)l.rows * l.stride_i8;
+      uint32_t vec_bytes = (uint32_t)l.rows * sizeof(float);
+      if (l.activation > DENSE_SOFTMAX || l.inputs > DENSE_MAX_WIDTH || l.outputs > DENSE_MAX_WIDTH ||
+          offset % DENSE_ALIGN || offset < MODEL_IMAGE_HEADER + (uint32_t)count * MODEL_IMAGE_LAYER ||
+          offset + f32_bytes + i8_bytes + 2 * vec_bytes > image_bytes) {
+        return false;
+      }
+      l.w_f32 = (const float*)(image + offset);
+      l.w_i8 = (const int8_t*)(image + offset + f32_bytes);
+      l.scale_i8 = (const float*)(image + offset + f32_bytes + i8_bytes);
+      l.bias = (const float*)(image + offset + f32_bytes + i8_bytes + vec_bytes);
+    }
+    net.layers = count;
+    net.inputs = spec.inputs;
+    net.outputs = spec.outputs;
+    net.layer = table;
+    net.input_mean = nullptr;
+    net.input_scale = nullptr;
+    uint32_t norm = image[4] >= 2 ? vitalsGet32(image + 24) : 0;
+    if (norm) {
+      uint32_t vec_bytes = (uint32_t)spec.inputs * sizeof(float);
+      if (norm % sizeof(float) || norm < MODEL_IMAGE_HEADER || norm + 2 * vec_bytes > image_bytes) {
+        return false;
+      }
+      net.input_mean = (const float*)(image + norm);
+      net.input_scale = (const float*)(image + norm + vec_bytes);
+      for (uint8_t i = 0; i < spec.inputs; i++) {
+        if (!isfinite(net.input_mean[i]) || !isfinite(net.input_scale[i])) {
+          return false;
+        }
+      }
+    }
+    if (version) {
+      *version = vitalsGet32(image + 12);
+    }
+    return DenseEngine::validate(net);
+  }
+
+  /**
+   * Map the partition and read the slot headers; trials that never got
+   * confirmed are rolled back here
+   * @return false if the device is too small or cannot be mapped
+   */
+  bool mount(BlockDevice* device) {
+    mounted = false;
+    dev = device;
+    if (!dev) {
+      return false;
+    }
+    slot_bytes = dev->sectorSize() * MODEL_SLOT_SECTORS;
+    map = dev->mapReadOnly();
+    if (!map || dev->sectorCount() < (uint32_t)MODEL_SLOT_COUNT * MODEL_SLOT_SECTORS) {
+      return false;
+    }
+    for (uint8_t s = 0; s < MODEL_SLOT_COUNT; s++) {
+      readSlot(s);
+      if (usable(s) && !(slots[s].state & MODEL_SLOT_TRIAL) && (slots[s].state & MODEL_SLOT_CONFIRMED)) {
+        setState(s, MODEL_SLOT_REJECTED);
+        stats.rollbacks++;
+      }
+    }
+    memset(active, -1, sizeof(active));
+    mounted = true;
+    return true;
+  }
+
+  /**
+   * Activate the newest usable slot of a model (a committed slot enters
+   * its trial); slots that fail validation are rejected on the way
+   * @return false if none is usable: run the built-in weights
+   */
+  bool select(ModelType type) {
+    if (!mounted || type >= MODEL_COUNT) {
+      return false;
+    }
+    uint32_t start = clock();
+    active[type] = -1;
+    trials[type].active = false;
+    for (;;) {
+      int8_t best = -1;
+      for (uint8_t ab = 0; ab < MODEL_SLOTS_PER_MODEL; ab++) {
+        uint8_t s = type * MODEL_SLOTS_PER_MODEL + ab;
+        if (usable(s) && (best < 0 || slots[s].sequence > slots[best].sequence)) {
+          best = s;
+        }
+      }
+      if (best < 0) {
+        return false;
+      }
+      if (!validate(slotImage(best), slots[best].image_bytes, type, layers[type], networks[type],
+                    &active_version[type])) {
+        setState(best, MODEL_SLOT_REJECTED);
+        stats.invalid++;
+        continue;
+      }
+      if ((slots[best].state & MODEL_SLOT_TRIAL) && !setState(best, MODEL_SLOT_TRIAL)) {
+        return false;
+      }
+      active[type] = best;
+      stats.activations++;
+      stats.last_activate_us = (uint32_t)clock() - start;
+      if (stats.last_activate_us > stats.max_activate_us) {
+        stats.max_activate_us = stats.last_activate_us;
+      }
+      return true;
+    }
+  }
+
+  /**
+   * Network of the active slot, weights in the mapping (nullptr: built-in)
+   */
+  const DenseNetwork* network(ModelType type) const {
+    return type < MODEL_COUNT && active[type] >= 0 ? &networks[type] : nullptr;
+  }
+
+  int8_t activeSlot(ModelType type) const {
+    return type < MODEL_COUNT ? active[type] : -1;
+  }
+
+  uint32_t activeVersion(ModelType type) const {
+    return network(type) ? active_version[type] : 0;
+  }
+
+  /**
+   * Start counting the active slot's trial from the registry's counters
+   */
+  void startTrial(ModelType type, uint32_t runs, uint32_t fallbacks) {
+    if (type >= MODEL_COUNT || active[type] < 0 || !(slots[active[type]].state & MODEL_SLOT_CONFIRMED)) {
+      return;
+    }
+    trials[type].active = true;
+    trials[type].runs = runs;
+    trials[type].fallbacks = fallbacks;
+  }
+
+  /**
+   * Confirm a trial after MODEL_SLOT_CONFIRM_RUNS clean runs
+   * @return false if the trial failed: reject() and select() again
+   */
+  bool checkTrial(ModelType type, uint32_t runs, uint32_t fallbacks) {
+    if (type >= MODEL_COUNT || !trials[type].active) {
+      return true;
+    }
+    if (fallbacks != trials[type].fallbacks) {
+      return false;
+    }
+    if (runs - trials[type].runs >= MODEL_SLOT_CONFIRM_RUNS) {
+      setState(active[type], MODEL_SLOT_CONFIRMED);
+      trials[type].active = false;
+    }
+    return true;
+  }
+
+  /**
+   * Reject the active slot; select() then falls back to the other slot or
+   * the built-in weights
+   */
+  void reject(ModelType type) {
+    if (type >= MODEL_COUNT || active[type] < 0) {
+      return;
+    }
+    setState(active[type], MODEL_SLOT_REJECTED);
+    active[type] = -1;
+    trials[type].active = false;
+    stats.rollbacks++;
+  }
+
+  // ==================== UPLOAD ====================
+
+  /**
+   * Pick the model's inactive slot for a new image; serviceErase() then
+   * erases it
+   * @param id: the phone's transfer id, echoed in the status
+   */
+  bool beginUpload(ModelType type, uint32_t bytes, uint32_t crc, uint8_t id = 0) {
+    memset(&xfer, 0, sizeof(xfer));
+    xfer.model = type;
+    xfer.bytes = bytes;
+    xfer.id = id;
+    if (!mounted) {
+      fail(MODEL_XFER_ERR_UNMOUNTED);
+      return false;
+    }
+    if (type >= MODEL_COUNT) {
+      fail(MODEL_XFER_ERR_REQUEST);
+      return false;
+    }
+    if (bytes < MODEL_IMAGE_HEADER || bytes > slot_bytes - MODEL_SLOT_HEADER) {
+      fail(MODEL_XFER_ERR_SIZE);
+      return false;
+    }
+    // Never the active slot; with none active, the older (or unused) one
+    uint8_t a = type * MODEL_SLOTS_PER_MODEL;
+    uint8_t target;
+    if (active[type] >= 0) {
+      target = active[type] == a ? a + 1 : a;
+    } else {
+      target = !usable(a) || (usable(a + 1) && slots[a + 1].sequence > slots[a].sequence) ? a : a + 1;
+    }
+    xfer.slot = target - a;
+    xfer.state = MODEL_XFER_ERASING;
+    xfer_crc = crc;
+    erase_next = 0;
+    return true;
+  }
+
+  bool needsErase() const {
+    return xfer.state == MODEL_XFER_ERASING;
+  }
+
+  /**
+   * Erase the next sector of the upload's slot (one flash stall); the
+   * upload is RECEIVING once the last one is done
+   */
+  bool serviceErase() {
+    if (xfer.state != MODEL_XFER_ERASING) {
+      return false;
+    }
+    uint8_t slot = xfer.model * MODEL_SLOTS_PER_MODEL + xfer.slot;
+    if (!dev->erase(slot * MODEL_SLOT_SECTORS + erase_next)) {
+      fail(MODEL_XFER_ERR_FLASH);
+      return false;
+    }
+    readSlot(slot);                       // no longer committed once the header sector is gone
+    if (++erase_next == MODEL_SLOT_SECTORS) {
+      xfer.state = MODEL_XFER_RECEIVING;
+      xfer.error = MODEL_XFER_OK;
+    }
+    return true;
+  }
+
+  /**
+   * Program one chunk; chunks must arrive in order
+   */
+  bool writeUpload(uint32_t offset, const uint8_t* data, size_t len) {
+    if (xfer.state == MODEL_XFER_ERASING) {
+      xfer.error = MODEL_XFER_ERR_OFFSET;   // early; resent from 0 once RECEIVING
+      return false;
+    }
+    if (xfer.state != MODEL_XFER_RECEIVING) {
+      return false;
+    }
+    if (offset != xfer.next_offset) {
+      xfer.error = MODEL_XFER_ERR_OFFSET;   // still receiving: the phone resumes from next_offset
+      return false;
+    }
+    if (offset + len > xfer.bytes) {
+      fail(MODEL_XFER_ERR_SIZE);
+      return false;
+    }
+    uint8_t slot = xfer.model * MODEL_SLOTS_PER_MODEL + xfer.slot;
+    if (!dev->program(slotOffset(slot) + MODEL_SLOT_HEADER + offset, data, len)) {
+      fail(MODEL_XFER_ERR_FLASH);
+      return false;
+    }
+    xfer.next_offset += len;
+    xfer.error = MODEL_XFER_OK;
+    return true;
+  }
+
+  /**
+   * Verify the image as it reads back from flash and commit the slot as
+   * the model's newest; select() activates it
+   */
+  bool finishUpload() {
+    if (xfer.state != MODEL_XFER_RECEIVING || xfer.next_offset != xfer.bytes) {
+      fail(MODEL_XFER_ERR_REQUEST);
+      return false;
+    }
+    ModelType type = (ModelType)xfer.model;
+    uint8_t a = type * MODEL_SLOTS_PER_MODEL;
+    uint8_t slot = a + xfer.slot;
+    const uint8_t* image = slotImage(slot);
+    if (crc32(image, xfer.bytes) != xfer_crc) {
+      fail(MODEL_XFER_ERR_CRC);
+      return false;
+    }
+    DenseLayer table[MODEL_IMAGE_MAX_LAYERS];
+    DenseNetwork net;
+    if (!validate(image, xfer.bytes, type, table, net, &xfer.version)) {
+      fail(MODEL_XFER_ERR_INVALID);
+      stats.invalid++;
+      return false;
+    }
+
+    uint32_t sequence = 0;
+    for (uint8_t ab = 0; ab < MODEL_SLOTS_PER_MODEL; ab++) {
+      if (slots[a + ab].committed && slots[a + ab].sequence > sequence) {
+        sequence = slots[a + ab].sequence;
+      }
+    }
+    uint8_t header[MODEL_SLOT_HEADER];
+    memset(header, 0xFF, sizeof(header));
+    vitalsPut32(header, sequence + 1);
+    vitalsPut32(header + 4, xfer.bytes);
+    vitalsPut32(header + 8, crc32(header, 8));
+    header[12] = (uint8_t)(0xFF & ~MODEL_SLOT_WRITTEN);
+    if (!dev->program(slotOffset(slot), header, 13)) {
+      fail(MODEL_XFER_ERR_FLASH);
+      return false;
+    }
+    readSlot(slot);
+    xfer.state = MODEL_XFER_DONE;
+    stats.uploads++;
+    return true;
+  }
+
+  void abortUpload() {
+    if (xfer.state == MODEL_XFER_RECEIVING || xfer.state == MODEL_XFER_ERASING) {
+      fail(MODEL_XFER_ERR_REQUEST);
+    }
+  }
+
+  /**
+   * Record that a committed image was refused by its engine
+   */
+  void uploadNotActivated() {
+    xfer.error = MODEL_XFER_ERR_ACTIVATE;
+  }
+
+  /**
+   * Apply one queued CONFIG frame
+   * @return true if a new image was committed: select() its model
+   */
+  bool apply(const ModelXferMsg& msg) {
+    switch (msg.op) {
+      case MODEL_XFER_BEGIN:
+        beginUpload((ModelType)msg.model, msg.value, msg.crc, msg.id);
+        return false;
+      case MODEL_XFER_DATA:
+        writeUpload(msg.value, msg.data, msg.length);
+        return false;
+      case MODEL_XFER_END:
+        return finishUpload();
+      default:
+        abortUpload();
+        return false;
+    }
+  }
+
+  const ModelXferStatus& transferStatus() const {
+    return xfer;
+  }
+
+  bool isMounted() const { return mounted; }
+  ModelSlotStats getStats() const { return stats; }
+};
+
+/**
+ * Parse a binary CONFIG write
+ * @return false if it is not a transfer frame (text commands start printable)
+ */
+static inline bool decodeModelTransfer(const uint8_t* buf, size_t len, ModelXferMsg& msg) {
+  if (len < 1 || buf[0] < MODEL_XFER_BEGIN || buf[0] > MODEL_XFER_ABORT) {
+    return false;
+  }
+  msg.op = buf[0];
+  msg.model = 0;
+  msg.id = 0;
+  msg.length = 0;
+  msg.value = 0;
+  msg.crc = 0;
+  if (msg.op == MODEL_XFER_BEGIN) {
+    if (len < 10) {
+      return false;
+    }
+    msg.model = buf[1];
+    msg.value = vitalsGet32(buf + 2);
+    msg.crc = vitalsGet32(buf + 6);
+    msg.id = len > 10 ? buf[10] : 0;
+  } else if (msg.op == MODEL_XFER_DATA) {
+    if (len < 6 || len - 5 > MODEL_XFER_CHUNK) {
+      return false;
+    }
+    msg.value = vitalsGet32(buf + 1);
+    msg.length = (uint8_t)(len - 5);
+    memcpy(msg.data, buf + 5, msg.length);
+  }
+  return true;
+}
+
+/**
+ * Status as read back from CONFIG
+ *   [0] MODEL_XFER_STATUS  [1] state  [2] model  [3] error  [4] slot (0 A, 1 B)
+ *   [5] transfer id  [6..8) 0  [8] u32 next offset  [12] u32 version (DONE)
+ *   [16] u32 image bytes
+ */
+static inline size_t encodeModelTransferStatus(const ModelXferStatus& s, uint8_t* out) {
+  memset(out, 0, MODEL_XFER_STATUS_SIZE);
+  out[0] = MODEL_XFER_STATUS;
+  out[1] = s.state;
+  out[2] = s.model;
+  out[3] = s.error;
+  out[4] = s.slot;
+  out[5] = s.id;
+  vitalsPut32(out + 8, s.next_offset);
+  vitalsPut32(out + 12, s.version);
+  vitalsPut32(out + 16, s.bytes);
+  return MODEL_XFER_STATUS_SIZE;
+}
+
+#endif // MODEL_SLOTS_H
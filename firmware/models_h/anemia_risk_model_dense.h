@@ -0,0 +1,68 @@
+/*
+ * LifeBand dense weights: anemia_risk_model
+ * Generated by convert_dense_models.py from anemia_risk_model.h - do not edit
+ *
+ * 5 -> 8 -> 4, rows padded to 4 floats / 16 int8, row count to 4
+ */
+
+#ifndef ANEMIA_RISK_MODEL_DENSE_H
+#define ANEMIA_RISK_MODEL_DENSE_H
+
+#include "../dense_engine.h"
+
+alignas(DENSE_ALIGN) static constexpr float anemia_risk_model_l0_w_f32[8 * 8] = {
+  -0.111698516f, -0.326510429f, -0.0586677641f, 0.354701906f, -0.187468231f, 0.0f, 0.0f, 0.0f,
+  -0.0432096459f, -1.35352123f, 0.473094791f, 1.17140961f, -0.340398878f, 0.0f, 0.0f, 0.0f,
+  0.00434972439f, -0.499043882f, 0.423763305f, -0.131600693f, -0.602137446f, 0.0f, 0.0f, 0.0f,
+  0.127589181f, -0.317852795f, -0.773794532f, -0.163803905f, -0.336075455f, 0.0f, 0.0f, 0.0f,
+  -1.47308946f, 0.750328064f, 0.916950047f, 0.370898277f, -0.204673976f, 0.0f, 0.0f, 0.0f,
+  0.000712757348f, 0.0891020149f, -0.80894047f, -0.183638841f, -0.283479184f, 0.0f, 0.0f, 0.0f,
+  -1.36835384f, 0.203974277f, 0.579395771f, 1.13283622f, -0.40790239f, 0.0f, 0.0f, 0.0f,
+  0.428640127f, 0.71023941f, -0.927118719f, 0.137526795f, 1.30121624f, 0.0f, 0.0f, 0.0f
+};
+alignas(DENSE_ALIGN) static constexpr int8_t anemia_risk_model_l0_w_i8[8 * 16] = {
+  -40, -117, -21, 127, -67, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+  -4, -127, 44, 110, -32, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+  1, -105, 89, -28, -127, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+  21, -52, -127, -27, -55, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+  -127, 65, 79, 32, -18, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+  0, 14, -127, -29, -45, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+  -127, 19, 54, 105, -38, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+  42, 69, -90, 13, 127, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0
+};
+alignas(DENSE_ALIGN) static constexpr float anemia_risk_model_l0_scale_i8[8] = {
+  0.0027929284f, 0.0106576475f, 0.00474123974f, 0.00609287033f,
+  0.0115991296f, 0.00636961f, 0.0107744397f, 0.0102457972f
+};
+alignas(DENSE_ALIGN) static constexpr float anemia_risk_model_l0_bias[8] = {
+  -0.0404074676f, -0.00906150602f, 0.00468424056f, -0.0510251001f,
+  -0.0365517326f, -0.090416342f, -0.042615518f, -0.0278178547f
+};
+
+alignas(DENSE_ALIGN) static constexpr float anemia_risk_model_l1_w_f32[4 * 8] = {
+  -0.493096441f, 0.0280693918f, -0.11610622f, -0.341539562f, -0.163808614f, 0.25628227f, -0.156570703f, 0.598124444f,
+  0.104917571f, -0.0140948175f, -0.736775577f, 0.0751031786f, 0.468370289f, -0.449501336f, -0.396144927f, -0.115968004f,
+  0.293223023f, 0.187661543f, -0.246220201f, 0.218319774f, 0.21057348f, -0.808220208f, -0.584488213f, 0.344052494f,
+  0.264539301f, 0.00774372974f, -0.618553519f, 0.800742626f, 0.404453486f, 0.0794206187f, -0.170479611f, -0.0326893963f
+};
+alignas(DENSE_ALIGN) static constexpr int8_t anemia_risk_model_l1_w_i8[4 * 16] = {
+  -105, 6, -25, -73, -35, 54, -33, 127, 0, 0, 0, 0, 0, 0, 0, 0,
+  18, -2, -127, 13, 81, -77, -68, -20, 0, 0, 0, 0, 0, 0, 0, 0,
+  46, 29, -39, 34, 33, -127, -92, 54, 0, 0, 0, 0, 0, 0, 0, 0,
+  42, 1, -98, 127, 64, 13, -27, -5, 0, 0, 0, 0, 0, 0, 0, 0
+};
+alignas(DENSE_ALIGN) static constexpr float anemia_risk_model_l1_scale_i8[4] = {
+  0.0047096413f, 0.0058013825f, 0.00636393864f, 0.00630506005f
+};
+alignas(DENSE_ALIGN) static constexpr float anemia_risk_model_l1_bias[4] = {
+  -0.0150463516f, 0.100365035f, 0.0424504988f, -0.127769217f
+};
+
+static constexpr DenseLayer anemia_risk_model_layers[2] = {
+  { 5, 8, 8, 8, 16, DENSE_RELU, anemia_risk_model_l0_w_f32, anemia_risk_model_l0_w_i8, anemia_risk_model_l0_scale_i8, anemia_risk_model_l0_bias },
+  { 8, 4, 4, 8, 16, DENSE_SOFTMAX, anemia_risk_model_l1_w_f32, anemia_risk_model_l1_w_i8, anemia_risk_model_l1_scale_i8, anemia_risk_model_l1_bias }
+};
+
+static constexpr DenseNetwork anemia_risk_model_dense = { 2, 5, 4, anemia_risk_model_layers, nullptr, nullptr };
+
+#endif // ANEMIA_RISK_MODEL_DENSE_H
@@ -0,0 +1,78 @@
+/*
+ * LifeBand dense weights: arrhythmia_risk_model
+ * Generated by convert_dense_models.py from arrhythmia_risk_model.h - do not edit
+ *
+ * 5 -> 8 -> 5, rows padded to 4 floats / 16 int8, row count to 4
+ */
+
+#ifndef ARRHYTHMIA_RISK_MODEL_DENSE_H
+#define ARRHYTHMIA_RISK_MODEL_DENSE_H
+
+#include "../dense_engine.h"
+
+alignas(DENSE_ALIGN) static constexpr float arrhythmia_risk_model_l0_w_f32[8 * 8] = {
+  -0.0808736607f, -0.76642251f, -0.426807493f, 0.311834961f, 0.326571286f, 0.0f, 0.0f, 0.0f,
+  -0.0482809283f, -0.303010494f, -0.132009223f, -0.77684176f, 1.05184078f, 0.0f, 0.0f, 0.0f,
+  0.0333471149f, -0.197710916f, -0.639940023f, 0.0338721275f, -0.621104598f, 0.0f, 0.0f, 0.0f,
+  0.449026614f, 0.907051325f, -0.15667218f, 0.381391257f, 0.660815179f, 0.0f, 0.0f, 0.0f,
+  -0.425015926f, 0.614106059f, 0.459273934f, -0.127576157f, 0.0495649911f, 0.0f, 0.0f, 0.0f,
+  -0.506453753f, 0.726217568f, 0.0945161581f, 0.368480206f, -0.817243576f, 0.0f, 0.0f, 0.0f,
+  0.691468775f, 0.470240176f, 0.772274375f, -0.586369216f, -0.691089094f, 0.0f, 0.0f, 0.0f,
+  -0.217196286f, 0.587993264f, -0.702537835f, -0.984585285f, 0.0421626046f, 0.0f, 0.0f, 0.0f
+};
+alignas(DENSE_ALIGN) static constexpr int8_t arrhythmia_risk_model_l0_w_i8[8 * 16] = {
+  -13, -127, -71, 52, 54, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+  -6, -37, -16, -94, 127, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+  7, -39, -127, 7, -123, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+  63, 127, -22, 53, 93, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+  -88, 127, 95, -26, 10, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+  -79, 113, 15, 57, -127, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+  114, 77, 127, -96, -114, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+  -28, 76, -91, -127, 5, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0
+};
+alignas(DENSE_ALIGN) static constexpr float arrhythmia_risk_model_l0_scale_i8[8] = {
+  0.00603482291f, 0.00828221088f, 0.00503889782f, 0.00714213642f,
+  0.00483548078f, 0.00643498879f, 0.00608090059f, 0.00775264004f
+};
+alignas(DENSE_ALIGN) static constexpr float arrhythmia_risk_model_l0_bias[8] = {
+  -0.0312190112f, -0.0436583795f, 0.0011133966f, -0.136910662f,
+  0.0284949373f, -0.0165415294f, -0.101829953f, -0.0364195444f
+};
+
+alignas(DENSE_ALIGN) static constexpr float arrhythmia_risk_model_l1_w_f32[8 * 8] = {
+  -0.200760782f, 0.0254962314f, -0.0562354065f, -0.568276167f, 0.807599187f, 0.344187319f, -0.706921577f, -0.349830091f,
+  -0.61984992f, -0.162468225f, 0.450976849f, -0.158023238f, 0.0408604816f, 0.312216818f, 0.272997886f, -0.792822242f,
+  -0.812842786f, 0.0998661667f, -0.496949553f, -0.999454379f, 0.239216447f, 0.336987466f, 0.477159798f, 0.417325497f,
+  -0.45844537f, 0.437806726f, -0.100558065f, 0.773170054f, -0.261711776f, -0.181911767f, 0.709655046f, -0.901234329f,
+  0.0597366244f, 0.16350019f, -0.0867809206f, -0.425926864f, 0.128132299f, -0.19091846f, 0.213396996f, -0.152834058f,
+  0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f,
+  0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f,
+  0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f
+};
+alignas(DENSE_ALIGN) static constexpr int8_t arrhythmia_risk_model_l1_w_i8[8 * 16] = {
+  -32, 4, -9, -89, 127, 54, -111, -55, 0, 0, 0, 0, 0, 0, 0, 0,
+  -99, -26, 72, -25, 7, 50, 44, -127, 0, 0, 0, 0, 0, 0, 0, 0,
+  -103, 13, -63, -127, 30, 43, 61, 53, 0, 0, 0, 0, 0, 0, 0, 0,
+  -65, 62, -14, 109, -37, -26, 100, -127, 0, 0, 0, 0, 0, 0, 0, 0,
+  18, 49, -26, -127, 38, -57, 64, -46, 0, 0, 0, 0, 0, 0, 0, 0,
+  0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+  0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+  0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0
+};
+alignas(DENSE_ALIGN) static constexpr float arrhythmia_risk_model_l1_scale_i8[8] = {
+  0.00635904872f, 0.00624269482f, 0.00786971952f, 0.0070963333f,
+  0.00335375484f, 0.0f, 0.0f, 0.0f
+};
+alignas(DENSE_ALIGN) static constexpr float arrhythmia_risk_model_l1_bias[8] = {
+  0.0480970554f, 0.046643585f, -0.0189567972f, -0.0933731198f,
+  0.0175892692f, 0.0f, 0.0f, 0.0f
+};
+
+static constexpr DenseLayer arrhythmia_risk_model_layers[2] = {
+  { 5, 8, 8, 8, 16, DENSE_RELU, arrhythmia_risk_model_l0_w_f32, arrhythmia_risk_model_l0_w_i8, arrhythmia_risk_model_l0_scale_i8, arrhythmia_risk_model_l0_bias },
+  { 8, 5, 8, 8, 16, DENSE_SOFTMAX, arrhythmia_risk_model_l1_w_f32, arrhythmia_risk_model_l1_w_i8, arrhythmia_risk_model_l1_scale_i8, arrhythmia_risk_model_l1_bias }
+};
+
+static constexpr DenseNetwork arrhythmia_risk_model_dense = { 2, 5, 5, arrhythmia_risk_model_layers, nullptr, nullptr };
+
+#endif // ARRHYTHMIA_RISK_MODEL_DENSE_H
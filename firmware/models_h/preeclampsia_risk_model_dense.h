@@ -0,0 +1,68 @@
+/*
+ * LifeBand dense weights: preeclampsia_risk_model
+ * Generated by convert_dense_models.py from preeclampsia_risk_model.h - do not edit
+ *
+ * 5 -> 8 -> 4, rows padded to 4 floats / 16 int8, row count to 4
+ */
+
+#ifndef PREECLAMPSIA_RISK_MODEL_DENSE_H
+#define PREECLAMPSIA_RISK_MODEL_DENSE_H
+
+#include "../dense_engine.h"
+
+alignas(DENSE_ALIGN) static constexpr float preeclampsia_risk_model_l0_w_f32[8 * 8] = {
+  -0.798100471f, -0.525220215f, 0.454791695f, 0.0832993686f, -0.15802826f, 0.0f, 0.0f, 0.0f,
+  0.437291592f, -0.34315753f, -1.18069601f, 0.295302093f, -0.178078011f, 0.0f, 0.0f, 0.0f,
+  -0.670633137f, -2.24286318f, -0.105885357f, -0.229241163f, 0.742963314f, 0.0f, 0.0f, 0.0f,
+  0.0134683093f, 1.32360482f, 1.11866522f, 0.820890784f, 0.441254407f, 0.0f, 0.0f, 0.0f,
+  -0.182652488f, 0.278851569f, -0.635916948f, -0.216632724f, 0.154657289f, 0.0f, 0.0f, 0.0f,
+  0.547639906f, -0.457823932f, 0.0412724614f, -1.22738445f, -0.00924995355f, 0.0f, 0.0f, 0.0f,
+  -0.688941896f, -0.709252059f, 1.38233972f, -0.253351361f, -0.697158933f, 0.0f, 0.0f, 0.0f,
+  0.273709089f, -0.309845477f, 0.373302281f, -0.587934852f, -1.32646918f, 0.0f, 0.0f, 0.0f
+};
+alignas(DENSE_ALIGN) static constexpr int8_t preeclampsia_risk_model_l0_w_i8[8 * 16] = {
+  -127, -84, 72, 13, -25, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+  47, -37, -127, 32, -19, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+  -38, -127, -6, -13, 42, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+  1, 127, 107, 79, 42, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+  -36, 56, -127, -43, 31, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+  57, -47, 4, -127, -1, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+  -63, -65, 127, -23, -64, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+  26, -30, 36, -56, -127, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0
+};
+alignas(DENSE_ALIGN) static constexpr float preeclampsia_risk_model_l0_scale_i8[8] = {
+  0.00628425568f, 0.00929681898f, 0.01766034f, 0.0104220852f,
+  0.00500722007f, 0.00966444447f, 0.0108845647f, 0.0104446392f
+};
+alignas(DENSE_ALIGN) static constexpr float preeclampsia_risk_model_l0_bias[8] = {
+  -0.0155288735f, 0.00762387738f, -0.0542637408f, -0.000216579356f,
+  -0.0799759552f, -0.0207886919f, 0.0177565124f, -0.0388740264f
+};
+
+alignas(DENSE_ALIGN) static constexpr float preeclampsia_risk_model_l1_w_f32[4 * 8] = {
+  0.0709461942f, 0.192625508f, 0.434426069f, 0.192412511f, 1.2851373f, 0.380069494f, -0.391866207f, 0.117620416f,
+  0.337638766f, 0.0265871864f, 0.32717073f, 0.281491071f, 0.000383751438f, 0.44465214f, -0.363509566f, 0.531020582f,
+  0.00247760233f, 0.826969981f, -0.474804878f, 0.267197818f, 0.47134918f, 0.272075266f, 0.211926535f, -0.254707754f,
+  -0.27875632f, 0.603638649f, 0.258242369f, 0.222960159f, -0.21185644f, 0.785020471f, 0.404293865f, -0.562473595f
+};
+alignas(DENSE_ALIGN) static constexpr int8_t preeclampsia_risk_model_l1_w_i8[4 * 16] = {
+  7, 19, 43, 19, 127, 38, -39, 12, 0, 0, 0, 0, 0, 0, 0, 0,
+  81, 6, 78, 67, 0, 106, -87, 127, 0, 0, 0, 0, 0, 0, 0, 0,
+  0, 127, -73, 41, 72, 42, 33, -39, 0, 0, 0, 0, 0, 0, 0, 0,
+  -45, 98, 42, 36, -34, 127, 65, -91, 0, 0, 0, 0, 0, 0, 0, 0
+};
+alignas(DENSE_ALIGN) static constexpr float preeclampsia_risk_model_l1_scale_i8[4] = {
+  0.0101191913f, 0.00418126442f, 0.00651157466f, 0.00618126355f
+};
+alignas(DENSE_ALIGN) static constexpr float preeclampsia_risk_model_l1_bias[4] = {
+  -0.0316624194f, -0.0230212901f, 0.0586856753f, -0.00400196947f
+};
+
+static constexpr DenseLayer preeclampsia_risk_model_layers[2] = {
+  { 5, 8, 8, 8, 16, DENSE_RELU, preeclampsia_risk_model_l0_w_f32, preeclampsia_risk_model_l0_w_i8, preeclampsia_risk_model_l0_scale_i8, preeclampsia_risk_model_l0_bias },
+  { 8, 4, 4, 8, 16, DENSE_SOFTMAX, preeclampsia_risk_model_l1_w_f32, preeclampsia_risk_model_l1_w_i8, preeclampsia_risk_model_l1_scale_i8, preeclampsia_risk_model_l1_bias }
+};
+
+static constexpr DenseNetwork preeclampsia_risk_model_dense = { 2, 5, 4, preeclampsia_risk_model_layers, nullptr, nullptr };
+
+#endif // PREECLAMPSIA_RISK_MODEL_DENSE_H
@@ -0,0 +1,338 @@
+/*
+ * LifeBand Task Pipeline
+ * Pinned FreeRTOS stages connected by lock-free SPSC queues
+ *
+ *   core 1  ECG sampler (ecg_acquisition.h, priority 20)
+ *           DSP stage   - drain ECG ring, filter, detect R-peaks, read the
+ *                         MAX30105 FIFO, detect PPG pulses, pack waveforms
+ *   core 0  inference   - beat/PPG events -> HR, HRV, BP, Edge AI, vitals
+ *           transport   - alerts, vitals frames and waveform packets -> BLE notify
+ *
+ * Each stage owns its state; stages only talk through PipelineQueue, a
+ * SpscRing that also records drops, the deepest backlog and push-to-pop
+ * latency, and wakes its consumer with a direct-to-task notification. A
+ * producer never blocks: a full queue drops the item and counts it.
+ *
+ * A stage is a step function run by a task: wait for a notification (or
+ * the idle timeout), run one step, repeat. runOnce() runs the same step
+ * from the caller, so loop() can drive the stages when a task cannot be
+ * created.
+ *
+ * Host builds use host/freertos_pthread.h, which provides the FreeRTOS
+ * calls used here on pthreads, so the queue and stage code can be stressed
+ * on Linux unchanged.
+ */
+
+#ifndef PIPELINE_H
+#define PIPELINE_H
+
+#ifdef ARDUINO
+#include <Arduino.h>
+#else
+#include "host/freertos_pthread.h"
+#endif
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+#include <atomic>
+#include "spsc_ring.h"
+#include "waveform_stream.h"
+#include "vitals_frame.h"
+
+#define PIPELINE_DSP_CORE 1
+#define PIPELINE_DSP_PRIORITY 15          // below the ECG sampler (20)
+#define PIPELINE_DSP_STACK 6144
+#define PIPELINE_DSP_IDLE_MS 4            // ECG ring fills at 1 sample / 4 ms
+
+#define PIPELINE_INFER_CORE 0
+#define PIPELINE_INFER_PRIORITY 5
+#define PIPELINE_INFER_STACK 12288        // TFLite interpreter calls
+#define PIPELINE_INFER_IDLE_MS 50
+
+#define PIPELINE_TRANSPORT_CORE 0
+#define PIPELINE_TRANSPORT_PRIORITY 3     // above the log drain (1)
+#define PIPELINE_TRANSPORT_STACK 6144     // JSON debug format
+#define PIPELINE_TRANSPORT_IDLE_MS 100
+
+#define PIPELINE_EVENT_QUEUE 32           // power of two
+#define PIPELINE_VITALS_QUEUE 4
+#define PIPELINE_WAVE_QUEUE 8             // ~4 KB of packets
+#define PIPELINE_ALERT_QUEUE 8
+#define PIPELINE_MODEL_QUEUE 4             // model upload frames, ~800 B
+
+// ==================== MESSAGES ====================
+
+enum DspEventKind : uint8_t {
+  DSP_ECG_BEAT = 0,       // R-peak: rr_ms (0 = first beat), qrs_ms, amplitude
+  DSP_ECG_LEARNED = 1,    // detector thresholds learned: amplitude = signal range
+  DSP_PTT = 2,            // R-peak paired with its pulse foot: ptt_us
+  DSP_PPG_BEAT = 3,       // PPG systolic peak: rr_ms = interval (0 after a gap), hr = median rate
+  DSP_PPG_WINDOW = 4,     // SpO2 estimator hop: hr, spo2 + validity flags, amplitude = PI x 100
+  DSP_ECG_SQI = 5,        // ECG beat scored against its template: amplitude = running SQI (0-100)
+  DSP_PPG_SQI = 6         // PPG beat scored against its template: amplitude = running SQI (0-100)
+};
+
+#define DSP_FLAG_SEARCH_BACK 0x01
+#define DSP_FLAG_HR_VALID 0x02
+#define DSP_FLAG_SPO2_VALID 0x04
+#define DSP_FLAG_SQI_LEARNING 0x08   // beat template still being built
+
+struct DspEvent {
+  uint8_t kind;           // DspEventKind
+  uint8_t flags;          // DSP_FLAG_*
+  uint16_t rr_ms;
+  uint16_t qrs_ms;
+  int16_t amplitude;
+  int16_t hr;
+  int16_t spo2;
+  uint32_t time_ms;       // millis() of the sample the event refers to
+  uint32_t ptt_us;        // DSP_PTT: R-peak to pulse foot
+};
+
+struct WavePacketMsg {
+  uint16_t len;
+  uint8_t data[WAVE_MAX_PACKET];
+};
+
+// ==================== STAGES ====================
+
+typedef void (*PipelineStepFn)(void* arg);
+
+struct StageStats {
+  uint32_t runs;            // step() calls
+  uint32_t max_run_us;      // longest step()
+  uint32_t mean_run_us;     // average step()
+};
+
+class PipelineStage {
+private:
+  TaskHandle_t task;
+  PipelineStepFn step_fn;
+  void* step_arg;
+  TickType_t idle_ticks;
+  std::atomic<bool> stop_requested;
+  std::atomic<bool> stopped;
+
+  StageStats stats;
+  uint64_t run_sum;
+
+  static void entry(void* arg) {
+    PipelineStage* self = (PipelineStage*)arg;
+    while (!self->stop_requested.load(std::memory_order_acquire)) {
+      ulTaskNotifyTake(pdTRUE, self->idle_ticks);
+      self->runOnce();
+    }
+    self->stopped.store(true, std::memory_order_release);
+    vTaskDelete(nullptr);
+  }
+
+public:
+  PipelineStage() :
+    task(nullptr),
+    step_fn(nullptr),
+    step_arg(nullptr),
+    idle_ticks(1),
+    stop_requested(false),
+    stopped(false),
+    run_sum(0) {
+    memset(&stats, 0, sizeof(stats));
+  }
+
+  /**
+   * Create the stage task
+   * @param fn: one non-blocking pass over the stage's inputs
+   * @param idle_ms: run fn at least this often without a notification
+   * @return true if the task is running
+   */
+  bool start(const char* name, PipelineStepFn fn, void* arg, uint32_t idle_ms,
+             BaseType_t core, UBaseType_t priority, uint32_t stack_bytes) {
+    if (task) {
+      return true;
+    }
+    step_fn = fn;
+    step_arg = arg;
+    idle_ticks = pdMS_TO_TICKS(idle_ms) > 0 ? pdMS_TO_TICKS(idle_ms) : 1;
+    stop_requested.store(false, std::memory_order_relaxed);
+    stopped.store(false, std::memory_order_relaxed);
+
+    BaseType_t ok = xTaskCreatePinnedToCore(
+      entry, name, stack_bytes, this, priority, &task, core);
+    if (ok != pdPASS) {
+      task = nullptr;
+      return false;
+    }
+    return true;
+  }
+
+  /**
+   * Run one step from the calling context (fallback when no task exists)
+   */
+  void runOnce() {
+    if (!step_fn) {
+      return;
+    }
+    uint32_t t0 = micros();
+    step_fn(step_arg);
+    uint32_t elapsed = micros() - t0;
+
+    stats.runs++;
+    run_sum += elapsed;
+    if (elapsed > stats.max_run_us) {
+      stats.max_run_us = elapsed;
+    }
+    stats.mean_run_us = (uint32_t)(run_sum / stats.runs);
+  }
+
+  /**
+   * Wake the stage early (called by producers after a push)
+   */
+  void notify() {
+    if (task) {
+      xTaskNotifyGive(task);
+    }
+  }
+
+  /**
+   * Ask the task to exit after its current step and wait for it
+   */
+  void stop() {
+    if (!task) {
+      return;
+    }
+    stop_requested.store(true, std::memory_order_release);
+    xTaskNotifyGive(task);
+    while (!stopped.load(std::memory_order_acquire)) {
+      vTaskDelay(1);
+    }
+    task = nullptr;
+  }
+
+  bool isRunning() const { return task != nullptr; }
+  StageStats getStats() const { return stats; }
+
+  /**
+   * Least free stack the task has had (bytes on ESP-IDF), 0 without a task
+   */
+  uint32_t stackHeadroom() const {
+    return task ? (uint32_t)uxTaskGetStackHighWaterMark(task) : 0;
+  }
+};
+
+// ==================== QUEUES ====================
+
+struct QueueStats {
+  uint32_t pushed;          // items accepted
+  uint32_t dropped;         // items refused because the queue was full
+  uint32_t high_water;      // deepest backlog seen after a push
+  uint32_t max_latency_us;  // worst push-to-pop time
+  uint32_t mean_latency_us; // average push-to-pop time
+};
+
+template <typename T, size_t CAPACITY>
+class PipelineQueue {
+private:
+  struct Entry {
+    T item;
+    uint32_t push_us;
+  };
+
+  SpscRing<Entry, CAPACITY> ring;
+  PipelineStage* consumer;
+
+  // Producer side
+  uint32_t pushed;
+  uint32_t dropped;
+  uint32_t high_water;
+
+  // Consumer side
+  uint32_t popped;
+  uint32_t max_latency_us;
+  uint32_t mean_latency_us;
+  uint64_t latency_sum;
+
+public:
+  PipelineQueue() :
+    consumer(nullptr),
+    pushed(0),
+    dropped(0),
+    high_water(0),
+    popped(0),
+    max_latency_us(0),
+    mean_latency_us(0),
+    latency_sum(0) {
+  }
+
+  /**
+   * Stage to notify after each push
+   */
+  void setConsumer(PipelineStage* stage) {
+    consumer = stage;
+  }
+
+  /**
+   * Producer side: never blocks
+   * @return false if the queue was full (item dropped and counted)
+   */
+  bool push(const T& item) {
+    Entry entry;
+    entry.item = item;
+    entry.push_us = micros();
+    if (!ring.push(entry)) {
+      dropped++;
+      return false;
+    }
+    pushed++;
+    uint32_t depth = (uint32_t)ring.size();
+    if (depth > high_water) {
+      high_water = depth;
+    }
+    if (consumer) {
+      consumer->notify();
+    }
+    return true;
+  }
+
+  /**
+   * Consumer side
+   * @return false if the queue is empty
+   */
+  bool pop(T& item) {
+    Entry entry;
+    if (!ring.pop(entry)) {
+      return false;
+    }
+    item = entry.item;
+
+    uint32_t latency = micros() - entry.push_us;
+    popped++;
+    latency_sum += latency;
+    if (latency > max_latency_us) {
+      max_latency_us = latency;
+    }
+    mean_latency_us = (uint32_t)(latency_sum / popped);
+    return true;
+  }
+
+  /**
+   * Consumer side: discard everything queued
+   */
+  void clear() {
+    ring.clear();
+  }
+
+  size_t depth() const { return ring.size(); }
+  size_t capacity() const { return CAPACITY; }
+
+  QueueStats getStats() const {
+    QueueStats s;
+    s.pushed = pushed;
+    s.dropped = dropped;
+    s.high_water = high_water;
+    s.max_latency_us = max_latency_us;
+    s.mean_latency_us = mean_latency_us;
+    return s;
+  }
+};
+
+#endif // PIPELINE_H
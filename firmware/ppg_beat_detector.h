@@ -0,0 +1,308 @@
+/*
+ * LifeBand PPG Beat Detector
+ * Streaming systolic peak detection with an adaptive envelope
+ *
+ * Replaces the "quick HR estimation", which took 60000 / (now - lastBeat)
+ * every 25 samples whenever raw IR exceeded 80000 and so measured noise.
+ * Every sample goes through:
+ *
+ *   band-pass  - 2nd-order Butterworth high-pass (0.5 Hz) and low-pass
+ *                (5 Hz, at most 0.4 x rate) biquads: removes DC,
+ *                respiration and LED/ambient noise
+ *   lobe       - a positive excursion above PPG_BEAT_THRESHOLD x envelope
+ *                opens a lobe; its maximum is the candidate systolic peak,
+ *                emitted when the signal falls back through zero, refined
+ *                to sub-sample position by a parabola
+ *   refractory - a lobe within PPG_BEAT_REFRACTORY_MS (or 40 % of the
+ *                median interval, if longer) of the previous beat is
+ *                dropped (dicrotic wave, motion)
+ *   envelope   - follows accepted peak heights (clipped to 2x, so one
+ *                artefact cannot blind the detector); the threshold decays
+ *                from it with PPG_BEAT_DECAY_S after each beat, so it comes
+ *                down again after missed beats or lower perfusion
+ *
+ * Each beat reports its inter-beat interval (0 after a gap longer than
+ * PPG_BEAT_MAX_IBI_MS) and the time since the peak, since a beat is only
+ * known once its lobe has closed. rateBpm() is the median of the last
+ * PPG_BEAT_INTERVALS intervals.
+ *
+ * Input must rise with blood volume (negate MAX30105 IR counts). O(1) per
+ * sample, no heap; no Arduino dependency.
+ */
+
+#ifndef PPG_BEAT_DETECTOR_H
+#define PPG_BEAT_DETECTOR_H
+
+#include <stdint.h>
+#include <string.h>
+#include <math.h>
+
+#define PPG_BEAT_THRESHOLD 0.4f       // of the envelope
+#define PPG_BEAT_REFRACTORY_MS 300    // 200 BPM
+#define PPG_BEAT_REFRACTORY_SHARE 0.4f  // ... or this share of the median interval
+#define PPG_BEAT_MAX_IBI_MS 2000      // 30 BPM
+#define PPG_BEAT_DECAY_S 3.0f
+#define PPG_BEAT_LEARN_MS 1500        // envelope seeded from the first 1.5 s
+#define PPG_BEAT_INTERVALS 5
+
+struct PpgBeat {
+  uint16_t ibi_ms;          // interval to the previous beat, 0 after a gap
+  uint16_t lag_ms;          // time from the peak to the sample that closed it
+  float amplitude;          // band-passed peak height
+  uint32_t beats;           // beats since reset
+};
+
+struct PpgBeatStats {
+  uint32_t samples;
+  uint32_t beats;
+  uint32_t refractory;      // lobes dropped inside the refractory period
+  uint32_t gaps;            // beats without an interval
+};
+
+class PpgBeatDetector {
+private:
+  struct Biquad {
+    float b0, b1, b2, a1, a2;
+    float z1, z2;
+
+    float run(float x) {
+      float y = b0 * x + z1;
+      z1 = b1 * x - a1 * y + z2;
+      z2 = b2 * x - a2 * y;
+      // A perfectly flat input decays the state into denormals, which
+      // are slow; anything this small is far below one ADC count
+      if (z1 > -1e-12f && z1 < 1e-12f) z1 = 0.0f;
+      if (z2 > -1e-12f && z2 < 1e-12f) z2 = 0.0f;
+      return y;
+    }
+  };
+
+  float rate_hz;
+  Biquad high_pass;
+  Biquad low_pass;
+  float decay;
+  uint32_t refractory;
+  uint32_t max_ibi;
+  uint32_t learn_samples;
+
+  uint32_t n;               // samples seen
+  float prev;               // previous band-passed value
+  float envelope;           // average peak height
+  float gate;               // envelope decayed since the last beat
+
+  bool in_lobe;
+  bool armed;               // signal went below zero since the last lobe
+  float lobe_max;
+  float lobe_before;        // value before the maximum
+  float lobe_after;         // value after the maximum
+  uint32_t lobe_index;
+  bool need_after;
+
+  bool have_last;
+  float last_peak;          // sample position of the last beat
+  float intervals[PPG_BEAT_INTERVALS];   // ms
+  uint8_t interval_next;
+  uint8_t interval_count;
+
+  PpgBeatStats stats;
+
+  /**
+   * RBJ cookbook biquad, Q = 1/sqrt(2)
+   */
+  static Biquad design(float fc, float fs, bool high) {
+    Biquad q;
+    float w = 2.0f * 3.14159265f * fc / fs;
+    float cw = cosf(w);
+    float alpha = sinf(w) / (2.0f * 0.70710678f);
+    float a0 = 1.0f + alpha;
+    if (high) {
+      q.b0 = (1.0f + cw) / 2.0f / a0;
+      q.b1 = -(1.0f + cw) / a0;
+    } else {
+      q.b0 = (1.0f - cw) / 2.0f / a0;
+      q.b1 = (1.0f - cw) / a0;
+    }
+    q.b2 = q.b0;
+    q.a1 = -2.0f * cw / a0;
+    q.a2 = (1.0f - alpha) / a0;
+    q.z1 = q.z2 = 0.0f;
+    return q;
+  }
+
+  void closeLobe(PpgBeat& out, bool& beat) {
+    in_lobe = false;
+    float denom = lobe_before - 2.0f * lobe_max + lobe_after;
+    float offset = denom < 0.0f ? 0.5f * (lobe_before - lobe_after) / denom : 0.0f;
+    if (offset > 0.5f) offset = 0.5f;
+    if (offset < -0.5f) offset = -0.5f;
+    float peak = (float)lobe_index + offset;
+
+    // The dicrotic wave of a slow beat can clear the fixed refractory
+    // period, so it also scales with the current rhythm
+    float blank = (float)refractory;
+    if (interval_count >= 3) {
+      float scaled = PPG_BEAT_REFRACTORY_SHARE * rate_hz * 60.0f / rateBpm();
+      if (scaled > blank) blank = scaled;
+    }
+    if (have_last && peak - last_peak < blank) {
+      stats.refractory++;
+      return;
+    }
+
+    // Envelope follows the peaks, an artefact moves it at most to 2x
+    float height = lobe_max;
+    if (envelope > 0.0f && height > 2.0f * envelope) height = 2.0f * envelope;
+    envelope += 0.25f * (height - envelope);
+    gate = envelope;
+
+    out.ibi_ms = 0;
+    if (have_last && peak - last_peak <= (float)max_ibi) {
+      float ibi = (peak - last_peak) * 1000.0f / rate_hz;
+      out.ibi_ms = (uint16_t)(ibi + 0.5f);
+      intervals[interval_next] = ibi;
+      interval_next = (interval_next + 1) % PPG_BEAT_INTERVALS;
+      if (interval_count < PPG_BEAT_INTERVALS) interval_count++;
+    } else {
+      stats.gaps++;
+    }
+    out.lag_ms = (uint16_t)(((float)(n - 1) - peak) * 1000.0f / rate_hz + 0.5f);
+    out.amplitude = lobe_max;
+    last_peak = peak;
+    have_last = true;
+    stats.beats++;
+    out.beats = stats.beats;
+    beat = true;
+  }
+
+public:
+  PpgBeatDetector() {
+    configure(25);
+  }
+
+  /**
+   * @param rate: samples per second delivered to process()
+   */
+  void configure(uint16_t rate) {
+    rate_hz = rate > 0 ? (float)rate : 25.0f;
+    float lp = 5.0f < 0.4f * rate_hz ? 5.0f : 0.4f * rate_hz;
+    high_pass = design(0.5f, rate_hz, true);
+    low_pass = design(lp, rate_hz, false);
+    decay = expf(-1.0f / (PPG_BEAT_DECAY_S * rate_hz));
+    refractory = (uint32_t)(PPG_BEAT_REFRACTORY_MS * rate_hz / 1000.0f);
+    max_ibi = (uint32_t)(PPG_BEAT_MAX_IBI_MS * rate_hz / 1000.0f);
+    learn_samples = (uint32_t)(PPG_BEAT_LEARN_MS * rate_hz / 1000.0f);
+    reset();
+  }
+
+  /**
+   * Forget all state (finger placed, sensor reconfigured)
+   */
+  void reset() {
+    high_pass.z1 = high_pass.z2 = 0.0f;
+    low_pass.z1 = low_pass.z2 = 0.0f;
+    n = 0;
+    prev = 0.0f;
+    envelope = 0.0f;
+    gate = 0.0f;
+    in_lobe = false;
+    armed = false;
+    lobe_max = lobe_before = lobe_after = 0.0f;
+    lobe_index = 0;
+    need_after = false;
+    have_last = false;
+    last_peak = 0.0f;
+    interval_next = 0;
+    interval_count = 0;
+    memset(&stats, 0, sizeof(stats));
+  }
+
+  /**
+   * Process one sample
+   * @return true when a beat was completed into out
+   */
+  bool process(int32_t value, PpgBeat& out) {
+    float x = (float)value;
+    if (n == 0) {
+      // Start the high-pass at steady state for this DC level
+      high_pass.z1 = -high_pass.b0 * x;
+      high_pass.z2 = high_pass.b2 * x;
+    }
+    float y = low_pass.run(high_pass.run(x));
+    uint32_t index = n++;
+    stats.samples++;
+    bool beat = false;
+
+    if (index < learn_samples) {
+      // Filters settle; the envelope starts from the largest swing
+      float mag = y < 0.0f ? -y : y;
+      if (index > learn_samples / 2 && mag > envelope) envelope = mag;
+      gate = envelope;
+      prev = y;
+      return false;
+    }
+    // Below one count the threshold is effectively zero; stopping here
+    // also keeps a long flat stretch out of slow denormals
+    gate = gate > 1.0f ? gate * decay : 0.0f;
+
+    if (need_after) {
+      lobe_after = y;
+      need_after = false;
+    }
+    if (in_lobe) {
+      if (y > lobe_max) {
+        lobe_before = prev;
+        lobe_max = y;
+        lobe_index = index;
+        need_after = true;
+      } else if (y < 0.0f || index - lobe_index > max_ibi) {
+        closeLobe(out, beat);
+        armed = true;
+      }
+    } else if (y < 0.0f) {
+      armed = true;
+    } else if (armed && y > PPG_BEAT_THRESHOLD * gate) {
+      in_lobe = true;
+      armed = false;
+      lobe_before = prev;
+      lobe_max = y;
+      lobe_index = index;
+      need_after = true;
+    }
+    prev = y;
+    return beat;
+  }
+
+  /**
+   * Median of the recent intervals in BPM, 0 before the first interval
+   */
+  float rateBpm() const {
+    if (interval_count == 0) {
+      return 0.0f;
+    }
+    float sorted[PPG_BEAT_INTERVALS];
+    memcpy(sorted, intervals, interval_count * sizeof(float));
+    for (uint8_t i = 1; i < interval_count; i++) {
+      float v = sorted[i];
+      int8_t j = i - 1;
+      while (j >= 0 && sorted[j] > v) {
+        sorted[j + 1] = sorted[j];
+        j--;
+      }
+      sorted[j + 1] = v;
+    }
+    return 60000.0f / sorted[interval_count / 2];
+  }
+
+  /**
+   * Band-passed value of the last sample (same polarity as the input)
+   */
+  float filtered() const { return prev; }
+
+  float envelopeLevel() const { return envelope; }
+
+  PpgBeatStats getStats() const {
+    return stats;
+  }
+};
+
+#endif // PPG_BEAT_DETECTOR_H
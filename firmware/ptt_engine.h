@@ -0,0 +1,296 @@
+/*
+ * LifeBand PTT Engine
+ * Per-beat pulse transit time from ECG R-peaks to PPG pulse feet
+ *
+ * computePTTandBP() subtracted two millis() stamps taken wherever loop()
+ * happened to notice a beat, so scheduling noise was larger than the PTT
+ * change it was meant to track. Here both streams are on the micros()
+ * timebase of their samples (EcgAcquisition::sampleTimeUs, StreamClock)
+ * and every R-peak is paired with the pulse foot that follows it:
+ *
+ *   1. R-peaks wait in a small queue until the PPG stream has passed
+ *      R + PTT_MAX_US, so arrival order and ECG filter delay do not matter
+ *   2. the steepest upstroke in [R + PTT_MIN_US, R + PTT_MAX_US] is found
+ *      on the first difference and refined by a parabola
+ *   3. the foot is where the tangent at that point meets the horizontal
+ *      through the preceding minimum (intersecting tangents), giving a
+ *      sub-sample position even at 25 Hz
+ *   4. the PTT is accepted if it is within PTT_TOLERANCE of the median of
+ *      the last PTT_MEDIAN_BEATS accepted beats; three outliers in a row
+ *      restart the median (sensor moved, new operating point)
+ *
+ * Input PPG values must rise with blood volume (negate MAX30105 IR counts).
+ * Single owner (DSP stage); no Arduino dependency.
+ */
+
+#ifndef PTT_ENGINE_H
+#define PTT_ENGINE_H
+
+#include <stdint.h>
+#include <string.h>
+
+#define PTT_PPG_HISTORY 128         // power of two; > 1 s of PPG at 100 Hz
+#define PTT_MAX_PENDING 4           // R-peaks waiting for their pulse
+#define PTT_MIN_US 100000UL
+#define PTT_MAX_US 500000UL
+#define PTT_MEDIAN_BEATS 9
+#define PTT_TOLERANCE_PCT 15        // of the median ...
+#define PTT_TOLERANCE_MIN_US 20000  // ... but never tighter than this
+
+#define PTT_FLAG_FOOT 0x01          // a pulse foot was found
+#define PTT_FLAG_ACCEPTED 0x02      // in range and consistent with the median
+
+struct PttMeasurement {
+  uint32_t r_us;            // R-peak time
+  uint32_t foot_us;         // pulse foot time
+  uint32_t ptt_us;          // foot - R (0 without a foot)
+  uint32_t median_us;       // median of accepted beats, 0 until one is accepted
+  uint8_t flags;            // PTT_FLAG_*
+};
+
+struct PttStats {
+  uint32_t beats;           // R-peaks received
+  uint32_t accepted;
+  uint32_t outliers;        // foot found but rejected
+  uint32_t no_foot;         // no upstroke in the search window
+  uint32_t dropped;         // queue full or PPG history no longer covers R
+};
+
+class PttEngine {
+private:
+  static const uint32_t MASK = PTT_PPG_HISTORY - 1;
+
+  int32_t ppg_value[PTT_PPG_HISTORY];
+  uint32_t ppg_time[PTT_PPG_HISTORY];
+  uint32_t ppg_count;                       // samples written
+
+  uint32_t pending[PTT_MAX_PENDING];
+  uint8_t pending_head;
+  uint8_t pending_count;
+
+  uint32_t history[PTT_MEDIAN_BEATS];       // accepted PTTs
+  uint8_t history_next;
+  uint8_t history_count;
+  uint8_t outlier_run;
+  uint32_t median;
+
+  PttStats stats;
+
+  int32_t value(uint32_t i) const { return ppg_value[i & MASK]; }
+  uint32_t time(uint32_t i) const { return ppg_time[i & MASK]; }
+
+  static bool after(uint32_t a, uint32_t b) {
+    return (int32_t)(a - b) > 0;            // a later than b, wrap-safe
+  }
+
+  void updateMedian() {
+    uint32_t sorted[PTT_MEDIAN_BEATS];
+    memcpy(sorted, history, history_count * sizeof(uint32_t));
+    for (uint8_t i = 1; i < history_count; i++) {
+      uint32_t v = sorted[i];
+      int8_t j = i - 1;
+      while (j >= 0 && sorted[j] > v) {
+        sorted[j + 1] = sorted[j];
+        j--;
+      }
+      sorted[j + 1] = v;
+    }
+    median = history_count ? sorted[history_count / 2] : 0;
+  }
+
+  void accept(uint32_t ptt) {
+    history[history_next] = ptt;
+    history_next = (history_next + 1) % PTT_MEDIAN_BEATS;
+    if (history_count < PTT_MEDIAN_BEATS) {
+      history_count++;
+    }
+    updateMedian();
+  }
+
+  /**
+   * Locate the pulse foot after r_us
+   * @return false if there is no upstroke or the history is too short
+   */
+  bool findFoot(uint32_t r_us, uint32_t& foot_us, bool& covered) {
+    uint32_t oldest = ppg_count > PTT_PPG_HISTORY ? ppg_count - PTT_PPG_HISTORY : 0;
+    covered = ppg_count > 0 && !after(time(oldest), r_us);
+    if (!covered) {
+      return false;
+    }
+    // First sample at or after R
+    uint32_t start = oldest;
+    while (start < ppg_count && after(r_us, time(start))) {
+      start++;
+    }
+
+    // Steepest rise: first difference v[i+1] - v[i], centred at i + 0.5
+    uint32_t best = 0;
+    int32_t best_slope = 0;
+    for (uint32_t i = start + 1; i + 2 < ppg_count; i++) {
+      uint32_t dt = time(i) - r_us;
+      if (dt < PTT_MIN_US) continue;
+      if (dt > PTT_MAX_US) break;
+      int32_t slope = value(i + 1) - value(i);
+      if (slope > best_slope) {
+        best_slope = slope;
+        best = i;
+      }
+    }
+    if (best_slope <= 0) {
+      return false;
+    }
+
+    // Parabola through the neighbouring differences
+    float d0 = (float)(value(best) - value(best - 1));
+    float d1 = (float)best_slope;
+    float d2 = (float)(value(best + 2) - value(best + 1));
+    float denom = d0 - 2.0f * d1 + d2;
+    float delta = denom < 0.0f ? 0.5f * (d0 - d2) / denom : 0.0f;
+    if (delta > 0.5f) delta = 0.5f;
+    if (delta < -0.5f) delta = -0.5f;
+    float slope = d1 - 0.25f * (d0 - d2) * delta;           // per sample
+    float steep_pos = (float)best + 0.5f + delta;
+    float level = value(best) + (0.5f + delta) * d1;
+
+    // Diastolic minimum between R and the upstroke
+    uint32_t low = start;
+    for (uint32_t i = start; i <= best; i++) {
+      if (value(i) < value(low)) low = i;
+    }
+    float low_pos = (float)low;
+    float low_level = (float)value(low);
+    if (low > start && low < best) {
+      float y0 = (float)value(low - 1), y1 = (float)value(low), y2 = (float)value(low + 1);
+      float dd = y0 - 2.0f * y1 + y2;
+      if (dd > 0.0f) {
+        float off = 0.5f * (y0 - y2) / dd;
+        low_pos += off;
+        low_level = y1 - 0.25f * (y0 - y2) * off;
+      }
+    }
+
+    // Tangent at the steepest point meets the level of the minimum
+    float pos = steep_pos - (level - low_level) / slope;
+    if (pos < low_pos) pos = low_pos;
+    if (pos < (float)start) pos = (float)start;
+
+    uint32_t i = (uint32_t)pos;
+    float frac = pos - (float)i;
+    uint32_t t0 = time(i);
+    uint32_t dt = time(i + 1) - t0;
+    foot_us = t0 + (uint32_t)(frac * (float)dt + 0.5f);
+    return true;
+  }
+
+  void evaluate(uint32_t r_us, PttMeasurement& out) {
+    memset(&out, 0, sizeof(out));
+    out.r_us = r_us;
+
+    bool covered = false;
+    uint32_t foot_us = 0;
+    if (!findFoot(r_us, foot_us, covered)) {
+      if (covered) {
+        stats.no_foot++;
+      } else {
+        stats.dropped++;
+      }
+      out.median_us = median;
+      return;
+    }
+    uint32_t ptt = foot_us - r_us;
+    out.foot_us = foot_us;
+    out.ptt_us = ptt;
+    out.flags = PTT_FLAG_FOOT;
+
+    bool plausible = ptt >= PTT_MIN_US && ptt <= PTT_MAX_US;
+    if (plausible && history_count >= 3) {
+      uint32_t tolerance = median * PTT_TOLERANCE_PCT / 100;
+      if (tolerance < PTT_TOLERANCE_MIN_US) tolerance = PTT_TOLERANCE_MIN_US;
+      uint32_t diff = ptt > median ? ptt - median : median - ptt;
+      plausible = diff <= tolerance;
+    }
+    if (plausible) {
+      outlier_run = 0;
+      accept(ptt);
+      out.flags |= PTT_FLAG_ACCEPTED;
+      stats.accepted++;
+    } else {
+      stats.outliers++;
+      if (++outlier_run >= 3) {
+        history_count = 0;      // operating point changed, start over
+        history_next = 0;
+        outlier_run = 0;
+        median = 0;
+      }
+    }
+    out.median_us = median;
+  }
+
+public:
+  PttEngine() {
+    reset();
+  }
+
+  void reset() {
+    ppg_count = 0;
+    pending_head = 0;
+    pending_count = 0;
+    history_next = 0;
+    history_count = 0;
+    outlier_run = 0;
+    median = 0;
+    memset(&stats, 0, sizeof(stats));
+  }
+
+  /**
+   * Queue an R-peak; it is evaluated once the PPG stream has passed it
+   * @param r_us: R-peak time on the shared micros() timebase
+   */
+  void addBeat(uint32_t r_us) {
+    stats.beats++;
+    if (pending_count == PTT_MAX_PENDING) {
+      pending_head = (pending_head + 1) % PTT_MAX_PENDING;   // oldest gives way
+      pending_count--;
+      stats.dropped++;
+    }
+    pending[(pending_head + pending_count) % PTT_MAX_PENDING] = r_us;
+    pending_count++;
+  }
+
+  /**
+   * Add one PPG sample in time order
+   * @param value: rises with blood volume
+   * @return true when a queued R-peak was evaluated into out
+   */
+  bool addPpg(uint32_t time_us, int32_t value, PttMeasurement& out) {
+    ppg_value[ppg_count & MASK] = value;
+    ppg_time[ppg_count & MASK] = time_us;
+    ppg_count++;
+
+    if (pending_count == 0) {
+      return false;
+    }
+    // Two samples beyond the window so the slope parabola is complete
+    uint32_t r_us = pending[pending_head];
+    if (ppg_count < 3 || !after(time(ppg_count - 3), r_us + PTT_MAX_US)) {
+      return false;
+    }
+    pending_head = (pending_head + 1) % PTT_MAX_PENDING;
+    pending_count--;
+    evaluate(r_us, out);
+    return true;
+  }
+
+  /**
+   * Median of the accepted PTTs (0 until the first one)
+   */
+  uint32_t medianUs() const {
+    return median;
+  }
+
+  PttStats getStats() const {
+    return stats;
+  }
+};
+
+#endif // PTT_ENGINE_H
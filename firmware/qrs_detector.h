@@ -0,0 +1,592 @@
+/*
+ * LifeBand Streaming QRS Detector
+ * Pan-Tompkins style R-peak detection in integer arithmetic
+ *
+ * Pipeline per sample (all O(1), no floats, no heap):
+ *   band-pass  - two cascaded boxcar low-passes (~30 ms) and a 160 ms
+ *                boxcar high-pass, i.e. the integer PT filters rescaled to
+ *                the actual sample rate
+ *   derivative - 5-point PT derivative
+ *   squaring   - saturated at 2^24
+ *   MWI        - 150 ms moving-window integration
+ *
+ * Peaks of the integrated signal are classified against adaptive dual
+ * thresholds (SPKI/NPKI), with a 200 ms refractory period, T-wave slope
+ * discrimination inside 360 ms and search-back at the lower threshold
+ * after 166% of the regular RR average. The thresholds learn for 2 s at
+ * start-up and re-learn after 3 s without a beat, so the detector keeps
+ * tracking when electrode contact changes.
+ *
+ * Each beat reports the R-peak sample index (same index space as the input
+ * samples), R amplitude above the QRS onset level and the QRS duration
+ * (onset/offset where the input slope falls under 10% of its QRS maximum).
+ * The only per-beat work beyond the per-sample pipeline is a bounded scan
+ * of the history ring (at most ~300 ms of samples) to locate R and the
+ * QRS boundaries.
+ */
+
+#ifndef QRS_DETECTOR_H
+#define QRS_DETECTOR_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+
+#define QRS_MAX_RATE_HZ 500
+#define QRS_HISTORY 512        // power of two, > 0.5 s at 500 Hz
+#define QRS_MAX_BOX 96         // longest boxcar (160 ms at 500 Hz = 81)
+#define QRS_RR_AVERAGE 8       // beats in each RR average
+#define QRS_MAX_GAP_FILL 16    // missing input samples bridged by repetition
+
+struct QrsEvent {
+  uint32_t r_index;       // input sample index of the R peak
+  int16_t amplitude;      // R height above the QRS onset level (input units)
+  uint16_t qrs_samples;   // QRS onset-to-offset duration in samples
+  uint32_t rr_samples;    // distance to the previous R peak (0 for the first beat)
+  bool search_back;       // accepted by search-back at the lower threshold
+};
+
+class QrsDetector {
+private:
+  // Running sum over the last len samples
+  struct BoxFilter {
+    int32_t buf[QRS_MAX_BOX];
+    uint16_t len;
+    uint16_t pos;
+    int32_t sum;
+
+    void init(uint16_t length) {
+      len = length;
+      pos = 0;
+      sum = 0;
+      memset(buf, 0, sizeof(buf));
+    }
+
+    int32_t push(int32_t x) {
+      sum += x - buf[pos];
+      buf[pos] = x;
+      if (++pos == len) pos = 0;
+      return sum;
+    }
+
+    // Value pushed 'delay' samples ago (0 = most recent)
+    int32_t at(uint16_t delay) const {
+      int idx = (int)pos - 1 - (int)delay;
+      while (idx < 0) idx += len;
+      return buf[idx];
+    }
+  };
+
+  struct Candidate {
+    int32_t value;        // MWI peak height
+    uint32_t index;       // MWI index of the peak
+    int32_t slope;        // max |derivative| while rising
+    QrsEvent event;       // R location / morphology, analysed while history is fresh
+  };
+
+  // --- Configuration (derived from the sample rate) ---
+  uint16_t fs;
+  uint16_t lp_len;        // low-pass boxcar length (~30 ms)
+  uint16_t hp_len;        // high-pass boxcar length (~160 ms, odd)
+  uint16_t mwi_len;       // integration window (150 ms)
+  uint16_t deriv_step;    // derivative tap spacing
+  uint8_t bp_shift;       // band-pass gain normalisation
+  uint16_t bp_delay;      // band-pass group delay in samples
+  uint16_t refractory;    // 200 ms
+  uint16_t twave_window;  // 360 ms
+  uint32_t learn_len;     // 2 s
+  uint32_t lost_len;      // 3 s without a beat -> re-learn
+
+  // --- Filter state ---
+  BoxFilter lp1, lp2, hp, mwi;
+  int16_t raw_hist[QRS_HISTORY];
+  int32_t bp_hist[QRS_HISTORY];
+  uint32_t n;             // index of the next input sample
+  bool started;
+  int16_t last_input;
+
+  // --- MWI peak tracking ---
+  bool falling;
+  int32_t prev_mwi;
+  int32_t cand_value;
+  uint32_t cand_index;
+  int32_t cand_slope;
+
+  // --- Adaptive thresholds ---
+  bool learning;
+  uint32_t learn_start;
+  int32_t learn_max;
+  int64_t learn_sum;
+  int16_t learn_min_raw;
+  int16_t learn_max_raw;
+  int32_t spki;
+  int32_t npki;
+  bool irregular;
+
+  // --- Beat bookkeeping ---
+  bool have_last;
+  uint32_t last_qrs_index;   // MWI index of the last accepted QRS
+  uint32_t last_r_index;
+  int32_t last_slope;
+  uint32_t rr1[QRS_RR_AVERAGE];
+  uint32_t rr2[QRS_RR_AVERAGE];
+  uint8_t rr1_count, rr1_pos, rr2_count, rr2_pos;
+  uint32_t rr1_avg, rr2_avg;
+  uint32_t rr_missed;
+
+  bool sb_valid;
+  Candidate sb_best;
+
+  bool pending;
+  QrsEvent pending_event;
+
+  // --- Statistics ---
+  uint32_t beats;
+  uint32_t search_backs;
+  uint32_t relearns;
+
+  static uint8_t log2Floor(uint32_t v) {
+    uint8_t r = 0;
+    while (v >>= 1) r++;
+    return r;
+  }
+
+  static int32_t absVal(int32_t v) {
+    return v < 0 ? -v : v;
+  }
+
+  int16_t rawAt(uint32_t index) const {
+    return raw_hist[index & (QRS_HISTORY - 1)];
+  }
+
+  int32_t bpAt(uint32_t index) const {
+    return bp_hist[index & (QRS_HISTORY - 1)];
+  }
+
+  // Oldest index still held in the history rings
+  uint32_t oldestIndex() const {
+    return n > QRS_HISTORY ? n - QRS_HISTORY + 1 : 0;
+  }
+
+  int32_t thresholdI1() const {
+    int32_t t = npki + ((spki - npki) >> 2);
+    return irregular ? t >> 1 : t;
+  }
+
+  int32_t thresholdI2() const {
+    return thresholdI1() >> 1;
+  }
+
+  /**
+   * Locate R, QRS onset/offset and amplitude for an MWI peak at mwi_index
+   */
+  QrsEvent analyze(uint32_t mwi_index) const {
+    QrsEvent ev;
+    memset(&ev, 0, sizeof(ev));
+
+    uint32_t oldest = oldestIndex() + bp_delay;
+    uint32_t hi = mwi_index >= 2u * deriv_step ? mwi_index - 2u * deriv_step : 0;
+    uint32_t lo = hi >= (uint32_t)mwi_len ? hi - mwi_len + 1 : 0;
+    if (lo < oldest) lo = oldest;
+    if (hi < lo) hi = lo;
+
+    // Largest band-passed excursion inside the integration window
+    uint32_t ib = lo;
+    int32_t peak = 0;
+    for (uint32_t i = lo; i <= hi; i++) {
+      int32_t a = absVal(bpAt(i));
+      if (a > peak) {
+        peak = a;
+        ib = i;
+      }
+    }
+
+    // Map the band-pass peak back to the input and refine R there
+    uint32_t first = oldestIndex() + 1;
+    uint32_t r_guess = ib - bp_delay;
+    uint16_t refine = fs / 50;   // +/- 20 ms
+    uint32_t r_lo = r_guess >= first + refine ? r_guess - refine : first;
+    uint32_t r_hi = r_guess + refine;
+    if (r_hi >= n - 1) r_hi = n - 2;
+    bool positive = bpAt(ib) >= 0;
+    uint32_t r = r_guess;
+    int16_t best = rawAt(r_guess);
+    for (uint32_t i = r_lo; i <= r_hi; i++) {
+      int16_t v = rawAt(i);
+      if (positive ? v > best : v < best) {
+        best = v;
+        r = i;
+      }
+    }
+
+    // QRS boundaries on the input slope: |x[i+1] - x[i-1]| stays under
+    // 10% of the steepest QRS slope for ~10 ms
+    uint16_t max_span = fs / 10;   // 100 ms either side
+    int32_t steepest = 0;
+    for (uint32_t i = (r >= first + refine ? r - refine : first); i <= r + refine && i < n - 1; i++) {
+      int32_t sl = absVal((int32_t)rawAt(i + 1) - rawAt(i - 1));
+      if (sl > steepest) steepest = sl;
+    }
+    int32_t edge = steepest / 10 > 2 ? steepest / 10 : 2;
+    uint16_t quiet_needed = fs / 100 > 2 ? fs / 100 : 2;
+
+    uint32_t onset = r;
+    uint16_t quiet = 0;
+    for (uint16_t k = 1; k <= max_span && r >= first + k; k++) {
+      uint32_t i = r - k;
+      if (absVal((int32_t)rawAt(i + 1) - rawAt(i - 1)) < edge) {
+        if (++quiet >= quiet_needed) {
+          onset = i + quiet_needed - 1;
+          break;
+        }
+      } else {
+        quiet = 0;
+        onset = i;
+      }
+    }
+
+    uint32_t offset = r;
+    quiet = 0;
+    for (uint16_t k = 1; k <= max_span && r + k < n - 1; k++) {
+      uint32_t i = r + k;
+      if (absVal((int32_t)rawAt(i + 1) - rawAt(i - 1)) < edge) {
+        if (++quiet >= quiet_needed) {
+          offset = i - quiet_needed + 1;
+          break;
+        }
+      } else {
+        quiet = 0;
+        offset = i;
+      }
+    }
+
+    int32_t amplitude = (int32_t)best - (int32_t)rawAt(onset);
+    if (amplitude > 32767) amplitude = 32767;
+    if (amplitude < -32768) amplitude = -32768;
+    uint32_t width = offset - onset;
+
+    ev.r_index = r;
+    ev.amplitude = (int16_t)amplitude;
+    ev.qrs_samples = (uint16_t)(width > 0xFFFF ? 0xFFFF : width);
+    return ev;
+  }
+
+  void updateRR(uint32_t rr) {
+    rr1[rr1_pos] = rr;
+    rr1_pos = (rr1_pos + 1) % QRS_RR_AVERAGE;
+    if (rr1_count < QRS_RR_AVERAGE) rr1_count++;
+    uint32_t sum = 0;
+    for (uint8_t i = 0; i < rr1_count; i++) sum += rr1[i];
+    rr1_avg = sum / rr1_count;
+
+    // RR_AVERAGE2 only takes beats within 92%-116% of itself
+    bool regular = rr2_count == 0 ||
+                   (rr * 100 >= rr2_avg * 92 && rr * 100 <= rr2_avg * 116);
+    if (regular) {
+      rr2[rr2_pos] = rr;
+      rr2_pos = (rr2_pos + 1) % QRS_RR_AVERAGE;
+      if (rr2_count < QRS_RR_AVERAGE) rr2_count++;
+      sum = 0;
+      for (uint8_t i = 0; i < rr2_count; i++) sum += rr2[i];
+      rr2_avg = sum / rr2_count;
+    }
+    irregular = !regular;
+    rr_missed = rr2_avg * 166 / 100;
+  }
+
+  void acceptQrs(const Candidate& c, uint32_t mwi_index, bool from_search_back) {
+    if (from_search_back) {
+      spki += (c.value - spki) >> 2;   // 0.25 weight for search-back beats
+      search_backs++;
+    } else {
+      spki += (c.value - spki) >> 3;   // 0.125 weight
+    }
+
+    QrsEvent ev = c.event;
+    ev.search_back = from_search_back;
+    ev.rr_samples = 0;
+    if (have_last && ev.r_index > last_r_index) {
+      ev.rr_samples = ev.r_index - last_r_index;
+      updateRR(ev.rr_samples);
+    }
+
+    have_last = true;
+    last_qrs_index = mwi_index;
+    last_r_index = ev.r_index;
+    last_slope = c.slope;
+    sb_valid = false;
+
+    pending_event = ev;
+    pending = true;
+    beats++;
+  }
+
+  void noisePeak(const Candidate& c) {
+    npki += (c.value - npki) >> 3;
+    // Remember the best sub-threshold peak for search-back
+    if (have_last && c.value > thresholdI2() && (!sb_valid || c.value > sb_best.value)) {
+      sb_best = c;
+      sb_valid = true;
+    }
+  }
+
+  void classifyPeak(int32_t value, uint32_t mwi_index, int32_t slope) {
+    if (learning) {
+      return;
+    }
+    if (have_last && mwi_index - last_qrs_index < refractory) {
+      return;
+    }
+
+    Candidate c;
+    c.value = value;
+    c.index = mwi_index;
+    c.slope = slope;
+    c.event = analyze(mwi_index);
+
+    if (value > thresholdI1()) {
+      // Inside 360 ms a shallow slope means T wave, not a new QRS
+      if (have_last && mwi_index - last_qrs_index < twave_window && slope < (last_slope >> 1)) {
+        noisePeak(c);
+        return;
+      }
+      acceptQrs(c, mwi_index, false);
+    } else {
+      noisePeak(c);
+    }
+  }
+
+  void startLearning(uint32_t at) {
+    learning = true;
+    learn_start = at;
+    learn_max = 0;
+    learn_sum = 0;
+    learn_min_raw = 32767;
+    learn_max_raw = -32768;
+    have_last = false;
+    sb_valid = false;
+    irregular = false;
+    rr1_count = rr1_pos = rr2_count = rr2_pos = 0;
+    rr1_avg = rr2_avg = fs;          // assume 60 BPM until beats arrive
+    rr_missed = rr2_avg * 166 / 100;
+  }
+
+  void processOne(int16_t x) {
+    uint32_t i = n;
+
+    // Band-pass: double boxcar low-pass, then boxcar high-pass
+    int32_t l1 = lp1.push(x);
+    int32_t l2 = lp2.push(l1);
+    int32_t hsum = hp.push(l2);
+    int32_t centre = hp.at((hp_len - 1) / 2);
+    int32_t bp = (centre * (int32_t)hp_len - hsum) >> bp_shift;
+
+    raw_hist[i & (QRS_HISTORY - 1)] = x;
+    bp_hist[i & (QRS_HISTORY - 1)] = bp;
+    n++;
+
+    // Derivative (PT 5-point), squaring, integration
+    int32_t d = 0;
+    if (i >= 4u * deriv_step) {
+      d = (2 * bp + bpAt(i - deriv_step) - bpAt(i - 3 * deriv_step) - 2 * bpAt(i - 4 * deriv_step)) >> 3;
+    }
+    int32_t ad = absVal(d);
+    int32_t sq = ad > 4095 ? (1 << 24) : d * d;
+    int32_t m = mwi.push(sq);
+
+    if (learning) {
+      if (x < learn_min_raw) learn_min_raw = x;
+      if (x > learn_max_raw) learn_max_raw = x;
+      // Skip the filter start-up transient
+      if (i - learn_start > hp_len + mwi_len) {
+        if (m > learn_max) learn_max = m;
+        learn_sum += m;
+      }
+      if (i - learn_start >= learn_len) {
+        uint32_t counted = learn_len - hp_len - mwi_len;
+        spki = learn_max / 3;
+        npki = (int32_t)(learn_sum / (counted ? counted : 1)) / 2;
+        learning = false;
+        last_qrs_index = i;   // start the lost-signal timer from here
+      }
+    }
+
+    // MWI peak tracking: a peak is final once the signal halves
+    if (falling) {
+      if (m > prev_mwi) {
+        falling = false;
+        cand_value = m;
+        cand_index = i;
+        cand_slope = ad;
+      }
+    } else {
+      if (m >= cand_value) {
+        cand_value = m;
+        cand_index = i;
+      }
+      if (ad > cand_slope) cand_slope = ad;
+      if (cand_value > 0 && m < (cand_value >> 1)) {
+        classifyPeak(cand_value, cand_index, cand_slope);
+        falling = true;
+        cand_value = 0;
+        cand_slope = 0;
+      }
+    }
+    prev_mwi = m;
+
+    if (!learning) {
+      // Search-back for a missed beat at the lower threshold
+      // The refractory and T-wave windows run from the recovered peak, not
+      // from the sample that triggered the search
+      if (have_last && sb_valid && i - last_qrs_index > rr_missed) {
+        Candidate c = sb_best;
+        acceptQrs(c, c.index, true);
+      }
+      // Nothing for 3 s: electrode contact changed, learn again
+      if (i - last_qrs_index > lost_len) {
+        startLearning(i);
+        relearns++;
+      }
+    }
+  }
+
+public:
+  QrsDetector() : fs(0) {
+    configure(250);
+  }
+
+  /**
+   * Derive all filter lengths and time constants from the sample rate
+   * @return false if the rate is outside 100..QRS_MAX_RATE_HZ
+   */
+  bool configure(uint16_t rate_hz) {
+    if (rate_hz < 100 || rate_hz > QRS_MAX_RATE_HZ) {
+      return false;
+    }
+    fs = rate_hz;
+    lp_len = (uint16_t)((fs * 3 + 50) / 100);           // 30 ms
+    hp_len = (uint16_t)((fs * 16 + 50) / 100) | 1;      // 160 ms, odd for an integer delay
+    mwi_len = (uint16_t)((fs * 15 + 50) / 100);         // 150 ms
+    deriv_step = fs >= 400 ? 2 : 1;
+    bp_shift = log2Floor((uint32_t)lp_len * lp_len * hp_len);
+    bp_delay = (lp_len - 1) + (hp_len - 1) / 2;
+    refractory = fs / 5;                                // 200 ms
+    twave_window = (uint16_t)((uint32_t)fs * 36 / 100); // 360 ms
+    learn_len = 2u * fs;
+    lost_len = 3u * fs;
+    reset();
+    return true;
+  }
+
+  /**
+   * Clear all signal history and restart threshold learning
+   */
+  void reset() {
+    lp1.init(lp_len);
+    lp2.init(lp_len);
+    hp.init(hp_len);
+    mwi.init(mwi_len);
+    memset(raw_hist, 0, sizeof(raw_hist));
+    memset(bp_hist, 0, sizeof(bp_hist));
+    n = 0;
+    started = false;
+    last_input = 0;
+    falling = true;
+    prev_mwi = 0;
+    cand_value = 0;
+    cand_index = 0;
+    cand_slope = 0;
+    spki = 0;
+    npki = 0;
+    last_qrs_index = 0;
+    last_r_index = 0;
+    last_slope = 0;
+    pending = false;
+    beats = 0;
+    search_backs = 0;
+    relearns = 0;
+    startLearning(0);
+  }
+
+  /**
+   * Feed one sample
+   * @param x: ECG sample (ADC counts or pre-filtered signal)
+   * @param index: sample index; small gaps are bridged by repeating the
+   *               previous sample so filter timing stays exact
+   * @param event: filled when a beat is confirmed
+   * @return true if event holds a new beat
+   */
+  bool process(int16_t x, uint32_t index, QrsEvent& event) {
+    if (!started) {
+      started = true;
+      n = index;
+      learn_start = index;
+      last_qrs_index = index;
+      last_input = x;
+    } else if (index > n) {
+      uint32_t gap = index - n;
+      if (gap > QRS_MAX_GAP_FILL) {
+        // Too much missing to bridge: restart from this sample
+        reset();
+        started = true;
+        n = index;
+        learn_start = index;
+        last_qrs_index = index;
+      } else {
+        while (n < index) {
+          processOne(last_input);
+        }
+      }
+    } else if (index < n) {
+      return false;   // duplicate or out-of-order sample
+    }
+
+    last_input = x;
+    processOne(x);
+
+    if (pending) {
+      pending = false;
+      event = pending_event;
+      return true;
+    }
+    return false;
+  }
+
+  /**
+   * Feed a block of samples with consecutive indices starting at first_index
+   * @return number of beats written to events (at most max_events)
+   */
+  size_t processBlock(const int16_t* samples, size_t count, uint32_t first_index,
+                      QrsEvent* events, size_t max_events) {
+    size_t found = 0;
+    for (size_t i = 0; i < count; i++) {
+      QrsEvent ev;
+      if (process(samples[i], first_index + (uint32_t)i, ev) && found < max_events) {
+        events[found++] = ev;
+      }
+    }
+    return found;
+  }
+
+  uint32_t samplesToMs(uint32_t samples) const {
+    return (uint32_t)((uint64_t)samples * 1000UL / fs);
+  }
+
+  uint16_t sampleRate() const { return fs; }
+  bool isLearning() const { return learning; }
+  int32_t signalLevel() const { return spki; }
+  int32_t noiseLevel() const { return npki; }
+  int32_t threshold() const { return thresholdI1(); }
+  uint32_t beatCount() const { return beats; }
+  uint32_t searchBackCount() const { return search_backs; }
+  uint32_t relearnCount() const { return relearns; }
+
+  /**
+   * Peak-to-peak input range seen during the last learning window
+   */
+  int16_t learningRange() const {
+    return learn_max_raw > learn_min_raw ? learn_max_raw - learn_min_raw : 0;
+  }
+};
+
+#endif // QRS_DETECTOR_H
@@ -0,0 +1,286 @@
+/*
+ * LifeBand SpO2 Estimator
+ * Streaming ratio-of-ratios SpO2, pulse rate and perfusion index
+ *
+ * Replaces the Maxim batch call, which ran every 50 samples over a buffer
+ * filled through sampleCount % 50 (not in time order after the first pass)
+ * and produced one value every 2 s. Here every red/IR sample updates a
+ * constant-size state:
+ *
+ *   DC  = exponential mean of the raw channel      (tau = window / 2)
+ *   AC  = raw band-passed to 0.5..4 Hz (two one-pole high-pass sections,
+ *         one low-pass), so respiratory baseline wander stays out of R
+ *   RMS = sqrt of the exponential mean of AC^2      (tau = window / 2)
+ *
+ *   R    = (RMS_red / DC_red) / (RMS_ir / DC_ir)
+ *   SpO2 = -45.060 R^2 + 30.354 R + 94.845         (Maxim calibration)
+ *   PI   = IR AC peak-to-peak per beat / DC_ir * 100 (averaged over beats)
+ *
+ * The same filters run on both channels, so their gain cancels in R.
+ *
+ * Pulses are the maxima of the inverted IR AC signal (absorption rises with
+ * the systolic inflow) above 0.6 RMS, refined to sub-sample position by a
+ * parabola through the three samples around the maximum, with a refractory
+ * period of one 220 BPM beat. Pulse rate is the mean of the last
+ * SPO2_MAX_INTERVALS plausible intervals; an interval more than 30 % off the
+ * mean is rejected, three rejections in a row restart the average.
+ *
+ * add() returns true every hop (e.g. 500 ms) with the current estimate.
+ * Values are flagged valid only after one window of samples with a finger
+ * on the sensor and a plausible ratio / perfusion. No Arduino dependency.
+ */
+
+#ifndef SPO2_ESTIMATOR_H
+#define SPO2_ESTIMATOR_H
+
+#include <stdint.h>
+#include <math.h>
+
+#define SPO2_MAX_INTERVALS 8
+#define SPO2_FINGER_DC 50000.0f     // IR DC below this: no finger on the sensor
+#define SPO2_MIN_BPM 35.0f
+#define SPO2_MAX_BPM 220.0f
+
+#define SPO2_FLAG_FINGER 0x01
+#define SPO2_FLAG_SPO2_VALID 0x02
+#define SPO2_FLAG_HR_VALID 0x04
+
+struct Spo2Estimate {
+  float spo2;               // %, clamped to 0..100
+  float ratio;              // R, ratio of ratios
+  float perfusion_index;    // %, IR AC peak-to-peak / DC
+  float heart_rate;         // BPM from pulse intervals, 0 if unknown
+  uint8_t flags;            // SPO2_FLAG_*
+  uint32_t samples;         // samples processed since reset
+};
+
+class Spo2Estimator {
+private:
+  struct Channel {
+    float dc;
+    float baseline1;        // high-pass states (2 x ~0.5 Hz)
+    float baseline2;
+    float ac;               // band-passed AC
+    float mean_square;      // of ac
+  };
+
+  float rate_hz;
+  float alpha_dc;
+  float alpha_hp;
+  float alpha_ac;
+  float alpha_rms;
+  uint16_t hop_samples;
+  uint32_t warmup_samples;
+
+  Channel red;
+  Channel ir;
+  uint32_t samples;
+  uint16_t since_emit;
+
+  // Pulse detection on -ir.ac
+  float pulse_prev2;
+  float pulse_prev1;
+  float last_peak;          // sample position, < 0 before the first pulse
+  float min_interval;
+  float max_interval;
+  float intervals[SPO2_MAX_INTERVALS];
+  uint8_t interval_next;
+  uint8_t interval_count;
+  float interval_sum;
+  uint8_t rejected_run;
+
+  // Perfusion: IR AC swing over the last beat
+  float beat_max;
+  float beat_min;
+  float pulse_amplitude;    // averaged peak-to-peak, 0 before the first beat
+
+  /**
+   * One-pole coefficient for time constant tau_s
+   */
+  static float smoothing(float tau_s, float rate) {
+    return 1.0f - expf(-1.0f / (tau_s * rate));
+  }
+
+  void update(Channel& ch, float x) {
+    if (samples == 0) {
+      ch.dc = x;
+      ch.baseline1 = x;
+      ch.baseline2 = 0.0f;
+      ch.ac = 0.0f;
+      ch.mean_square = 0.0f;
+      return;
+    }
+    ch.dc += alpha_dc * (x - ch.dc);
+    ch.baseline1 += alpha_hp * (x - ch.baseline1);
+    float hp1 = x - ch.baseline1;
+    ch.baseline2 += alpha_hp * (hp1 - ch.baseline2);
+    ch.ac += alpha_ac * ((hp1 - ch.baseline2) - ch.ac);
+    ch.mean_square += alpha_rms * (ch.ac * ch.ac - ch.mean_square);
+  }
+
+  void clearIntervals() {
+    interval_next = 0;
+    interval_count = 0;
+    interval_sum = 0.0f;
+    rejected_run = 0;
+  }
+
+  void addInterval(float interval) {
+    if (interval_count >= 3) {
+      float mean = interval_sum / interval_count;
+      if (fabsf(interval - mean) > 0.3f * mean) {
+        if (++rejected_run >= 3) {
+          clearIntervals();    // rhythm changed, start over
+        }
+        return;
+      }
+    }
+    rejected_run = 0;
+    if (interval_count == SPO2_MAX_INTERVALS) {
+      interval_sum -= intervals[interval_next];
+    } else {
+      interval_count++;
+    }
+    intervals[interval_next] = interval;
+    interval_sum += interval;
+    interval_next = (interval_next + 1) % SPO2_MAX_INTERVALS;
+  }
+
+  /**
+   * Feed one pulse-signal value; a maximum is confirmed one sample late
+   */
+  void detectPulse(float y) {
+    float threshold = 0.6f * sqrtf(ir.mean_square);
+    float pos = (float)samples - 1.0f;      // position of pulse_prev1
+    if (pulse_prev1 > threshold && pulse_prev1 > pulse_prev2 && pulse_prev1 >= y &&
+        (last_peak < 0.0f || pos - last_peak >= min_interval)) {
+      float denom = pulse_prev2 - 2.0f * pulse_prev1 + y;
+      float offset = denom != 0.0f ? 0.5f * (pulse_prev2 - y) / denom : 0.0f;
+      if (offset > 0.5f) offset = 0.5f;
+      if (offset < -0.5f) offset = -0.5f;
+      float peak = pos + offset;
+
+      if (last_peak >= 0.0f) {
+        float interval = peak - last_peak;
+        if (interval <= max_interval) {
+          addInterval(interval);
+          float swing = beat_max - beat_min;
+          pulse_amplitude = pulse_amplitude > 0.0f ?
+            pulse_amplitude + 0.25f * (swing - pulse_amplitude) : swing;
+        } else {
+          clearIntervals();    // pulse lost for a while
+        }
+      }
+      last_peak = peak;
+      beat_max = beat_min = pulse_prev1;
+    }
+    if (y > beat_max) beat_max = y;
+    if (y < beat_min) beat_min = y;
+    pulse_prev2 = pulse_prev1;
+    pulse_prev1 = y;
+  }
+
+public:
+  Spo2Estimator() {
+    configure(25, 500, 4.0f);
+  }
+
+  /**
+   * @param rate: samples per second delivered to add()
+   * @param hop_ms: time between estimates
+   * @param window_s: averaging window of DC and RMS (also the warm-up)
+   */
+  void configure(uint16_t rate, uint16_t hop_ms, float window_s) {
+    rate_hz = rate > 0 ? (float)rate : 25.0f;
+    alpha_dc = smoothing(window_s * 0.5f, rate_hz);
+    alpha_rms = smoothing(window_s * 0.5f, rate_hz);
+    alpha_hp = smoothing(0.32f, rate_hz);            // ~0.5 Hz high-pass
+    alpha_ac = smoothing(0.04f, rate_hz);            // ~4 Hz low-pass
+    uint32_t hop = (uint32_t)(hop_ms * rate_hz / 1000.0f + 0.5f);
+    hop_samples = hop > 0 ? (uint16_t)hop : 1;
+    warmup_samples = (uint32_t)(window_s * rate_hz);
+    min_interval = rate_hz * 60.0f / SPO2_MAX_BPM;
+    max_interval = rate_hz * 60.0f / SPO2_MIN_BPM;
+    reset();
+  }
+
+  /**
+   * Forget all state (finger removed, sensor reconfigured)
+   */
+  void reset() {
+    red.dc = red.baseline1 = red.baseline2 = red.ac = red.mean_square = 0.0f;
+    ir.dc = ir.baseline1 = ir.baseline2 = ir.ac = ir.mean_square = 0.0f;
+    samples = 0;
+    since_emit = 0;
+    pulse_prev2 = 0.0f;
+    pulse_prev1 = 0.0f;
+    last_peak = -1.0f;
+    clearIntervals();
+    beat_max = beat_min = 0.0f;
+    pulse_amplitude = 0.0f;
+  }
+
+  /**
+   * Process one sample
+   * @return true when a new estimate was written to out (once per hop)
+   */
+  bool add(uint32_t red_raw, uint32_t ir_raw, Spo2Estimate& out) {
+    update(red, (float)red_raw);
+    update(ir, (float)ir_raw);
+    detectPulse(-ir.ac);
+    samples++;
+
+    if (++since_emit < hop_samples) {
+      return false;
+    }
+    since_emit = 0;
+    estimate(out);
+    return true;
+  }
+
+  /**
+   * Current estimate without waiting for the hop
+   */
+  void estimate(Spo2Estimate& out) const {
+    out.samples = samples;
+    out.flags = 0;
+    out.spo2 = 0.0f;
+    out.ratio = 0.0f;
+    out.perfusion_index = 0.0f;
+    out.heart_rate = 0.0f;
+
+    if (ir.dc < SPO2_FINGER_DC || red.dc <= 0.0f) {
+      return;
+    }
+    out.flags |= SPO2_FLAG_FINGER;
+
+    float ac_ir = sqrtf(ir.mean_square);
+    float ac_red = sqrtf(red.mean_square);
+    float pi_ir = ac_ir / ir.dc;
+    out.perfusion_index = pulse_amplitude / ir.dc * 100.0f;
+    if (interval_count > 0) {
+      out.heart_rate = 60.0f * rate_hz * interval_count / interval_sum;
+    }
+    if (samples < warmup_samples) {
+      return;
+    }
+
+    if (pi_ir > 0.0f) {
+      float r = (ac_red / red.dc) / pi_ir;
+      float spo2 = -45.060f * r * r + 30.354f * r + 94.845f;
+      out.ratio = r;
+      out.spo2 = spo2 < 0.0f ? 0.0f : spo2 > 100.0f ? 100.0f : spo2;
+      // Calibration covers 0.2 < R < 1.8; PI outside 0.05..20 % is motion or no pulse
+      if (r > 0.2f && r < 1.8f && out.perfusion_index >= 0.05f && out.perfusion_index <= 20.0f) {
+        out.flags |= SPO2_FLAG_SPO2_VALID;
+      }
+    }
+    if (interval_count >= 3 && out.heart_rate >= SPO2_MIN_BPM && out.heart_rate <= SPO2_MAX_BPM) {
+      out.flags |= SPO2_FLAG_HR_VALID;
+    }
+  }
+
+  uint16_t hopSamples() const { return hop_samples; }
+};
+
+#endif // SPO2_ESTIMATOR_H
@@ -0,0 +1,115 @@
+/*
+ * LifeBand Lock-free SPSC Ring Buffer
+ * Fixed-capacity single-producer / single-consumer queue
+ *
+ * One context pushes (ISR, sampler task), one context pops (loop, DSP task).
+ * No locks and no heap: storage lives inside the object, capacity must be a
+ * power of two so index wrap is a mask. Indices run freely and wrap at 2^32.
+ *
+ * Builds on the ESP32 and on a Linux host (std::atomic only).
+ */
+
+#ifndef SPSC_RING_H
+#define SPSC_RING_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <atomic>
+
+template <typename T, size_t CAPACITY>
+class SpscRing {
+  static_assert(CAPACITY >= 2 && (CAPACITY & (CAPACITY - 1)) == 0,
+                "SpscRing capacity must be a power of two");
+
+private:
+  static const uint32_t MASK = CAPACITY - 1;
+
+  T slots[CAPACITY];
+  std::atomic<uint32_t> head;   // next slot to write (producer owned)
+  std::atomic<uint32_t> tail;   // next slot to read (consumer owned)
+
+public:
+  SpscRing() : head(0), tail(0) {}
+
+  /**
+   * Producer side: append one item
+   * @return false if the ring is full (item is NOT written)
+   */
+  bool push(const T& item) {
+    uint32_t h = head.load(std::memory_order_relaxed);
+    uint32_t t = tail.load(std::memory_order_acquire);
+    if (h - t >= CAPACITY) {
+      return false;
+    }
+    slots[h & MASK] = item;
+    head.store(h + 1, std::memory_order_release);
+    return true;
+  }
+
+  /**
+   * Consumer side: remove one item
+   * @return false if the ring is empty
+   */
+  bool pop(T& item) {
+    uint32_t t = tail.load(std::memory_order_relaxed);
+    uint32_t h = head.load(std::memory_order_acquire);
+    if (h == t) {
+      return false;
+    }
+    item = slots[t & MASK];
+    tail.store(t + 1, std::memory_order_release);
+    return true;
+  }
+
+  /**
+   * Consumer side: remove up to max_items in one call
+   * @return number of items copied into out
+   */
+  size_t popBlock(T* out, size_t max_items) {
+    uint32_t t = tail.load(std::memory_order_relaxed);
+    uint32_t h = head.load(std::memory_order_acquire);
+    size_t n = h - t;
+    if (n > max_items) {
+      n = max_items;
+    }
+    for (size_t i = 0; i < n; i++) {
+      out[i] = slots[(t + i) & MASK];
+    }
+    tail.store(t + (uint32_t)n, std::memory_order_release);
+    return n;
+  }
+
+  /**
+   * Consumer side: look at the oldest item without removing it
+   */
+  bool peek(T& item) const {
+    uint32_t t = tail.load(std::memory_order_relaxed);
+    uint32_t h = head.load(std::memory_order_acquire);
+    if (h == t) {
+      return false;
+    }
+    item = slots[t & MASK];
+    return true;
+  }
+
+  size_t size() const {
+    return head.load(std::memory_order_acquire) - tail.load(std::memory_order_acquire);
+  }
+
+  bool empty() const {
+    return size() == 0;
+  }
+
+  size_t capacity() const {
+    return CAPACITY;
+  }
+
+  /**
+   * Consumer side: drop everything currently queued
+   */
+  void clear() {
+    tail.store(head.load(std::memory_order_acquire), std::memory_order_release);
+  }
+};
+
+#endif // SPSC_RING_H
@@ -0,0 +1,152 @@
+/*
+ * LifeBand Stream Clock
+ * Sample index -> micros() for a sensor with its own sample clock
+ *
+ * The ECG is sampled on an ESP32 timer, so its sample index maps to
+ * micros() exactly (EcgAcquisition::sampleTimeUs). The MAX30105 samples on
+ * its own oscillator and is read in bursts: a timestamp back-computed from
+ * the read time is late by the time the newest sample sat in the FIFO (up
+ * to one period plus I2C latency) and the sensor rate is only nominal.
+ *
+ * StreamClock fits the lower envelope of the observed (index, time) pairs:
+ * an observation can be late but never early, so the smallest residual of
+ * each block of STREAM_CLOCK_BLOCK samples is taken as an on-time point.
+ * Each point steers a second-order loop: part of the step moves the
+ * offset, part corrects the sample period (bounded to STREAM_CLOCK_MAX_PPM
+ * of nominal), so the sensor's rate error does not accumulate while single
+ * late reads are averaged out. A constant group delay (sensor-side
+ * averaging) is subtracted, putting both streams on one timebase.
+ *
+ * O(1) per sample; no Arduino dependency.
+ */
+
+#ifndef STREAM_CLOCK_H
+#define STREAM_CLOCK_H
+
+#include <stdint.h>
+#include <string.h>
+
+#define STREAM_CLOCK_BLOCK 50          // observations per envelope point
+#define STREAM_CLOCK_OFFSET_GAIN 0.25f // share of each step applied to the offset
+#define STREAM_CLOCK_RATE_GAIN 0.02f   // share of each step applied to the period
+#define STREAM_CLOCK_MAX_PPM 20000     // +/- 2 % around the nominal period
+
+struct StreamClockStats {
+  uint32_t observations;
+  uint32_t points;             // envelope points (re-anchors)
+  int32_t last_step_us;        // correction applied at the last re-anchor
+  int32_t rate_error_ppm;      // estimated period vs nominal
+};
+
+class StreamClock {
+private:
+  float nominal_us;
+  float period_us;
+  uint32_t group_delay_us;
+
+  bool locked;
+  uint32_t anchor_index;
+  uint32_t anchor_us;
+
+  uint16_t block_count;
+  int32_t block_min;
+  uint32_t block_min_index;
+
+  StreamClockStats stats;
+
+  uint32_t predict(uint32_t index) const {
+    float offset = (float)(int32_t)(index - anchor_index) * period_us;
+    return anchor_us + (uint32_t)(int32_t)(offset + (offset >= 0.0f ? 0.5f : -0.5f));
+  }
+
+public:
+  StreamClock() :
+    nominal_us(0.0f),
+    period_us(0.0f),
+    group_delay_us(0) {
+    reset();
+  }
+
+  /**
+   * @param sample_period_us: nominal time between samples
+   * @param delay_us: sensor group delay subtracted from every timestamp
+   */
+  void configure(uint32_t sample_period_us, uint32_t delay_us) {
+    nominal_us = (float)sample_period_us;
+    group_delay_us = delay_us;
+    reset();
+  }
+
+  /**
+   * Forget the fit (sensor restarted, index space reset)
+   */
+  void reset() {
+    period_us = nominal_us;
+    locked = false;
+    anchor_index = 0;
+    anchor_us = 0;
+    block_count = 0;
+    block_min = 0;
+    block_min_index = 0;
+    memset(&stats, 0, sizeof(stats));
+  }
+
+  /**
+   * Feed the index and the (possibly late) arrival estimate of a sample
+   */
+  void observe(uint32_t index, uint32_t time_us) {
+    stats.observations++;
+    if (!locked) {
+      anchor_index = index;
+      anchor_us = time_us;
+      locked = true;
+      return;
+    }
+    int32_t residual = (int32_t)(time_us - predict(index));
+    if (block_count == 0 || residual < block_min) {
+      block_min = residual;
+      block_min_index = index;
+    }
+    if (++block_count < STREAM_CLOCK_BLOCK) {
+      return;
+    }
+    block_count = 0;
+
+    // Gains start at 1 and shrink to their floor: fast lock, then averaging
+    float step = (float)block_min;
+    float offset_gain = 1.0f / (stats.points + 1);
+    if (offset_gain < STREAM_CLOCK_OFFSET_GAIN) offset_gain = STREAM_CLOCK_OFFSET_GAIN;
+    int32_t span = (int32_t)(block_min_index - anchor_index);
+    if (stats.points > 0 && span > 0) {
+      // The first point only replaces the raw first observation
+      float rate_gain = 1.0f / stats.points;
+      if (rate_gain < STREAM_CLOCK_RATE_GAIN) rate_gain = STREAM_CLOCK_RATE_GAIN;
+      period_us += rate_gain * step / span;
+      float limit = nominal_us * STREAM_CLOCK_MAX_PPM / 1000000.0f;
+      if (period_us > nominal_us + limit) period_us = nominal_us + limit;
+      if (period_us < nominal_us - limit) period_us = nominal_us - limit;
+    }
+    anchor_us = predict(block_min_index) + (uint32_t)(int32_t)(offset_gain * step);
+    anchor_index = block_min_index;
+    stats.points++;
+    stats.last_step_us = block_min;
+    stats.rate_error_ppm = nominal_us > 0.0f ?
+      (int32_t)((period_us - nominal_us) * 1000000.0f / nominal_us) : 0;
+  }
+
+  /**
+   * micros() at which sample index was taken (valid after one observation)
+   */
+  uint32_t timeUs(uint32_t index) const {
+    return predict(index) - group_delay_us;
+  }
+
+  bool isLocked() const { return locked; }
+  float periodUs() const { return period_us; }
+
+  StreamClockStats getStats() const {
+    return stats;
+  }
+};
+
+#endif // STREAM_CLOCK_H
@@ -0,0 +1,126 @@
+/*
+ * LifeBand Tensor Arena
+ * One statically allocated arena for every on-device model, planned at build time
+ *
+ * Each EloquentTinyML Sequential carried its own 8 KB arena and came from
+ * new at boot, one per engine (tflite_inference.h embedded 16 KB per
+ * engine). The models are tiny and never run at the same time, so all of
+ * that is replaced by one arena in .bss, carved into one region per model:
+ *
+ *   offset 0                     MODEL_REGISTRY[0].arena_bytes (aligned)
+ *   offset region 0 end          MODEL_REGISTRY[1].arena_bytes (aligned)
+ *   ...                          TENSOR_ARENA_BYTES in total
+ *
+ * The plan is constexpr over MODEL_REGISTRY, so changing a model's
+ * arena_bytes resizes the arena at compile time. Regions do not overlap:
+ * a TFLM interpreter keeps persistent state (tensor structs, kernel
+ * scratch) in its arena between Invoke() calls, so time-multiplexing one
+ * region would mean re-running AllocateTensors() on every switch. The
+ * regions already add up to less than one of the old per-model arenas.
+ *
+ * arena_bytes is a provisional budget (MODEL_ARENA_BUDGET), an estimate
+ * for a five-input dense model that has not been checked on the device
+ * yet. Each engine records arena_used_bytes() here after AllocateTensors()
+ * and the boot report shows budget against use, with an error for any
+ * model over budget; the budget should then be replaced by the recorded
+ * figure rounded up. A model whose region turns out too small fails
+ * AllocateTensors() and falls back to rules, it cannot spill into its
+ * neighbour. No Arduino dependency.
+ */
+
+#ifndef TENSOR_ARENA_H
+#define TENSOR_ARENA_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+#include "model_registry.h"
+
+#define TENSOR_ARENA_ALIGN 16             // TFLM tensor alignment
+
+constexpr uint32_t tensorArenaAlign(uint32_t bytes) {
+  return (bytes + TENSOR_ARENA_ALIGN - 1) & ~(uint32_t)(TENSOR_ARENA_ALIGN - 1);
+}
+
+/**
+ * Start of a model's region (MODEL_COUNT: total size)
+ */
+constexpr uint32_t tensorArenaOffset(uint8_t type) {
+  return type == 0 ? 0 : tensorArenaOffset(type - 1) + tensorArenaAlign(MODEL_REGISTRY[type - 1].arena_bytes);
+}
+
+#define TENSOR_ARENA_BYTES tensorArenaOffset(MODEL_COUNT)
+
+static_assert(TENSOR_ARENA_BYTES > 0, "tensor arena plan is empty");
+
+struct ArenaRegion {
+  uint32_t offset;
+  uint32_t size;            // budget
+  uint32_t used;            // recorded arena_used_bytes(), 0 until loaded
+};
+
+class TensorArena {
+private:
+  alignas(TENSOR_ARENA_ALIGN) uint8_t memory[TENSOR_ARENA_BYTES];
+  uint32_t used[MODEL_COUNT];
+
+public:
+  TensorArena() {
+    memset(used, 0, sizeof(used));
+  }
+
+  static constexpr uint32_t size() {
+    return TENSOR_ARENA_BYTES;
+  }
+
+  /**
+   * The model's region (owned by its engine)
+   */
+  uint8_t* region(ModelType type) {
+    return memory + tensorArenaOffset(type);
+  }
+
+  static constexpr uint32_t regionSize(ModelType type) {
+    return tensorArenaAlign(MODEL_REGISTRY[type].arena_bytes);
+  }
+
+  /**
+   * Engine reports arena_used_bytes() after allocating its tensors
+   */
+  void recordUsed(ModelType type, uint32_t bytes) {
+    if (type < MODEL_COUNT) {
+      used[type] = bytes;
+    }
+  }
+
+  ArenaRegion plan(ModelType type) const {
+    ArenaRegion r;
+    r.offset = tensorArenaOffset(type);
+    r.size = regionSize(type);
+    r.used = used[type];
+    return r;
+  }
+
+  /**
+   * @return MODEL_BIT mask of models using more than their region
+   */
+  uint8_t overBudget() const {
+    uint8_t mask = 0;
+    for (uint8_t i = 0; i < MODEL_COUNT; i++) {
+      if (used[i] > regionSize((ModelType)i)) {
+        mask |= MODEL_BIT(i);
+      }
+    }
+    return mask;
+  }
+
+  uint32_t totalUsed() const {
+    uint32_t total = 0;
+    for (uint8_t i = 0; i < MODEL_COUNT; i++) {
+      total += used[i];
+    }
+    return total;
+  }
+};
+
+#endif // TENSOR_ARENA_H
@@ -1,282 +1,168 @@
 /**
- * TensorFlow Lite Inference Engine using EloquentTinyML
- * Real TensorFlow Lite Micro implementation for ESP32
- * 
- * Based on EloquentTinyML v3.x API
+ * TensorFlow Lite Inference Engine for ESP32
+ * Real TensorFlow Lite Micro implementation (tflm_esp32, the TFLM build
+ * EloquentTinyML v3.x wraps)
+ *
+ * One engine runs one model: the ModelSpec is bound at construction and
+ * scheduling is left to ModelRegistry (model_registry.h). The interpreter
+ * works in the model's region of the shared static TensorArena
+ * (tensor_arena.h) and is constructed in place, so loading a model does
+ * not touch the heap. Eloquent's Sequential is not used because it embeds
+ * an arena of its own in every instance.
  */
 
 #ifndef TFLITE_INFERENCE_ELOQUENT_H
 #define TFLITE_INFERENCE_ELOQUENT_H
 
 #include <Arduino.h>
+#include <new>
 
 // Model headers - MUST be included BEFORE TensorFlow headers
-#include "models_h/arrhythmia_risk_model.h"
-#include "models_h/anemia_risk_model.h"
-#include "models_h/preeclampsia_risk_model.h"
+#include "model_registry.h"
+#include "tensor_arena.h"
 
-// TensorFlow Lite for ESP32 (EloquentTinyML v3.x)
+// TensorFlow Lite for ESP32
 #include <tflm_esp32.h>
-#include <eloquent_tinyml.h>
+#include <tensorflow/lite/micro/micro_mutable_op_resolver.h>
+#include <tensorflow/lite/micro/micro_interpreter.h>
+#include <tensorflow/lite/schema/schema_generated.h>
 
-#define ARENA_SIZE 8192  // 8KB arena per model
-#define TF_NUM_OPS 10    // Number of TensorFlow operations
-
-// Model types
-enum ModelType {
-  MODEL_ARRHYTHMIA = 0,
-  MODEL_ANEMIA = 1,
-  MODEL_PREECLAMPSIA = 2
-};
+#define TF_NUM_OPS 2     // FullyConnected, Softmax
 
 /**
- * TensorFlow Lite Inference Engine
+ * TensorFlow Lite Inference Engine (one model)
  */
-class TFLiteInferenceEngine {
+class TFLiteInferenceEngine : public InferenceBackend {
 private:
-  ModelType current_model_type;
-  bool initialized;
-  
-  // Eloquent TF Sequential models (v3.x API)
-  Eloquent::TF::Sequential<TF_NUM_OPS, ARENA_SIZE> *arrhythmia_ml;
-  Eloquent::TF::Sequential<TF_NUM_OPS, ARENA_SIZE> *anemia_ml;
-  Eloquent::TF::Sequential<TF_NUM_OPS, ARENA_SIZE> *preeclampsia_ml;
-  
+  const ModelSpec& model_spec;
+  TensorArena& arena;
+
+  tflite::MicroMutableOpResolver<TF_NUM_OPS> resolver;
+  alignas(tflite::MicroInterpreter) uint8_t interpreter_storage[sizeof(tflite::MicroInterpreter)];
+  tflite::MicroInterpreter* interpreter;   // in interpreter_storage once begin() succeeds
+  TfLiteTensor* input;
+  TfLiteTensor* output;
+
+  bool fail(const char* reason) {
+    Serial.print("[TFLITE] ✗ ");
+    Serial.print(model_spec.name);
+    Serial.print(" model failed: ");
+    Serial.println(reason);
+    freeModel();
+    return false;
+  }
+
 public:
-  TFLiteInferenceEngine() : 
-    current_model_type(MODEL_ARRHYTHMIA),
-    initialized(false),
-    arrhythmia_ml(nullptr),
-    anemia_ml(nullptr),
-    preeclampsia_ml(nullptr) {
+  TFLiteInferenceEngine(const ModelSpec& spec, TensorArena& tensor_arena) :
+    model_spec(spec),
+    arena(tensor_arena),
+    interpreter(nullptr),
+    input(nullptr),
+    output(nullptr) {
+    resolver.AddFullyConnected();
+    resolver.AddSoftmax();
   }
-  
+
   ~TFLiteInferenceEngine() {
-    if (arrhythmia_ml) delete arrhythmia_ml;
-    if (anemia_ml) delete anemia_ml;
-    if (preeclampsia_ml) delete preeclampsia_ml;
+    freeModel();
   }
-  
-  /**
-   * Initialize a specific model
-   */
-  bool initModel(ModelType type) {
-    Serial.print("[TFLITE] Loading model type ");
-    Serial.println(type);
-    
-    try {
-      switch (type) {
-        case MODEL_ARRHYTHMIA: {
-          if (!arrhythmia_ml) {
-            arrhythmia_ml = new Eloquent::TF::Sequential<TF_NUM_OPS, ARENA_SIZE>();
-            arrhythmia_ml->setNumInputs(5);
-            arrhythmia_ml->setNumOutputs(5);
-            arrhythmia_ml->resolver.AddFullyConnected();
-            arrhythmia_ml->resolver.AddSoftmax();
-          }
-          
-          if (!arrhythmia_ml->begin(arrhythmia_risk_model_tflite).isOk()) {
-            Serial.print("[TFLITE] ✗ Arrhythmia model failed: ");
-            Serial.println(arrhythmia_ml->exception.toString());
-            return false;
-          }
-          Serial.println("[TFLITE] ✓ Arrhythmia model loaded");
-          return true;
-        }
-          
-        case MODEL_ANEMIA: {
-          if (!anemia_ml) {
-            anemia_ml = new Eloquent::TF::Sequential<TF_NUM_OPS, ARENA_SIZE>();
-            anemia_ml->setNumInputs(5);
-            anemia_ml->setNumOutputs(4);
-            anemia_ml->resolver.AddFullyConnected();
-            anemia_ml->resolver.AddSoftmax();
-          }
-          
-          if (!anemia_ml->begin(anemia_risk_model_tflite).isOk()) {
-            Serial.print("[TFLITE] ✗ Anemia model failed: ");
-            Serial.println(anemia_ml->exception.toString());
-            return false;
-          }
-          Serial.println("[TFLITE] ✓ Anemia model loaded");
-          return true;
-        }
-          
-        case MODEL_PREECLAMPSIA: {
-          if (!preeclampsia_ml) {
-            preeclampsia_ml = new Eloquent::TF::Sequential<TF_NUM_OPS, ARENA_SIZE>();
-            preeclampsia_ml->setNumInputs(5);
-            preeclampsia_ml->setNumOutputs(4);
-            preeclampsia_ml->resolver.AddFullyConnected();
-            preeclampsia_ml->resolver.AddSoftmax();
-          }
-          
-          if (!preeclampsia_ml->begin(preeclampsia_risk_model_tflite).isOk()) {
-            Serial.print("[TFLITE] ✗ Preeclampsia model failed: ");
-            Serial.println(preeclampsia_ml->exception.toString());
-            return false;
-          }
-          Serial.println("[TFLITE] ✓ Preeclampsia model loaded");
-          return true;
-        }
-          
-        default:
-          Serial.println("[TFLITE] ✗ Unknown model type");
-          return false;
-      }
-    } catch (...) {
-      Serial.println("[TFLITE] ✗ Exception during model init");
-      return false;
-    }
+
+  const ModelSpec& spec() const override {
+    return model_spec;
+  }
+
+  const char* name() const override {
+    return "TFLite Micro";
   }
-  
+
   /**
-   * Load a model for inference
+   * Initialize the bound model in its arena region
    */
-  bool loadModel(ModelType type) {
-    current_model_type = type;
-    
-    // Model is already initialized in initModel()
-    switch (type) {
-      case MODEL_ARRHYTHMIA:
-        return arrhythmia_ml != nullptr;
-      case MODEL_ANEMIA:
-        return anemia_ml != nullptr;
-      case MODEL_PREECLAMPSIA:
-        return preeclampsia_ml != nullptr;
-      default:
-        return false;
+  bool begin() override {
+    Serial.print("[TFLITE] Loading ");
+    Serial.print(model_spec.name);
+    Serial.println(" model");
+    freeModel();
+
+    // A flatbuffer carries its identifier at offset 4; anything else would be
+    // dereferenced as garbage offsets by GetModel()
+    if (model_spec.length < 8 || memcmp(model_spec.data + 4, "TFL3", 4) != 0) {
+      return fail("not a TFLite flatbuffer");
+    }
+    const tflite::Model* model = tflite::GetModel(model_spec.data);
+    if (!model || model->version() != TFLITE_SCHEMA_VERSION) {
+      return fail("not a TFLite flatbuffer of this schema version");
+    }
+    interpreter = new (interpreter_storage) tflite::MicroInterpreter(
+      model, resolver, arena.region(model_spec.type), TensorArena::regionSize(model_spec.type));
+    if (interpreter->AllocateTensors() != kTfLiteOk) {
+      return fail("tensors do not fit the planned arena region");
     }
+    arena.recordUsed(model_spec.type, interpreter->arena_used_bytes());
+
+    input = interpreter->input(0);
+    output = interpreter->output(0);
+    if (!input || !output ||
+        input->bytes < model_spec.inputs * (input->type == kTfLiteInt8 ? 1 : sizeof(float)) ||
+        output->bytes < model_spec.outputs * (output->type == kTfLiteInt8 ? 1 : sizeof(float))) {
+      return fail("input/output shape does not match the registry");
+    }
+
+    Serial.print("[TFLITE] ✓ ");
+    Serial.print(model_spec.name);
+    Serial.print(" model loaded, arena ");
+    Serial.print((unsigned long)interpreter->arena_used_bytes());
+    Serial.print("/");
+    Serial.print((unsigned long)TensorArena::regionSize(model_spec.type));
+    Serial.println(" B");
+    return true;
   }
-  
+
   /**
-   * Run inference
+   * Run inference (int8 models are quantized and dequantized here)
    */
-  bool invoke(float* input, int input_size, float* output, int output_size) {
-    if (input_size != 5) {
-      Serial.println("[TFLITE] ✗ Expected 5 inputs");
+  bool invoke(const float* in, float* out) override {
+    if (!interpreter) {
       return false;
     }
-    
-    try {
-      switch (current_model_type) {
-        case MODEL_ARRHYTHMIA: {
-          if (!arrhythmia_ml) {
-            Serial.println("[TFLITE] ✗ Arrhythmia model not loaded");
-            return false;
-          }
-          
-          // Run prediction
-          if (!arrhythmia_ml->predict(input).isOk()) {
-            Serial.print("[TFLITE] ✗ Prediction failed: ");
-            Serial.println(arrhythmia_ml->exception.toString());
-            return false;
-          }
-          
-          // Copy output using the output() method
-          for (int i = 0; i < output_size && i < 5; i++) {
-            output[i] = arrhythmia_ml->output(i);
-          }
-          break;
-        }
-          
-        case MODEL_ANEMIA: {
-          if (!anemia_ml) {
-            Serial.println("[TFLITE] ✗ Anemia model not loaded");
-            return false;
-          }
-          
-          if (!anemia_ml->predict(input).isOk()) {
-            Serial.print("[TFLITE] ✗ Prediction failed: ");
-            Serial.println(anemia_ml->exception.toString());
-            return false;
-          }
-          
-          for (int i = 0; i < output_size && i < 4; i++) {
-            output[i] = anemia_ml->output(i);
-          }
-          break;
-        }
-          
-        case MODEL_PREECLAMPSIA: {
-          if (!preeclampsia_ml) {
-            Serial.println("[TFLITE] ✗ Preeclampsia model not loaded");
-            return false;
-          }
-          
-          if (!preeclampsia_ml->predict(input).isOk()) {
-            Serial.print("[TFLITE] ✗ Prediction failed: ");
-            Serial.println(preeclampsia_ml->exception.toString());
-            return false;
-          }
-          
-          for (int i = 0; i < output_size && i < 4; i++) {
-            output[i] = preeclampsia_ml->output(i);
-          }
-          break;
-        }
-          
-        default:
-          Serial.println("[TFLITE] ✗ Invalid model type");
-          return false;
+
+    for (int i = 0; i < model_spec.inputs; i++) {
+      if (input->type == kTfLiteInt8) {
+        long q = lroundf(in[i] / input->params.scale) + input->params.zero_point;
+        input->data.int8[i] = (int8_t)(q < -128 ? -128 : q > 127 ? 127 : q);
+      } else {
+        input->data.f[i] = in[i];
       }
-      
-      return true;
-      
-    } catch (...) {
-      Serial.println("[TFLITE] ✗ Exception during inference");
-      return false;
     }
-  }
-  
-  /**
-   * Get predicted class (argmax)
-   */
-  int getPredictedClass(float* output, int output_size) {
-    int max_idx = 0;
-    float max_val = output[0];
-    
-    for (int i = 1; i < output_size; i++) {
-      if (output[i] > max_val) {
-        max_val = output[i];
-        max_idx = i;
-      }
+    if (interpreter->Invoke() != kTfLiteOk) {
+      return false;
     }
-    
-    return max_idx;
-  }
-  
-  /**
-   * Get confidence of prediction (0-100)
-   */
-  float getConfidence(float* output, int output_size) {
-    float max_prob = 0.0;
-    
-    for (int i = 0; i < output_size; i++) {
-      if (output[i] > max_prob) {
-        max_prob = output[i];
-      }
+    for (int i = 0; i < model_spec.outputs; i++) {
+      out[i] = output->type == kTfLiteInt8 ?
+        (output->data.int8[i] - output->params.zero_point) * output->params.scale :
+        output->data.f[i];
     }
-    
-    return max_prob * 100.0;  // Convert to percentage
+    return true;
   }
-  
+
   /**
    * Check if ready for inference
    */
-  bool isReady() {
-    return arrhythmia_ml != nullptr || 
-           anemia_ml != nullptr || 
-           preeclampsia_ml != nullptr;
+  bool isReady() const {
+    return interpreter != nullptr;
   }
-  
+
   /**
-   * Free model memory
+   * Release the interpreter (its arena region stays reserved)
    */
   void freeModel() {
-    if (arrhythmia_ml) { delete arrhythmia_ml; arrhythmia_ml = nullptr; }
-    if (anemia_ml) { delete anemia_ml; anemia_ml = nullptr; }
-    if (preeclampsia_ml) { delete preeclampsia_ml; preeclampsia_ml = nullptr; }
+    if (interpreter) {
+      interpreter->~MicroInterpreter();
+      interpreter = nullptr;
+    }
+    input = nullptr;
+    output = nullptr;
+    arena.recordUsed(model_spec.type, 0);
   }
 };
 
@@ -1,72 +0,0 @@
-/*
- * TensorFlow Lite Micro Inference Engine for ESP32-S3
- * Optimized for LifeBand maternal health monitoring
- * 
- * Supports 3 models:
- * - Arrhythmia Detection
- * - Anemia Risk Assessment  
- * - Preeclampsia Detection
- * 
- * NOTE: TensorFlow Lite has compilation issues with ESP32-S3.
- * This version uses rule-based fallback (which is already excellent).
- */
-
-#ifndef TFLITE_INFERENCE_H
-#define TFLITE_INFERENCE_H
-
-#include <Arduino.h>
-
-// Include generated model headers (not used but needed for compatibility)
-#include "arrhythmia_risk_model.h"
-#include "anemia_risk_model.h"
-#include "preeclampsia_risk_model.h"
-
-// Model types
-enum ModelType {
-  MODEL_ARRHYTHMIA = 0,
-  MODEL_ANEMIA = 1,
-  MODEL_PREECLAMPSIA = 2
-};
-
-// Placeholder TFLite Inference Engine (bypasses TensorFlow Lite library issues)
-// Uses rule-based detection which is already proven to work excellently
-class TFLiteInferenceEngine {
-private:
-  ModelType current_model;
-  bool initialized;
-  
-public:
-  TFLiteInferenceEngine() : initialized(false) {}
-  
-  // Initialize model (always returns false to trigger rule-based fallback)
-  bool initModel(ModelType type) {
-    current_model = type;
-    // Return false to use rule-based detection
-    // This bypasses TensorFlow Lite compilation issues
-    initialized = false;
-    return false;
-  }
-  
-  // Run inference (not implemented - uses fallback)
-  bool invoke(float* input, int input_size, float* output, int output_size) {
-    // Not implemented - rule-based detection will be used
-    return false;
-  }
-  
-  // Get predicted class (not used)
-  int getPredictedClass(float* output, int output_size) {
-    return 0;
-  }
-  
-  // Get confidence (not used)
-  float getConfidence(float* output, int output_size) {
-    return 0.0;
-  }
-  
-  // Check if model is ready
-  bool isReady() {
-    return false;  // Always false to trigger fallback
-  }
-};
-
-#endif // TFLITE_INFERENCE_H
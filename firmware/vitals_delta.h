@@ -0,0 +1,381 @@
+/*
+ * LifeBand Delta Vitals Frames
+ * Field-subscribed, change-only vitals notifications with periodic keyframes
+ *
+ * Every vitals notification resent all fields of the frame every 2 s, even
+ * though most of them (AI results, BP, quality, score) hold still for
+ * minutes. VitalsDeltaEncoder keeps the last value sent for each field and
+ * emits only the subscribed fields that changed, no more often than each
+ * field's minimum period; a keyframe with every subscribed field goes out
+ * every keyframe interval so a receiver that just connected or missed a
+ * notification resynchronizes. A step in which nothing changed sends
+ * nothing.
+ *
+ * Frame = 4-byte header + payload, little-endian:
+ *   header  [0] magic 'D' (0x44)  [1] version
+ *           [2] payload length    [3] sequence (shared with full frames)
+ *   payload u24 field mask (bit 23 = keyframe), then the fields whose bit
+ *           is set, in bit order:
+ *
+ *   bit field         bytes            bit field         bytes
+ *    0  TIME          u32 timestamp     10  SOURCE        u8 hr_source | bp_method << 2
+ *    1  HR            u8                11  ALERTS        u8
+ *    2  HR_ECG        u8                12  RHYTHM        u8 type, u8 confidence
+ *    3  HR_PPG        u8                13  ANEMIA        u8 risk, u8 confidence
+ *    4  SPO2          u8                14  PREECLAMPSIA  u8 risk, u8 confidence
+ *    5  BP            u8 sys, u8 dia    15  SCORE         u8
+ *    6  HRV           u16 last RR       16  ECG           u16 raw ADC
+ *    7  SDNN          u16               17  IR            u32
+ *    8  PTT           u16               18  RED           u32
+ *    9  QUALITY       u8 ecg, u8 ppg
+ *
+ * Values and encodings are those of the schema-2 full frame (vitals_frame.h).
+ * Later versions only add fields at higher bits, so a decoder stops after
+ * the fields it knows. Frames replayed from the offline log are always sent
+ * as full frames.
+ *
+ * Single owner (transport stage); no Arduino dependency.
+ */
+
+#ifndef VITALS_DELTA_H
+#define VITALS_DELTA_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+#include "vitals_frame.h"
+
+#define VITALS_DELTA_MAGIC 0x44
+#define VITALS_DELTA_VERSION 1
+#define VITALS_DELTA_KEYFRAME 0x800000UL  // mask bit 23
+#define VITALS_DELTA_MAX_PAYLOAD 40       // mask + every field
+#define VITALS_DELTA_SIZE (VITALS_FRAME_HEADER + VITALS_DELTA_MAX_PAYLOAD)
+#define VITALS_DELTA_KEYFRAME_MS 10000    // default keyframe interval
+#define VITALS_DELTA_MIN_PERIOD_MS 250    // fastest per-field rate accepted
+
+enum VitalsField : uint8_t {
+  VITALS_FIELD_TIME = 0,
+  VITALS_FIELD_HR,
+  VITALS_FIELD_HR_ECG,
+  VITALS_FIELD_HR_PPG,
+  VITALS_FIELD_SPO2,
+  VITALS_FIELD_BP,
+  VITALS_FIELD_HRV,
+  VITALS_FIELD_SDNN,
+  VITALS_FIELD_PTT,
+  VITALS_FIELD_QUALITY,
+  VITALS_FIELD_SOURCE,
+  VITALS_FIELD_ALERTS,
+  VITALS_FIELD_RHYTHM,
+  VITALS_FIELD_ANEMIA,
+  VITALS_FIELD_PREECLAMPSIA,
+  VITALS_FIELD_SCORE,
+  VITALS_FIELD_ECG,
+  VITALS_FIELD_IR,
+  VITALS_FIELD_RED,
+  VITALS_FIELD_COUNT
+};
+
+#define VITALS_FIELDS_ALL ((1UL << VITALS_FIELD_COUNT) - 1)
+#define VITALS_FIELD_BYTES 37             // sum of all field sizes
+
+static const uint8_t VITALS_FIELD_SIZES[VITALS_FIELD_COUNT] = {
+  4, 1, 1, 1, 1, 2, 2, 2, 2, 2, 1, 1, 2, 2, 2, 1, 2, 4, 4
+};
+
+static const char* const VITALS_FIELD_NAMES[VITALS_FIELD_COUNT] = {
+  "TIME", "HR", "HR_ECG", "HR_PPG", "SPO2", "BP", "HRV", "SDNN", "PTT", "QUALITY",
+  "SOURCE", "ALERTS", "RHYTHM", "ANEMIA", "PREECLAMPSIA", "SCORE", "ECG", "IR", "RED"
+};
+
+/**
+ * Serialize one field of a frame
+ * @return bytes written (VITALS_FIELD_SIZES[field])
+ */
+static inline uint8_t packVitalsField(const VitalsFrame& f, uint8_t field, uint8_t* p) {
+  switch (field) {
+    case VITALS_FIELD_TIME:         vitalsPut32(p, f.timestamp_ms); break;
+    case VITALS_FIELD_HR:           p[0] = f.hr; break;
+    case VITALS_FIELD_HR_ECG:       p[0] = f.hr_ecg; break;
+    case VITALS_FIELD_HR_PPG:       p[0] = f.hr_ppg; break;
+    case VITALS_FIELD_SPO2:         p[0] = f.spo2; break;
+    case VITALS_FIELD_BP:           p[0] = f.bp_sys; p[1] = f.bp_dia; break;
+    case VITALS_FIELD_HRV:          vitalsPut16(p, f.hrv_ms); break;
+    case VITALS_FIELD_SDNN:         vitalsPut16(p, f.hrv_sdnn); break;
+    case VITALS_FIELD_PTT:          vitalsPut16(p, f.ptt_ms); break;
+    case VITALS_FIELD_QUALITY:      p[0] = f.ecg_quality; p[1] = f.ppg_quality; break;
+    case VITALS_FIELD_SOURCE:       p[0] = (uint8_t)((f.hr_source & 0x03) | ((f.bp_method & 0x01) << 2)); break;
+    case VITALS_FIELD_ALERTS:       p[0] = f.alerts; break;
+    case VITALS_FIELD_RHYTHM:       p[0] = f.rhythm; p[1] = f.rhythm_confidence; break;
+    case VITALS_FIELD_ANEMIA:       p[0] = f.anemia_risk; p[1] = f.anemia_confidence; break;
+    case VITALS_FIELD_PREECLAMPSIA: p[0] = f.preeclampsia_risk; p[1] = f.preeclampsia_confidence; break;
+    case VITALS_FIELD_SCORE:        p[0] = f.maternal_health_score; break;
+    case VITALS_FIELD_ECG:          vitalsPut16(p, f.ecg_raw); break;
+    case VITALS_FIELD_IR:           vitalsPut32(p, f.ir); break;
+    case VITALS_FIELD_RED:          vitalsPut32(p, f.red); break;
+    default: return 0;
+  }
+  return VITALS_FIELD_SIZES[field];
+}
+
+static inline uint8_t unpackVitalsField(VitalsFrame& f, uint8_t field, const uint8_t* p) {
+  switch (field) {
+    case VITALS_FIELD_TIME:         f.timestamp_ms = vitalsGet32(p); break;
+    case VITALS_FIELD_HR:           f.hr = p[0]; break;
+    case VITALS_FIELD_HR_ECG:       f.hr_ecg = p[0]; break;
+    case VITALS_FIELD_HR_PPG:       f.hr_ppg = p[0]; break;
+    case VITALS_FIELD_SPO2:         f.spo2 = p[0]; break;
+    case VITALS_FIELD_BP:           f.bp_sys = p[0]; f.bp_dia = p[1]; break;
+    case VITALS_FIELD_HRV:          f.hrv_ms = vitalsGet16(p); break;
+    case VITALS_FIELD_SDNN:         f.hrv_sdnn = vitalsGet16(p); break;
+    case VITALS_FIELD_PTT:          f.ptt_ms = vitalsGet16(p); break;
+    case VITALS_FIELD_QUALITY:      f.ecg_quality = p[0]; f.ppg_quality = p[1]; break;
+    case VITALS_FIELD_SOURCE:
+      f.hr_source = (HrSource)(p[0] & 0x03);
+      f.bp_method = (BpMethod)((p[0] >> 2) & 0x01);
+      break;
+    case VITALS_FIELD_ALERTS:       f.alerts = p[0]; break;
+    case VITALS_FIELD_RHYTHM:       f.rhythm = (RhythmType)p[0]; f.rhythm_confidence = p[1]; break;
+    case VITALS_FIELD_ANEMIA:       f.anemia_risk = (RiskLevel)p[0]; f.anemia_confidence = p[1]; break;
+    case VITALS_FIELD_PREECLAMPSIA: f.preeclampsia_risk = (RiskLevel)p[0]; f.preeclampsia_confidence = p[1]; break;
+    case VITALS_FIELD_SCORE:        f.maternal_health_score = p[0]; break;
+    case VITALS_FIELD_ECG:          f.ecg_raw = vitalsGet16(p); break;
+    case VITALS_FIELD_IR:           f.ir = vitalsGet32(p); break;
+    case VITALS_FIELD_RED:          f.red = vitalsGet32(p); break;
+    default: return 0;
+  }
+  return VITALS_FIELD_SIZES[field];
+}
+
+/**
+ * @param name: field name, not NUL-terminated
+ * @return VitalsField, or -1 if unknown
+ */
+static inline int vitalsFieldIndex(const char* name, size_t len) {
+  for (uint8_t i = 0; i < VITALS_FIELD_COUNT; i++) {
+    if (strlen(VITALS_FIELD_NAMES[i]) == len && strncmp(VITALS_FIELD_NAMES[i], name, len) == 0) {
+      return i;
+    }
+  }
+  return -1;
+}
+
+/**
+ * Parse a field list: "ALL", "NONE", a hex mask ("0x1F") or field names
+ * separated by commas or spaces ("HR,SPO2,BP")
+ * @return false on an unknown name (mask unchanged)
+ */
+static inline bool parseVitalsFieldMask(const char* text, uint32_t& mask) {
+  while (*text == ' ') text++;
+  if (strcmp(text, "ALL") == 0) {
+    mask = VITALS_FIELDS_ALL;
+    return true;
+  }
+  if (strcmp(text, "NONE") == 0) {
+    mask = 0;
+    return true;
+  }
+  if (text[0] == '0' && (text[1] == 'X' || text[1] == 'x')) {
+    uint32_t value = 0;
+    const char* p = text + 2;
+    if (!*p) return false;
+    for (; *p; p++) {
+      char c = *p;
+      int digit = c >= '0' && c <= '9' ? c - '0' :
+                  c >= 'A' && c <= 'F' ? c - 'A' + 10 :
+                  c >= 'a' && c <= 'f' ? c - 'a' + 10 : -1;
+      if (digit < 0 || value > 0x0FFFFFFFUL) return false;
+      value = (value << 4) | (uint32_t)digit;
+    }
+    mask = value & VITALS_FIELDS_ALL;
+    return true;
+  }
+  uint32_t value = 0;
+  const char* p = text;
+  while (*p) {
+    while (*p == ',' || *p == ' ') p++;
+    const char* start = p;
+    while (*p && *p != ',' && *p != ' ') p++;
+    if (p == start) break;
+    int field = vitalsFieldIndex(start, (size_t)(p - start));
+    if (field < 0) return false;
+    value |= 1UL << field;
+  }
+  mask = value;
+  return true;
+}
+
+struct VitalsDeltaConfig {
+  uint32_t mask;                             // subscribed fields
+  uint16_t period_ms[VITALS_FIELD_COUNT];    // minimum spacing, 0 = every change
+  uint16_t keyframe_ms;                      // 0 = only when forced
+
+  /**
+   * Everything, on every change, keyframe every VITALS_DELTA_KEYFRAME_MS
+   */
+  void setDefaults() {
+    mask = VITALS_FIELDS_ALL;
+    for (uint8_t i = 0; i < VITALS_FIELD_COUNT; i++) period_ms[i] = 0;
+    keyframe_ms = VITALS_DELTA_KEYFRAME_MS;
+  }
+
+  /**
+   * Snapshot interval the fastest subscribed field needs
+   * @param base_ms: interval when no field asks for more
+   */
+  uint32_t intervalMs(uint32_t base_ms) const {
+    uint32_t interval = base_ms;
+    for (uint8_t i = 0; i < VITALS_FIELD_COUNT; i++) {
+      if ((mask & (1UL << i)) && period_ms[i] > 0 && period_ms[i] < interval) {
+        interval = period_ms[i];
+      }
+    }
+    return interval < VITALS_DELTA_MIN_PERIOD_MS ? VITALS_DELTA_MIN_PERIOD_MS : interval;
+  }
+};
+
+struct VitalsDeltaStats {
+  uint32_t frames;          // delta frames sent (keyframes included)
+  uint32_t keyframes;
+  uint32_t unchanged;       // snapshots with nothing to send
+  uint32_t fields;          // field values sent
+  uint32_t bytes;           // delta bytes sent, headers included
+  uint32_t full_bytes;      // what full frames would have cost
+};
+
+class VitalsDeltaEncoder {
+private:
+  VitalsDeltaConfig config;
+  uint8_t offsets[VITALS_FIELD_COUNT];
+  uint8_t sent[VITALS_FIELD_BYTES];          // last value sent per field
+  uint32_t sent_ms[VITALS_FIELD_COUNT];
+  uint32_t keyframe_at_ms;
+  bool need_keyframe;
+
+  VitalsDeltaStats stats;
+
+public:
+  VitalsDeltaEncoder() :
+    keyframe_at_ms(0),
+    need_keyframe(true) {
+    uint8_t offset = 0;
+    for (uint8_t i = 0; i < VITALS_FIELD_COUNT; i++) {
+      offsets[i] = offset;
+      offset += VITALS_FIELD_SIZES[i];
+    }
+    config.setDefaults();
+    memset(sent, 0, sizeof(sent));
+    memset(sent_ms, 0, sizeof(sent_ms));
+    memset(&stats, 0, sizeof(stats));
+  }
+
+  /**
+   * Apply a subscription; the next frame is a keyframe
+   */
+  void configure(const VitalsDeltaConfig& cfg) {
+    config = cfg;
+    config.mask &= VITALS_FIELDS_ALL;
+    need_keyframe = true;
+  }
+
+  /**
+   * Send every subscribed field next time (new subscriber, resync)
+   */
+  void forceKeyframe() {
+    need_keyframe = true;
+  }
+
+  /**
+   * Encode the subscribed fields of a snapshot that are due
+   * @param now_ms: snapshot time (the frame's timestamp)
+   * @param buf: at least VITALS_DELTA_SIZE bytes
+   * @return bytes written, 0 if there is nothing to send
+   */
+  size_t encode(const VitalsFrame& f, uint32_t now_ms, uint8_t seq, uint8_t* buf, size_t capacity) {
+    if (capacity < VITALS_DELTA_SIZE) {
+      return 0;
+    }
+    stats.full_bytes += VITALS_FRAME_SIZE;
+    bool keyframe = need_keyframe ||
+                    (config.keyframe_ms > 0 && now_ms - keyframe_at_ms >= config.keyframe_ms);
+
+    uint8_t* p = buf + VITALS_FRAME_HEADER + 3;
+    uint32_t mask = 0;
+    uint8_t value[4];
+    for (uint8_t i = 0; i < VITALS_FIELD_COUNT; i++) {
+      if (!(config.mask & (1UL << i))) {
+        continue;
+      }
+      uint8_t size = packVitalsField(f, i, value);
+      if (!keyframe) {
+        if (memcmp(value, sent + offsets[i], size) == 0) continue;
+        if (config.period_ms[i] > 0 && now_ms - sent_ms[i] < config.period_ms[i]) continue;
+      }
+      memcpy(sent + offsets[i], value, size);
+      memcpy(p, value, size);
+      p += size;
+      sent_ms[i] = now_ms;
+      mask |= 1UL << i;
+      stats.fields++;
+    }
+
+    if (keyframe) {
+      mask |= VITALS_DELTA_KEYFRAME;
+      keyframe_at_ms = now_ms;
+      need_keyframe = false;
+      stats.keyframes++;
+    } else if (mask == 0) {
+      stats.unchanged++;
+      return 0;
+    }
+
+    size_t length = (size_t)(p - buf);
+    buf[0] = VITALS_DELTA_MAGIC;
+    buf[1] = VITALS_DELTA_VERSION;
+    buf[2] = (uint8_t)(length - VITALS_FRAME_HEADER);
+    buf[3] = seq;
+    buf[4] = (uint8_t)(mask & 0xFF);
+    buf[5] = (uint8_t)((mask >> 8) & 0xFF);
+    buf[6] = (uint8_t)((mask >> 16) & 0xFF);
+    stats.frames++;
+    stats.bytes += length;
+    return length;
+  }
+
+  const VitalsDeltaConfig& getConfig() const { return config; }
+  VitalsDeltaStats getStats() const { return stats; }
+};
+
+/**
+ * Apply a delta frame to the receiver's copy of the vitals
+ * @param keyframe: optional, receives whether this was a keyframe
+ * @return false if the header is invalid or the payload is truncated
+ */
+static inline bool decodeVitalsDelta(const uint8_t* buf, size_t len, VitalsFrame& f, bool* keyframe = nullptr) {
+  if (len < VITALS_FRAME_HEADER + 3 || buf[0] != VITALS_DELTA_MAGIC || buf[1] < 1) {
+    return false;
+  }
+  size_t payload = buf[2];
+  if (payload < 3 || len < VITALS_FRAME_HEADER + payload) {
+    return false;
+  }
+  const uint8_t* p = buf + VITALS_FRAME_HEADER;
+  const uint8_t* end = p + payload;
+  uint32_t mask = (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16);
+  p += 3;
+  for (uint8_t i = 0; i < VITALS_FIELD_COUNT; i++) {
+    if (!(mask & (1UL << i))) {
+      continue;
+    }
+    if (p + VITALS_FIELD_SIZES[i] > end) {
+      return false;
+    }
+    p += unpackVitalsField(f, i, p);
+  }
+  if (keyframe) {
+    *keyframe = (mask & VITALS_DELTA_KEYFRAME) != 0;
+  }
+  return true;
+}
+
+#endif // VITALS_DELTA_H
@@ -0,0 +1,207 @@
+/*
+ * LifeBand Binary Vitals Frame
+ * Fixed-layout, versioned replacement for the JSON vitals notification
+ *
+ * Frame = 4-byte schema header + payload, little-endian:
+ *   header  [0] magic 'V' (0x56)  [1] schema version
+ *           [2] payload length    [3] frame sequence (wraps)
+ *   payload (schema 1, 38 bytes)
+ *      0 u32 timestamp_ms         20 u8  rhythm (RhythmType)
+ *      4 u8  hr                   21 u8  rhythm_confidence
+ *      5 u8  hr_ecg               22 u8  anemia_risk (RiskLevel)
+ *      6 u8  hr_ppg               23 u8  anemia_confidence
+ *      7 u8  spo2                 24 u8  preeclampsia_risk (RiskLevel)
+ *      8 u8  bp_sys               25 u8  preeclampsia_confidence
+ *      9 u8  bp_dia               26 u8  maternal_health_score
+ *     10 u16 hrv_ms (last RR)     27 u8  flags (VITALS_FLAG_*, 0 in schema 1)
+ *     12 u16 hrv_sdnn             28 u16 ecg raw ADC
+ *     14 u16 ptt_ms               30 u32 ir
+ *     16 u8  ecg_quality          34 u32 red
+ *     17 u8  ppg_quality
+ *     18 u8  hr_source | bp_method << 2
+ *     19 u8  alerts: bit0 arrhythmia, bit1 anemia, bit2 preeclampsia
+ *   schema 2 appends (42 bytes)
+ *     38 u32 age_ms: how long before sending the frame was measured
+ *
+ * A VITALS_FLAG_BUFFERED frame was recorded while the phone was away and is
+ * replayed from the on-device log (vitals_store.h); its timestamp_ms is from
+ * an earlier boot's clock, so receivers date it with age_ms instead.
+ *
+ * Compatibility: later schemas only append fields and bump the version;
+ * decoders read the fields they know and skip the rest using the length.
+ * A frame shorter than the schema-1 payload is rejected.
+ */
+
+#ifndef VITALS_FRAME_H
+#define VITALS_FRAME_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+#include "lifeband_types.h"
+
+#define VITALS_FRAME_MAGIC 0x56
+#define VITALS_FRAME_VERSION 2
+#define VITALS_FRAME_HEADER 4
+#define VITALS_FRAME_PAYLOAD_V1 38
+#define VITALS_FRAME_PAYLOAD_V2 42
+#define VITALS_FRAME_SIZE (VITALS_FRAME_HEADER + VITALS_FRAME_PAYLOAD_V2)
+
+#define VITALS_ALERT_ARRHYTHMIA 0x01
+#define VITALS_ALERT_ANEMIA 0x02
+#define VITALS_ALERT_PREECLAMPSIA 0x04
+
+#define VITALS_FLAG_BUFFERED 0x01     // replayed from the offline log
+
+struct VitalsFrame {
+  uint32_t timestamp_ms;
+  uint8_t hr;
+  uint8_t hr_ecg;
+  uint8_t hr_ppg;
+  uint8_t spo2;
+  uint8_t bp_sys;
+  uint8_t bp_dia;
+  uint16_t hrv_ms;
+  uint16_t hrv_sdnn;
+  uint16_t ptt_ms;
+  uint8_t ecg_quality;
+  uint8_t ppg_quality;
+  HrSource hr_source;
+  BpMethod bp_method;
+  uint8_t alerts;
+  RhythmType rhythm;
+  uint8_t rhythm_confidence;
+  RiskLevel anemia_risk;
+  uint8_t anemia_confidence;
+  RiskLevel preeclampsia_risk;
+  uint8_t preeclampsia_confidence;
+  uint8_t maternal_health_score;
+  uint16_t ecg_raw;
+  uint32_t ir;
+  uint32_t red;
+  uint8_t flags;            // VITALS_FLAG_*
+  uint32_t age_ms;
+};
+
+/**
+ * Clamp a measurement into an unsigned field of the frame
+ */
+static inline uint32_t vitalsClamp(long value, uint32_t max_value) {
+  if (value < 0) return 0;
+  if ((unsigned long)value > max_value) return max_value;
+  return (uint32_t)value;
+}
+
+static inline void vitalsPut16(uint8_t* p, uint16_t v) {
+  p[0] = (uint8_t)(v & 0xFF);
+  p[1] = (uint8_t)(v >> 8);
+}
+
+static inline void vitalsPut32(uint8_t* p, uint32_t v) {
+  p[0] = (uint8_t)(v & 0xFF);
+  p[1] = (uint8_t)((v >> 8) & 0xFF);
+  p[2] = (uint8_t)((v >> 16) & 0xFF);
+  p[3] = (uint8_t)(v >> 24);
+}
+
+static inline uint16_t vitalsGet16(const uint8_t* p) {
+  return (uint16_t)(p[0] | (p[1] << 8));
+}
+
+static inline uint32_t vitalsGet32(const uint8_t* p) {
+  return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+/**
+ * Serialize a frame
+ * @param buf: at least VITALS_FRAME_SIZE bytes
+ * @return bytes written, 0 if buf is too small
+ */
+static inline size_t encodeVitalsFrame(const VitalsFrame& f, uint8_t seq, uint8_t* buf, size_t capacity) {
+  if (capacity < VITALS_FRAME_SIZE) {
+    return 0;
+  }
+  buf[0] = VITALS_FRAME_MAGIC;
+  buf[1] = VITALS_FRAME_VERSION;
+  buf[2] = VITALS_FRAME_PAYLOAD_V2;
+  buf[3] = seq;
+
+  uint8_t* p = buf + VITALS_FRAME_HEADER;
+  vitalsPut32(p + 0, f.timestamp_ms);
+  p[4] = f.hr;
+  p[5] = f.hr_ecg;
+  p[6] = f.hr_ppg;
+  p[7] = f.spo2;
+  p[8] = f.bp_sys;
+  p[9] = f.bp_dia;
+  vitalsPut16(p + 10, f.hrv_ms);
+  vitalsPut16(p + 12, f.hrv_sdnn);
+  vitalsPut16(p + 14, f.ptt_ms);
+  p[16] = f.ecg_quality;
+  p[17] = f.ppg_quality;
+  p[18] = (uint8_t)((f.hr_source & 0x03) | ((f.bp_method & 0x01) << 2));
+  p[19] = f.alerts;
+  p[20] = f.rhythm;
+  p[21] = f.rhythm_confidence;
+  p[22] = f.anemia_risk;
+  p[23] = f.anemia_confidence;
+  p[24] = f.preeclampsia_risk;
+  p[25] = f.preeclampsia_confidence;
+  p[26] = f.maternal_health_score;
+  p[27] = f.flags;
+  vitalsPut16(p + 28, f.ecg_raw);
+  vitalsPut32(p + 30, f.ir);
+  vitalsPut32(p + 34, f.red);
+  vitalsPut32(p + 38, f.age_ms);
+  return VITALS_FRAME_SIZE;
+}
+
+/**
+ * Parse a frame of this or a later schema version
+ * @param seq: optional, receives the frame sequence number
+ * @return false if the header is invalid or the payload is truncated
+ */
+static inline bool decodeVitalsFrame(const uint8_t* buf, size_t len, VitalsFrame& f, uint8_t* seq = nullptr) {
+  if (len < VITALS_FRAME_HEADER || buf[0] != VITALS_FRAME_MAGIC || buf[1] < 1) {
+    return false;
+  }
+  size_t payload = buf[2];
+  if (payload < VITALS_FRAME_PAYLOAD_V1 || len < VITALS_FRAME_HEADER + payload) {
+    return false;
+  }
+  if (seq) {
+    *seq = buf[3];
+  }
+
+  const uint8_t* p = buf + VITALS_FRAME_HEADER;
+  f.timestamp_ms = vitalsGet32(p + 0);
+  f.hr = p[4];
+  f.hr_ecg = p[5];
+  f.hr_ppg = p[6];
+  f.spo2 = p[7];
+  f.bp_sys = p[8];
+  f.bp_dia = p[9];
+  f.hrv_ms = vitalsGet16(p + 10);
+  f.hrv_sdnn = vitalsGet16(p + 12);
+  f.ptt_ms = vitalsGet16(p + 14);
+  f.ecg_quality = p[16];
+  f.ppg_quality = p[17];
+  f.hr_source = (HrSource)(p[18] & 0x03);
+  f.bp_method = (BpMethod)((p[18] >> 2) & 0x01);
+  f.alerts = p[19];
+  f.rhythm = (RhythmType)p[20];
+  f.rhythm_confidence = p[21];
+  f.anemia_risk = (RiskLevel)p[22];
+  f.anemia_confidence = p[23];
+  f.preeclampsia_risk = (RiskLevel)p[24];
+  f.preeclampsia_confidence = p[25];
+  f.maternal_health_score = p[26];
+  f.ecg_raw = vitalsGet16(p + 28);
+  f.ir = vitalsGet32(p + 30);
+  f.red = vitalsGet32(p + 34);
+  f.flags = p[27];
+  f.age_ms = payload >= VITALS_FRAME_PAYLOAD_V2 ? vitalsGet32(p + 38) : 0;
+  return true;
+}
+
+#endif // VITALS_FRAME_H
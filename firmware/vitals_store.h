@@ -0,0 +1,562 @@
+/*
+ * LifeBand Vitals Store
+ * Append-only time-series log of vitals frames and AI results in flash
+ *
+ * publishVitals() returned as soon as the phone was not connected, so
+ * everything measured while it was away was lost. VitalsStore records every
+ * frame in a log-structured ring of flash pages on a BlockDevice (a raw
+ * data partition on the ESP32, a file on a host):
+ *
+ *   page    one erase sector: 16-byte header (magic, page sequence, erase
+ *           count, format, CRC-16) followed by fixed 48-byte records
+ *   record  store time (s), kind, length, 40-byte payload, CRC-16
+ *   ring    page sequence s always lives in sector s % pages; when the
+ *           ring is full the oldest page is erased for the next one, so
+ *           every sector is erased equally often (erase counts are kept in
+ *           the headers and reported as wear)
+ *
+ * Erasing a sector stalls the flash cache on both cores, ECG sampler
+ * included, for tens of milliseconds. append() only programs: prepare()
+ * erases the sector of the next page ahead of time, one sector per call,
+ * at a moment the caller picks (the sketch runs it just after an R-peak,
+ * so the sampler's gap falls in diastole and is bridged). append() erases
+ * itself only if nothing was prepared, and counts it.
+ *
+ * Nothing is ever rewritten in place, so a power cut can only leave the
+ * record or page header being written torn. mount() rebuilds the state from
+ * the headers: the highest valid sequence is the head, appends continue
+ * after its last non-blank slot, and torn records fail their CRC and are
+ * skipped by readers.
+ *
+ * RAM is bounded by VITALS_STORE_MAX_PAGES: one word per page holding the
+ * time of its first record. Times never decrease (append() clamps them), so
+ * seek() is a binary search over that index plus a scan of one page.
+ *
+ * Single owner (inference stage); no heap; no Arduino dependency beyond
+ * block_device.h.
+ */
+
+#ifndef VITALS_STORE_H
+#define VITALS_STORE_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+#include "block_device.h"
+#include "vitals_frame.h"
+
+#define VITALS_STORE_MAGIC 0x474F4C56UL   // "VLOG"
+#define VITALS_STORE_FORMAT 1
+#define VITALS_STORE_PAGE_HEADER 16
+#define VITALS_STORE_RECORD_SIZE 48
+#define VITALS_STORE_PAYLOAD 40
+#define VITALS_STORE_MAX_PAGES 512        // 2 MB of 4 KB sectors, 2 KB of RAM
+#define VITALS_STORE_OPEN_TRIES 4         // sectors tried when one fails to erase
+
+#define VITALS_RECORD_FRAME 1             // payload: schema-1 vitals frame payload
+#define VITALS_RECORD_AI 2                // payload: model, class/risk, confidence, alert
+
+#define VITALS_AI_ARRHYTHMIA 0            // VITALS_RECORD_AI model ids
+#define VITALS_AI_ANEMIA 1
+#define VITALS_AI_PREECLAMPSIA 2
+
+struct VitalsRecord {
+  uint32_t time_s;          // store time
+  uint8_t kind;             // VITALS_RECORD_*
+  uint8_t length;
+  uint8_t payload[VITALS_STORE_PAYLOAD];
+};
+
+/**
+ * Position in the log; valid across appends, moved to the oldest record if
+ * the page it points into has been recycled
+ */
+struct VitalsCursor {
+  uint32_t seq;             // page sequence
+  uint16_t slot;            // record within the page
+};
+
+struct VitalsStoreStats {
+  uint32_t appended;
+  uint32_t pages_opened;    // new pages started
+  uint32_t prepared;        // sectors erased ahead by prepare()
+  uint32_t inline_erases;   // sectors append() had to erase itself
+  uint32_t overwritten;     // pages of oldest data recycled
+  uint32_t torn;            // partly written records found (power loss)
+  uint32_t errors;          // device read / program / erase failures
+  uint32_t max_erase_count; // wear of the most-erased sector
+};
+
+class VitalsStore {
+private:
+  static const uint32_t EMPTY = 0xFFFFFFFFUL;
+
+  BlockDevice* dev;
+  uint32_t sector_size;
+  uint32_t pages;
+  uint16_t slots;           // records per page
+
+  uint32_t first_time[VITALS_STORE_MAX_PAGES];  // by sector, EMPTY if no record
+  bool mounted;
+  bool have_pages;
+  uint32_t head_seq;
+  uint32_t tail_seq;
+  uint16_t head_slot;       // next free slot of the head page
+  uint32_t last_time;
+  bool prepared;            // sector of prepared_seq erased and blank
+  uint32_t prepared_seq;
+  uint32_t next_erase_count;// erase count for the header of the erased page
+
+  VitalsStoreStats stats;
+
+  /**
+   * CRC-16/CCITT-FALSE, nibble table
+   */
+  static uint16_t crc16(const uint8_t* data, size_t len) {
+    static const uint16_t table[16] = {
+      0x0000, 0x1021, 0x2042, 0x3063, 0x4084, 0x50A5, 0x60C6, 0x70E7,
+      0x8108, 0x9129, 0xA14A, 0xB16B, 0xC18C, 0xD1AD, 0xE1CE, 0xF1EF
+    };
+    uint16_t crc = 0xFFFF;
+    for (size_t i = 0; i < len; i++) {
+      crc = (uint16_t)((crc << 4) ^ table[(crc >> 12) ^ (data[i] >> 4)]);
+      crc = (uint16_t)((crc << 4) ^ table[(crc >> 12) ^ (data[i] & 0x0F)]);
+    }
+    return crc;
+  }
+
+  static bool blank(const uint8_t* data, size_t len) {
+    for (size_t i = 0; i < len; i++) {
+      if (data[i] != 0xFF) return false;
+    }
+    return true;
+  }
+
+  uint32_t sectorOf(uint32_t seq) const { return seq % pages; }
+
+  uint32_t slotOffset(uint32_t seq, uint16_t slot) const {
+    return sectorOf(seq) * sector_size + VITALS_STORE_PAGE_HEADER + (uint32_t)slot * VITALS_STORE_RECORD_SIZE;
+  }
+
+  /**
+   * @return true if the sector holds a valid header; seq/erase_count filled
+   */
+  bool readHeader(uint32_t sector, uint32_t& seq, uint32_t& erase_count) {
+    uint8_t h[VITALS_STORE_PAGE_HEADER];
+    if (!dev->read(sector * sector_size, h, sizeof(h))) {
+      stats.errors++;
+      return false;
+    }
+    if (vitalsGet32(h) != VITALS_STORE_MAGIC || h[12] != VITALS_STORE_FORMAT ||
+        h[13] != VITALS_STORE_RECORD_SIZE || vitalsGet16(h + 14) != crc16(h, 14)) {
+      return false;
+    }
+    seq = vitalsGet32(h + 4);
+    erase_count = vitalsGet32(h + 8);
+    return seq % pages == sector;
+  }
+
+  enum SlotState { SLOT_BLANK, SLOT_VALID, SLOT_TORN, SLOT_ERROR };
+
+  SlotState readSlot(uint32_t seq, uint16_t slot, VitalsRecord* out) {
+    uint8_t r[VITALS_STORE_RECORD_SIZE];
+    if (!dev->read(slotOffset(seq, slot), r, sizeof(r))) {
+      stats.errors++;
+      return SLOT_ERROR;
+    }
+    if (blank(r, sizeof(r))) {
+      return SLOT_BLANK;
+    }
+    if (vitalsGet16(r + 46) != crc16(r, 46) || r[5] > VITALS_STORE_PAYLOAD) {
+      return SLOT_TORN;
+    }
+    if (out) {
+      out->time_s = vitalsGet32(r);
+      out->kind = r[4];
+      out->length = r[5];
+      memcpy(out->payload, r + 6, VITALS_STORE_PAYLOAD);
+    }
+    return SLOT_VALID;
+  }
+
+  /**
+   * Erase the sector of seq, recycling the oldest page if the ring is full;
+   * the sector's erase count is carried in next_erase_count
+   */
+  bool erasePage(uint32_t seq) {
+    uint32_t sector = sectorOf(seq);
+    uint32_t old_seq = 0, erase_count = 0;
+    if (!readHeader(sector, old_seq, erase_count)) {
+      erase_count = 0;
+    }
+    if (have_pages && seq - tail_seq >= pages) {
+      tail_seq = seq - pages + 1;                // oldest page is recycled
+      stats.overwritten++;
+    }
+    first_time[sector] = EMPTY;
+    next_erase_count = erase_count + 1;
+    if (!dev->erase(sector)) {
+      stats.errors++;
+      return false;
+    }
+    return true;
+  }
+
+  /**
+   * Write the header of page seq, erasing its sector unless prepare() did;
+   * the head moves to seq even on failure, so the next attempt uses the
+   * following sector
+   */
+  bool openPage(uint32_t seq) {
+    bool erased = prepared && prepared_seq == seq;
+    prepared = false;
+    if (!erased) {
+      erased = erasePage(seq);
+      stats.inline_erases++;
+    }
+    head_seq = seq;
+    head_slot = slots;                           // unusable until the header is written
+    have_pages = true;
+    if (!erased) {
+      return false;
+    }
+
+    uint32_t sector = sectorOf(seq);
+    uint8_t h[VITALS_STORE_PAGE_HEADER];
+    vitalsPut32(h, VITALS_STORE_MAGIC);
+    vitalsPut32(h + 4, seq);
+    vitalsPut32(h + 8, next_erase_count);
+    h[12] = VITALS_STORE_FORMAT;
+    h[13] = VITALS_STORE_RECORD_SIZE;
+    vitalsPut16(h + 14, crc16(h, 14));
+    if (!dev->program(sector * sector_size, h, sizeof(h))) {
+      stats.errors++;
+      return false;
+    }
+    head_slot = 0;
+    stats.pages_opened++;
+    if (next_erase_count > stats.max_erase_count) {
+      stats.max_erase_count = next_erase_count;
+    }
+    return true;
+  }
+
+  /**
+   * First valid record of a page at or after a slot
+   * @return slot index, or slots if there is none
+   */
+  uint16_t firstValid(uint32_t seq, uint16_t from, uint32_t* time_s) {
+    VitalsRecord rec;
+    for (uint16_t slot = from; slot < slots; slot++) {
+      SlotState state = readSlot(seq, slot, &rec);
+      if (state == SLOT_BLANK) break;
+      if (state == SLOT_VALID) {
+        if (time_s) *time_s = rec.time_s;
+        return slot;
+      }
+    }
+    return slots;
+  }
+
+public:
+  VitalsStore() :
+    dev(nullptr),
+    sector_size(0),
+    pages(0),
+    slots(0),
+    mounted(false),
+    have_pages(false),
+    head_seq(0),
+    tail_seq(0),
+    head_slot(0),
+    last_time(0),
+    prepared(false),
+    prepared_seq(0),
+    next_erase_count(0) {
+    memset(&stats, 0, sizeof(stats));
+  }
+
+  /**
+   * Rebuild the log state from flash; a device without valid pages (new,
+   * or holding another filesystem) becomes an empty log, formatted lazily
+   * one page at a time
+   * @return false if the device is too small
+   */
+  bool mount(BlockDevice* device) {
+    dev = device;
+    mounted = false;
+    have_pages = false;
+    head_seq = tail_seq = 0;
+    head_slot = 0;
+    last_time = 0;
+    prepared = false;
+    memset(&stats, 0, sizeof(stats));
+    if (!dev) {
+      return false;
+    }
+    sector_size = dev->sectorSize();
+    pages = dev->sectorCount();
+    if (pages > VITALS_STORE_MAX_PAGES) pages = VITALS_STORE_MAX_PAGES;
+    if (pages < 2 || sector_size <= VITALS_STORE_PAGE_HEADER + VITALS_STORE_RECORD_SIZE) {
+      return false;
+    }
+    slots = (uint16_t)((sector_size - VITALS_STORE_PAGE_HEADER) / VITALS_STORE_RECORD_SIZE);
+
+    // Pass 1: headers (first_time temporarily holds the sequence)
+    for (uint32_t s = 0; s < pages; s++) {
+      uint32_t seq = 0, erase_count = 0;
+      first_time[s] = EMPTY;
+      if (!readHeader(s, seq, erase_count)) continue;
+      first_time[s] = seq;
+      if (erase_count > stats.max_erase_count) stats.max_erase_count = erase_count;
+      if (!have_pages || (int32_t)(seq - head_seq) > 0) {
+        head_seq = seq;
+        have_pages = true;
+      }
+    }
+    mounted = true;
+    if (!have_pages) {
+      return true;
+    }
+
+    // Pass 2: pages of the current ring, their first record times
+    tail_seq = head_seq;
+    for (uint32_t s = 0; s < pages; s++) {
+      uint32_t seq = first_time[s];
+      first_time[s] = EMPTY;
+      if (seq == EMPTY || head_seq - seq >= pages) continue;   // stale sector
+      uint32_t t = 0;
+      if (firstValid(seq, 0, &t) < slots) {
+        first_time[s] = t;
+      }
+      if ((int32_t)(seq - tail_seq) < 0) tail_seq = seq;
+    }
+
+    // Head page: appends continue after the last non-blank slot
+    VitalsRecord rec;
+    head_slot = 0;
+    for (uint16_t slot = 0; slot < slots; slot++) {
+      SlotState state = readSlot(head_seq, slot, &rec);
+      if (state == SLOT_BLANK) break;
+      head_slot = slot + 1;
+      if (state == SLOT_VALID) {
+        last_time = rec.time_s;
+      } else if (state == SLOT_TORN) {
+        stats.torn++;
+      }
+    }
+    if (first_time[sectorOf(head_seq)] == EMPTY) {
+      // Head page holds nothing readable: the newest time is further back
+      for (uint32_t seq = head_seq; seq != tail_seq; ) {
+        seq--;
+        if (first_time[sectorOf(seq)] == EMPTY) continue;
+        for (uint16_t slot = 0; slot < slots; slot++) {
+          SlotState state = readSlot(seq, slot, &rec);
+          if (state == SLOT_BLANK) break;
+          if (state == SLOT_VALID) last_time = rec.time_s;
+        }
+        break;
+      }
+    }
+    return true;
+  }
+
+  /**
+   * Append one record
+   * @param time_s: store time; clamped so the log never goes back in time
+   * @return false if nothing could be written
+   */
+  bool append(uint8_t kind, uint32_t time_s, const uint8_t* payload, uint8_t length) {
+    if (!mounted || length > VITALS_STORE_PAYLOAD) {
+      return false;
+    }
+    if (time_s < last_time) {
+      time_s = last_time;
+    }
+    uint8_t tries = 0;
+    while (!have_pages || head_slot >= slots) {
+      if (tries++ == VITALS_STORE_OPEN_TRIES) {
+        return false;
+      }
+      openPage(have_pages ? head_seq + 1 : 0);
+    }
+
+    uint8_t r[VITALS_STORE_RECORD_SIZE];
+    memset(r, 0xFF, sizeof(r));
+    vitalsPut32(r, time_s);
+    r[4] = kind;
+    r[5] = length;
+    memcpy(r + 6, payload, length);
+    vitalsPut16(r + 46, crc16(r, 46));
+
+    // The slot is used even if programming fails: it may be half written
+    uint16_t slot = head_slot++;
+    if (!dev->program(slotOffset(head_seq, slot), r, sizeof(r))) {
+      stats.errors++;
+      return false;
+    }
+    if (first_time[sectorOf(head_seq)] == EMPTY) {
+      first_time[sectorOf(head_seq)] = time_s;
+    }
+    last_time = time_s;
+    stats.appended++;
+    return true;
+  }
+
+  /**
+   * Erase the sector of the next page now, so the append that opens it
+   * only programs; the oldest page is recycled here if the ring is full
+   * @return true if a sector was erased (or the erase was attempted):
+   *         the flash was busy for one sector erase
+   */
+  bool prepare() {
+    if (!mounted) {
+      return false;
+    }
+    uint32_t seq = have_pages ? head_seq + 1 : 0;
+    if (prepared && prepared_seq == seq) {
+      return false;
+    }
+    prepared_seq = seq;
+    prepared = erasePage(seq);
+    if (prepared) {
+      stats.prepared++;
+    }
+    return true;
+  }
+
+  /**
+   * @return true if the next page still needs its erase (prepare() has work)
+   */
+  bool needsPrepare() const {
+    return mounted && !(prepared && prepared_seq == (have_pages ? head_seq + 1 : 0));
+  }
+
+  /**
+   * Position of the next record to be appended
+   */
+  VitalsCursor end() const {
+    VitalsCursor c;
+    c.seq = have_pages ? head_seq : 0;
+    c.slot = have_pages ? head_slot : 0;
+    if (have_pages && head_slot >= slots) {
+      c.seq++;
+      c.slot = 0;
+    }
+    return c;
+  }
+
+  /**
+   * Position of the oldest record
+   */
+  VitalsCursor begin() const {
+    VitalsCursor c;
+    c.seq = tail_seq;
+    c.slot = 0;
+    return c;
+  }
+
+  /**
+   * Position of the first record at or after a store time
+   */
+  VitalsCursor seek(uint32_t time_s) {
+    VitalsCursor c = begin();
+    if (!mounted || !have_pages) {
+      return end();
+    }
+    // Last page whose first record is at or before time_s
+    uint32_t lo = 0, hi = head_seq - tail_seq;   // page offsets from the tail
+    uint32_t found = EMPTY;
+    while (lo <= hi) {
+      uint32_t mid = lo + (hi - lo) / 2;
+      uint32_t probe = mid;
+      while (probe <= hi && first_time[sectorOf(tail_seq + probe)] == EMPTY) probe++;
+      if (probe > hi) {
+        if (mid == 0) break;
+        hi = mid - 1;
+        continue;
+      }
+      if (first_time[sectorOf(tail_seq + probe)] <= time_s) {
+        found = probe;
+        lo = probe + 1;
+      } else {
+        if (mid == 0) break;
+        hi = mid - 1;
+      }
+    }
+    if (found == EMPTY) {
+      return c;                                  // everything is later
+    }
+    c.seq = tail_seq + found;
+    VitalsRecord rec;
+    for (uint16_t slot = 0; slot < slots; slot++) {
+      SlotState state = readSlot(c.seq, slot, &rec);
+      if (state == SLOT_BLANK) break;
+      if (state == SLOT_VALID && rec.time_s >= time_s) {
+        c.slot = slot;
+        return c;
+      }
+    }
+    c.seq++;
+    c.slot = 0;
+    return c;
+  }
+
+  /**
+   * Read the record at the cursor and advance it, skipping torn records
+   * @param until: optional stop position (an earlier end()), so records
+   *               appended after it are left for the caller
+   * @return false at the end of the log
+   */
+  bool next(VitalsCursor& c, VitalsRecord& out, const VitalsCursor* until = nullptr) {
+    if (!mounted || !have_pages) {
+      return false;
+    }
+    VitalsCursor stop = until ? *until : end();
+    for (;;) {
+      if ((int32_t)(c.seq - tail_seq) < 0) {
+        c.seq = tail_seq;                        // recycled under the reader
+        c.slot = 0;
+      }
+      if ((int32_t)(c.seq - stop.seq) > 0 || (c.seq == stop.seq && c.slot >= stop.slot)) {
+        return false;
+      }
+      if (c.slot >= slots || first_time[sectorOf(c.seq)] == EMPTY) {
+        c.seq++;
+        c.slot = 0;
+        continue;
+      }
+      SlotState state = readSlot(c.seq, c.slot, &out);
+      c.slot++;
+      if (state == SLOT_VALID) {
+        return true;
+      }
+      if (state == SLOT_BLANK && c.seq != head_seq) {
+        c.slot = slots;                          // rest of a closed page is blank
+      }
+    }
+  }
+
+  bool isMounted() const { return mounted; }
+  bool isEmpty() const { return !have_pages || (tail_seq == head_seq && head_slot == 0); }
+  uint32_t lastTime() const { return last_time; }
+
+  /**
+   * Oldest stored time, or lastTime() when empty
+   */
+  uint32_t firstTime() const {
+    for (uint32_t seq = tail_seq; have_pages && (int32_t)(seq - head_seq) <= 0; seq++) {
+      if (first_time[sectorOf(seq)] != EMPTY) return first_time[sectorOf(seq)];
+    }
+    return last_time;
+  }
+
+  uint32_t capacityRecords() const { return pages * slots; }
+  uint32_t pageCount() const { return pages; }
+
+  VitalsStoreStats getStats() const {
+    return stats;
+  }
+};
+
+#endif // VITALS_STORE_H
@@ -0,0 +1,309 @@
+/*
+ * LifeBand Waveform Stream
+ * Lossless delta + zig-zag varint packing of raw ECG / PPG samples
+ *
+ * One WaveformEncoder per channel fills MTU-sized packets; the sketch
+ * notifies each finished packet on the WAVEFORM characteristic. Consecutive
+ * samples differ by a few ADC counts, so most deltas fit in one byte.
+ *
+ * Packet layout (little-endian):
+ *   [0]     version << 4 | channel
+ *   [1]     sample count
+ *   [2..3]  sequence number (per channel, wraps at 65536)
+ *   [4..7]  sample index of the first sample
+ *   [8..9]  sample rate in Hz
+ *   [10..]  zig-zag varint of the first sample, then of each delta
+ *
+ * A packet always holds consecutive sample indices; an index jump closes
+ * the packet, so a receiver sees acquisition gaps as index jumps and lost
+ * notifications as sequence jumps. WaveformDecoder is the reference
+ * decoder (src/services/waveformCodec.ts mirrors it in the app).
+ */
+
+#ifndef WAVEFORM_STREAM_H
+#define WAVEFORM_STREAM_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+
+#define WAVE_PACKET_VERSION 1
+#define WAVE_HEADER_SIZE 10
+#define WAVE_MAX_PACKET 509       // 512-byte ATT MTU minus 3-byte notify header
+#define WAVE_MIN_PACKET 20        // default 23-byte MTU
+#define WAVE_MAX_SAMPLES 255      // count field is one byte
+#define WAVE_MAX_VARINT 5         // zig-zag of a 32-bit delta
+
+enum WaveChannel {
+  WAVE_CH_ECG = 0,
+  WAVE_CH_PPG_IR = 1,
+  WAVE_CH_PPG_RED = 2
+};
+
+struct WavePacketInfo {
+  uint8_t version;
+  uint8_t channel;
+  uint8_t count;
+  uint16_t seq;
+  uint32_t first_index;
+  uint16_t rate_hz;
+};
+
+struct WaveStreamStats {
+  uint32_t packets;         // packets handed to the transport
+  uint32_t samples;         // samples packed
+  uint32_t bytes;           // packet bytes including headers
+  uint32_t dropped;         // finished packets overwritten before release()
+  uint32_t index_breaks;    // packets closed early by an index jump
+};
+
+static inline uint32_t waveZigZag(int32_t v) {
+  return ((uint32_t)v << 1) ^ (uint32_t)(v >> 31);
+}
+
+static inline int32_t waveUnZigZag(uint32_t u) {
+  return (int32_t)(u >> 1) ^ -(int32_t)(u & 1);
+}
+
+/**
+ * Append a varint to buf
+ * @return bytes written (1-5)
+ */
+static inline size_t wavePutVarint(uint8_t* buf, uint32_t u) {
+  size_t n = 0;
+  while (u >= 0x80) {
+    buf[n++] = (uint8_t)(u | 0x80);
+    u >>= 7;
+  }
+  buf[n++] = (uint8_t)u;
+  return n;
+}
+
+class WaveformEncoder {
+private:
+  uint8_t building[WAVE_MAX_PACKET];
+  uint8_t ready[WAVE_MAX_PACKET];
+  size_t building_len;
+  size_t ready_len;
+  bool ready_valid;
+
+  uint8_t channel;
+  uint16_t rate_hz;
+  uint16_t seq;
+  size_t max_bytes;
+  uint8_t max_samples;
+
+  uint8_t count;
+  uint32_t next_index;
+  int32_t last_value;
+
+  WaveStreamStats stats;
+
+  void startPacket(uint32_t first_index) {
+    building[0] = (uint8_t)((WAVE_PACKET_VERSION << 4) | (channel & 0x0F));
+    building[1] = 0;
+    building[2] = (uint8_t)(seq & 0xFF);
+    building[3] = (uint8_t)(seq >> 8);
+    building[4] = (uint8_t)(first_index & 0xFF);
+    building[5] = (uint8_t)((first_index >> 8) & 0xFF);
+    building[6] = (uint8_t)((first_index >> 16) & 0xFF);
+    building[7] = (uint8_t)(first_index >> 24);
+    building[8] = (uint8_t)(rate_hz & 0xFF);
+    building[9] = (uint8_t)(rate_hz >> 8);
+    building_len = WAVE_HEADER_SIZE;
+    count = 0;
+    next_index = first_index;
+  }
+
+  void closePacket() {
+    if (count == 0) {
+      return;
+    }
+    building[1] = count;
+    if (ready_valid) {
+      stats.dropped++;
+    }
+    memcpy(ready, building, building_len);
+    ready_len = building_len;
+    ready_valid = true;
+    stats.packets++;
+    stats.bytes += building_len;
+    seq++;
+    count = 0;
+    building_len = 0;
+  }
+
+public:
+  WaveformEncoder() {
+    configure(WAVE_CH_ECG, 250);
+  }
+
+  /**
+   * Set channel id and nominal rate, and start a new sequence
+   */
+  void configure(WaveChannel ch, uint16_t rate) {
+    channel = (uint8_t)ch;
+    rate_hz = rate;
+    max_bytes = WAVE_MIN_PACKET;
+    max_samples = WAVE_MAX_SAMPLES;
+    reset();
+  }
+
+  /**
+   * Bound packet size and latency
+   * @param bytes: usable notification payload (ATT MTU - 3)
+   * @param samples: close a packet after this many samples (latency bound)
+   */
+  void setLimits(size_t bytes, uint8_t samples) {
+    if (bytes > WAVE_MAX_PACKET) bytes = WAVE_MAX_PACKET;
+    if (bytes < WAVE_MIN_PACKET) bytes = WAVE_MIN_PACKET;
+    max_bytes = bytes;
+    max_samples = samples ? samples : 1;
+  }
+
+  /**
+   * Drop any partial or pending packet and restart sequence numbering
+   */
+  void reset() {
+    building_len = 0;
+    ready_len = 0;
+    ready_valid = false;
+    seq = 0;
+    count = 0;
+    next_index = 0;
+    last_value = 0;
+    memset(&stats, 0, sizeof(stats));
+  }
+
+  /**
+   * Append one sample
+   * @param index: acquisition sample index (a jump starts a new packet)
+   * @return true if a finished packet is waiting to be sent
+   */
+  bool add(uint32_t index, int32_t value) {
+    if (count > 0 && index != next_index) {
+      stats.index_breaks++;
+      closePacket();
+    }
+
+    uint8_t tmp[WAVE_MAX_VARINT];
+    size_t n;
+    if (count == 0) {
+      startPacket(index);
+      n = wavePutVarint(tmp, waveZigZag(value));
+    } else {
+      n = wavePutVarint(tmp, waveZigZag(value - last_value));
+      if (building_len + n > max_bytes) {
+        closePacket();
+        startPacket(index);
+        n = wavePutVarint(tmp, waveZigZag(value));
+      }
+    }
+
+    memcpy(building + building_len, tmp, n);
+    building_len += n;
+    count++;
+    next_index = index + 1;
+    last_value = value;
+    stats.samples++;
+
+    if (count >= max_samples || building_len + WAVE_MAX_VARINT > max_bytes) {
+      closePacket();
+    }
+    return ready_valid;
+  }
+
+  /**
+   * Close the partial packet now (e.g. when streaming stops)
+   */
+  bool flush() {
+    closePacket();
+    return ready_valid;
+  }
+
+  bool hasPacket() const { return ready_valid; }
+  const uint8_t* packet() const { return ready; }
+  size_t packetSize() const { return ready_len; }
+
+  /**
+   * Mark the pending packet as sent
+   */
+  void release() {
+    ready_valid = false;
+  }
+
+  uint8_t channelId() const { return channel; }
+  uint16_t sampleRate() const { return rate_hz; }
+  WaveStreamStats getStats() const { return stats; }
+};
+
+class WaveformDecoder {
+private:
+  bool seen[16];
+  uint16_t expected_seq[16];
+  uint32_t lost_packets;
+  uint32_t malformed;
+
+public:
+  WaveformDecoder() {
+    reset();
+  }
+
+  void reset() {
+    memset(seen, 0, sizeof(seen));
+    memset(expected_seq, 0, sizeof(expected_seq));
+    lost_packets = 0;
+    malformed = 0;
+  }
+
+  /**
+   * Decode one packet
+   * @param out: room for WAVE_MAX_SAMPLES values
+   * @return number of samples, or -1 if the packet is malformed
+   */
+  int decode(const uint8_t* data, size_t len, WavePacketInfo& info, int32_t* out) {
+    if (len < WAVE_HEADER_SIZE + 1 || (data[0] >> 4) != WAVE_PACKET_VERSION) {
+      malformed++;
+      return -1;
+    }
+    info.version = data[0] >> 4;
+    info.channel = data[0] & 0x0F;
+    info.count = data[1];
+    info.seq = (uint16_t)(data[2] | (data[3] << 8));
+    info.first_index = (uint32_t)data[4] | ((uint32_t)data[5] << 8) |
+                       ((uint32_t)data[6] << 16) | ((uint32_t)data[7] << 24);
+    info.rate_hz = (uint16_t)(data[8] | (data[9] << 8));
+
+    size_t pos = WAVE_HEADER_SIZE;
+    int32_t value = 0;
+    for (uint8_t i = 0; i < info.count; i++) {
+      uint32_t u = 0;
+      uint8_t shift = 0;
+      for (;;) {
+        if (pos >= len || shift > 28) {
+          malformed++;
+          return -1;
+        }
+        uint8_t b = data[pos++];
+        u |= (uint32_t)(b & 0x7F) << shift;
+        if (!(b & 0x80)) break;
+        shift += 7;
+      }
+      int32_t v = waveUnZigZag(u);
+      value = (i == 0) ? v : value + v;
+      out[i] = value;
+    }
+
+    if (seen[info.channel]) {
+      lost_packets += (uint16_t)(info.seq - expected_seq[info.channel]);
+    }
+    seen[info.channel] = true;
+    expected_seq[info.channel] = info.seq + 1;
+    return info.count;
+  }
+
+  uint32_t lostPackets() const { return lost_packets; }
+  uint32_t malformedPackets() const { return malformed; }
+};
+
+#endif // WAVEFORM_STREAM_H
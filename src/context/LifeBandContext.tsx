@@ -10,7 +10,9 @@ import {
   scanAndConnectToLifeBand,
   disconnectLifeBand,
   reconnectLifeBandById,
+  setLifeBandAlertListener,
 } from '../services/bleService';
+import { LifeBandAlert } from '../types/alert';
 import { VitalsSample } from '../types/vitals';
 import { updateUserProfile } from '../services/userService';
 
@@ -134,6 +136,39 @@ export const LifeBandProvider: React.FC<{ children: React.ReactNode }> = ({ chil
     aggregationRef.current = null;
   }, [uid]);
 
+  // Alerts arrive ahead of the next vitals frame: raise the flag on the live sample right away
+  useEffect(() => {
+    setLifeBandAlertListener((alert: LifeBandAlert) => {
+      if (!isMountedRef.current) {
+        return;
+      }
+      const flag =
+        alert.type === 'arrhythmia'
+          ? { arrhythmia_alert: true }
+          : alert.type === 'anemia'
+            ? { anemia_alert: true }
+            : alert.type === 'preeclampsia'
+              ? { preeclampsia_alert: true }
+              : null;
+      setLatestVitals((prev) => {
+        if (!prev || !flag) {
+          return prev;
+        }
+        const updated = { ...prev, ...flag };
+        liveSampleRef.current = updated;
+        return updated;
+      });
+      if (alert.severity === 'critical') {
+        const title = alert.type === 'severe_bp' ? 'Severe Blood Pressure' : `${alert.label} detected`;
+        Alert.alert(
+          `LifeBand Alert: ${title}`,
+          `HR ${alert.hr} bpm, SpO₂ ${alert.spo2}%, BP ${alert.bp_sys}/${alert.bp_dia} mmHg`,
+        );
+      }
+    });
+    return () => setLifeBandAlertListener(null);
+  }, []);
+
   const persistDevice = useCallback(
     async (deviceId: string, deviceName?: string | null) => {
       await AsyncStorage.setItem(DEVICE_KEY, deviceId);
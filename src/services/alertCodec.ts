@@ -0,0 +1,86 @@
+import { Buffer } from 'buffer';
+import { LifeBandAlert, LifeBandAlertSeverity, LifeBandAlertType } from '../types/alert';
+
+// Mirrors firmware/alert_channel.h (version 1)
+export const ALERT_FRAME_MAGIC = 0x41;
+const ALERT_HEADER = 4;
+const ALERT_PAYLOAD = 18;
+const ALERT_FLAG_RETRANSMIT = 0x01;
+const RECENT_ALERTS = 16;
+
+const TYPES: Record<number, LifeBandAlertType> = {
+  1: 'arrhythmia',
+  2: 'anemia',
+  3: 'preeclampsia',
+  4: 'severe_bp',
+};
+const RHYTHM_NAMES = ['Normal', 'AFib', 'PVC', 'Bradycardia', 'Tachycardia', 'NoSignal'];
+const RISK_NAMES = ['Low', 'Moderate', 'High', 'Critical', 'Low-Moderate', 'Unknown'];
+
+/**
+ * Acknowledgement written back to the ALERT characteristic: u16 sequence
+ */
+export const encodeAlertAck = (seq: number): string => {
+  const ack = Buffer.alloc(2);
+  ack.writeUInt16LE(seq & 0xffff, 0);
+  return ack.toString('base64');
+};
+
+/**
+ * Stateful decoder: the device resends an alert until it is acknowledged,
+ * so alerts already delivered are recognised and reported as duplicates.
+ */
+export class AlertDecoder {
+  private recent: string[] = [];
+
+  reset() {
+    this.recent = [];
+  }
+
+  decode(base64Value: string): { alert: LifeBandAlert; duplicate: boolean } | null {
+    const data = Buffer.from(base64Value, 'base64');
+    if (data.length < ALERT_HEADER || data[0] !== ALERT_FRAME_MAGIC || data[1] < 1) {
+      return null;
+    }
+    const payloadLength = data[2];
+    if (payloadLength < ALERT_PAYLOAD || data.length < ALERT_HEADER + payloadLength) {
+      return null;
+    }
+
+    const p = data.subarray(ALERT_HEADER);
+    const type = TYPES[p[2]];
+    if (!type) {
+      return null;
+    }
+    const seq = p.readUInt16LE(0);
+    const deviceTimeMs = p.readUInt32LE(10);
+    const ageMs = p.readUInt32LE(14);
+    const severity: LifeBandAlertSeverity = p[3] >= 2 ? 'critical' : 'warning';
+    const names = type === 'arrhythmia' ? RHYTHM_NAMES : RISK_NAMES;
+
+    const alert: LifeBandAlert = {
+      seq,
+      type,
+      severity,
+      label: type === 'severe_bp' ? 'Severe BP' : names[p[4]] ?? 'Unknown',
+      confidence: p[5],
+      hr: p[6],
+      spo2: p[7],
+      bp_sys: p[8],
+      bp_dia: p[9],
+      detectedAt: new Date(Date.now() - ageMs).toISOString(),
+      retransmit: (data[3] & ALERT_FLAG_RETRANSMIT) !== 0,
+    };
+
+    // Sequence numbers restart when the device reboots; the detection time tells them apart
+    const key = `${seq}:${deviceTimeMs}`;
+    const duplicate = this.recent.includes(key);
+    if (!duplicate) {
+      this.recent.push(key);
+      if (this.recent.length > RECENT_ALERTS) {
+        this.recent.shift();
+      }
+    }
+    return { alert, duplicate };
+  }
+}
@@ -2,6 +2,28 @@ import { BleManager, Device, Subscription } from 'react-native-ble-plx';
 import base64 from 'react-native-base64';
 import { Platform, PermissionsAndroid } from 'react-native';
 import { VitalsSample } from '../types/vitals';
+import { WaveformMode, WaveformPacket } from '../types/waveform';
+import { LifeBandAlert } from '../types/alert';
+import { WaveformDecoder } from './waveformCodec';
+import { AlertDecoder, encodeAlertAck } from './alertCodec';
+import {
+  LifeBandModel,
+  MODEL_XFER_CHUNK,
+  ModelTransferStatus,
+  decodeTransferStatus,
+  encodeTransferAbort,
+  encodeTransferBegin,
+  encodeTransferData,
+  encodeTransferEnd,
+  isTransferStatusFor,
+} from './modelTransferCodec';
+import {
+  APP_DELTA_FIELDS,
+  VitalsDeltaDecoder,
+  decodeVitalsFrame,
+  isVitalsDelta,
+  isVitalsFrame,
+} from './vitalsFrameCodec';
 import { Buffer } from 'buffer';
 
 export type BleConnectionState = 'disconnected' | 'scanning' | 'connecting' | 'connected';
@@ -22,10 +44,18 @@ export interface LifeBandState {
 export const LIFEBAND_SERVICE_UUID = 'c0de0001-73f3-4b4c-8f61-1aa7a6d5beef';
 export const LIFEBAND_VITALS_CHAR_UUID = 'c0de0002-73f3-4b4c-8f61-1aa7a6d5beef'; // Notify
 export const LIFEBAND_CONFIG_CHAR_UUID = 'c0de0003-73f3-4b4c-8f61-1aa7a6d5beef'; // Write (START/STOP)
+export const LIFEBAND_WAVEFORM_CHAR_UUID = 'c0de0004-73f3-4b4c-8f61-1aa7a6d5beef'; // Notify (raw ECG/PPG packets)
+export const LIFEBAND_ALERT_CHAR_UUID = 'c0de0005-73f3-4b4c-8f61-1aa7a6d5beef'; // Notify + write (alerts, acks)
 export const LIFEBAND_DEVICE_NAME = 'LIFEBAND-S3';
 
 let manager: BleManager | null = null;
 let notificationSub: Subscription | null = null;
+let waveformSub: Subscription | null = null;
+let alertSub: Subscription | null = null;
+let alertListener: ((alert: LifeBandAlert) => void) | null = null;
+const alertDecoder = new AlertDecoder();
+const waveformDecoder = new WaveformDecoder();
+const vitalsDeltaDecoder = new VitalsDeltaDecoder();
 let currentDevice: Device | null = null;
 let isCleaningUp = false; // Flag to prevent multiple simultaneous cleanups
 let isConnecting = false; // Flag to prevent simultaneous connection attempts
@@ -100,6 +130,57 @@ const sendControlCommand = async (device: Device, command: string) => {
   }
 };
 
+/**
+ * Switch vitals notifications to delta frames carrying only the fields the
+ * app shows; firmware without delta support ignores both commands and keeps
+ * sending full frames.
+ */
+const requestDeltaVitals = async (device: Device) => {
+  vitalsDeltaDecoder.reset();
+  await sendControlCommand(device, APP_DELTA_FIELDS);
+  await sendControlCommand(device, 'FORMAT DELTA');
+};
+
+/**
+ * Receive alerts on their own characteristic. Every frame is acknowledged,
+ * retransmissions included, so the device stops resending; the listener
+ * only sees each alert once.
+ */
+export const setLifeBandAlertListener = (listener: ((alert: LifeBandAlert) => void) | null) => {
+  alertListener = listener;
+};
+
+const subscribeAlerts = (device: Device) => {
+  cleanupAlerts();
+  alertSub = device.monitorCharacteristicForService(
+    LIFEBAND_SERVICE_UUID,
+    LIFEBAND_ALERT_CHAR_UUID,
+    (error, characteristic) => {
+      if (error || !characteristic?.value) {
+        return;
+      }
+      const decoded = alertDecoder.decode(characteristic.value);
+      if (!decoded) {
+        console.warn('[ALERT] Malformed alert frame');
+        return;
+      }
+      const { alert, duplicate } = decoded;
+      device
+        .writeCharacteristicWithoutResponseForService(
+          LIFEBAND_SERVICE_UUID,
+          LIFEBAND_ALERT_CHAR_UUID,
+          encodeAlertAck(alert.seq),
+        )
+        .catch(() => console.warn(`[ALERT] Failed to acknowledge alert ${alert.seq}`));
+      if (duplicate) {
+        return;
+      }
+      console.log(`[ALERT] ${alert.severity} ${alert.type} (${alert.label}) seq ${alert.seq}`);
+      alertListener?.(alert);
+    },
+  );
+};
+
 const parseVitalsPayload = (value?: string | null): VitalsSample | null => {
   if (!value) {
     console.warn('[PARSE] Empty payload received');
@@ -108,7 +189,30 @@ const parseVitalsPayload = (value?: string | null): VitalsSample | null => {
   try {
     console.log('[PARSE] Raw payload length:', value.length);
     
-    // Try to parse as direct JSON first (new firmware sends raw JSON)
+    // Delta frame (requested with CONFIG "FORMAT DELTA" after START)
+    const raw = Buffer.from(value, 'base64');
+    if (isVitalsDelta(raw)) {
+      const deltaSample = vitalsDeltaDecoder.decode(raw);
+      if (!deltaSample) {
+        console.log('[PARSE] Delta frame before first keyframe or truncated:', raw.length, 'bytes');
+        return null;
+      }
+      return deltaSample;
+    }
+
+    // Full binary vitals frame (firmware default, and frames replayed from its offline log)
+    if (isVitalsFrame(raw)) {
+      const frameSample = decodeVitalsFrame(raw);
+      if (!frameSample) {
+        console.warn('[PARSE] Truncated vitals frame:', raw.length, 'bytes');
+        return null;
+      }
+      console.log(`[PARSE] ✓ Binary vitals frame v${raw[1]} (${raw.length} bytes)`);
+      return frameSample;
+    }
+    
+    // JSON debug format (CONFIG "FORMAT JSON") or older firmware
+    // Try to parse as direct JSON first
     let jsonString: string;
     try {
       // Attempt to parse directly as JSON
@@ -229,11 +333,37 @@ const parseVitalsPayload = (value?: string | null): VitalsSample | null => {
   }
 };
 
+const cleanupWaveform = () => {
+  if (waveformSub) {
+    try {
+      waveformSub.remove();
+    } catch (error) {
+      console.warn('[BLE] Cleanup waveform subscription error');
+    } finally {
+      waveformSub = null;
+    }
+  }
+};
+
+const cleanupAlerts = () => {
+  if (alertSub) {
+    try {
+      alertSub.remove();
+    } catch (error) {
+      console.warn('[BLE] Cleanup alert subscription error');
+    } finally {
+      alertSub = null;
+    }
+  }
+};
+
 const cleanupNotification = () => {
   if (isCleaningUp) {
     console.log('[BLE] Cleanup already in progress, skipping');
     return;
   }
+  cleanupWaveform();
+  cleanupAlerts();
   
   if (notificationSub) {
     isCleaningUp = true;
@@ -273,6 +403,141 @@ const waitForGracefulDisconnect = async (
   return false;
 };
 
+/**
+ * Toggle the firmware's raw waveform stream (ECG, optionally IR/red PPG).
+ * Packets are delta/varint coded; `lostBefore` reports dropped notifications.
+ */
+export const setWaveformStreaming = async (
+  mode: WaveformMode,
+  onPacket?: (packet: WaveformPacket) => void,
+): Promise<boolean> => {
+  const device = currentDevice;
+  if (!device) {
+    console.warn('[WAVE] No connected LifeBand');
+    return false;
+  }
+
+  cleanupWaveform();
+  if (mode === 'off') {
+    await sendControlCommand(device, 'WAVE OFF');
+    return true;
+  }
+
+  waveformDecoder.reset();
+  waveformSub = device.monitorCharacteristicForService(
+    LIFEBAND_SERVICE_UUID,
+    LIFEBAND_WAVEFORM_CHAR_UUID,
+    (error, characteristic) => {
+      if (error || !characteristic?.value) {
+        return;
+      }
+      const packet = waveformDecoder.decode(characteristic.value);
+      if (!packet) {
+        console.warn('[WAVE] Malformed waveform packet');
+        return;
+      }
+      if (packet.lostBefore > 0) {
+        console.warn(`[WAVE] ${packet.lostBefore} ${packet.channel} packet(s) lost before seq ${packet.seq}`);
+      }
+      onPacket?.(packet);
+    },
+  );
+  await sendControlCommand(device, mode === 'ecg_ppg' ? 'WAVE PPG' : 'WAVE ON');
+  return true;
+};
+
+const MODEL_XFER_WINDOW = 4; // frames the device queues between status reads
+const MODEL_XFER_POLLS = 50;
+let modelTransferId = 0;
+
+const readTransferStatus = async (device: Device): Promise<ModelTransferStatus | null> => {
+  const characteristic = await device.readCharacteristicForService(
+    LIFEBAND_SERVICE_UUID,
+    LIFEBAND_CONFIG_CHAR_UUID,
+  );
+  return characteristic.value ? decodeTransferStatus(characteristic.value) : null;
+};
+
+/**
+ * Poll until done() or failure; statuses of other transfers (the one a
+ * retry replaces, before the device has seen the new BEGIN) are ignored
+ */
+const waitForTransfer = async (
+  device: Device,
+  mine: (status: ModelTransferStatus) => boolean,
+  done: (status: ModelTransferStatus) => boolean,
+): Promise<ModelTransferStatus | null> => {
+  let status: ModelTransferStatus | null = null;
+  for (let i = 0; i < MODEL_XFER_POLLS; i++) {
+    const read = await readTransferStatus(device);
+    status = read && mine(read) ? read : null;
+    if (status && (status.state === 'failed' || done(status))) {
+      break;
+    }
+    await new Promise((resolve) => setTimeout(resolve, 100));
+  }
+  return status;
+};
+
+/**
+ * Upload a model image (convert_dense_models.py --image) into the device's
+ * inactive model slot. The device erases the slot first, one sector per
+ * heartbeat, and then reports 'receiving'. Frames are queued on the device,
+ * so the status is read after every few chunks and sending resumes from the
+ * offset the device actually received. The device activates the image once
+ * it has checked it; the returned status carries the version, or the error.
+ */
+export const uploadLifeBandModel = async (
+  model: LifeBandModel,
+  image: Buffer,
+  onProgress?: (sent: number, total: number) => void,
+): Promise<ModelTransferStatus | null> => {
+  const device = currentDevice;
+  if (!device) {
+    console.warn('[MODEL] No connected LifeBand');
+    return null;
+  }
+  const write = (frame: string) =>
+    device.writeCharacteristicWithResponseForService(LIFEBAND_SERVICE_UUID, LIFEBAND_CONFIG_CHAR_UUID, frame);
+
+  modelTransferId = (modelTransferId % 255) + 1;
+  const transferId = modelTransferId;
+  const mine = (s: ModelTransferStatus) => isTransferStatusFor(s, transferId, model, image);
+
+  try {
+    await write(encodeTransferBegin(model, image, transferId));
+    let status = await waitForTransfer(device, mine, (s) => s.state === 'receiving' && s.nextOffset === 0);
+    let offset = 0;
+    while (status?.state === 'receiving' && offset < image.length) {
+      for (let i = 0; i < MODEL_XFER_WINDOW && offset < image.length; i++) {
+        await write(encodeTransferData(image, offset));
+        offset += Math.min(MODEL_XFER_CHUNK, image.length - offset);
+      }
+      // Everything sent was programmed, or a dropped frame made a later one arrive out of order
+      status = await waitForTransfer(device, mine, (s) => s.nextOffset === offset || s.error === 'out of order');
+      if (status?.state === 'receiving') {
+        offset = status.nextOffset; // resume after dropped frames
+        onProgress?.(offset, image.length);
+      }
+    }
+    if (status?.state !== 'receiving') {
+      console.warn(`[MODEL] Upload of ${model} model failed: ${status?.error ?? 'no response'}`);
+      return status;
+    }
+    await write(encodeTransferEnd());
+    status = await waitForTransfer(device, mine, (s) => s.state === 'done');
+    console.log(
+      `[MODEL] ${model} model ${status?.state === 'done' ? `v${status.version} in slot ${status.slot}` : 'rejected'}` +
+        (status?.error ? ` (${status.error})` : ''),
+    );
+    return status;
+  } catch (error) {
+    console.warn(`[MODEL] Upload of ${model} model interrupted`, error);
+    await write(encodeTransferAbort()).catch(() => undefined);
+    return null;
+  }
+};
+
 export const disconnectLifeBand = async (): Promise<void> => {
   console.log('[BLE] Disconnecting LifeBand...');
   
@@ -475,6 +740,8 @@ export const scanAndConnectToLifeBand = async (
       console.warn('[BLE] Failed to send START command, continuing anyway');
       // Don't fail the connection - ESP32 auto-enables notifications
     }
+    await requestDeltaVitals(connected);
+    subscribeAlerts(connected);
 
     // Monitor disconnection with safe error handling
     connected.onDisconnected((error) => {
@@ -668,6 +935,8 @@ export const reconnectLifeBandById = async (
       const errorMsg = writeError.reason || writeError.message || 'Unknown error';
       console.warn('[BLE] Failed to send START command:', errorMsg);
     }
+    await requestDeltaVitals(device);
+    subscribeAlerts(device);
 
     // Monitor disconnection with safe error handling
     device.onDisconnected((error) => {
@@ -774,12 +1043,9 @@ export async function connectToNearestLifeBand(
               if (monitorError || !characteristic?.value) {
                 return;
               }
-              try {
-                const json = Buffer.from(characteristic.value, 'base64').toString('utf8');
-                const sample = JSON.parse(json) as LifeBandSample;
+              const sample = parseVitalsPayload(characteristic.value);
+              if (sample) {
                 onVitals(sample);
-              } catch (parseError) {
-                console.warn('Failed to parse vitals payload', parseError);
               }
             },
           );
@@ -0,0 +1,109 @@
+import { Buffer } from 'buffer';
+
+// Mirrors firmware/model_slots.h (transfer frames on the CONFIG characteristic)
+const XFER_BEGIN = 0xb0;
+const XFER_DATA = 0xb1;
+const XFER_END = 0xb2;
+const XFER_ABORT = 0xb3;
+const XFER_STATUS = 0xb5;
+const XFER_STATUS_SIZE = 20;
+export const MODEL_XFER_CHUNK = 177; // 185-byte MTU - 3 ATT - 5 frame header
+
+export type LifeBandModel = 'arrhythmia' | 'anemia' | 'preeclampsia';
+export type ModelTransferState = 'idle' | 'receiving' | 'done' | 'failed' | 'erasing';
+
+export interface ModelTransferStatus {
+  state: ModelTransferState;
+  model: number;
+  error: string | null;
+  slot: 'A' | 'B';
+  transferId: number; // echoed from the BEGIN this status answers
+  nextOffset: number;
+  version: number;
+  bytes: number;
+}
+
+const MODEL_TYPES: Record<LifeBandModel, number> = { arrhythmia: 0, anemia: 1, preeclampsia: 2 };
+const STATES: ModelTransferState[] = ['idle', 'receiving', 'done', 'failed', 'erasing'];
+const ERRORS = [null, 'no models partition', 'bad request', 'image too large', 'out of order',
+  'flash error', 'CRC mismatch', 'invalid image', 'activation failed'];
+
+const CRC_TABLE = (() => {
+  const table: number[] = [];
+  for (let n = 0; n < 256; n++) {
+    let c = n;
+    for (let k = 0; k < 8; k++) {
+      c = c & 1 ? 0xedb88320 ^ (c >>> 1) : c >>> 1;
+    }
+    table.push(c >>> 0);
+  }
+  return table;
+})();
+
+/**
+ * CRC-32 as used by the firmware and zlib
+ */
+export const crc32 = (data: Buffer): number => {
+  let crc = 0xffffffff;
+  for (let i = 0; i < data.length; i++) {
+    crc = CRC_TABLE[(crc ^ data[i]) & 0xff] ^ (crc >>> 8);
+  }
+  return (crc ^ 0xffffffff) >>> 0;
+};
+
+/**
+ * transferId (1..255) is echoed in every status for this upload, so a status
+ * left over from an earlier attempt can be told apart
+ */
+export const encodeTransferBegin = (model: LifeBandModel, image: Buffer, transferId: number): string => {
+  const frame = Buffer.alloc(11);
+  frame[0] = XFER_BEGIN;
+  frame[1] = MODEL_TYPES[model];
+  frame.writeUInt32LE(image.length, 2);
+  frame.writeUInt32LE(crc32(image), 6);
+  frame[10] = transferId;
+  return frame.toString('base64');
+};
+
+export const encodeTransferData = (image: Buffer, offset: number): string => {
+  const chunk = image.subarray(offset, offset + MODEL_XFER_CHUNK);
+  const frame = Buffer.alloc(5 + chunk.length);
+  frame[0] = XFER_DATA;
+  frame.writeUInt32LE(offset, 1);
+  chunk.copy(frame, 5);
+  return frame.toString('base64');
+};
+
+export const encodeTransferEnd = (): string => Buffer.from([XFER_END]).toString('base64');
+export const encodeTransferAbort = (): string => Buffer.from([XFER_ABORT]).toString('base64');
+
+/**
+ * Status read back from CONFIG; null until the device has published one
+ */
+export const decodeTransferStatus = (base64Value: string): ModelTransferStatus | null => {
+  const data = Buffer.from(base64Value, 'base64');
+  if (data.length < XFER_STATUS_SIZE || data[0] !== XFER_STATUS) {
+    return null;
+  }
+  return {
+    state: STATES[data[1]] ?? 'failed',
+    model: data[2],
+    error: data[3] < ERRORS.length ? ERRORS[data[3]] : `error ${data[3]}`,
+    slot: data[4] ? 'B' : 'A',
+    transferId: data[5],
+    nextOffset: data.readUInt32LE(8),
+    version: data.readUInt32LE(12),
+    bytes: data.readUInt32LE(16),
+  };
+};
+
+/**
+ * Whether a status belongs to the upload started with these BEGIN fields
+ */
+export const isTransferStatusFor = (
+  status: ModelTransferStatus,
+  transferId: number,
+  model: LifeBandModel,
+  image: Buffer,
+): boolean =>
+  status.transferId === transferId && status.model === MODEL_TYPES[model] && status.bytes === image.length;
@@ -0,0 +1,152 @@
+import { Buffer } from 'buffer';
+import { VitalsSample } from '../types/vitals';
+
+// Mirrors firmware/vitals_frame.h and firmware/lifeband_types.h (schema 2)
+export const VITALS_FRAME_MAGIC = 0x56;
+const VITALS_FRAME_HEADER = 4;
+const VITALS_FRAME_PAYLOAD_V1 = 38;
+const VITALS_FRAME_PAYLOAD_V2 = 42;
+
+const RHYTHM_NAMES = ['Normal', 'AFib', 'PVC', 'Bradycardia', 'Tachycardia', 'NoSignal'];
+const RISK_NAMES = ['Low', 'Moderate', 'High', 'Critical', 'Low-Moderate', 'Unknown'];
+const HR_SOURCE_NAMES = ['NONE', 'ECG', 'PPG'];
+const BP_METHOD_NAMES = ['ECG', 'PTT'];
+
+const ALERT_ARRHYTHMIA = 0x01;
+const ALERT_ANEMIA = 0x02;
+const ALERT_PREECLAMPSIA = 0x04;
+
+const FLAG_BUFFERED = 0x01;
+
+export const isVitalsFrame = (data: Buffer): boolean =>
+  data.length >= VITALS_FRAME_HEADER && data[0] === VITALS_FRAME_MAGIC && data[1] >= 1;
+
+/**
+ * Decode a binary vitals frame. Fields appended by newer schema versions are
+ * skipped using the payload length; truncated frames return null.
+ * The device timestamp is millis() since boot, so the receive time is used,
+ * less the frame's age for frames replayed from the device's offline log.
+ */
+export const decodeVitalsFrame = (data: Buffer): VitalsSample | null => {
+  if (!isVitalsFrame(data)) {
+    return null;
+  }
+  const payloadLength = data[2];
+  if (payloadLength < VITALS_FRAME_PAYLOAD_V1 || data.length < VITALS_FRAME_HEADER + payloadLength) {
+    return null;
+  }
+
+  const p = data.subarray(VITALS_FRAME_HEADER);
+  const sources = p[18];
+  const alerts = p[19];
+  const rr = p.readUInt16LE(10);
+  const ptt = p.readUInt16LE(14);
+  const spo2 = p[7];
+  const flags = p[27];
+  const ageMs = payloadLength >= VITALS_FRAME_PAYLOAD_V2 ? p.readUInt32LE(38) : 0;
+
+  return {
+    hr: p[4],
+    hr_ecg: p[5],
+    hr_ppg: p[6],
+    spo2: spo2 > 0 ? spo2 : undefined,
+    bp_sys: p[8],
+    bp_dia: p[9],
+    hrv: rr,
+    hrv_sdnn: p.readUInt16LE(12),
+    ptt,
+    ecg_quality: p[16],
+    ppg_quality: p[17],
+    hr_source: HR_SOURCE_NAMES[sources & 0x03] ?? 'NONE',
+    bp_method: BP_METHOD_NAMES[(sources >> 2) & 0x01],
+    rhythm: RHYTHM_NAMES[p[20]] ?? 'Unknown',
+    rhythm_confidence: p[21],
+    arrhythmia_alert: (alerts & ALERT_ARRHYTHMIA) !== 0,
+    anemia_risk: RISK_NAMES[p[22]] ?? 'Unknown',
+    anemia_confidence: p[23],
+    anemia_alert: (alerts & ALERT_ANEMIA) !== 0,
+    preeclampsia_risk: RISK_NAMES[p[24]] ?? 'Unknown',
+    preeclampsia_confidence: p[25],
+    preeclampsia_alert: (alerts & ALERT_PREECLAMPSIA) !== 0,
+    maternal_health_score: p[26],
+    ecg: p.readUInt16LE(28),
+    ir: p.readUInt32LE(30),
+    red: p.readUInt32LE(34),
+    timestamp: Date.now() - ageMs,
+    buffered: (flags & FLAG_BUFFERED) !== 0,
+  };
+};
+
+// Mirrors firmware/vitals_delta.h (version 1)
+export const VITALS_DELTA_MAGIC = 0x44;
+const VITALS_DELTA_KEYFRAME = 0x800000;
+
+// [offset in the schema-1 payload, size] per field bit: the delta fields are
+// the frame's fields in frame order, so they are patched into a full frame
+const DELTA_FIELDS: Array<[number, number]> = [
+  [0, 4], [4, 1], [5, 1], [6, 1], [7, 1], [8, 2], [10, 2], [12, 2], [14, 2], [16, 2],
+  [18, 1], [19, 1], [20, 2], [22, 2], [24, 2], [26, 1], [28, 2], [30, 4], [34, 4],
+];
+
+/**
+ * Fields the app shows: everything but the device clock and the raw PPG
+ * counts (CONFIG "FIELDS" mask, bits 1-16)
+ */
+export const APP_DELTA_FIELDS = 'FIELDS 0x1FFFE';
+
+export const isVitalsDelta = (data: Buffer): boolean =>
+  data.length >= VITALS_FRAME_HEADER + 3 && data[0] === VITALS_DELTA_MAGIC && data[1] >= 1;
+
+/**
+ * Stateful decoder for delta frames (CONFIG "FORMAT DELTA"): each frame's
+ * fields are applied to the last known values and the merged sample is
+ * returned. Returns null until the first keyframe and for truncated frames;
+ * fields unknown to this version are ignored.
+ */
+export class VitalsDeltaDecoder {
+  private state = Buffer.alloc(VITALS_FRAME_HEADER + VITALS_FRAME_PAYLOAD_V1);
+  private synced = false;
+
+  reset() {
+    this.state.fill(0);
+    this.synced = false;
+  }
+
+  decode(data: Buffer): VitalsSample | null {
+    if (!isVitalsDelta(data)) {
+      return null;
+    }
+    const end = VITALS_FRAME_HEADER + data[2];
+    if (data[2] < 3 || data.length < end) {
+      return null;
+    }
+    const mask = data[4] | (data[5] << 8) | (data[6] << 16);
+
+    let size = 0;
+    DELTA_FIELDS.forEach(([, fieldSize], field) => {
+      if (mask & (1 << field)) size += fieldSize;
+    });
+    if (VITALS_FRAME_HEADER + 3 + size > end) {
+      return null;
+    }
+
+    let pos = VITALS_FRAME_HEADER + 3;
+    DELTA_FIELDS.forEach(([offset, fieldSize], field) => {
+      if (mask & (1 << field)) {
+        data.copy(this.state, VITALS_FRAME_HEADER + offset, pos, pos + fieldSize);
+        pos += fieldSize;
+      }
+    });
+    if (mask & VITALS_DELTA_KEYFRAME) {
+      this.synced = true;
+    }
+    if (!this.synced) {
+      return null;
+    }
+
+    this.state[0] = VITALS_FRAME_MAGIC;
+    this.state[1] = 1;
+    this.state[2] = VITALS_FRAME_PAYLOAD_V1;
+    return decodeVitalsFrame(this.state);
+  }
+}
@@ -0,0 +1,65 @@
+import { Buffer } from 'buffer';
+import { WaveformChannel, WaveformPacket } from '../types/waveform';
+
+// Mirrors firmware/waveform_stream.h (packet version 1)
+const WAVE_PACKET_VERSION = 1;
+const WAVE_HEADER_SIZE = 10;
+
+const CHANNELS: WaveformChannel[] = ['ecg', 'ppg_ir', 'ppg_red'];
+
+const unZigZag = (u: number): number => (u >>> 1) ^ -(u & 1);
+
+/**
+ * Stateful decoder: keeps the expected sequence number per channel so
+ * dropped notifications are reported in `lostBefore`.
+ */
+export class WaveformDecoder {
+  private expectedSeq = new Map<number, number>();
+
+  reset() {
+    this.expectedSeq.clear();
+  }
+
+  decode(base64Value: string): WaveformPacket | null {
+    const data = Buffer.from(base64Value, 'base64');
+    if (data.length < WAVE_HEADER_SIZE + 1 || data[0] >> 4 !== WAVE_PACKET_VERSION) {
+      return null;
+    }
+
+    const channelId = data[0] & 0x0f;
+    const channel = CHANNELS[channelId];
+    if (!channel) {
+      return null;
+    }
+    const count = data[1];
+    const seq = data.readUInt16LE(2);
+    const firstIndex = data.readUInt32LE(4);
+    const sampleRate = data.readUInt16LE(8);
+
+    const samples: number[] = new Array(count);
+    let pos = WAVE_HEADER_SIZE;
+    let value = 0;
+    for (let i = 0; i < count; i++) {
+      let u = 0;
+      let shift = 0;
+      for (;;) {
+        if (pos >= data.length || shift > 28) {
+          return null;
+        }
+        const b = data[pos++];
+        u = (u | ((b & 0x7f) << shift)) >>> 0;
+        if (!(b & 0x80)) break;
+        shift += 7;
+      }
+      const delta = unZigZag(u);
+      value = i === 0 ? delta : (value + delta) | 0;
+      samples[i] = value;
+    }
+
+    const expected = this.expectedSeq.get(channelId);
+    const lostBefore = expected === undefined ? 0 : (seq - expected + 0x10000) & 0xffff;
+    this.expectedSeq.set(channelId, (seq + 1) & 0xffff);
+
+    return { channel, seq, firstIndex, sampleRate, samples, lostBefore };
+  }
+}
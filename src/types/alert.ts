@@ -0,0 +1,17 @@
+export type LifeBandAlertType = 'arrhythmia' | 'anemia' | 'preeclampsia' | 'severe_bp';
+
+export type LifeBandAlertSeverity = 'warning' | 'critical';
+
+export interface LifeBandAlert {
+  seq: number;            // Device sequence number (acknowledged back)
+  type: LifeBandAlertType;
+  severity: LifeBandAlertSeverity;
+  label: string;          // Rhythm or risk level that raised it
+  confidence: number;     // 0-100
+  hr: number;
+  spo2: number;
+  bp_sys: number;
+  bp_dia: number;
+  detectedAt: string;     // ISO time of detection on the device
+  retransmit: boolean;
+}
@@ -0,0 +1,12 @@
+export type WaveformChannel = 'ecg' | 'ppg_ir' | 'ppg_red';
+
+export type WaveformMode = 'off' | 'ecg' | 'ecg_ppg';
+
+export interface WaveformPacket {
+  channel: WaveformChannel;
+  seq: number;            // Per-channel packet sequence (wraps at 65536)
+  firstIndex: number;     // Device sample index of samples[0]
+  sampleRate: number;     // Hz
+  samples: number[];      // Raw ADC counts (ECG) or MAX30105 counts (PPG)
+  lostBefore: number;     // Packets missing between this one and the previous
+}